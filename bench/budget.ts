@@ -0,0 +1,131 @@
+import * as fs from "fs";
+import * as path from "path";
+
+import { Measurement } from "./metrics";
+
+export const BUDGET_FILE = path.join(__dirname, "budgets.json");
+export const RESULTS_DIR = path.join(__dirname, "results");
+
+// the counters Vert checks, those of the `BUDGETED_CODES` tables. `native_budget` records them with
+// the inline actions and checks all three exactly on the native backend, whose `eosio.token` and
+// `eosio.system` are stand-ins; on Vert they only have to stay within the budget
+const VERT_COUNTERS = ["ram_bytes", "db_ops"] as const;
+
+export type Budget = Partial<Pick<Measurement, "time_ms" | "inline_actions" | "ram_bytes" | "db_ops" | "host_calls" | "instructions">>;
+
+export interface BudgetFile {
+  // multiplies every `time_ms` budget, for slower CI machines
+  time_scale: number;
+  // slowdown allowed over a recorded median `time_ms`, 1.5 is 50%
+  time_tolerance: number;
+  scenarios: { [scenario: string]: Budget };
+}
+
+const update = process.env.BENCH_UPDATE === "1";
+const time_scale_env = Number(process.env.BENCH_TIME_SCALE ?? "1");
+
+export const loadBudgets = (): BudgetFile => {
+  if (!fs.existsSync(BUDGET_FILE)) {
+    return { time_scale: 1, time_tolerance: 1.5, scenarios: {} };
+  }
+  return { time_tolerance: 1.5, ...JSON.parse(fs.readFileSync(BUDGET_FILE, "utf8")) };
+}
+
+const results: { [scenario: string]: Measurement } = {};
+
+// scenarios run without a recorded `time_ms`, printed after the run
+export const missingTimes: string[] = [];
+
+/**
+ * Compare a measurement with its checked-in budget.
+ * Returns the list of exceeded budgets, empty when within budget.
+ * With `BENCH_UPDATE=1` the Vert part of the budget (time, host calls, instructions) is
+ * regenerated from the measurement instead; the counters are `native_budget --update`'s.
+ */
+export const checkBudget = (budgets: BudgetFile, scenario: string, m: Measurement): string[] => {
+  results[scenario] = m;
+  if (update) {
+    const profiled = Object.keys(m.host_calls).length > 0;
+    const metered = m.instructions > 0;
+    const previous = budgets.scenarios[scenario] ?? {};
+    budgets.scenarios[scenario] = {
+      // the median of a release build, the profile and metered builds run slower
+      time_ms: profiled || metered ? previous.time_ms : Number(m.time_ms.toFixed(3)),
+      inline_actions: previous.inline_actions,
+      ram_bytes: previous.ram_bytes,
+      db_ops: previous.db_ops,
+      // a release build prints no counters, keep those of the last profile run
+      host_calls: profiled ? m.host_calls : previous.host_calls,
+      // likewise the instructions of the last metered run
+      instructions: metered ? m.instructions : previous.instructions,
+    };
+    return [];
+  }
+
+  const budget = budgets.scenarios[scenario];
+  if (!budget) {
+    return [`${scenario}: no budget, record one with native_budget --update`];
+  }
+  const errors: string[] = [];
+  if (budget.time_ms === undefined) {
+    missingTimes.push(scenario);
+  } else {
+    const time_limit = budget.time_ms * budgets.time_tolerance * budgets.time_scale * time_scale_env;
+    if (m.time_ms > time_limit) {
+      errors.push(`${scenario}: time ${m.time_ms.toFixed(3)}ms > ${time_limit.toFixed(3)}ms `
+        + `(${budget.time_ms}ms x ${budgets.time_tolerance} tolerance)`);
+    }
+  }
+  // counted in the `BUDGETED_CODES` tables only, growth fails
+  for (const key of VERT_COUNTERS) {
+    const limit = budget[key];
+    const value = key == "ram_bytes" ? Math.max(m[key], 0) : m[key];
+    if (limit !== undefined && value > limit) {
+      errors.push(`${scenario}: ${key} ${value} > ${limit}`);
+    }
+  }
+  // host calls are only checked on the profile build, a call missing from the budget counts as a regression
+  if (budget.host_calls && Object.keys(m.host_calls).length > 0) {
+    for (const [call, count] of Object.entries(m.host_calls)) {
+      const limit = budget.host_calls[call] ?? 0;
+      if (count > limit) {
+        errors.push(`${scenario}: ${call} ${count} > ${limit}`);
+      }
+    }
+  }
+  // instructions are only checked on the metered build, and exactly: they do not depend on the machine
+  if (budget.instructions !== undefined && m.instructions > budget.instructions) {
+    errors.push(`${scenario}: instructions ${m.instructions} > ${budget.instructions}`);
+  }
+  return errors;
+}
+
+export const saveResults = (budgets: BudgetFile, name: string) => {
+  fs.mkdirSync(RESULTS_DIR, { recursive: true });
+  fs.writeFileSync(path.join(RESULTS_DIR, `${name}.json`), JSON.stringify(results, null, 2) + "\n");
+  if (update) {
+    const sorted: BudgetFile = { time_scale: budgets.time_scale, time_tolerance: budgets.time_tolerance, scenarios: {} };
+    for (const key of Object.keys(budgets.scenarios).sort()) {
+      sorted.scenarios[key] = budgets.scenarios[key];
+    }
+    fs.writeFileSync(BUDGET_FILE, JSON.stringify(sorted, null, 2) + "\n");
+  }
+}
+
+export const formatRow = (scenario: string, m: Measurement): string => {
+  const tables = Object.entries(m.ram)
+    .filter(([, bytes]) => bytes != 0)
+    .map(([table, bytes]) => `${table}=${bytes}`)
+    .join(" ");
+  const calls = Object.values(m.host_calls).reduce((a, b) => a + b, 0);
+  return `${scenario.padEnd(56)} ${m.time_ms.toFixed(3).padStart(9)}ms `
+    + `inline=${m.inline_actions} notify=${m.notifications} db=${m.db_ops} ram=${m.ram_bytes} `
+    + (calls > 0 ? `host=${calls} ` : "") + (m.instructions > 0 ? `ins=${m.instructions} ` : "") + tables;
+}
+
+// the `count` functions of the metered build that executed the most instructions, with their share
+export const formatHottest = (scenario: string, m: Measurement, count: number = 5): string[] =>
+  Object.entries(m.instruction_functions)
+    .sort(([, a], [, b]) => b - a)
+    .slice(0, count)
+    .map(([fn, n]) => `  ${scenario.padEnd(54)} ${n.toString().padStart(9)} ${(100 * n / m.instructions).toFixed(1).padStart(5)}%  ${fn}`);
@@ -0,0 +1,241 @@
+import * as path from "path";
+import { Blockchain, Account, AccountPermission } from "@proton/vert"
+import { TimePointSec, Authority, PermissionLevel, Name } from "@greymass/eosio";
+
+export const VAULT = "vault.defi";
+export const STOKEN = "stoken.defi";
+export const ADMIN = "admin.defi";
+export const AWARD = "award.defi";
+export const FEES = "vfees.defi";
+export const TOKENS = "tokens";
+export const PROXY = "proxy.defi";
+export const REX_SEEDER = "rexseeder";
+
+export const DAY = 86400;
+
+export interface ChainOptions {
+  // number of non-EOS collaterals created on the `tokens` contract
+  collaterals?: number;
+  // create the EOS collateral backed by REX
+  eos?: boolean;
+  // number of depositor accounts (user1, user2 ...)
+  users?: number;
+}
+
+export interface Chain {
+  blockchain: Blockchain;
+  vault: Account;
+  stoken: Account;
+  eosio: Account;
+  eosToken: Account;
+  tokens: Account;
+  users: string[];
+  // symbol codes of the non-EOS collaterals, in collateral id order
+  symbols: string[];
+}
+
+// wasm/abi paths (without extension) of the vault and stoken builds under test
+export interface ContractBuild {
+  vault: string;
+  stoken: string;
+}
+
+// `dir` laid out like `contracts/` after `yarn build`
+export const contractBuild = (dir: string): ContractBuild => ({
+  vault: path.join(dir, "vault", "vault"),
+  stoken: path.join(dir, "stoken", "stoken"),
+});
+
+// `BENCH_BUILD=build/profile` benchmarks the host-call counting build of `yarn build:profile`,
+// `BENCH_BUILD=build/meter` the instruction counting build of `yarn build:meter`
+export const DEFAULT_BUILD = contractBuild(process.env.BENCH_BUILD ?? "contracts");
+
+export const scopeOf = (account: string): bigint => Name.from(account).value.value;
+
+// `account@active` satisfied by the inline actions of `codes`
+export const codePermission = (account: Account, ...codes: string[]) => {
+  account.setPermissions([AccountPermission.from({
+    parent: "owner",
+    perm_name: "active",
+    required_auth: Authority.from({
+      threshold: 1,
+      accounts: codes.sort().map(code => ({
+        weight: 1,
+        permission: PermissionLevel.from(`${code}@eosio.code`)
+      }))
+    })
+  })]);
+}
+
+// TA, TB ... TZ, TAA, TAB ... so that `S` + code stays a valid symbol code
+export const collateralSymbol = (index: number): string => {
+  const letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  let code = "";
+  let n = index;
+  do {
+    code = letters[n % 26] + code;
+    n = Math.floor(n / 26) - 1;
+  } while (n >= 0);
+  return `T${code}`;
+}
+
+export const userName = (index: number): string => {
+  // account names only allow a-z, 1-5 and '.'
+  const digits = "abcdefghijklmnopqrstuvwxyz12345";
+  let suffix = "";
+  let n = index;
+  do {
+    suffix = digits[n % digits.length] + suffix;
+    n = Math.floor(n / digits.length);
+  } while (n > 0);
+  return `user.${suffix}`;
+}
+
+/**
+ * Create the accounts, contracts and permissions of the bench chain on
+ * `blockchain`, without pushing any action. Shared by `createChain`,
+ * snapshot restore and trace replay, which passes the build to compare.
+ */
+export const deployChain = (blockchain: Blockchain, users: string[], build: ContractBuild = DEFAULT_BUILD): Chain => {
+  const eosio = blockchain.createContract("eosio", "tests/eosio/eosio.system", true);
+  const eosToken = blockchain.createContract("eosio.token", "tests/eosio/eosio.token", true);
+  blockchain.createContract("eosio.reserv", "tests/eosio/rex.results");
+  const tokens = blockchain.createContract(TOKENS, "tests/eosio/eosio.token");
+  const stoken = blockchain.createContract(STOKEN, build.stoken, true);
+  const vault = blockchain.createContract(VAULT, build.vault, true);
+
+  blockchain.createAccounts("eosio.rex", "eosio.stake", "eosio.ram", "eosio.ramfee",
+    "eosio.saving", "eosio.bpay", "eosio.vpay", "eosio.names", ADMIN, FEES, PROXY, REX_SEEDER);
+  const award = blockchain.createAccount(AWARD);
+  codePermission(award, AWARD, VAULT);
+  codePermission(vault, STOKEN, VAULT);
+  codePermission(eosio, "eosio");
+
+  if (users.length > 0) {
+    blockchain.createAccounts(...users);
+  }
+  return { blockchain, vault, stoken, eosio, eosToken, tokens, users, symbols: [] as string[] };
+}
+
+/**
+ * Build a fresh chain with the system contract, REX, stoken, vault and
+ * `collaterals` test tokens already wired up.
+ */
+export const createChain = async (options: ChainOptions = {}): Promise<Chain> => {
+  const collateral_count = options.collaterals ?? 1;
+  const user_count = options.users ?? 2;
+
+  const blockchain = new Blockchain();
+  blockchain.setTime(TimePointSec.from(new Date("2023-01-01T00:00:00Z")));
+
+  const users: string[] = [];
+  for (let i = 0; i < user_count; i++) {
+    users.push(userName(i));
+  }
+  const { vault, stoken, eosio, eosToken, tokens } = deployChain(blockchain, users);
+
+  // core token and system
+  await eosToken.actions.create(["eosio", "10000000000.0000 EOS"]).send("eosio.token@active");
+  await eosToken.actions.issue(["eosio", "10000000000.0000 EOS", "init"]).send("eosio@active");
+  await eosio.actions.init([0, "4,EOS"]).send("eosio@active");
+
+  // REX needs a voter with a proxy, and an existing pool before the vault can buy
+  await eosio.actions.regproxy([PROXY, true]).send(`${PROXY}@active`);
+  for (const account of [REX_SEEDER, VAULT]) {
+    await eosToken.actions.transfer(["eosio", account, "1000.0000 EOS", "init"]).send("eosio@active");
+    await eosio.actions.delegatebw([account, account, "1.0000 EOS", "1.0000 EOS", false]).send(`${account}@active`);
+  }
+  await eosio.actions.voteproducer([REX_SEEDER, PROXY, []]).send(`${REX_SEEDER}@active`);
+  await eosio.actions.deposit([REX_SEEDER, "100.0000 EOS"]).send(`${REX_SEEDER}@active`);
+  await eosio.actions.buyrex([REX_SEEDER, "100.0000 EOS"]).send(`${REX_SEEDER}@active`);
+  await vault.actions.proxyto([PROXY]).send(`${ADMIN}@active`);
+
+  // balances
+  await eosToken.actions.transfer(["eosio", AWARD, "200000.0000 EOS", "init"]).send("eosio@active");
+  for (const user of users) {
+    await eosToken.actions.transfer(["eosio", user, "1000000.0000 EOS", "init"]).send("eosio@active");
+  }
+
+  const symbols: string[] = [];
+  for (let i = 0; i < collateral_count; i++) {
+    const sym = collateralSymbol(i);
+    symbols.push(sym);
+    await tokens.actions.create([TOKENS, `10000000000.0000 ${sym}`]).send(`${TOKENS}@active`);
+    await tokens.actions.issue([TOKENS, `10000000000.0000 ${sym}`, "init"]).send(`${TOKENS}@active`);
+    await tokens.actions.transfer([TOKENS, AWARD, `200000.0000 ${sym}`, "init"]).send(`${TOKENS}@active`);
+    for (const user of users) {
+      await tokens.actions.transfer([TOKENS, user, `1000000.0000 ${sym}`, "init"]).send(`${TOKENS}@active`);
+    }
+    await createCollateral({ vault } as Chain, TOKENS, sym);
+  }
+  if (options.eos ?? true) {
+    await createCollateral({ vault } as Chain, "eosio.token", "EOS");
+  }
+
+  // first income call only sets last_income_time
+  await vault.actions.income().send();
+
+  return { blockchain, vault, stoken, eosio, eosToken, tokens, users, symbols };
+}
+
+export const createCollateral = async (chain: Pick<Chain, "vault">, contract: string, sym: string) => {
+  await chain.vault.actions.createcoll({
+    "contract": contract,
+    "sym": `4,${sym}`,
+    "income_account": AWARD,
+    "fees_account": FEES,
+    "min_quantity": `0.1000 ${sym}`,
+    "income_ratio": 50,
+    "release_fees": 30,
+    "refund_ratio": 5000
+  }).send(`${ADMIN}@active`);
+}
+
+export const tokenOf = (chain: Chain, sym: string): Account => {
+  return sym === "EOS" ? chain.eosToken : chain.tokens;
+}
+
+export const deposit = (chain: Chain, user: string, quantity: string) => {
+  const sym = quantity.split(" ")[1];
+  return tokenOf(chain, sym).actions.transfer([user, VAULT, quantity, ""]).send(`${user}@active`);
+}
+
+export const withdraw = (chain: Chain, user: string, quantity: string) => {
+  return chain.stoken.actions.transfer([user, VAULT, quantity, ""]).send(`${user}@active`);
+}
+
+export const release = (chain: Chain, user: string) => {
+  return chain.vault.actions.release([user]).send(`${user}@active`);
+}
+
+export const income = (chain: Chain) => {
+  return chain.vault.actions.income().send();
+}
+
+export const addTime = (chain: Chain, seconds: number) => {
+  chain.blockchain.addTime(TimePointSec.from(seconds));
+}
+
+/**
+ * Let the vault buy REX on `days` distinct days so its `rexbal` row carries
+ * that many maturity buckets.
+ */
+export const buildMaturities = async (chain: Chain, user: string, days: number) => {
+  for (let i = 0; i < days; i++) {
+    await deposit(chain, user, "10.0000 EOS");
+    addTime(chain, DAY);
+  }
+}
+
+/**
+ * Queue `count` pending releases for `user` on the collateral `sym`.
+ */
+export const buildReleases = async (chain: Chain, user: string, sym: string, count: number) => {
+  if (count == 0) {
+    return;
+  }
+  await deposit(chain, user, `${count}.0000 ${sym}`);
+  for (let i = 0; i < count; i++) {
+    await withdraw(chain, user, `0.5000 S${sym}`);
+  }
+}
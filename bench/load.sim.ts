@@ -0,0 +1,144 @@
+import * as fs from "fs";
+import * as path from "path";
+
+import { Chain, createChain, deposit, withdraw, release, income, addTime } from "./chain";
+import { Measurement, measure, ROW_OVERHEAD } from "./metrics";
+import { RESULTS_DIR } from "./budget";
+import { FIXTURES_DIR, TableSize, takeSnapshot, restoreChain, saveSnapshot, readSnapshot, tableSizes } from "./snapshot";
+import { LoadGenerator } from "./load";
+
+const list = (value: string | undefined, fallback: number[]) =>
+  value ? value.split(",").map(Number) : fallback;
+
+// state sizes to measure at, ascending, each grows from the previous one
+const USERS = list(process.env.LOAD_USERS, [100, 1000]);
+// pending releases per user at every scale
+const PENDING_PER_USER = Number(process.env.LOAD_PENDING_PER_USER ?? "2");
+const COLLATERALS = Number(process.env.LOAD_COLLATERALS ?? "8");
+const SEED = Number(process.env.LOAD_SEED ?? "1");
+// samples per probed action, the median is reported
+const PROBES = Number(process.env.LOAD_PROBES ?? "5");
+// rebuild fixtures even when a snapshot file exists
+const REBUILD = process.env.LOAD_REBUILD === "1";
+
+// growing 100k users takes hours, loading its snapshot seconds
+const TIMEOUT = 24 * 3600 * 1000;
+
+interface ScaleReport {
+  users: number;
+  pending: number;
+  // seconds spent growing the state, or restoring it from a fixture
+  build_s: number;
+  restored: boolean;
+  tables: { [table: string]: TableSize };
+  actions: { [action: string]: Measurement };
+}
+
+const fixtureFile = (users: number) =>
+  path.join(FIXTURES_DIR, `load-c${COLLATERALS}-u${users}-p${PENDING_PER_USER}-s${SEED}.json.gz`);
+
+const median = (runs: Measurement[]): Measurement => {
+  const sorted = [...runs].sort((a, b) => a.time_ms - b.time_ms);
+  return sorted[Math.floor(sorted.length / 2)];
+}
+
+/**
+ * Probe each action `PROBES` times against random users of the current state.
+ * Probes do change the state slightly, they run after the fixture is saved.
+ */
+const probe = async (chain: Chain, gen: LoadGenerator): Promise<{ [action: string]: Measurement }> => {
+  const users = chain.users;
+  const sym = chain.symbols[chain.symbols.length - 1];
+  const runs: { [action: string]: Measurement[] } = {};
+  const run = async (action: string, fn: () => Promise<any>) => {
+    (runs[action] ??= []).push(await measure(chain.blockchain, fn));
+  };
+
+  for (let i = 0; i < PROBES; i++) {
+    const user = users[(i * 7919) % users.length];
+    await run("deposit", () => deposit(chain, user, `10.0000 ${sym}`));
+    await run("withdraw", () => withdraw(chain, user, `1.0000 S${sym}`));
+    addTime(chain, 600);
+    await run("income", () => income(chain));
+  }
+  gen.matureReleases();
+  for (let i = 0; i < PROBES; i++) {
+    const user = users[(i * 7919) % users.length];
+    await run("release", () => release(chain, user));
+  }
+
+  const result: { [action: string]: Measurement } = {};
+  for (const [action, measured] of Object.entries(runs)) {
+    result[action] = median(measured);
+  }
+  return result;
+}
+
+const format = (report: ScaleReport): string => {
+  const rows = [`users=${report.users} pending=${report.pending} `
+    + `${report.restored ? "restored" : "built"} in ${report.build_s.toFixed(1)}s`];
+  for (const [table, size] of Object.entries(report.tables).sort()) {
+    rows.push(`  ${table.padEnd(32)} rows=${size.rows} bytes=${size.bytes}`);
+  }
+  for (const [action, m] of Object.entries(report.actions)) {
+    rows.push(`  ${action.padEnd(32)} ${m.time_ms.toFixed(3).padStart(9)}ms `
+      + `inline=${m.inline_actions} db=${m.db_ops} ram=${m.ram_bytes}`);
+  }
+  return rows.join("\n");
+}
+
+// cost ratio between consecutive scales, ~1 means the action does not depend on state size
+const growth = (reports: ScaleReport[]): string[] => {
+  const rows: string[] = [];
+  for (let i = 1; i < reports.length; i++) {
+    const [a, b] = [reports[i - 1], reports[i]];
+    const ratios = Object.keys(b.actions).map(action => {
+      const ratio = b.actions[action].time_ms / Math.max(a.actions[action]?.time_ms ?? 0, 1e-3);
+      return `${action}=${ratio.toFixed(2)}x`;
+    });
+    rows.push(`users ${a.users} -> ${b.users}: ${ratios.join(" ")}`);
+  }
+  return rows;
+}
+
+describe("load", () => {
+  const reports: ScaleReport[] = [];
+
+  afterAll(() => {
+    fs.mkdirSync(RESULTS_DIR, { recursive: true });
+    fs.writeFileSync(path.join(RESULTS_DIR, "load.json"), JSON.stringify(reports, null, 2) + "\n");
+    console.log([...reports.map(format), ...growth(reports)].join("\n"));
+  });
+
+  let chain: Chain | undefined;
+  let gen: LoadGenerator | undefined;
+
+  for (const users of USERS) {
+    it(`users=${users}`, async () => {
+      const target = { users, pending: users * PENDING_PER_USER };
+      const file = fixtureFile(users);
+      const start = process.hrtime.bigint();
+
+      const snapshot = REBUILD ? undefined : readSnapshot(file);
+      let restored = false;
+      if (snapshot) {
+        chain = restoreChain(snapshot);
+        gen = new LoadGenerator(chain, SEED + users);
+        gen.pendingReleases = snapshot.meta.pending ?? 0;
+        restored = true;
+      } else {
+        if (!chain) {
+          chain = await createChain({ collaterals: COLLATERALS, eos: false, users: 0 });
+          gen = new LoadGenerator(chain, SEED);
+        }
+        await gen!.grow(target);
+        saveSnapshot(takeSnapshot(chain, { pending: gen!.pendingReleases, stats: gen!.stats }), file);
+      }
+      const build_s = Number(process.hrtime.bigint() - start) / 1e9;
+
+      const tables = tableSizes(takeSnapshot(chain), ROW_OVERHEAD);
+      const actions = await probe(chain, gen!);
+      reports.push({ users, pending: gen!.pendingReleases, build_s, restored, tables, actions });
+    }, TIMEOUT);
+  }
+});
@@ -0,0 +1,188 @@
+import { Chain, deposit, withdraw, release, income, addTime, tokenOf, userName, DAY, TOKENS } from "./chain";
+
+export interface LoadTarget {
+  // total depositor accounts
+  users: number;
+  // pending (unreleased) withdrawals across all users
+  pending: number;
+}
+
+export interface TrafficMix {
+  deposit: number;
+  withdraw: number;
+  release: number;
+  income: number;
+}
+
+// rough mix of production traffic, weights need not sum to one
+export const DEFAULT_MIX: TrafficMix = { deposit: 0.5, withdraw: 0.25, release: 0.15, income: 0.1 };
+
+export interface LoadStats {
+  actions: number;
+  failed: number;
+  deposits: number;
+  withdraws: number;
+  releases: number;
+  incomes: number;
+}
+
+// releases mature this long after the withdraw, see `vault::do_withdraw`
+const RELEASE_DELAY = 5 * DAY;
+
+/**
+ * mulberry32, so a given seed always produces the same traffic and fixtures
+ * are reproducible.
+ */
+export const random = (seed: number) => {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  }
+}
+
+/**
+ * Drives mixed deposit/withdraw/release/income traffic through the vault and
+ * grows the chain state towards a `LoadTarget`. Users are created and funded
+ * lazily on their first deposit so the setup cost stays proportional to the
+ * traffic.
+ */
+export class LoadGenerator {
+  readonly stats: LoadStats = { actions: 0, failed: 0, deposits: 0, withdraws: 0, releases: 0, incomes: 0 };
+
+  private rand: () => number;
+  // symbols each user holds shares of
+  private holdings = new Map<string, Set<string>>();
+  private funded = new Set<string>();
+  private pending = 0;
+
+  constructor(readonly chain: Chain, seed = 1, readonly mix: TrafficMix = DEFAULT_MIX) {
+    this.rand = random(seed);
+  }
+
+  // restored fixtures carry the count in their snapshot metadata
+  get pendingReleases() { return this.pending; }
+  set pendingReleases(count: number) { this.pending = count; }
+
+  private pick<T>(items: T[]): T {
+    return items[Math.floor(this.rand() * items.length)];
+  }
+
+  private collaterals(): string[] {
+    return this.chain.symbols.length > 0 ? this.chain.symbols : ["EOS"];
+  }
+
+  private async fund(user: string, sym: string) {
+    const key = `${user}:${sym}`;
+    if (this.funded.has(key)) {
+      return;
+    }
+    const from = sym === "EOS" ? "eosio" : TOKENS;
+    await tokenOf(this.chain, sym).actions.transfer([from, user, `100000.0000 ${sym}`, "load"]).send(`${from}@active`);
+    this.funded.add(key);
+  }
+
+  private async run(fn: () => Promise<any>): Promise<boolean> {
+    this.stats.actions++;
+    try {
+      await fn();
+      return true;
+    } catch (e) {
+      // traffic is random, an occasional rejected action (no shares left, nothing matured) is expected
+      this.stats.failed++;
+      return false;
+    }
+  }
+
+  // time advances with the traffic so releases mature and income accrues
+  private tick(seconds: number) {
+    addTime(this.chain, seconds);
+  }
+
+  async addUser(): Promise<string> {
+    const user = userName(this.chain.users.length);
+    this.chain.blockchain.createAccounts(user);
+    this.chain.users.push(user);
+    await this.deposit(user);
+    return user;
+  }
+
+  async deposit(user: string) {
+    const sym = this.pick(this.collaterals());
+    await this.fund(user, sym);
+    const amount = (1 + Math.floor(this.rand() * 100)).toFixed(4);
+    if (await this.run(() => deposit(this.chain, user, `${amount} ${sym}`))) {
+      this.stats.deposits++;
+      if (!this.holdings.has(user)) this.holdings.set(user, new Set());
+      this.holdings.get(user)!.add(sym);
+    }
+  }
+
+  async withdraw(user: string) {
+    const held = [...(this.holdings.get(user) ?? [])];
+    if (held.length == 0) {
+      return this.deposit(user);
+    }
+    const sym = this.pick(held);
+    if (await this.run(() => withdraw(this.chain, user, `0.2000 S${sym}`))) {
+      this.stats.withdraws++;
+      this.pending++;
+    }
+  }
+
+  async release(user: string, matured: number) {
+    if (await this.run(() => release(this.chain, user))) {
+      this.stats.releases++;
+      this.pending = Math.max(0, this.pending - matured);
+    }
+  }
+
+  async income() {
+    this.tick(600);
+    if (await this.run(() => income(this.chain))) {
+      this.stats.incomes++;
+    }
+  }
+
+  /**
+   * One action drawn from the traffic mix against a random existing user.
+   * `keepPending` suppresses releases while the pending target is not reached.
+   */
+  async step(keepPending: boolean) {
+    const user = this.pick(this.chain.users);
+    const { deposit, withdraw, release, income } = this.mix;
+    const r = this.rand() * (deposit + withdraw + release + income);
+    if (r < deposit) {
+      await this.deposit(user);
+    } else if (r < deposit + withdraw) {
+      await this.withdraw(user);
+    } else if (r < deposit + withdraw + release) {
+      if (!keepPending) await this.release(user, 1);
+    } else {
+      await this.income();
+    }
+  }
+
+  /**
+   * Grow the chain until it holds `target.users` depositors and about
+   * `target.pending` pending releases, interleaving mixed traffic.
+   */
+  async grow(target: LoadTarget) {
+    while (this.chain.users.length < target.users) {
+      await this.addUser();
+      await this.step(this.pending < target.pending);
+    }
+    // top up the pending queue with withdrawals spread over random users
+    while (this.pending < target.pending) {
+      await this.withdraw(this.pick(this.chain.users));
+    }
+  }
+
+  // let every pending release mature, e.g. before probing `release`
+  matureReleases() {
+    this.tick(RELEASE_DELAY + 1);
+  }
+}
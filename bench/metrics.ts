@@ -0,0 +1,220 @@
+import * as fs from "fs";
+import { Blockchain } from "@proton/vert"
+
+import { DEFAULT_BUILD, STOKEN, VAULT } from "./chain";
+
+// nodeos bills this many bytes of RAM per table row on top of the row data
+export const ROW_OVERHEAD = 112;
+
+export interface Measurement {
+  // wall-clock execution time of the transaction in milliseconds
+  time_ms: number;
+  // actions executed besides the one pushed (inline sends, notifications excluded)
+  inline_actions: number;
+  // notifications (require_recipient) delivered
+  notifications: number;
+  // RAM delta in bytes, keyed by `code:table`
+  ram: { [table: string]: number };
+  // RAM delta in bytes of the `BUDGETED_CODES` tables
+  ram_bytes: number;
+  // row inserts, updates and removes in the `BUDGETED_CODES` tables
+  db_ops: number;
+  // host function calls keyed by `receiver:function`, profile build only (see `hostCalls`)
+  host_calls: { [call: string]: number };
+  // executed wasm instructions, metered build only (see `instructionCounts`)
+  instructions: number;
+  // the same keyed by `receiver:function`
+  instruction_functions: { [fn: string]: number };
+}
+
+// `ram_bytes` and `db_ops` count the rows of the contracts under test, `ram` still lists every
+// table. eosio.token and eosio.system are stand-ins on the native chain, so only these counters
+// can be checked there against bench/budgets.json (tools/native/native_budget.cpp).
+export const BUDGETED_CODES = [VAULT, STOKEN];
+
+// the tracing members of the @proton/vert `Blockchain` the bench reads
+interface VertTracing {
+  enableStorageDeltas(): void;
+  clearStorageDeltas(): void;
+  getStorageDeltas(): StorageDelta[];
+  executionTraces: ExecutionTrace[];
+  console: string;
+}
+
+interface StorageDelta {
+  tableId: { code: any; scope: any; table: any };
+  // absent on insert
+  oldValue?: any;
+  // absent on remove
+  newValue?: any;
+}
+
+interface ExecutionTrace {
+  contract: any;
+  isInline: boolean;
+  isNotification: boolean;
+  console?: string;
+}
+
+interface Delta {
+  code: string;
+  table: string;
+  bytes: number;
+}
+
+const str = (value: any): string => value === undefined || value === null ? "" : value.toString();
+
+const byteLength = (value: any): number => {
+  if (typeof value === "string") return value.length / 2;   // hex encoded row
+  if (value.length !== undefined) return value.length;
+  if (value.array !== undefined) return value.array.length;  // Bytes
+  throw new Error(`storage delta row of unknown type: ${Object.keys(value)}`);
+}
+
+/**
+ * The tracing API of `blockchain`, throws when the installed Vert lacks any
+ * of it: counters read from missing traces would all be 0 and pass every budget.
+ */
+export const vertTracing = (blockchain: Blockchain): VertTracing => {
+  const chain = blockchain as any;
+  for (const fn of ["enableStorageDeltas", "clearStorageDeltas", "getStorageDeltas"]) {
+    if (typeof chain[fn] !== "function") {
+      throw new Error(`@proton/vert has no Blockchain.${fn}(), the bench needs storage deltas`);
+    }
+  }
+  if (!Array.isArray(chain.executionTraces)) {
+    throw new Error("@proton/vert has no Blockchain.executionTraces, the bench needs execution traces");
+  }
+  return chain as VertTracing;
+}
+
+const toDelta = (delta: StorageDelta): Delta => {
+  if (!delta.tableId || (delta.oldValue === undefined && delta.newValue === undefined)) {
+    throw new Error(`storage delta of unknown shape: ${Object.keys(delta)}`);
+  }
+  const code = str(delta.tableId.code);
+  const table = str(delta.tableId.table);
+  if (delta.oldValue === undefined) {
+    return { code, table, bytes: byteLength(delta.newValue) + ROW_OVERHEAD };
+  }
+  if (delta.newValue === undefined) {
+    return { code, table, bytes: -(byteLength(delta.oldValue) + ROW_OVERHEAD) };
+  }
+  return { code, table, bytes: byteLength(delta.newValue) - byteLength(delta.oldValue) };
+}
+
+const HOST_CALLS = /#hostcalls ([a-z1-5.]+) (\{[^}\n]*\})/g;
+const INSTRUCTIONS = /#instructions ([a-z1-5.]+) (\{[^}\n]*\})/g;
+
+// the console of every action trace, or of the transaction when the traces carry none
+const consoleText = (traces: ExecutionTrace[], console_output: string): string => {
+  const consoles = traces.map(trace => str(trace.console));
+  return consoles.some(c => c !== "") ? consoles.join("\n") : console_output;
+}
+
+/**
+ * Sum the `#hostcalls` trailers the profile build prints at the end of every
+ * action (contracts/profile/host_profile.hpp).
+ */
+export const hostCalls = (traces: ExecutionTrace[], console_output: string = ""): { [call: string]: number } => {
+  const calls: { [call: string]: number } = {};
+  const text = consoleText(traces, console_output);
+  for (const [, receiver, counts] of text.matchAll(HOST_CALLS)) {
+    for (const [fn, count] of Object.entries(JSON.parse(counts) as { [fn: string]: number })) {
+      const key = `${receiver}:${fn}`;
+      calls[key] = (calls[key] ?? 0) + count;
+    }
+  }
+  return calls;
+}
+
+// function names of the metered build by receiver, from the `<contract>.names.json` of `wasm_meter`
+const functionNames: { [receiver: string]: { [index: string]: string } } = {};
+
+const namesOf = (receiver: string): { [index: string]: string } => {
+  if (!(receiver in functionNames)) {
+    const base = receiver == VAULT ? DEFAULT_BUILD.vault : receiver == STOKEN ? DEFAULT_BUILD.stoken : "";
+    const file = `${base}.names.json`;
+    functionNames[receiver] = base && fs.existsSync(file) ? JSON.parse(fs.readFileSync(file, "utf8")) : {};
+  }
+  return functionNames[receiver];
+}
+
+/**
+ * Sum the `#instructions` trailers the metered build prints at the end of every
+ * action (tools/wasmmeter/meter.hpp) per function, keyed by `receiver:function`.
+ * Functions without a name keep their index, `f212`.
+ */
+export const instructionCounts = (traces: ExecutionTrace[], console_output: string = ""): { [fn: string]: number } => {
+  const counts: { [fn: string]: number } = {};
+  for (const [, receiver, trailer] of consoleText(traces, console_output).matchAll(INSTRUCTIONS)) {
+    const names = namesOf(receiver);
+    for (const [index, count] of Object.entries(JSON.parse(trailer) as { [index: string]: number })) {
+      const key = `${receiver}:${names[index] ?? `f${index}`}`;
+      counts[key] = (counts[key] ?? 0) + count;
+    }
+  }
+  return counts;
+}
+
+/**
+ * Run `fn` (a single transaction push) and collect its cost from the chain traces.
+ */
+export const measure = async (blockchain: Blockchain, fn: () => Promise<any>): Promise<Measurement> => {
+  const chain = vertTracing(blockchain);
+  chain.enableStorageDeltas();
+  chain.clearStorageDeltas();
+
+  const start = process.hrtime.bigint();
+  await fn();
+  const time_ms = Number(process.hrtime.bigint() - start) / 1e6;
+
+  const traces = chain.executionTraces;
+  if (traces.length == 0) {
+    throw new Error("the measured transaction left no execution trace");
+  }
+  let inline_actions = 0;
+  let notifications = 0;
+  for (const trace of traces) {
+    if (trace.isNotification) {
+      notifications++;
+    } else if (trace.isInline) {
+      inline_actions++;
+    }
+  }
+
+  const ram: { [table: string]: number } = {};
+  let ram_bytes = 0;
+  let db_ops = 0;
+  for (const delta of chain.getStorageDeltas().map(toDelta)) {
+    const key = `${delta.code}:${delta.table}`;
+    ram[key] = (ram[key] ?? 0) + delta.bytes;
+    if (BUDGETED_CODES.includes(delta.code)) {
+      ram_bytes += delta.bytes;
+      db_ops++;
+    }
+  }
+  chain.clearStorageDeltas();
+
+  const host_calls = hostCalls(traces, str(chain.console));
+  const instruction_functions = instructionCounts(traces, str(chain.console));
+  const instructions = Object.values(instruction_functions).reduce((a, b) => a + b, 0);
+  return { time_ms, inline_actions, notifications, ram, ram_bytes, db_ops, host_calls, instructions, instruction_functions };
+}
+
+/**
+ * Measure `fn` `runs` times, `prepare` runs before each sample outside the
+ * measured window. Counters come from the last run, time is the median.
+ */
+export const sample = async (blockchain: Blockchain, runs: number,
+  prepare: (run: number) => Promise<any>, fn: (run: number) => Promise<any>): Promise<Measurement> => {
+  const times: number[] = [];
+  let last: Measurement | undefined;
+  for (let run = 0; run < runs; run++) {
+    await prepare(run);
+    last = await measure(blockchain, () => fn(run));
+    times.push(last.time_ms);
+  }
+  times.sort((a, b) => a - b);
+  return { ...(last as Measurement), time_ms: times[Math.floor(times.length / 2)] };
+}
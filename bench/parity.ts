@@ -0,0 +1,153 @@
+import * as fs from "fs";
+import * as os from "os";
+import * as path from "path";
+import { execFileSync } from "child_process";
+import { Blockchain, Account } from "@proton/vert"
+import { Name, PermissionLevel, TimePointSec } from "@greymass/eosio";
+
+import { Chain, codePermission } from "./chain";
+import { takeSnapshot } from "./snapshot";
+
+export const SCENARIOS_DIR = path.join(__dirname, "..", "tests", "scenarios");
+
+// built by `cmake --build build/tools`, see tools/README.txt
+export const NATIVE_RUN = process.env.NATIVE_RUN
+  ?? path.join(__dirname, "..", "build", "tools", "native", "native_run");
+
+// wasm of every contract kind a scenario can deploy
+const WASM: { [kind: string]: string } = {
+  vault: "contracts/vault/vault",
+  stoken: "contracts/stoken/stoken",
+  token: "tests/eosio/eosio.token",
+  system: "tests/eosio/eosio.system",
+  results: "tests/eosio/rex.results",
+};
+
+export interface Step {
+  contract?: string;
+  action?: string;
+  auth?: string[];
+  data?: any[];
+  // substring of the expected assertion message
+  error?: string;
+  wait?: number;
+}
+
+export interface DumpSpec {
+  code: string;
+  table: string;
+  scopes: (string | number)[];
+}
+
+// format of tests/scenarios/*.json, described in tools/native/scenario.hpp
+export interface Scenario {
+  time: number;
+  accounts: string[];
+  contracts: { [account: string]: string };
+  privileged?: string[];
+  code_permissions?: { [actor: string]: string[] };
+  steps: Step[];
+  dump: DumpSpec[];
+}
+
+export interface StepResult {
+  ok: boolean;
+  expected: boolean;
+  error: string;
+}
+
+export interface Outcome {
+  results: StepResult[];
+  // JSON lines `{"code","scope","table","hex"}`, as `native_run --dump` writes them
+  rows: string[];
+}
+
+export const scenarioFiles = (): string[] =>
+  fs.readdirSync(SCENARIOS_DIR).filter(f => f.endsWith(".json")).sort().map(f => path.join(SCENARIOS_DIR, f));
+
+export const readScenario = (file: string): Scenario => JSON.parse(fs.readFileSync(file, "utf8"));
+
+const expected = (step: Step, ok: boolean, error: string) =>
+  step.error === undefined ? ok : !ok && error.includes(step.error);
+
+const scopeValue = (scope: string | number): bigint =>
+  typeof scope === "number" ? BigInt(scope) : Name.from(scope).value.value;
+
+const dumpLine = (spec: DumpSpec, scope: string | number, hex: string) =>
+  `{"code":"${spec.code}","scope":${JSON.stringify(scope)},"table":"${spec.table}","hex":"${hex}"}`;
+
+/**
+ * Run `scenario` on Vert with the wasm contracts and the real system
+ * contract. `privileged` is not needed there, Vert does not check the
+ * authorization of inline actions sent by `eosio`.
+ */
+export const runVert = async (scenario: Scenario): Promise<Outcome> => {
+  const blockchain = new Blockchain();
+  blockchain.setTime(TimePointSec.fromInteger(scenario.time));
+  const contracts: { [account: string]: Account } = {};
+  for (const [account, kind] of Object.entries(scenario.contracts)) {
+    contracts[account] = blockchain.createContract(account, WASM[kind], true);
+  }
+  const accounts: { [account: string]: Account } = { ...contracts };
+  for (const account of blockchain.createAccounts(...scenario.accounts)) {
+    accounts[account.name.toString()] = account;
+  }
+  for (const [actor, codes] of Object.entries(scenario.code_permissions ?? {})) {
+    codePermission(accounts[actor], ...codes);
+  }
+
+  const results: StepResult[] = [];
+  for (const step of scenario.steps) {
+    if (step.wait) {
+      blockchain.addTime(TimePointSec.from(step.wait));
+      results.push({ ok: true, expected: true, error: "" });
+      continue;
+    }
+    const auth = (step.auth ?? []).map(a => a.includes("@") ? a : `${a}@active`);
+    let ok = true;
+    let error = "";
+    try {
+      const action = contracts[step.contract!].actions[step.action!](step.data ?? []);
+      await action.send(auth.length == 1 ? auth[0] : auth.map(a => PermissionLevel.from(a)) as any);
+    } catch (e: any) {
+      ok = false;
+      error = e.message ?? String(e);
+    }
+    results.push({ ok, expected: expected(step, ok, error), error });
+  }
+
+  const snapshot = takeSnapshot({ blockchain, users: [], symbols: [] } as unknown as Chain);
+  const rows: string[] = [];
+  for (const spec of scenario.dump) {
+    for (const scope of spec.scopes) {
+      const value = scopeValue(scope).toString();
+      snapshot.rows
+        .filter(([code, s, table]) => code == spec.code && s == value && table == spec.table)
+        .sort((a, b) => (BigInt(a[3]) < BigInt(b[3]) ? -1 : BigInt(a[3]) > BigInt(b[3]) ? 1 : 0))
+        .forEach(row => rows.push(dumpLine(spec, scope, row[5].toLowerCase())));
+    }
+  }
+  return { results, rows };
+}
+
+/**
+ * Run the scenario file with the native backend, `native_run` exits non-zero
+ * when a step does not go as expected, the outcome is read either way.
+ */
+export const runNative = (file: string): Outcome => {
+  const dump = path.join(os.tmpdir(), `parity.${process.pid}.${path.basename(file, ".json")}.jsonl`);
+  let stdout: string;
+  try {
+    stdout = execFileSync(NATIVE_RUN, ["--dump", dump, file], { encoding: "utf8" });
+  } catch (e: any) {
+    if (e.stdout === undefined) throw e;
+    stdout = e.stdout;
+  }
+  const results: StepResult[] = stdout.split("\n").filter(l => l.trim()).map(l => {
+    const r = JSON.parse(l);
+    return { ok: r.ok, expected: r.expected, error: r.error };
+  });
+  const rows = fs.existsSync(dump) ? fs.readFileSync(dump, "utf8").split("\n").filter(l => l.trim()) : [];
+  fs.rmSync(dump, { force: true });
+  return { results, rows };
+}
@@ -0,0 +1,243 @@
+import * as fs from "fs";
+import * as zlib from "zlib";
+import { Blockchain } from "@proton/vert"
+import { Name, PermissionLevel, TimePointSec } from "@greymass/eosio";
+
+import { Chain, ContractBuild, deployChain, STOKEN, VAULT } from "./chain";
+import { Measurement, measure, vertTracing } from "./metrics";
+import { Snapshot, loadSnapshot } from "./snapshot";
+
+/**
+ * One top-level action of a recorded stream. Inline actions and
+ * notifications are not replayed, the contracts send them again.
+ */
+export interface TraceAction {
+  // chain time in seconds, the chain is moved forward to it before the push
+  time?: number;
+  account: string;
+  name: string;
+  authorization: string[];
+  // ABI field object, or positional arguments
+  data: any;
+}
+
+export interface ActionCost {
+  count: number;
+  failed: number;
+  time_p50_ms: number;
+  time_p99_ms: number;
+  time_max_ms: number;
+  // inline actions plus notifications
+  fanout_p50: number;
+  fanout_max: number;
+  ram_p99: number;
+  ram_total: number;
+  db_ops_p99: number;
+}
+
+export interface ReplayReport {
+  build: ContractBuild;
+  actions: number;
+  failed: number;
+  // errors by message, to tell a broken build from a trace the snapshot cannot satisfy
+  errors: { [message: string]: number };
+  costs: { [key: string]: ActionCost };
+}
+
+const str = (value: any): string => value === undefined || value === null ? "" : value.toString();
+
+const timeOf = (value: any): number | undefined => {
+  if (value === undefined || value === null) return undefined;
+  if (typeof value === "number") return value;
+  // Hyperion and state history timestamps carry no zone, they are UTC
+  const text = /[zZ]|[+-]\d\d:\d\d$/.test(value) ? value : `${value}Z`;
+  return Math.floor(Date.parse(text) / 1000);
+}
+
+const authOf = (auth: any): string =>
+  typeof auth === "string" ? (auth.includes("@") ? auth : `${auth}@active`) : `${auth.actor}@${auth.permission}`;
+
+/**
+ * Accept the flat `TraceAction` layout as well as history exports where the
+ * action sits under `act` (Hyperion `get_actions`, dfuse, state history).
+ * Returns undefined for inline actions and notification receipts.
+ */
+export const parseTraceLine = (line: string): TraceAction | undefined => {
+  const record = JSON.parse(line);
+  const act = record.act ?? record.action ?? record;
+  if (Number(record.creator_action_ordinal ?? 0) > 0 || record.inline === true) return undefined;
+  const receiver = str(record.receiver ?? record.receipt?.receiver);
+  if (receiver !== "" && receiver !== str(act.account)) return undefined;
+  return {
+    time: timeOf(record.time ?? record["@timestamp"] ?? record.timestamp ?? record.block_time),
+    account: str(act.account),
+    name: str(act.name),
+    authorization: (act.authorization ?? []).map(authOf),
+    data: act.data,
+  };
+}
+
+// JSON lines, gzipped when the file name ends in `.gz`
+export const readTrace = (file: string, limit = Infinity): TraceAction[] => {
+  const raw = fs.readFileSync(file);
+  const text = (file.endsWith(".gz") ? zlib.gunzipSync(raw) : raw).toString("utf8");
+  const actions: TraceAction[] = [];
+  for (const line of text.split("\n")) {
+    if (actions.length >= limit) break;
+    if (!line.trim()) continue;
+    const action = parseTraceLine(line);
+    if (action) actions.push(action);
+  }
+  return actions;
+}
+
+const field = (data: any, name: string, index: number) => Array.isArray(data) ? data[index] : data?.[name];
+
+/**
+ * Cost bucket of an action: transfers into the vault are deposits (share
+ * transfers are withdraws), vault actions keep their name, anything else is
+ * `account:name`.
+ */
+export const costKey = (action: TraceAction): string => {
+  if (action.name === "transfer" && str(field(action.data, "to", 1)) === VAULT) {
+    return action.account === STOKEN ? "withdraw" : "deposit";
+  }
+  return action.account === VAULT ? action.name : `${action.account}:${action.name}`;
+}
+
+/**
+ * Restore `snapshot` on a fresh chain running `build`. Token contracts that
+ * appear in the trace or own `stat` rows in the snapshot but are not part of
+ * the bench chain are deployed as `eosio.token`, accounts the trace touches
+ * are created, so a production snapshot and its action stream replay as is.
+ */
+export const replayChain = (snapshot: Snapshot, trace: TraceAction[], build: ContractBuild): Chain => {
+  const blockchain = new Blockchain();
+  const chain = deployChain(blockchain, snapshot.users, build);
+  const exists = (account: string) => blockchain.getAccount(Name.from(account)) !== undefined;
+
+  const tokens = new Set<string>();
+  for (const [code, , table] of snapshot.rows) {
+    if (table === "stat") tokens.add(code);
+  }
+  for (const action of trace) {
+    if (action.name === "transfer") tokens.add(action.account);
+  }
+  for (const token of tokens) {
+    if (!exists(token)) blockchain.createContract(token, "tests/eosio/eosio.token");
+  }
+
+  const accounts = new Set<string>();
+  for (const action of trace) {
+    action.authorization.forEach(auth => accounts.add(auth.split("@")[0]));
+    if (action.name === "transfer") accounts.add(str(field(action.data, "to", 1)));
+  }
+  for (const account of accounts) {
+    if (account !== "" && !exists(account)) blockchain.createAccount(account);
+  }
+
+  loadSnapshot(chain, snapshot);
+  return chain;
+}
+
+// nearest rank, `sorted` ascending
+const percentile = (sorted: number[], p: number): number =>
+  sorted.length == 0 ? 0 : sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil(p * sorted.length) - 1))];
+
+const summarize = (runs: Measurement[], failed: number): ActionCost => {
+  const ascending = (values: number[]) => [...values].sort((a, b) => a - b);
+  const times = ascending(runs.map(m => m.time_ms));
+  const fanout = ascending(runs.map(m => m.inline_actions + m.notifications));
+  const ram = ascending(runs.map(m => m.ram_bytes));
+  const db = ascending(runs.map(m => m.db_ops));
+  return {
+    count: runs.length,
+    failed,
+    time_p50_ms: percentile(times, 0.5),
+    time_p99_ms: percentile(times, 0.99),
+    time_max_ms: percentile(times, 1),
+    fanout_p50: percentile(fanout, 0.5),
+    fanout_max: percentile(fanout, 1),
+    ram_p99: percentile(ram, 0.99),
+    ram_total: ram.reduce((a, b) => a + b, 0),
+    db_ops_p99: percentile(db, 0.99),
+  };
+}
+
+/**
+ * Push every action of `trace` in order on `chain`, each as its own
+ * transaction, and collect its cost. Failed actions are counted and
+ * skipped, their cost is not part of the distributions.
+ */
+export const replay = async (chain: Chain, trace: TraceAction[], build: ContractBuild): Promise<ReplayReport> => {
+  const blockchain = chain.blockchain as any;
+  const runs: { [key: string]: Measurement[] } = {};
+  const failures: { [key: string]: number } = {};
+  const errors: { [message: string]: number } = {};
+  let failed = 0;
+  // a failed action is skipped, a Vert without traces fails the replay
+  vertTracing(chain.blockchain);
+
+  for (const action of trace) {
+    const now = Math.floor(blockchain.timestamp.toMilliseconds() / 1000);
+    if (action.time !== undefined && action.time > now) {
+      chain.blockchain.setTime(TimePointSec.from(action.time));
+    }
+    const key = costKey(action);
+    const contract = blockchain.getAccount(Name.from(action.account));
+    try {
+      const push = contract.actions[action.name](action.data);
+      const auth = action.authorization.map(a => PermissionLevel.from(a));
+      const m = await measure(chain.blockchain, () => push.send(auth));
+      (runs[key] ??= []).push(m);
+    } catch (e: any) {
+      failed++;
+      failures[key] = (failures[key] ?? 0) + 1;
+      const message = str(e.message ?? e).split("\n")[0];
+      errors[message] = (errors[message] ?? 0) + 1;
+    }
+  }
+
+  const costs: { [key: string]: ActionCost } = {};
+  for (const key of [...new Set([...Object.keys(runs), ...Object.keys(failures)])].sort()) {
+    costs[key] = summarize(runs[key] ?? [], failures[key] ?? 0);
+  }
+  return { build, actions: trace.length, failed, errors, costs };
+}
+
+/**
+ * Regressions of `current` against `base`: time percentiles beyond
+ * `tolerance` times the base, and any growth of the deterministic counters
+ * or of the failure count.
+ */
+export const compareReports = (base: ReplayReport, current: ReplayReport, tolerance: number): string[] => {
+  const regressions: string[] = [];
+  for (const [key, cur] of Object.entries(current.costs)) {
+    const old = base.costs[key];
+    if (!old) continue;
+    for (const metric of ["time_p50_ms", "time_p99_ms"] as const) {
+      if (cur[metric] > old[metric] * tolerance) {
+        regressions.push(`${key}: ${metric} ${cur[metric].toFixed(3)} > ${old[metric].toFixed(3)} x ${tolerance}`);
+      }
+    }
+    for (const metric of ["fanout_max", "ram_p99", "db_ops_p99", "failed"] as const) {
+      if (cur[metric] > old[metric]) {
+        regressions.push(`${key}: ${metric} ${cur[metric]} > ${old[metric]}`);
+      }
+    }
+  }
+  return regressions;
+}
+
+export const formatReport = (report: ReplayReport): string => {
+  const rows = [`${report.build.vault}: ${report.actions} actions, ${report.failed} failed`];
+  for (const [key, c] of Object.entries(report.costs)) {
+    rows.push(`  ${key.padEnd(32)} n=${String(c.count).padStart(6)} failed=${c.failed} `
+      + `p50=${c.time_p50_ms.toFixed(3)}ms p99=${c.time_p99_ms.toFixed(3)}ms max=${c.time_max_ms.toFixed(3)}ms `
+      + `fanout=${c.fanout_p50}/${c.fanout_max} ram.p99=${c.ram_p99} ram=${c.ram_total} db.p99=${c.db_ops_p99}`);
+  }
+  for (const [message, count] of Object.entries(report.errors).sort((a, b) => b[1] - a[1]).slice(0, 5)) {
+    rows.push(`  error x${count}: ${message}`);
+  }
+  return rows.join("\n");
+}
@@ -0,0 +1,145 @@
+import { Chain, createChain, collateralSymbol, createCollateral, deposit, withdraw, release, income,
+  addTime, buildMaturities, buildReleases, DAY, TOKENS, VAULT } from "./chain";
+import { Measurement, sample } from "./metrics";
+import { loadBudgets, checkBudget, saveResults, formatRow, formatHottest, missingTimes } from "./budget";
+
+const RUNS = Number(process.env.BENCH_RUNS ?? "5");
+
+const COLLATERALS = [1, 8, 32];
+const PENDING = [0, 16, 128];
+const MATURITIES = [1, 4];
+
+const budgets = loadBudgets();
+const rows: string[] = [];
+const hottest: string[] = [];
+
+const record = (scenario: string, m: Measurement) => {
+  rows.push(formatRow(scenario, m));
+  hottest.push(...formatHottest(scenario, m));
+  expect(checkBudget(budgets, scenario, m)).toEqual([]);
+}
+
+afterAll(() => {
+  saveResults(budgets, "scenarios");
+  console.log(rows.join("\n"));
+  if (hottest.length > 0) {
+    console.log(["hottest functions, metered build:", ...hottest].join("\n"));
+  }
+  if (missingTimes.length > 0) {
+    console.warn([`no time budget for ${missingTimes.length} scenarios, record them with BENCH_UPDATE=1:`,
+      ...missingTimes.map(scenario => `  ${scenario}`)].join("\n"));
+  }
+});
+
+describe("vault.defi", () => {
+  for (const n of COLLATERALS) {
+    it(`createcoll collaterals=${n}`, async () => {
+      const chain = await createChain({ collaterals: n, eos: false });
+      const m = await sample(chain.blockchain, RUNS, async (run) => {
+        const sym = collateralSymbol(n + run);
+        await chain.tokens.actions.create([TOKENS, `10000000000.0000 ${sym}`]).send(`${TOKENS}@active`);
+      }, (run) => createCollateral(chain, TOKENS, collateralSymbol(n + run)));
+      record(`createcoll collaterals=${n}`, m);
+    });
+
+    it(`deposit/token collaterals=${n}`, async () => {
+      const chain = await createChain({ collaterals: n, eos: false });
+      // the last collateral is the worst case for the linear collateral lookup
+      const sym = chain.symbols[n - 1];
+      const m = await sample(chain.blockchain, RUNS, async () => { },
+        () => deposit(chain, chain.users[0], `100.0000 ${sym}`));
+      record(`deposit/token collaterals=${n}`, m);
+    });
+
+    it(`income collaterals=${n}`, async () => {
+      const chain = await createChain({ collaterals: n, eos: false });
+      const m = await sample(chain.blockchain, RUNS, async () => addTime(chain, 600), () => income(chain));
+      record(`income collaterals=${n}`, m);
+    });
+
+    // the first tick of a day adds a `ratehistory` row per collateral
+    it(`income/new day collaterals=${n}`, async () => {
+      const chain = await createChain({ collaterals: n, eos: false });
+      const m = await sample(chain.blockchain, RUNS, async () => addTime(chain, DAY), () => income(chain));
+      record(`income/new day collaterals=${n}`, m);
+    });
+  }
+
+  for (const p of PENDING) {
+    it(`withdraw pending=${p}`, async () => {
+      const chain = await createChain({ collaterals: 1, eos: false });
+      const [user] = chain.users;
+      const sym = chain.symbols[0];
+      await buildReleases(chain, user, sym, p);
+      await deposit(chain, user, `100.0000 ${sym}`);
+      const m = await sample(chain.blockchain, RUNS, async () => { },
+        () => withdraw(chain, user, `1.0000 S${sym}`));
+      record(`withdraw pending=${p}`, m);
+    });
+
+    it(`release/token pending=${p}`, async () => {
+      const chain = await createChain({ collaterals: 1, eos: false });
+      const [user] = chain.users;
+      const sym = chain.symbols[0];
+      await buildReleases(chain, user, sym, p + RUNS);
+      addTime(chain, 6 * DAY);
+      const m = await sample(chain.blockchain, RUNS, async () => { }, () => release(chain, user));
+      record(`release/token pending=${p}`, m);
+    });
+  }
+
+  for (const l of MATURITIES) {
+    it(`deposit/eos maturities=${l}`, async () => {
+      const chain = await createChain({ collaterals: 0, eos: true });
+      const [user] = chain.users;
+      await buildMaturities(chain, user, l);
+      const m = await sample(chain.blockchain, RUNS, async () => { },
+        () => deposit(chain, user, "10.0000 EOS"));
+      record(`deposit/eos maturities=${l}`, m);
+    });
+
+    it(`release/eos maturities=${l}`, async () => {
+      const chain = await createChain({ collaterals: 0, eos: true });
+      const [user] = chain.users;
+      await deposit(chain, user, "1000.0000 EOS");
+      addTime(chain, 6 * DAY);
+      await buildMaturities(chain, user, l);
+      const m = await sample(chain.blockchain, RUNS, async () => {
+        await withdraw(chain, user, "10.0000 SEOS");
+        addTime(chain, 6 * DAY);
+      }, () => release(chain, user));
+      record(`release/eos maturities=${l}`, m);
+    });
+  }
+});
+
+describe("stoken.defi", () => {
+  let chain: Chain;
+  let sym: string;
+
+  beforeAll(async () => {
+    chain = await createChain({ collaterals: 1, eos: false });
+    sym = `S${chain.symbols[0]}`;
+    await deposit(chain, chain.users[0], `1000.0000 ${chain.symbols[0]}`);
+  });
+
+  it("issue", async () => {
+    const m = await sample(chain.blockchain, RUNS, async () => { },
+      () => chain.stoken.actions.issue([chain.users[1], `1.0000 ${sym}`, "bench"]).send(`${VAULT}@active`));
+    record("stoken/issue", m);
+  });
+
+  it("transfer", async () => {
+    const [from, to] = chain.users;
+    const m = await sample(chain.blockchain, RUNS, async () => { },
+      () => chain.stoken.actions.transfer([from, to, `1.0000 ${sym}`, "bench"]).send(`${from}@active`));
+    record("stoken/transfer", m);
+  });
+
+  it("retire", async () => {
+    const m = await sample(chain.blockchain, RUNS,
+      () => chain.stoken.actions.issue([VAULT, `1.0000 ${sym}`, "bench"]).send(`${VAULT}@active`),
+      () => chain.stoken.actions.retire([`1.0000 ${sym}`, "bench"]).send(`${VAULT}@active`));
+    record("stoken/retire", m);
+  });
+});
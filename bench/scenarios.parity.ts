@@ -0,0 +1,19 @@
+import * as path from "path";
+
+import { scenarioFiles, readScenario, runVert, runNative } from "./parity";
+
+// every scenario on Vert and on the native backend: same step outcomes, same rows
+describe("native parity", () => {
+  for (const file of scenarioFiles()) {
+    it(path.basename(file, ".json"), async () => {
+      const scenario = readScenario(file);
+      const vert = await runVert(scenario);
+      const native = runNative(file);
+
+      // a step Vert does not run as the scenario says shows up with its index and error
+      expect(vert.results.map((r, step) => ({ step, ...r })).filter(r => !r.expected)).toEqual([]);
+      expect(native.results.map(r => r.ok)).toEqual(vert.results.map(r => r.ok));
+      expect(native.rows).toEqual(vert.rows);
+    });
+  }
+});
@@ -0,0 +1,142 @@
+import * as fs from "fs";
+import * as path from "path";
+import * as zlib from "zlib";
+import { Blockchain } from "@proton/vert"
+import { Name, TimePointSec } from "@greymass/eosio";
+
+import { Chain, deployChain } from "./chain";
+
+export const FIXTURES_DIR = path.join(__dirname, "fixtures");
+
+// bump when the row layout of any contract or the snapshot format changes
+const SNAPSHOT_VERSION = 1;
+
+// [code, scope, table, primary key, payer, hex encoded row]
+type SnapshotRow = [string, string, string, string, string, string];
+
+export interface Snapshot {
+  version: number;
+  // chain time in seconds
+  time: number;
+  users: string[];
+  symbols: string[];
+  // free-form data of the tool that wrote the snapshot
+  meta: { [key: string]: any };
+  rows: SnapshotRow[];
+}
+
+export interface TableSize {
+  rows: number;
+  // row data plus the per-row overhead nodeos bills
+  bytes: number;
+}
+
+const str = (value: any): string => value === undefined || value === null ? "" : value.toString();
+
+const nameOf = (value: any): string => {
+  if (value === undefined || value === null) return "";
+  if (typeof value === "bigint" || typeof value === "number") return Name.from(value.toString()).toString();
+  if (value.value !== undefined && typeof value.toString === "function") return value.toString();
+  return str(value);
+}
+
+const toHex = (value: any): string => {
+  if (typeof value === "string") return value;
+  if (value.hexString !== undefined) return value.hexString;
+  const bytes: Uint8Array = value.array ?? value;
+  return Buffer.from(bytes).toString("hex");
+}
+
+// Vert keeps every contract table in `blockchain.store`, its field names
+// changed across releases, accept any of them.
+const storeOf = (blockchain: Blockchain): any => (blockchain as any).store;
+
+const tablesOf = (store: any): any[] => {
+  const tables = store.tables ?? store._tables ?? store.tableMap ?? [];
+  return tables instanceof Map ? [...tables.values()] : Array.isArray(tables) ? tables : Object.values(tables);
+}
+
+const rowsOf = (table: any): any[] => {
+  const rows = table.rows ?? table.data ?? table.primaryIndex ?? [];
+  return rows instanceof Map ? [...rows.values()] : Array.isArray(rows) ? rows : Object.values(rows);
+}
+
+const rowValue = (row: any): any => row.value ?? row.data ?? row.buffer;
+
+/**
+ * Dump every contract table row of `chain` together with the chain time
+ * and the user/collateral lists the bench helpers need.
+ */
+export const takeSnapshot = (chain: Chain, meta: { [key: string]: any } = {}): Snapshot => {
+  const rows: SnapshotRow[] = [];
+  for (const table of tablesOf(storeOf(chain.blockchain))) {
+    const code = nameOf(table.code);
+    const scope = str(table.scope);
+    const name = nameOf(table.table ?? table.name);
+    for (const row of rowsOf(table)) {
+      rows.push([code, scope, name, str(row.primaryKey ?? row.primary_key ?? row.key),
+        nameOf(row.payer ?? table.payer), toHex(rowValue(row))]);
+    }
+  }
+  const time = Math.floor((chain.blockchain as any).timestamp.toMilliseconds() / 1000);
+  return { version: SNAPSHOT_VERSION, time, users: [...chain.users], symbols: [...chain.symbols], meta, rows };
+}
+
+/**
+ * Replace the table contents of `chain` with `snapshot`.
+ */
+export const loadSnapshot = (chain: Chain, snapshot: Snapshot) => {
+  if (snapshot.version !== SNAPSHOT_VERSION) {
+    throw new Error(`snapshot version ${snapshot.version}, expected ${SNAPSHOT_VERSION}`);
+  }
+  const blockchain = chain.blockchain;
+  const store = storeOf(blockchain);
+  blockchain.resetTables();
+  for (const [code, scope, table, primaryKey, payer, value] of snapshot.rows) {
+    const codeName = Name.from(code);
+    const tableName = Name.from(table);
+    const tab = store.findTable(codeName, BigInt(scope), tableName)
+      ?? store.createTable(codeName, BigInt(scope), tableName, Name.from(payer));
+    tab.set(BigInt(primaryKey), Name.from(payer), Buffer.from(value, "hex"));
+  }
+  blockchain.setTime(TimePointSec.from(snapshot.time));
+  chain.users.splice(0, chain.users.length, ...snapshot.users);
+  chain.symbols.splice(0, chain.symbols.length, ...snapshot.symbols);
+}
+
+/**
+ * Build a chain from a snapshot: deploy the contracts and accounts, then
+ * load the rows, without replaying any action.
+ */
+export const restoreChain = (snapshot: Snapshot): Chain => {
+  const blockchain = new Blockchain();
+  const chain = deployChain(blockchain, snapshot.users);
+  loadSnapshot(chain, snapshot);
+  return chain;
+}
+
+export const saveSnapshot = (snapshot: Snapshot, file: string) => {
+  fs.mkdirSync(path.dirname(file), { recursive: true });
+  fs.writeFileSync(file, zlib.gzipSync(JSON.stringify(snapshot)));
+}
+
+export const readSnapshot = (file: string): Snapshot | undefined => {
+  if (!fs.existsSync(file)) {
+    return undefined;
+  }
+  return JSON.parse(zlib.gunzipSync(fs.readFileSync(file)).toString("utf8"));
+}
+
+/**
+ * Row count and billed bytes per `code:table`, summed over all scopes.
+ */
+export const tableSizes = (snapshot: Snapshot, overhead: number): { [table: string]: TableSize } => {
+  const sizes: { [table: string]: TableSize } = {};
+  for (const [code, , table, , , value] of snapshot.rows) {
+    const key = `${code}:${table}`;
+    const size = sizes[key] ?? (sizes[key] = { rows: 0, bytes: 0 });
+    size.rows++;
+    size.bytes += value.length / 2 + overhead;
+  }
+  return sizes;
+}
@@ -0,0 +1,57 @@
+import * as fs from "fs";
+import * as path from "path";
+
+import { contractBuild } from "./chain";
+import { RESULTS_DIR } from "./budget";
+import { readSnapshot } from "./snapshot";
+import { ReplayReport, readTrace, replayChain, replay, compareReports, formatReport } from "./replay";
+
+// JSON lines of top-level actions, see `parseTraceLine`
+const TRACE = process.env.REPLAY_TRACE;
+// table snapshot the trace starts from, as written by `saveSnapshot`
+const SNAPSHOT = process.env.REPLAY_SNAPSHOT;
+// contracts directory of the build under test
+const BUILD = process.env.REPLAY_BUILD ?? "contracts";
+// contracts directory of a second build to replay and compare against
+const BASE_BUILD = process.env.REPLAY_BASE_BUILD;
+// or the results file of an earlier run
+const BASELINE = process.env.REPLAY_BASELINE;
+// allowed time ratio before a percentile counts as a regression
+const TOLERANCE = Number(process.env.REPLAY_TOLERANCE ?? "1.25");
+const LIMIT = Number(process.env.REPLAY_LIMIT ?? "Infinity");
+
+const TIMEOUT = 24 * 3600 * 1000;
+
+const run = async (dir: string): Promise<ReplayReport> => {
+  const snapshot = readSnapshot(SNAPSHOT!);
+  if (!snapshot) throw new Error(`cannot read ${SNAPSHOT}`);
+  const trace = readTrace(TRACE!, LIMIT);
+  const build = contractBuild(dir);
+  return replay(replayChain(snapshot, trace, build), trace, build);
+}
+
+const save = (name: string, report: ReplayReport) => {
+  fs.mkdirSync(RESULTS_DIR, { recursive: true });
+  fs.writeFileSync(path.join(RESULTS_DIR, `${name}.json`), JSON.stringify(report, null, 2) + "\n");
+}
+
+describe("replay", () => {
+  (TRACE && SNAPSHOT ? it : it.skip)(path.basename(TRACE ?? "REPLAY_TRACE unset"), async () => {
+    let base: ReplayReport | undefined;
+    if (BASE_BUILD) {
+      base = await run(BASE_BUILD);
+      save("replay-base", base);
+      console.log(formatReport(base));
+    } else if (BASELINE) {
+      base = JSON.parse(fs.readFileSync(BASELINE, "utf8"));
+    }
+
+    const report = await run(BUILD);
+    save("replay", report);
+    console.log(formatReport(report));
+
+    if (base) {
+      expect(compareReports(base, report, TOLERANCE)).toEqual([]);
+    }
+  }, TIMEOUT);
+});
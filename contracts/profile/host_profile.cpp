@@ -0,0 +1,18 @@
+#include "host_profile.hpp"
+
+// the counting definitions, see host_profile.hpp
+extern "C" {
+
+#define HOST_PROFILE_IMPORT(fn, ret, params, args) \
+    __attribute__((import_module("env"), import_name(#fn))) ret host_profile_real_##fn params;
+HOST_PROFILE_CALLS(HOST_PROFILE_IMPORT)
+#undef HOST_PROFILE_IMPORT
+
+#define HOST_PROFILE_SHIM(fn, ret, params, args)  \
+    ret fn params {                               \
+        host_profile::counts[host_profile::fn]++; \
+        return host_profile_real_##fn args;       \
+    }
+HOST_PROFILE_CALLS(HOST_PROFILE_SHIM)
+#undef HOST_PROFILE_SHIM
+}
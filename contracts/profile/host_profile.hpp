@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Host-call counters of the profile build (`yarn build:profile`).
+ *
+ * The header is force included ahead of the eosio headers (`-include
+ * host_profile.hpp -DCONTRACT_PROFILE`) and `host_profile.cpp` is linked next
+ * to the contract. The eosio headers declare the table, inline action and
+ * notification host functions as C imports in `eosio::internal_use_do_not_use`
+ * and leave them untouched. `host_profile.cpp` defines C functions of the same
+ * names, which the linker binds those calls to ahead of the imports, and each
+ * counts the call before forwarding it to the real import. The contract object
+ * prints the counts of its action when it goes out of scope:
+ *
+ *     #hostcalls vault.defi {"db_find_i64":4,"db_get_i64":3,"send_inline":2}
+ *
+ * `bench/metrics.ts` collects the trailers of every action of a transaction.
+ * A release build never sees this header.
+ */
+
+// name, return type, parameters, arguments
+#define HOST_PROFILE_CALLS(X)                                                                                           \
+    X(db_find_i64, int32_t, (uint64_t code, uint64_t scope, uint64_t table, uint64_t id), (code, scope, table, id))     \
+    X(db_lowerbound_i64, int32_t, (uint64_t code, uint64_t scope, uint64_t table, uint64_t id),                         \
+      (code, scope, table, id))                                                                                         \
+    X(db_upperbound_i64, int32_t, (uint64_t code, uint64_t scope, uint64_t table, uint64_t id),                         \
+      (code, scope, table, id))                                                                                         \
+    X(db_end_i64, int32_t, (uint64_t code, uint64_t scope, uint64_t table), (code, scope, table))                       \
+    X(db_get_i64, int32_t, (int32_t itr, const void *data, uint32_t len), (itr, data, len))                             \
+    X(db_next_i64, int32_t, (int32_t itr, uint64_t *primary), (itr, primary))                                           \
+    X(db_previous_i64, int32_t, (int32_t itr, uint64_t *primary), (itr, primary))                                       \
+    X(db_store_i64, int32_t, (uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void *data,            \
+                              uint32_t len),                                                                            \
+      (scope, table, payer, id, data, len))                                                                             \
+    X(db_update_i64, void, (int32_t itr, uint64_t payer, const void *data, uint32_t len), (itr, payer, data, len))      \
+    X(db_remove_i64, void, (int32_t itr), (itr))                                                                        \
+    X(send_inline, void, (char *action, size_t size), (action, size))                                                   \
+    X(require_recipient, void, (uint64_t account), (account))                                                           \
+    X(require_auth, void, (uint64_t account), (account))                                                                \
+    X(has_auth, bool, (uint64_t account), (account))                                                                    \
+    X(is_account, bool, (uint64_t account), (account))
+
+namespace host_profile {
+
+#define HOST_PROFILE_ENUM(fn, ret, params, args) fn,
+    enum call : uint32_t { HOST_PROFILE_CALLS(HOST_PROFILE_ENUM) call_count };
+#undef HOST_PROFILE_ENUM
+
+#define HOST_PROFILE_NAME(fn, ret, params, args) #fn,
+    inline const char *const names[] = { HOST_PROFILE_CALLS(HOST_PROFILE_NAME) };
+#undef HOST_PROFILE_NAME
+
+    // one wasm instance per action, the counts are those of the running action
+    inline uint32_t counts[call_count];
+
+} // namespace host_profile
+
+extern "C" {
+__attribute__((import_module("env"), import_name("prints"))) void host_profile_prints(const char *text);
+__attribute__((import_module("env"), import_name("printn"))) void host_profile_printn(uint64_t name);
+__attribute__((import_module("env"), import_name("printui"))) void host_profile_printui(uint64_t value);
+}
+
+namespace host_profile {
+
+    // member of the contract class, prints the trailer at the end of the action
+    struct trailer {
+        uint64_t receiver;
+
+        explicit trailer(uint64_t receiver) : receiver(receiver) {
+            for (auto &c : counts) c = 0;
+        }
+        ~trailer() {
+            host_profile_prints("\n#hostcalls ");
+            host_profile_printn(receiver);
+            host_profile_prints(" {");
+            const char *separator = "\"";
+            for (uint32_t i = 0; i < call_count; i++) {
+                if (counts[i] == 0) continue;
+                host_profile_prints(separator);
+                host_profile_prints(names[i]);
+                host_profile_prints("\":");
+                host_profile_printui(counts[i]);
+                separator = ",\"";
+            }
+            host_profile_prints("}\n");
+        }
+    };
+
+} // namespace host_profile
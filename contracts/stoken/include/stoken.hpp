@@ -97,6 +97,20 @@ class [[eosio::contract("stoken")]] stoken : public contract {
                                        const asset &quantity, const asset &from_balance,
                                        const asset &to_balance);
 
+    /**
+     * Set ram stat action.
+     *
+     * @details Seeds the `ramstats` counters of `table` for rows written before the
+     * counters existed, sent by `vault.defi` on behalf of its admin.
+     *
+     * @param table - `stat` or `accounts`,
+     * @param scopes - scopes holding at least one row,
+     * @param rows - rows over all scopes,
+     * @param bytes - packed row data, without the per-row overhead.
+     */
+    [[eosio::action]] void setramstat(const name &table, uint64_t scopes, uint64_t rows,
+                                      uint64_t bytes);
+
     /**
      * Get supply method.
      *
@@ -141,9 +155,46 @@ class [[eosio::contract("stoken")]] stoken : public contract {
         uint64_t primary_key() const { return supply.symbol.code().raw(); }
     };
 
-    typedef eosio::multi_index<"accounts"_n, s_account> accounts;
-    typedef eosio::multi_index<"stat"_n, s_stat>        stats;
+    // rows and packed bytes per table, read by `vault.defi` `getram`
+    struct [[eosio::table]] s_ram_stat {
+        name     table;
+        uint64_t scopes;
+        uint64_t rows;
+        uint64_t bytes;
+
+        uint64_t primary_key() const { return table.value; }
+    };
+
+    typedef eosio::multi_index<"accounts"_n, s_account>  accounts;
+    typedef eosio::multi_index<"stat"_n, s_stat>         stats;
+    typedef eosio::multi_index<"ramstats"_n, s_ram_stat> ramstats;
 
     asset sub_balance(const name &owner, const asset &value);
     asset add_balance(const name &owner, const asset &value, const name &ram_payer);
+
+    // `scopes` is the change of non-empty scopes
+    template <typename T>
+    void track_ram(const name &table, const T &row, int64_t rows, int64_t scopes) {
+        ramstats stattbl(get_self(), get_self().value);
+        int64_t bytes = rows * int64_t(pack_size(row));
+        auto updater = [&](auto &s) {
+            s.rows = std::max(int64_t(s.rows) + rows, int64_t(0));
+            s.scopes = std::max(int64_t(s.scopes) + scopes, int64_t(0));
+            s.bytes = std::max(int64_t(s.bytes) + bytes, int64_t(0));
+        };
+        auto itr = stattbl.find(table.value);
+        if (itr == stattbl.end()) {
+            stattbl.emplace(get_self(), [&](auto &s) {
+                s.table = table;
+                updater(s);
+            });
+            return;
+        }
+        stattbl.modify(itr, same_payer, updater);
+    }
+
+#ifdef CONTRACT_PROFILE
+    // host-call trailer of the profile build, see contracts/profile/host_profile.hpp
+    host_profile::trailer _host_profile { get_self().value };
+#endif
 };
\ No newline at end of file
@@ -17,11 +17,12 @@ void stoken::create(const name &issuer, const asset &maximum_supply) {
    auto existing = statstable.find(sym.code().raw());
    check(existing == statstable.end(), "token with symbol already exists");
 
-   statstable.emplace(get_self(), [&](auto &s) {
+   auto st = statstable.emplace(get_self(), [&](auto &s) {
       s.supply.symbol = maximum_supply.symbol;
       s.max_supply = maximum_supply;
       s.issuer = issuer;
    });
+   track_ram("stat"_n, *st, 1, 1);
 }
 
 void stoken::issue(const name &to, const asset &quantity, const string &memo) {
@@ -128,9 +129,11 @@ asset stoken::add_balance(const name &owner, const asset &value, const name &ram
    accounts to_acnts(get_self(), owner.value);
    auto to = to_acnts.find(value.symbol.code().raw());
    if (to == to_acnts.end()) {
+      bool new_scope = to_acnts.begin() == to_acnts.end();
       to = to_acnts.emplace(ram_payer, [&](auto &a) {
          a.balance = value;
       });
+      track_ram("accounts"_n, *to, 1, new_scope);
    } else {
       to_acnts.modify(to, same_payer, [&](auto &a) {
          a.balance += value;
@@ -152,9 +155,11 @@ void stoken::open(const name &owner, const symbol &symbol, const name &ram_payer
    accounts acnts(get_self(), owner.value);
    auto it = acnts.find(sym_code_raw);
    if (it == acnts.end()) {
-      acnts.emplace(ram_payer, [&](auto &a) {
+      bool new_scope = acnts.begin() == acnts.end();
+      it = acnts.emplace(ram_payer, [&](auto &a) {
          a.balance = asset{0, symbol};
       });
+      track_ram("accounts"_n, *it, 1, new_scope);
    }
 }
 
@@ -164,9 +169,30 @@ void stoken::close(const name &owner, const symbol &symbol) {
    auto it = acnts.find(symbol.code().raw());
    check(it != acnts.end(), "Balance row already deleted or never existed. Action won't have any effect.");
    check(it->balance.amount == 0, "Cannot close because the balance is not zero.");
+   auto row = *it;
    acnts.erase(it);
+   track_ram("accounts"_n, row, -1, -int64_t(acnts.begin() == acnts.end()));
 }
 
 void stoken::transferlog(const name &from, const name &to, const asset &quantity, const asset &from_balance, const asset &to_balance) {
    require_auth(_self);
 }
+
+void stoken::setramstat(const name &table, uint64_t scopes, uint64_t rows, uint64_t bytes) {
+   require_auth(VAULT_ACCOUNT);
+   check(table == "stat"_n || table == "accounts"_n, "table not tracked");
+
+   ramstats stattbl(get_self(), get_self().value);
+   auto updater = [&](auto &s) {
+      s.table = table;
+      s.scopes = scopes;
+      s.rows = rows;
+      s.bytes = bytes;
+   };
+   auto itr = stattbl.find(table.value);
+   if (itr == stattbl.end()) {
+      stattbl.emplace(get_self(), updater);
+   } else {
+      stattbl.modify(itr, same_payer, updater);
+   }
+}
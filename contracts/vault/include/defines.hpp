@@ -1,5 +1,8 @@
 #pragma once
 #include <eosio/eosio.hpp>
+#include <eosio/print.hpp>
+
+#include <vault_math.hpp>
 
 using namespace eosio;
 
@@ -7,9 +10,25 @@ static constexpr name EOSIO_ACCOUNT{"eosio"_n};
 static constexpr name EOS_TOKEN_ACCOUNT{"eosio.token"_n};
 static constexpr name EOS_REX_ACCOUNT{"eosio.rex"_n};
 static constexpr name ADMIN_ACCOUNT{"admin.defi"_n};
+static constexpr name KEEPER_ACCOUNT{"keeper.defi"_n};
 static constexpr name STOKRN_ACCOUNT{"stoken.defi"_n};
 
 static constexpr symbol EOS_SYMBOL = symbol("EOS", 4);
 static constexpr symbol REX_SYMBOL = symbol("REX", 4);
 
-static const uint64_t RATE_BASE = 100000000LL;
\ No newline at end of file
+static const uint64_t RATE_BASE = vault_math::RATE_BASE;
+
+// nodeos bills this many bytes of RAM per table row on top of the row data
+static constexpr uint64_t RAM_ROW_OVERHEAD = 112;
+
+// debug tracing of the vault, the release build (-DVAULT_TRACE=0) compiles it out
+// together with the formatting code and strings
+#ifndef VAULT_TRACE
+#define VAULT_TRACE 1
+#endif
+
+#if VAULT_TRACE
+#define VAULT_PRINT(...) eosio::print_f(__VA_ARGS__)
+#else
+#define VAULT_PRINT(...) ((void)0)
+#endif
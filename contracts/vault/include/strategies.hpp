@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * Yield strategies of the collateral kinds. A strategy is picked once per
+ * collateral by `vault::with_strategy` and passed down as a template
+ * argument, so the deposit, withdraw, release and payout routines of each
+ * kind are compiled separately without runtime checks of the kind.
+ *
+ * A new strategy adds a tag here, its traits, and a case in `with_strategy`.
+ */
+namespace strategy {
+
+    // tokens stay in the vault's balance, the rate is balance over supply
+    struct hold {
+        // the rate counts REX lent out besides the token balance
+        static constexpr bool counts_rex = false;
+        // deposits are lent to REX right after the shares are issued
+        static constexpr bool lends_to_rex = false;
+        // payouts larger than the liquid balance are queued in `payouts` and sell matured REX
+        static constexpr bool sells_rex_on_payout = false;
+    };
+
+    // EOS lent to REX, see `buyrex` and `withdraw_sellrex`
+    struct rex {
+        static constexpr bool counts_rex          = true;
+        static constexpr bool lends_to_rex        = true;
+        static constexpr bool sells_rex_on_payout = true;
+    };
+
+} // namespace strategy
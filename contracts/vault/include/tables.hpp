@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/system.hpp>
 
 using namespace eosio;
 
@@ -32,6 +33,46 @@ struct rex_balance {
 
 typedef eosio::multi_index< "rexbal"_n, rex_balance > rex_balance_table;
 
+/**
+ * The part of a `rexbal` row (`rex_balance`) the vault reads: its REX balance and how much of
+ * it is matured. The maturity list is summed as it is read from the row bytes
+ * instead of being copied into a `std::deque`, so the cost no longer depends
+ * on the allocator. The sum is taken at decode time, read it within the
+ * action only.
+ */
+struct rex_balance_view {
+    name     owner;
+    int64_t  rex_balance = 0;
+    // `matured_rex` of the row plus the maturity buckets due now
+    uint64_t matured_rex = 0;
+
+    uint64_t primary_key()const { return owner.value; }
+
+    template <typename DataStream>
+    friend DataStream &operator>>(DataStream &ds, rex_balance_view &v) {
+        uint8_t version;
+        asset   vote_stake, rex_balance;
+        int64_t matured;
+        ds >> version >> v.owner >> vote_stake >> rex_balance >> matured;
+        v.rex_balance = rex_balance.amount;
+
+        const time_point_sec now(current_time_point());
+        uint64_t             sum = matured;
+        unsigned_int         count;
+        ds >> count;
+        for (uint32_t i = 0; i < count.value; i++) {
+            time_point_sec time;
+            int64_t        amount;
+            ds >> time >> amount;
+            if (time <= now) sum += amount;
+        }
+        v.matured_rex = sum;
+        return ds;
+    }
+};
+
+typedef eosio::multi_index< "rexbal"_n, rex_balance_view > rex_balance_view_table;
+
 
 struct [[eosio::table]] s_account {
     asset balance;
@@ -1,10 +1,15 @@
 #pragma once
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 #include <eosio/eosio.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/system.hpp>
 
+#include <optional>
+#include <vector>
+
 #include <defines.hpp>
+#include <strategies.hpp>
 #include <tables.hpp>
 
 using namespace eosio;
@@ -22,6 +27,7 @@ class [[eosio::contract("vault")]] vault : public contract {
             _config.deposit_status   = 1;
             _config.withdraw_status  = 1;
             _config.log_id           = 0;
+            _config.queued_eos.emplace(0);
             _configs.set(_config, _self);
         }
     }
@@ -80,6 +86,7 @@ class [[eosio::contract("vault")]] vault : public contract {
      * ## ACTION `updatecoll`
      *
      * > Modify the configuration of the collateral.
+     * > Adds its token contract to `notifiers` when missing.
      *
      * - **authority**: `admin.defi`
      *
@@ -186,63 +193,220 @@ class [[eosio::contract("vault")]] vault : public contract {
      */
     [[eosio::action]] void sellrex(asset quantity);
     /**
-     * ## ACTION `sellnext`
+     * ## ACTION `payout`
      *
-     * > Sell {{quantity}} of rex for {{owner}}.
+     * > Pay the queued EOS payouts (`payouts`) in order, as far as the liquid balance goes,
+     * > and sell matured REX for the rest. The EOS of the sell pays them when it arrives.
      *
-     * - **authority**: `get_self()`
+     * - **authority**: `keeper.defi` or `admin.defi`
+     *
+     * ### example
+     *
+     * ```bash
+     * $ cleos push action vault.defi payout '[]' -p keeper.defi
+     * ```
+     */
+    [[eosio::action]] void payout();
+
+    /**
+     * ## ACTION `income`
+     *
+     * > Transfer from collateral->income_account to vault contract (every 10 minutes).
+     *
+     * - **authority**: `anyone`
+     *
+     * ```bash
+     * $ cleos push action vault.defi income '[]' -p any
+     * ```
+     */
+    [[eosio::action]] void income();
+
+    struct apy_result {
+        uint64_t       collateral_id;
+        uint64_t       rate;
+        time_point_sec time;
+        int64_t        apy_1d;
+        int64_t        apy_7d;
+        int64_t        apy_30d;
+    };
+
+    /**
+     * ## ACTION `getapy`
+     *
+     * > Read-only. Yield of a collateral over the last 1, 7 and 30 days, computed
+     * > from `ratehistory` and annualized without compounding.
+     *
+     * - **authority**: `anyone`
      *
      * ### params
      *
-     * - `{name} owner` - the deposit account
-     * - `{asset} quantity` - amount of rex to sell
-     * - `{string} memo` - the memo string to accompany the transaction.
+     * - `{uint64_t} collateral_id` - the collateral id
+     *
+     * ### returns
+     *
+     * - `{uint64_t} rate` - latest recorded ratio of exchange
+     * - `{time_point_sec} time` - time of the latest recorded point
+     * - `{int64_t} apy_1d` / `apy_7d` / `apy_30d` - yield per year, 100000000 = 100%
+     *   (measured from the oldest point when the history is shorter than the window, `0` without history)
      *
      * ### example
      *
      * ```bash
-     * $ cleos push action vault.defi sellnext '["depositowner", "10.0000 EOS", ""]' -p vault.defi
+     * $ cleos push action vault.defi getapy '[1]' -p any --read-only
      * ```
      */
-    [[eosio::action]] void sellnext(name owner, asset quantity, string memo);
+    [[eosio::action, eosio::read_only]] apy_result getapy(uint64_t collateral_id);
+
+    struct ram_usage {
+        name     code;
+        name     table;
+        name     scope_class;
+        uint64_t scopes;
+        uint64_t rows;
+        uint64_t bytes;
+    };
+
     /**
-     * ## ACTION `sellnext2`
+     * ## ACTION `getram`
      *
-     * > Sell {{quantity}} of rex for {{owner}}.
+     * > Read-only. Rows and RAM of the vault and stoken tables, from the counters in `ramstats`
+     * > of both contracts, without scanning any table.
      *
-     * - **authority**: `get_self()`
+     * - **authority**: `anyone`
+     *
+     * ### returns
+     *
+     * one entry per table:
+     *
+     * - `{name} code` - `vault.defi` or `stoken.defi`
+     * - `{name} table` - the table
+     * - `{name} scope_class` - what the table is scoped by (`self`, `owner`, `collateral`, `holder`, `symbol`)
+     * - `{uint64_t} scopes` - scopes holding at least one row
+     * - `{uint64_t} rows` - rows over all scopes
+     * - `{uint64_t} bytes` - row data plus the 112 bytes nodeos bills per row
+     *
+     * ### example
+     *
+     * ```bash
+     * $ cleos push action vault.defi getram '[]' -p any --read-only
+     * ```
+     */
+    [[eosio::action, eosio::read_only]] std::vector<ram_usage> getram();
+
+    struct planned_transfer {
+        name   contract;
+        name   to;
+        asset  quantity;
+        string memo;
+        bool   queued;
+    };
+
+    struct payout_plan {
+        bool                          ok;
+        string                        error;
+        uint64_t                      release_id;
+        time_point_sec                release_time;
+        std::vector<planned_transfer> transfers;
+        asset                         sell_rex;
+        asset                         sell_eos;
+        string                        payout_error;
+        uint32_t                      inline_actions;
+        uint32_t                      rows_written;
+    };
+
+    /**
+     * ## ACTION `planrelease`
+     *
+     * > Read-only. What `release` of `owner` would do now, computed as `release` does but without
+     * > sending or writing anything: the transfers, the REX sold for the ones the liquid balance
+     * > does not cover, and the work of the action.
+     *
+     * - **authority**: `anyone`
      *
      * ### params
      *
      * - `{name} owner` - the deposit account
-     * - `{name} quantity` - amount of rex to sell
-     * - `{name} memo` - the memo string to accompany the transaction.
+     *
+     * ### returns
+     *
+     * - `{bool} ok` - `false` when `release` would fail, `error` says why
+     * - `{uint64_t} release_id` / `{time_point_sec} release_time` - the release paid, `0` when none is due
+     *   (`release` then succeeds without doing anything)
+     * - `{planned_transfer[]} transfers` - `contract`, `to`, `quantity`, `memo` of each transfer;
+     *   `queued` ones wait in `payouts` and are paid by the EOS of the REX sell when it covers them
+     * - `{asset} sell_rex` / `sell_eos` - matured REX sold and the EOS it returns, `0` without a sell
+     * - `{string} payout_error` - why paying the release out as planned would fail, empty when it
+     *   would not; a release that would fail has it in `error` too
+     * - `{uint32_t} inline_actions` - inline actions the vault sends, notifications not included
+     * - `{uint32_t} rows_written` - vault rows stored, modified or erased
      *
      * ### example
      *
      * ```bash
-     * $ cleos push action vault.defi sellnext2 '["depositowner", "10.0000 EOS", ""]' -p vault.defi
+     * $ cleos push action vault.defi planrelease '["mydeposit"]' -p any --read-only
      * ```
      */
-    [[eosio::action]] void sellnext2(name owner, asset quantity, string memo);
+    [[eosio::action, eosio::read_only]] payout_plan planrelease(name owner);
 
     /**
-     * ## ACTION `income`
+     * ## ACTION `planwithdraw`
      *
-     * > Transfer from collateral->income_account to vault contract (every 10 minutes).
+     * > Read-only. What a transfer of `quantity` from `owner` to the vault would do now: the
+     * > release row it adds, and the transfers and REX sell of that release were it paid today,
+     * > at today's rate and liquid balance.
      *
      * - **authority**: `anyone`
      *
+     * ### params
+     *
+     * - `{name} owner` - the deposit account
+     * - `{asset} quantity` - the stoken quantity withdrawn
+     *
+     * ### returns
+     *
+     * as `planrelease`; `release_id` and `release_time` are those of the row the withdraw adds,
+     * `inline_actions` and `rows_written` the work of the withdraw itself. `ok` and `error` are
+     * about the withdraw; `payout_error` about its release were it paid today
+     *
+     * ### example
+     *
      * ```bash
-     * $ cleos push action vault.defi income '[]' -p any
+     * $ cleos push action vault.defi planwithdraw '["mydeposit", "10.0000 SEOS"]' -p any --read-only
      * ```
      */
-    [[eosio::action]] void income();
+    [[eosio::action, eosio::read_only]] payout_plan planwithdraw(name owner, asset quantity);
+
+    /**
+     * ## ACTION `setramstat`
+     *
+     * > Seed the `ramstats` counters of a table, for rows written before the counters existed.
+     * > Counters of `stoken.defi` tables are forwarded to its `setramstat`.
+     *
+     * - **authority**: `admin.defi`
+     *
+     * ### params
+     *
+     * - `{name} code` - `vault.defi` or `stoken.defi`
+     * - `{name} table` - the table
+     * - `{uint64_t} scopes` - scopes holding at least one row
+     * - `{uint64_t} rows` - rows over all scopes
+     * - `{uint64_t} bytes` - packed row data, without the per-row overhead
+     *
+     * ### example
+     *
+     * ```bash
+     * $ cleos push action vault.defi setramstat '["vault.defi", "releases", 812, 1904, 68544]' -p admin.defi
+     * ```
+     */
+    [[eosio::action]] void setramstat(name code, name table, uint64_t scopes, uint64_t rows,
+                                      uint64_t bytes);
 
     /**
      * ## ACTION `release`
      *
      * > The mortgaged property to be withdrawn and deposited after maturity.
+     * > EOS that neither the liquid balance nor matured REX covers is queued in `payouts`.
+     * > The withdraw fees and refund of a recipient are paid in one transfer, memo `withdraw fees, refund`.
      *
      * - **authority**: `owner`
      *
@@ -408,6 +572,17 @@ class [[eosio::contract("vault")]] vault : public contract {
     [[eosio::on_notify("*::transfer")]] void on_tokens_transfer(
         name from, name to, asset quantity, string memo);
 
+    // whether `on_tokens_transfer` runs for a `transfer` of `code`, decided before the
+    // contract is built from `from` and `to` of the packed action `data`: `false` for the
+    // transfers it ignores, aborts for the tokens of contracts in neither `notifiers` nor
+    // `collaterals`
+    static bool accepts_transfer(name self, name code, const char *data, uint32_t size);
+
+    // whether a notification of `code` runs `on_tokens_transfer`: a `transfer` that
+    // `accepts_transfer` lets through. The one filter of the wasm `apply` and of the
+    // native backend, it reads the head of the running action's data
+    static bool runs_notification(name self, name code, name action);
+
     // utils
     static asset get_supply(const name &token_contract_account, const symbol_code &sym_code) {
         stats       statstable(token_contract_account, sym_code.raw());
@@ -458,14 +633,15 @@ class [[eosio::contract("vault")]] vault : public contract {
     /**
      * ## TABLE `collaterals`
      *
+     * > Configuration of the collaterals, written only by `createcoll` and `updatecoll`.
+     * > The income counters are kept in `incomes`.
+     *
      * ### params
      *
      * - `{uint64_t} id` - the collateral id
      * - `{name} deposit_contract` - collateral token contract
      * - `{symbl} deposit_symbol` - collateral token symbol
      * - `{symbl} issue_symbol` - the token to be issue
-     * - `{asset} last_income` - last transfer from collateral->income account
-     * - `{asset} total_income` - transfer total quantity from collateral->income account
      * - `{uint16_t} income_ratio` - Percentage of collateral->income_account transferred
      * - `{name} income_account` - used to store reward accounts
      * - `{asset} min_quantity` - Minimum deposit quantity
@@ -481,8 +657,6 @@ class [[eosio::contract("vault")]] vault : public contract {
      *      "deposit_contract": "eosio.token",
      *      "deposit_symbol": "4,EOS",
      *      "issue_symbol": "4,SEOS",
-     *      "last_income": "1.3344 EOS",
-     *      "total_income": "5208.1385 EOS",
      *      "income_ratio": 50,
      *      "income_account": "award.defi",
      *      "min_quantity": "0.1000 EOS",
@@ -497,8 +671,6 @@ class [[eosio::contract("vault")]] vault : public contract {
         name     deposit_contract;
         symbol   deposit_symbol;
         symbol   issue_symbol;
-        asset    last_income;
-        asset    total_income;
         uint16_t income_ratio = 10;
         name     income_account;
         asset    min_quantity;
@@ -506,6 +678,68 @@ class [[eosio::contract("vault")]] vault : public contract {
         uint16_t release_fees = 30;
         uint16_t refund_ratio = 5000;
         uint64_t primary_key() const { return id; }
+
+        // rows written before `incomes` existed still hold `last_income` and
+        // `total_income` after the symbols (`s_collateral_v0`) until `migrate_collateral_v0`
+        // moves them, both layouts read the same
+        template <typename DataStream>
+        friend DataStream &operator>>(DataStream &ds, s_collateral &c) {
+            ds >> c.id >> c.deposit_contract >> c.deposit_symbol >> c.issue_symbol;
+            if (ds.remaining() >= LEGACY_INCOME_BYTES + COMPACT_TAIL_BYTES) {
+                asset last_income, total_income;
+                ds >> last_income >> total_income;
+            }
+            return ds >> c.income_ratio >> c.income_account >> c.min_quantity >> c.fees_account
+                      >> c.release_fees >> c.refund_ratio;
+        }
+
+        static constexpr size_t LEGACY_INCOME_BYTES = 2 * 16;
+        static constexpr size_t COMPACT_TAIL_BYTES  = 2 + 8 + 16 + 8 + 2 + 2;
+    };
+
+    // the `collaterals` layout before the income counters moved to `incomes`, only read by `migrate_collateral_v0`
+    struct s_collateral_v0 {
+        uint64_t id;
+        name     deposit_contract;
+        symbol   deposit_symbol;
+        symbol   issue_symbol;
+        asset    last_income;
+        asset    total_income;
+        uint16_t income_ratio;
+        name     income_account;
+        asset    min_quantity;
+        name     fees_account;
+        uint16_t release_fees;
+        uint16_t refund_ratio;
+        uint64_t primary_key() const { return id; }
+    };
+
+    /**
+     * ## TABLE `incomes`
+     *
+     * > Income counters of the collaterals, the only row `income` writes per collateral and tick.
+     *
+     * ### params
+     *
+     * - `{uint64_t} collateral_id` - (primary key) the collateral id
+     * - `{asset} last_income` - last transfer from collateral->income account
+     * - `{asset} total_income` - transfer total quantity from collateral->income account
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "collateral_id": 1,
+     *   "last_income": "1.3344 EOS",
+     *   "total_income": "5208.1385 EOS"
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_income {
+        uint64_t collateral_id;
+        asset    last_income;
+        asset    total_income;
+        uint64_t primary_key() const { return collateral_id; }
     };
     /**
      * ## TABLE `config`
@@ -517,6 +751,8 @@ class [[eosio::contract("vault")]] vault : public contract {
      * - `{uint8_t} deposit_status` - deposit status (`0: suspended 1: open`)
      * - `{uint8_t} withdraw_status` - withdraw status (`0: suspended 1: open`)
      * - `{uint64_t} log_id` - Save the latest id of the `releases` table
+     * - `{binary_extension<int64_t>} queued_eos` - EOS owed to the `payouts` queue, absent
+     *   in rows written before it was added
      *
      * ### example
      *
@@ -526,7 +762,8 @@ class [[eosio::contract("vault")]] vault : public contract {
      *    "transfer_status": 1,
      *    "deposit_status": 1,
      *    "withdraw_status": 1,
-     *    "log_id": 22
+     *    "log_id": 22,
+     *    "queued_eos": 0
      * }
      * ```
      */
@@ -536,41 +773,299 @@ class [[eosio::contract("vault")]] vault : public contract {
         uint8_t  deposit_status;
         uint8_t  withdraw_status;
         uint64_t log_id;
+        // kept by `queue_payout` and `pay_queued`; absent on rows written before
+        // it existed, until `queued_eos()` sums the queue once
+        binary_extension<int64_t> queued_eos;
+    };
+
+    /**
+     * ## TABLE `metrics`
+     *
+     * > Per-collateral totals, updated in place by every deposit, withdraw and release.
+     *
+     * ### params
+     *
+     * - `{uint64_t} collateral_id` - (primary key) the collateral id
+     * - `{asset} total_deposit` - total quantity deposited
+     * - `{asset} total_withdraw` - total quantity released to the owners
+     * - `{asset} withdraw_award_fees` - total withdrawal fees to the collateral->income_account
+     * - `{asset} withdraw_sys_fees` - total withdrawal fees to the collateral->fees_account
+     * - `{asset} refund_award_quantity` - total refunds to the collateral->income_account
+     * - `{asset} refund_sys_quantity` - total refunds to the collateral->fees_account
+     * - `{uint64_t} pending_count` - number of releases waiting in `releases`
+     * - `{asset} pending_quantity` - issued tokens waiting in `releases`
+     * - `{uint64_t} last_rate` - ratio of exchange of the last deposit, withdraw or release
+     * - `{block_timestamp} update_time` - time of the last update
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "collateral_id": 1,
+     *   "total_deposit": "1900.0000 USDT",
+     *   "total_withdraw": "1896.1201 USDT",
+     *   "withdraw_award_fees": "0.2845 USDT",
+     *   "withdraw_sys_fees": "0.6639 USDT",
+     *   "refund_award_quantity": "0.5512 USDT",
+     *   "refund_sys_quantity": "1.2862 USDT",
+     *   "pending_count": 0,
+     *   "pending_quantity": "0.0000 SUSDT",
+     *   "last_rate": 100188590,
+     *   "update_time": "2022-12-03T10:13:07.000"
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_metrics {
+        uint64_t        collateral_id;
+        asset           total_deposit;
+        asset           total_withdraw;
+        asset           withdraw_award_fees;
+        asset           withdraw_sys_fees;
+        asset           refund_award_quantity;
+        asset           refund_sys_quantity;
+        uint64_t        pending_count;
+        asset           pending_quantity;
+        uint64_t        last_rate;
+        block_timestamp update_time;
+        uint64_t        primary_key() const { return collateral_id; }
+    };
+
+    /**
+     * ## TABLE `ratehistory`
+     *
+     * > Ratio of exchange recorded at every `income` tick, scoped by collateral id.
+     * > One row per day holding a point per 10 minutes, rows are reused after 30 days
+     * > so the table never grows past 30 rows per collateral.
+     *
+     * ### params
+     *
+     * - `{uint64_t} slot` - (primary key) day number modulo 30
+     * - `{uint32_t} day` - days since epoch of the points in `rates`
+     * - `{vector<uint64_t>} rates` - 144 points, `rates[i]` at `day * 86400 + i * 600`, `0` when no income ran
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "slot": 17,
+     *   "day": 19327,
+     *   "rates": [100186412, 100186455, 0, 100186523, ...]
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_rate_day {
+        uint64_t              slot;
+        uint32_t              day;
+        std::vector<uint64_t> rates;
+        uint64_t              primary_key() const { return slot; }
+    };
+
+    /**
+     * ## TABLE `payouts`
+     *
+     * > EOS payouts the liquid balance and matured REX could not cover when they were made,
+     * > paid in `id` order by the next REX sell or `payout`. The table is empty most of the time.
+     *
+     * ### params
+     *
+     * - `{uint64_t} id` - (primary key) position in the queue
+     * - `{name} to` - the owner, collateral->income_account or collateral->fees_account
+     * - `{asset} quantity` - EOS owed
+     * - `{string} memo` - memo of the transfer
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "id": 0,
+     *   "to": "depositowner",
+     *   "quantity": "1000.2410 EOS",
+     *   "memo": "withdraw"
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_payout {
+        uint64_t id;
+        name     to;
+        asset    quantity;
+        string   memo;
+        uint64_t primary_key() const { return id; }
+    };
+
+    /**
+     * ## TABLE `ramstats`
+     *
+     * > Rows and packed bytes per table, updated by every action that adds or removes a row.
+     * > `stoken.defi` keeps the same table for its own tables.
+     *
+     * ### params
+     *
+     * - `{name} table` - (primary key) the table
+     * - `{uint64_t} scopes` - scopes holding at least one row
+     * - `{uint64_t} rows` - rows over all scopes
+     * - `{uint64_t} bytes` - packed row data, without the per-row overhead
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "table": "releases",
+     *   "scopes": 812,
+     *   "rows": 1904,
+     *   "bytes": 68544
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_ram_stat {
+        name     table;
+        uint64_t scopes;
+        uint64_t rows;
+        uint64_t bytes;
+        uint64_t primary_key() const { return table.value; }
+    };
+
+    /**
+     * ## TABLE `notifiers`
+     *
+     * > Token contracts besides `eosio.token` and `stoken.defi` whose `transfer` notifications
+     * > reach `on_tokens_transfer`, added by `createcoll` and `updatecoll` for the contract of the
+     * > collateral. Transfers of any other contract are refused before the contract is built.
+     * > The contract of a collateral created before the table existed is found in `collaterals`
+     * > instead, and its row added by its next deposit.
+     *
+     * ### params
+     *
+     * - `{name} contract` - (primary key) the token contract
+     *
+     * ### example
+     *
+     * ```json
+     * {
+     *   "contract": "tethertether"
+     * }
+     * ```
+     */
+    struct [[eosio::table]] s_notifier {
+        name     contract;
+        uint64_t primary_key() const { return contract.value; }
     };
 
     typedef eosio::multi_index<"releases"_n, s_release>       releases;
-    typedef eosio::multi_index<"collaterals"_n, s_collateral> collaterals;
+    typedef eosio::multi_index<"collaterals"_n, s_collateral>    collaterals;
+    typedef eosio::multi_index<"collaterals"_n, s_collateral_v0> collaterals_v0;
+    typedef eosio::multi_index<"incomes"_n, s_income>            incomes;
+    typedef eosio::multi_index<"metrics"_n, s_metrics>        metrics;
+    typedef eosio::multi_index<"ratehistory"_n, s_rate_day>   ratehistory;
+    typedef eosio::multi_index<"payouts"_n, s_payout>         payouts;
+    typedef eosio::multi_index<"ramstats"_n, s_ram_stat>      ramstats;
+    typedef eosio::multi_index<"notifiers"_n, s_notifier>     notifiers;
     typedef eosio::singleton<"config"_n, config>              configs;
 
     configs _configs;
     config  _config;
 
-    void transfer_token_to(name contract, name to, asset quantity, string memo);
+    // read once per action and drawn down by the payouts of that action,
+    // `_eos_balance` is the liquid EOS not owed to the `payouts` queue
+    std::optional<asset>            _eos_balance;
+    std::optional<uint64_t>         _matured_rex;
+    // the vault's rexbal row, decoded once per action; owner is empty without one
+    std::optional<rex_balance_view> _rex_balance;
+
+    // transfers of one recipient in one class are summed and sent once by `send_transfers`
+    enum class memo_class : uint8_t { withdraw, fees, queued };
+    struct pending_transfer {
+        name       contract;
+        name       to;
+        asset      quantity;
+        string     memo;
+        memo_class kind;
+        bool       sells_rex;   // checked against `_eos_balance` when sent
+        bool       queued = false;   // set by `plan_transfers`
+    };
+    std::vector<pending_transfer> _transfers;
+
+#ifdef CONTRACT_PROFILE
+    // host-call trailer of the profile build, see contracts/profile/host_profile.hpp
+    host_profile::trailer _host_profile { get_self().value };
+#endif
 
-    void do_deposit(s_collateral collateral, const name &owner, const asset &quantity);
-    void do_withdraw(s_collateral collateral, const name &owner, const asset &quantity);
+    // the one runtime check of the collateral kind, `f` is called with the strategy tag
+    template <typename F>
+    static auto with_strategy(const s_collateral &collateral, F &&f) {
+        if (collateral.deposit_contract == EOS_TOKEN_ACCOUNT && collateral.deposit_symbol == EOS_SYMBOL) {
+            return f(strategy::rex {});
+        }
+        return f(strategy::hold {});
+    }
+
+    template <typename Strategy>
+    void transfer_token_to(name contract, name to, asset quantity, string memo, memo_class kind);
+    void add_transfer(name contract, name to, asset quantity, const string &memo, memo_class kind,
+                      bool sells_rex);
+    int64_t plan_transfers();
+    void send_transfers();
+
+    template <typename Strategy>
+    void add_release_transfers(const s_collateral &collateral, const name &owner,
+                               const vault_math::release_result &amounts);
+    void plan_payout(payout_plan &plan, uint32_t &inline_actions, uint32_t &rows_written);
+
+    template <typename Strategy>
+    void do_deposit(const s_collateral &collateral, const name &owner, const asset &quantity);
+    template <typename Strategy>
+    void do_withdraw(const s_collateral &collateral, const name &owner, const asset &quantity);
+    template <typename Strategy>
+    void release_first(const s_collateral &collateral, const name &owner, releases &releasetbl,
+                       releases::const_iterator itr);
 
     void deposit_buyrex(asset quantity);
-    void withdraw_sellrex(name user, asset sell_quantity, asset tsf_quantity, string memo);
+    struct rex_sale {
+        asset rex;      // matured REX sold
+        asset eos;      // EOS it returns
+        asset unlent;   // EOS of the pool that pays it
+    };
+    rex_sale rex_for(asset sell_quantity);
+    void withdraw_sellrex(asset sell_quantity);
+    void queue_payout(name to, asset quantity, string memo);
+    asset pay_queued();
 
     // if there are some tokens to release, release it
     void check_for_released(const name &owner);
 
-    asset get_rex_eos() {
-        rex_pool_table rexpool_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
-        auto           rex_itr = rexpool_table.begin();
+    const rex_balance_view &get_rex_balance() {
+        if (!_rex_balance) {
+            rex_balance_view_table rexbal_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
+            auto                   rexbal_it = rexbal_table.find(_self.value);
+            _rex_balance = rexbal_it == rexbal_table.end() ? rex_balance_view {} : *rexbal_it;
+        }
+        return *_rex_balance;
+    }
 
-        rex_balance_table rexbal_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
-        auto              rexbal_it = rexbal_table.find(_self.value);
+    // EOS owed to the `payouts` queue, from `config`; a row written before the
+    // total was kept has the queue summed, the next payout write stores it
+    int64_t queued_eos() {
+        if (!_config.queued_eos.has_value()) {
+            payouts payouttbl(_self, _self.value);
+            int64_t total = 0;
+            for (auto itr = payouttbl.begin(); itr != payouttbl.end(); itr++) {
+                total += itr->quantity.amount;
+            }
+            _config.queued_eos.emplace(total);
+        }
+        return _config.queued_eos.value();
+    }
 
+    asset get_rex_eos() {
         auto rex_eos = asset(0, EOS_SYMBOL);
-        if (rexbal_it == rexbal_table.end()) {
+        if (get_rex_balance().owner.value == 0) {
             return rex_eos;
         }
 
-        const int64_t S0 = rex_itr->total_lendable.amount;
-        const int64_t R0 = rex_itr->total_rex.amount;
-        rex_eos.amount   = (uint128_t(rexbal_it->rex_balance.amount) * S0) / R0;
+        rex_pool_table rexpool_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
+        auto           rex_itr = rexpool_table.begin();
+        rex_eos.amount = vault_math::rex_to_eos(get_rex_balance().rex_balance,
+                                                rex_itr->total_lendable.amount,
+                                                rex_itr->total_rex.amount);
 
         return rex_eos;
     }
@@ -578,21 +1073,27 @@ class [[eosio::contract("vault")]] vault : public contract {
     uint64_t get_eos_rate(int64_t amount) {
         uint64_t rex_eos_amount = get_rex_eos().amount;
 
-        uint128_t eos_amount = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL).amount;
-        eos_amount += rex_eos_amount;
-        eos_amount += amount;
+        // queued payouts are still in the balance but no longer the depositors'
+        uint128_t eos_amount = vault_math::total_with(
+            get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL).amount, rex_eos_amount, amount - queued_eos());
 
         auto vault_supply = get_supply(STOKRN_ACCOUNT, symbol_code("SEOS"));
 
-        print_f("rex eos: %, total eos: % seos supply: % \n",
-                asset(rex_eos_amount, EOS_SYMBOL),
-                asset(eos_amount, EOS_SYMBOL), vault_supply);
+        VAULT_PRINT("rex eos: %, total eos: % seos supply: % \n",
+                    asset(rex_eos_amount, EOS_SYMBOL),
+                    asset(eos_amount, EOS_SYMBOL), vault_supply);
 
-        if (vault_supply.amount == 0) {
-            return RATE_BASE;
-        }
+        return vault_math::rate(eos_amount, vault_supply.amount);
+    }
 
-        return eos_amount * RATE_BASE / vault_supply.amount;
+    // rate as if `amount` more (or less when negative) was held
+    template <typename Strategy>
+    uint64_t rate_with(const s_collateral &collateral, int64_t amount) {
+        if constexpr (Strategy::counts_rex) {
+            return get_eos_rate(amount);
+        } else {
+            return get_rate(collateral.deposit_contract, asset(amount, collateral.deposit_symbol));
+        }
     }
 
     uint64_t get_rate(name contract, asset quantity) {
@@ -606,11 +1107,7 @@ class [[eosio::contract("vault")]] vault : public contract {
 
         // check(false, "balance " + balance.to_string() + " supply " + vault_supply.to_string());
 
-        if (vault_supply.amount == 0) {
-            return RATE_BASE;
-        }
-
-        return uint128_t(balance.amount) * RATE_BASE / vault_supply.amount;
+        return vault_math::rate(vault_math::total_with(balance.amount, 0, 0), vault_supply.amount);
     }
 
     s_collateral get_collateral(name contract, symbol sym, bool error_when_empty = true) {
@@ -654,17 +1151,152 @@ class [[eosio::contract("vault")]] vault : public contract {
         return *itr;
     }
 
-    uint64_t calculate_matured_rex(rex_balance_table::const_iterator rexbal_it) {
-        uint64_t matured_rex = rexbal_it->matured_rex;
-        auto     now         = time_point_sec(current_time_point());
-        auto     mr_itr      = rexbal_it->rex_maturities.begin();
-        while (mr_itr != rexbal_it->rex_maturities.end()) {
-            if (mr_itr->first <= now) {
-                matured_rex += mr_itr->second;
+    // one find and one write per call; rows of collaterals created before the
+    // table existed are added on first use
+    template <typename Lambda>
+    void update_metrics(const s_collateral &collateral, Lambda &&updater) {
+        metrics metricstbl(_self, _self.value);
+        auto    itr = metricstbl.find(collateral.id);
+        if (itr == metricstbl.end()) {
+            itr = metricstbl.emplace(_self, [&](auto &m) {
+                zero_metrics(m, collateral);
+                updater(m);
+                m.update_time = current_block_time();
+            });
+            track_ram("metrics"_n, *itr, 1, 0);
+            return;
+        }
+        metricstbl.modify(itr, same_payer, [&](auto &m) {
+            updater(m);
+            m.update_time = current_block_time();
+        });
+    }
+
+    // rows `update_metrics` writes: the row, and its ramstats when it is emplaced
+    uint32_t metrics_writes(const s_collateral &collateral) {
+        metrics metricstbl(_self, _self.value);
+        return metricstbl.find(collateral.id) == metricstbl.end() ? 2 : 1;
+    }
+
+    // the zeroed `metrics` row of a newly added collateral
+    void init_metrics(const s_collateral &collateral) {
+        metrics metricstbl(_self, _self.value);
+        auto    itr = metricstbl.emplace(_self, [&](auto &m) {
+            zero_metrics(m, collateral);
+            m.update_time = current_block_time();
+        });
+        track_ram("metrics"_n, *itr, 1, 0);
+    }
+
+    static void zero_metrics(s_metrics &m, const s_collateral &collateral) {
+        m.collateral_id         = collateral.id;
+        m.total_deposit         = asset(0, collateral.deposit_symbol);
+        m.total_withdraw        = asset(0, collateral.deposit_symbol);
+        m.withdraw_award_fees   = asset(0, collateral.deposit_symbol);
+        m.withdraw_sys_fees     = asset(0, collateral.deposit_symbol);
+        m.refund_award_quantity = asset(0, collateral.deposit_symbol);
+        m.refund_sys_quantity   = asset(0, collateral.deposit_symbol);
+        m.pending_count         = 0;
+        m.pending_quantity      = asset(0, collateral.issue_symbol);
+        m.last_rate             = RATE_BASE;
+    }
+
+    // one find per call; a collateral without an `incomes` row is still in the
+    // `s_collateral_v0` layout and is migrated on first use
+    incomes::const_iterator income_of(incomes &incometbl, collaterals &collateraltbl,
+                                      collaterals::const_iterator collateral) {
+        auto itr = incometbl.find(collateral->id);
+        if (itr != incometbl.end()) {
+            return itr;
+        }
+        return migrate_collateral_v0(incometbl, collateraltbl, collateral);
+    }
+
+    // moves the income counters of a legacy collateral row to `incomes`, then
+    // rewrites the row, which packs it again without them
+    incomes::const_iterator migrate_collateral_v0(incomes &incometbl, collaterals &collateraltbl,
+                                                  collaterals::const_iterator collateral) {
+        collaterals_v0 legacytbl(_self, _self.value);
+        auto           legacy = legacytbl.get(collateral->id, "collateral not found");
+        auto           itr    = incometbl.emplace(_self, [&](auto &i) {
+            i.collateral_id = collateral->id;
+            i.last_income   = legacy.last_income;
+            i.total_income  = legacy.total_income;
+            if (i.last_income.symbol.code() == symbol_code("")) {
+                i.last_income = asset(0, collateral->deposit_symbol);
+            }
+            if (i.total_income.symbol.code() == symbol_code("")) {
+                i.total_income = asset(0, collateral->deposit_symbol);
             }
-            mr_itr++;
+        });
+        track_ram("incomes"_n, *itr, 1, 0);
+
+        collateraltbl.modify(collateral, same_payer, [](auto &) {});
+        track_ram("collaterals"_n, legacy, -1, 0);
+        track_ram("collaterals"_n, *collateral, 1, 0);
+        return itr;
+    }
+
+    // one find and one write per collateral and income tick
+    void record_rate(uint64_t collateral_id, uint64_t time, uint64_t rate) {
+        ratehistory historytbl(_self, collateral_id);
+        uint32_t    day   = vault_math::history_day(time);
+        uint32_t    point = vault_math::history_point(time);
+        auto        itr   = historytbl.find(vault_math::history_slot(time));
+        if (itr == historytbl.end()) {
+            bool new_scope = historytbl.begin() == historytbl.end();
+            itr            = historytbl.emplace(_self, [&](auto &h) {
+                h.slot = vault_math::history_slot(time);
+                h.day  = day;
+                h.rates.assign(vault_math::HISTORY_POINTS, 0);
+                h.rates[point] = rate;
+            });
+            track_ram("ratehistory"_n, *itr, 1, new_scope);
+            return;
+        }
+        historytbl.modify(itr, same_payer, [&](auto &h) {
+            if (h.day != day) {
+                h.day = day;
+                h.rates.assign(vault_math::HISTORY_POINTS, 0);
+            }
+            h.rates[point] = rate;
+        });
+    }
+
+    // the contract of a collateral in `notifiers`, one find per call; `eosio.token` and
+    // `stoken.defi` are accepted without a row
+    void allow_notifier(name contract) {
+        if (contract == EOS_TOKEN_ACCOUNT || contract == STOKRN_ACCOUNT) {
+            return;
+        }
+        notifiers notifiertbl(_self, _self.value);
+        if (notifiertbl.find(contract.value) != notifiertbl.end()) {
+            return;
+        }
+        auto itr = notifiertbl.emplace(_self, [&](auto &n) { n.contract = contract; });
+        track_ram("notifiers"_n, *itr, 1, 0);
+    }
+
+    // one find and one write per call, only on the paths that add or remove a row;
+    // `scopes` is the change of non-empty scopes, tables scoped by the contract pass 0
+    template <typename T>
+    void track_ram(name table, const T &row, int64_t rows, int64_t scopes) {
+        ramstats stattbl(_self, _self.value);
+        int64_t  bytes   = rows * int64_t(pack_size(row));
+        auto     updater = [&](auto &s) {
+            s.rows   = std::max(int64_t(s.rows) + rows, int64_t(0));
+            s.scopes = std::max(int64_t(s.scopes) + scopes, int64_t(0));
+            s.bytes  = std::max(int64_t(s.bytes) + bytes, int64_t(0));
+        };
+        auto itr = stattbl.find(table.value);
+        if (itr == stattbl.end()) {
+            stattbl.emplace(_self, [&](auto &s) {
+                s.table = table;
+                updater(s);
+            });
+            return;
         }
-        return matured_rex;
+        stattbl.modify(itr, same_payer, updater);
     }
 
     uint64_t get_log_id() {
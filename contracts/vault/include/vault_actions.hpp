@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * The actions of the vault, `X(action)` for each: the one list the wasm `apply`
+ * of vault.cpp switches on and the native backend builds its action table from
+ * (tools/native/contracts/vault_apply.cpp). A new action is added here, next to
+ * its `[[eosio::action]]` declaration in vault.hpp.
+ */
+#define VAULT_ACTIONS(X)                                                                                    \
+    X(updatestatus) X(createcoll)   X(updatecoll)                                                           \
+    X(proxyto)      X(buyallrex)    X(buyrex)                                                               \
+    X(sellallrex)   X(sellrex)      X(payout)                                                               \
+    X(income)       X(getapy)       X(release)                                                              \
+    X(colupadtelog) X(depositlog)   X(releaselog)                                                           \
+    X(withdrawlog)  X(getram)       X(setramstat)                                                           \
+    X(planrelease)  X(planwithdraw)
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Pure integer formulas of the vault.
+ *
+ * Nothing here touches chain state, so the same header is compiled into the
+ * contract and into the native tools under `tools/`. Every function mirrors
+ * the arithmetic the contract has always used (including its truncation and
+ * 128-bit intermediates), changing one changes the on-chain results.
+ */
+namespace vault_math {
+
+    using u128 = unsigned __int128;
+    using i128 = __int128;
+
+    static constexpr uint64_t RATE_BASE   = 100000000ULL;
+    static constexpr uint64_t RATIO_BASE  = 10000;
+    static constexpr int64_t  MAX_AMOUNT  = (1LL << 62) - 1;
+
+    // 10^exponent, the unit of an asset with `exponent` decimals
+    constexpr uint64_t pow10(uint8_t exponent) {
+        uint64_t result = 1;
+        while (exponent-- > 0) {
+            result *= 10;
+        }
+        return result;
+    }
+
+    /**
+     * Exchange rate of one issued token in collateral, scaled by `RATE_BASE`.
+     *
+     * - `total` - collateral held by the vault (for EOS: liquid + REX value)
+     * - `supply` - issued token supply
+     */
+    constexpr uint64_t rate(u128 total, int64_t supply) {
+        if (supply == 0) {
+            return RATE_BASE;
+        }
+        return uint64_t(total * RATE_BASE / uint64_t(supply));
+    }
+
+    /**
+     * Collateral backing the rate, `adjust` is added before dividing
+     * (a deposit passes its negated amount because the transfer already landed).
+     */
+    constexpr u128 total_with(int64_t balance, uint64_t rex_eos, int64_t adjust) {
+        u128 total = uint64_t(balance);
+        total += rex_eos;
+        total += u128(i128(adjust));
+        return total;
+    }
+
+    // tokens issued for depositing `amount` collateral at `rate`
+    constexpr uint64_t issue_amount(int64_t amount, uint64_t rate) {
+        return uint64_t(u128(amount) * RATE_BASE / rate);
+    }
+
+    // collateral refunded for `amount` issued tokens at `rate`
+    constexpr int64_t refund_amount(int64_t amount, uint64_t rate) {
+        return int64_t(u128(amount) * rate / RATE_BASE);
+    }
+
+    // the release rate never goes below the rate locked in at withdraw time
+    constexpr uint64_t release_rate(uint64_t locked_rate, uint64_t current_rate) {
+        return current_rate < locked_rate ? locked_rate : current_rate;
+    }
+
+    // withdraw service fee on `amount`, `release_fees` in pips of 1% (64-bit product, as on chain)
+    constexpr int64_t withdraw_fees(int64_t amount, uint16_t release_fees) {
+        return amount * release_fees / int64_t(RATIO_BASE);
+    }
+
+    // `amount` * `ratio` / 10000 with the rounding of `asset::operator*` then `operator/`
+    constexpr int64_t ratio_of(int64_t amount, uint16_t ratio) {
+        return int64_t(i128(amount) * ratio / i128(RATIO_BASE));
+    }
+
+    struct split {
+        int64_t award;   // to collateral->income_account
+        int64_t sys;     // to collateral->fees_account
+    };
+
+    // split `amount` between income_account (`refund_ratio`) and fees_account (the rest)
+    constexpr split split_fees(int64_t amount, uint16_t refund_ratio) {
+        int64_t award = ratio_of(amount, refund_ratio);
+        return split { award, amount - award };
+    }
+
+    struct release_result {
+        int64_t withdraw;   // paid to the owner
+        split   fees;       // release_fees split
+        split   refund;     // rate gain since withdraw split
+    };
+
+    /**
+     * Amounts paid out when a `releases` row of `quantity` issued tokens locked
+     * at `locked_rate` is released while the vault rate is `current_rate`.
+     */
+    constexpr release_result release(int64_t quantity, uint64_t locked_rate, uint64_t current_rate,
+                                     uint16_t release_fees, uint16_t refund_ratio) {
+        uint64_t rate1   = release_rate(locked_rate, current_rate);
+        int64_t  refund0 = refund_amount(quantity, locked_rate);
+        int64_t  refund1 = refund_amount(quantity, rate1);
+        int64_t  fees    = withdraw_fees(refund0, release_fees);
+
+        release_result r {};
+        r.withdraw = refund0 - fees;
+        r.fees     = split_fees(fees, refund_ratio);
+        r.refund   = split_fees(refund1 - refund0, refund_ratio);
+        return r;
+    }
+
+    // REX bought with `eos`, S0 = rexpool total_lendable, R0 = rexpool total_rex
+    constexpr int64_t eos_to_rex(int64_t eos, int64_t total_lendable, int64_t total_rex) {
+        return int64_t(u128(eos) * uint64_t(total_rex) / uint64_t(total_lendable));
+    }
+
+    // EOS value of `rex`
+    constexpr int64_t rex_to_eos(int64_t rex, int64_t total_lendable, int64_t total_rex) {
+        return int64_t(u128(rex) * uint64_t(total_lendable) / uint64_t(total_rex));
+    }
+
+    // REX pool utilization in percent, `buyrex` stops buying at 85
+    constexpr int64_t rex_utilization(int64_t total_lent, int64_t total_lendable) {
+        return int64_t(i128(total_lent) * 100 / total_lendable);
+    }
+
+    // ratio of the income account balance moved to the vault after `periods` income periods
+    constexpr uint64_t income_ratio(uint64_t periods, uint16_t ratio) {
+        uint64_t total_ratio = periods * ratio;
+        return total_ratio > RATIO_BASE ? RATIO_BASE : total_ratio;
+    }
+
+    constexpr int64_t income_amount(int64_t balance, uint64_t periods, uint16_t ratio) {
+        return int64_t(i128(balance) * income_ratio(periods, ratio) / i128(RATIO_BASE));
+    }
+
+    // `ratehistory` keeps one point per income period for `HISTORY_DAYS` days,
+    // one row per day
+    static constexpr uint32_t HISTORY_PERIOD  = 600;
+    static constexpr uint32_t DAY_SECONDS     = 86400;
+    static constexpr uint32_t HISTORY_POINTS  = DAY_SECONDS / HISTORY_PERIOD;
+    static constexpr uint32_t HISTORY_DAYS    = 30;
+    static constexpr uint64_t YEAR_SECONDS    = 365ULL * DAY_SECONDS;
+
+    constexpr uint32_t history_day(uint64_t time) { return uint32_t(time / DAY_SECONDS); }
+    constexpr uint64_t history_slot(uint64_t time) { return history_day(time) % HISTORY_DAYS; }
+    constexpr uint32_t history_point(uint64_t time) {
+        return uint32_t(time % DAY_SECONDS / HISTORY_PERIOD);
+    }
+
+    /**
+     * Yield between `rate0` and `rate1` taken `seconds` apart, annualized without
+     * compounding and scaled by `RATE_BASE` (100000000 = 100%). Negative when the
+     * rate fell, saturates instead of overflowing.
+     */
+    constexpr int64_t annualized_yield(uint64_t rate0, uint64_t rate1, uint64_t seconds) {
+        if (rate0 == 0 || seconds == 0) {
+            return 0;
+        }
+        i128 yield = (i128(rate1) - i128(rate0)) * i128(RATE_BASE) * i128(YEAR_SECONDS)
+                     / (i128(rate0) * i128(seconds));
+        if (yield > i128(INT64_MAX)) return INT64_MAX;
+        if (yield < i128(INT64_MIN)) return INT64_MIN;
+        return int64_t(yield);
+    }
+
+    /**
+     * Sum of matured REX: `matured_rex` plus every maturity bucket at or before `now`.
+     * `Maturities` iterates `std::pair`-like entries of (time, amount).
+     */
+    template <typename Maturities, typename Time>
+    uint64_t matured_rex(int64_t matured, const Maturities &maturities, const Time &now) {
+        uint64_t sum = matured;
+        for (const auto &m : maturities) {
+            if (m.first <= now) {
+                sum += m.second;
+            }
+        }
+        return sum;
+    }
+
+} // namespace vault_math
@@ -1,6 +1,6 @@
 #include <vault.hpp>
+#include <vault_actions.hpp>
 
-#include <cmath>
 
 using std::make_tuple;
 
@@ -46,12 +46,21 @@ void vault::createcoll(const name &contract, const symbol &sym, const name &inco
         a.min_quantity     = min_quantity;
         a.release_fees     = release_fees;
         a.refund_ratio     = refund_ratio;
-        a.last_income      = asset(0, sym);
-        a.total_income     = asset(0, sym);
     });
+    track_ram("collaterals"_n, *itr, 1, 0);
+
+    incomes incometbl(_self, _self.value);
+    auto    income = incometbl.emplace(_self, [&](auto &i) {
+        i.collateral_id = new_id;
+        i.last_income   = asset(0, sym);
+        i.total_income  = asset(0, sym);
+    });
+    track_ram("incomes"_n, *income, 1, 0);
+    init_metrics(*itr);
+    allow_notifier(contract);
 
     // Create SEOS tokens with a total circulation of 1 billion, with the same bit precision
-    uint32_t prec_num = pow(10, sym.precision());
+    uint32_t prec_num = vault_math::pow10(sym.precision());
     auto data = std::make_tuple(_self, asset(1000000000ULL * prec_num, issue_symbol));
     action(permission_level { _self, "active"_n }, STOKRN_ACCOUNT, "create"_n, data)
         .send();
@@ -78,6 +87,12 @@ void vault::updatecoll(uint64_t collateral_id, const name &income_account,
     check(itr->deposit_symbol == min_quantity.symbol,
           "min_quantity symbol error");
 
+    // a legacy row keeps its income counters only until it is rewritten
+    incomes incometbl(_self, _self.value);
+    income_of(incometbl, collateraltbl, itr);
+    // collaterals created before `notifiers` existed are added when rewritten
+    allow_notifier(itr->deposit_contract);
+
     collateraltbl.modify(itr, same_payer, [&](auto &a) {
         a.income_account = income_account;
         a.fees_account   = fees_account;
@@ -116,7 +131,9 @@ void vault::buyrex(asset quantity) {
     }
 
     // Do not operate until the balance is more than 1 eos
-    auto eos_balance = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL);
+    // the queued payouts are paid first, EOS still owed to them is not staked
+    auto eos_balance = pay_queued();
+    eos_balance.amount -= queued_eos();
     if (quantity.amount == 0) {
         quantity = eos_balance;
     }
@@ -128,9 +145,9 @@ void vault::buyrex(asset quantity) {
     // The whole network rex mortgage rate exceeds 85, no longer buy, and to sell all directly
     rex_pool_table rexpool_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
     auto           itr = rexpool_table.begin();
-    auto           pct = itr->total_lent * 100 / itr->total_lendable;
+    auto pct = vault_math::rex_utilization(itr->total_lent.amount, itr->total_lendable.amount);
     if (pct >= 85) {
-        withdraw_sellrex(_self, asset(0, EOS_SYMBOL), asset(0, EOS_SYMBOL), "sell all REX");
+        withdraw_sellrex(asset(0, EOS_SYMBOL));
         return;
     }
 
@@ -140,7 +157,7 @@ void vault::buyrex(asset quantity) {
 void vault::sellallrex() {
     require_auth(ADMIN_ACCOUNT);
 
-    withdraw_sellrex(_self, asset(0, EOS_SYMBOL), asset(0, EOS_SYMBOL), "sell all REX");
+    withdraw_sellrex(asset(0, EOS_SYMBOL));
 }
 
 void vault::sellrex(asset quantity) {
@@ -152,38 +169,18 @@ void vault::sellrex(asset quantity) {
     // Sell the excess
     check(quantity <= total_eos, string("not enough rex to sell"));
 
-    withdraw_sellrex(_self, quantity, asset(0, EOS_SYMBOL), "REX reward");
-}
-
-void vault::sellnext(name owner, asset quantity, string memo) {
-    require_auth(_self);
-
-    action(permission_level { _self, "active"_n }, _self, name("sellnext2"),
-           make_tuple(owner, quantity, memo))
-        .send();
+    withdraw_sellrex(quantity);
 }
 
-void vault::sellnext2(name owner, asset quantity, string memo) {
-    require_auth(_self);
-
-    if (owner != _self) {
-        auto balance = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL);
-        if (quantity > balance) {
-            if ((quantity - balance).amount < 10) {
-                // The error of 0.001 was the acceptable range
-                quantity = balance;
-            } else {
-                print_f("%, % \n", quantity, balance);
-                check(false, "error! no enough eos to transfer.");
-            }
-        }
-        // print_f("%, % \n", quantity, balance);
-        // check(false, "");
-        auto data = std::make_tuple(_self, owner, quantity, memo);
-        action(permission_level { _self, "active"_n }, EOS_TOKEN_ACCOUNT, "transfer"_n, data)
-            .send();
-
-        // check_for_released(owner);
+// keeper or admin only: each call that finds the liquid balance short sells REX
+void vault::payout() {
+    if (!has_auth(KEEPER_ACCOUNT)) {
+        require_auth(ADMIN_ACCOUNT);
+    }
+    auto balance = pay_queued();
+    // the EOS of the sell pays the rest in `on_tokens_transfer`
+    if (queued_eos() > balance.amount) {
+        withdraw_sellrex(asset(queued_eos() - balance.amount + 1, EOS_SYMBOL));
     }
 }
 
@@ -196,17 +193,15 @@ void vault::income() {
     }
     if (_config.last_income_time > 0) {
         collaterals collateraltbl(_self, _self.value);
+        incomes     incometbl(_self, _self.value);
         auto        itr = collateraltbl.begin();
         while (itr != collateraltbl.end()) {
             auto period = (this_time - _config.last_income_time) / ten_minutes;
             if (period > 0) {
-                uint64_t total_ratio = period * itr->income_ratio;
-                if (total_ratio > 10000) {
-                    total_ratio = 10000;
-                }
                 auto quantity = get_balance(itr->deposit_contract,
-                                            itr->income_account, itr->deposit_symbol)
-                                * total_ratio / 10000L;
+                                            itr->income_account, itr->deposit_symbol);
+                quantity.amount = vault_math::income_amount(quantity.amount, period,
+                                                            itr->income_ratio);
 
                 // transfer to self
                 if (quantity.amount > 0) {
@@ -217,13 +212,15 @@ void vault::income() {
                         .send();
                 }
                 // save
-                collateraltbl.modify(itr, same_payer, [&](auto &c) {
-                    c.last_income = quantity;
-                    if (c.total_income.symbol.code() == symbol_code("")) {
-                        c.total_income.symbol = itr->deposit_symbol;
-                    }
-                    c.total_income += quantity;
+                incometbl.modify(income_of(incometbl, collateraltbl, itr), same_payer, [&](auto &i) {
+                    i.last_income = quantity;
+                    i.total_income += quantity;
                 });
+
+                // the transfer above runs after this action, count it in the recorded rate
+                record_rate(itr->id, this_time, with_strategy(*itr, [&](auto s) {
+                                return rate_with<decltype(s)>(*itr, quantity.amount);
+                            }));
             }
             itr++;
         }
@@ -232,6 +229,220 @@ void vault::income() {
     _configs.set(_config, _self);
 }
 
+vault::apy_result vault::getapy(uint64_t collateral_id) {
+    get_collateral_by_id(collateral_id);
+
+    // at most 30 rows, read once and indexed by slot
+    std::vector<s_rate_day> days(vault_math::HISTORY_DAYS);
+    ratehistory             historytbl(_self, collateral_id);
+    for (auto itr = historytbl.begin(); itr != historytbl.end(); itr++) {
+        days[itr->slot] = *itr;
+    }
+    auto rate_at = [&](uint64_t time) -> uint64_t {
+        const auto &d = days[vault_math::history_slot(time)];
+        if (d.day != vault_math::history_day(time) || d.rates.empty()) {
+            return 0;
+        }
+        return d.rates[vault_math::history_point(time)];
+    };
+
+    const uint64_t period = vault_math::HISTORY_PERIOD;
+    const uint64_t span   = uint64_t(vault_math::HISTORY_DAYS) * vault_math::DAY_SECONDS;
+    uint64_t       now    = current_time_point().sec_since_epoch();
+    uint64_t       oldest = now - now % period - span + period;
+
+    apy_result result {};
+    result.collateral_id = collateral_id;
+    uint64_t last        = now - now % period;
+    while (last >= oldest && rate_at(last) == 0) {
+        last -= period;
+    }
+    if (last < oldest) {
+        return result;
+    }
+    result.rate = rate_at(last);
+    result.time = time_point_sec(last);
+
+    // first recorded point inside the window ending at `last`
+    auto apy = [&](uint32_t window_days) -> int64_t {
+        uint64_t from = last - uint64_t(window_days) * vault_math::DAY_SECONDS;
+        from          = from < oldest ? oldest : from;
+        while (from < last && rate_at(from) == 0) {
+            from += period;
+        }
+        return vault_math::annualized_yield(rate_at(from), result.rate, last - from);
+    };
+    result.apy_1d  = apy(1);
+    result.apy_7d  = apy(7);
+    result.apy_30d = apy(30);
+    return result;
+}
+
+std::vector<vault::ram_usage> vault::getram() {
+    struct table_class {
+        name code;
+        name table;
+        name scope_class;
+    };
+    const table_class tables[] = {
+        { _self, "collaterals"_n, "self"_n },
+        { _self, "incomes"_n, "self"_n },
+        { _self, "metrics"_n, "self"_n },
+        { _self, "notifiers"_n, "self"_n },
+        { _self, "payouts"_n, "self"_n },
+        { _self, "ratehistory"_n, "collateral"_n },
+        { _self, "releases"_n, "owner"_n },
+        { STOKRN_ACCOUNT, "stat"_n, "symbol"_n },
+        { STOKRN_ACCOUNT, "accounts"_n, "holder"_n },
+    };
+
+    // the config singleton always holds one row
+    std::vector<ram_usage> result;
+    result.push_back({ _self, "config"_n, "self"_n, 1, 1, pack_size(_config) + RAM_ROW_OVERHEAD });
+
+    for (const auto &t : tables) {
+        ramstats stattbl(t.code, t.code.value);
+        auto     itr   = stattbl.find(t.table.value);
+        ram_usage usage { t.code, t.table, t.scope_class, 0, 0, 0 };
+        if (itr != stattbl.end()) {
+            usage.rows   = itr->rows;
+            usage.scopes = t.scope_class == "self"_n ? uint64_t(itr->rows > 0) : itr->scopes;
+            usage.bytes  = itr->bytes + itr->rows * RAM_ROW_OVERHEAD;
+        }
+        result.push_back(usage);
+    }
+    return result;
+}
+
+vault::payout_plan vault::planrelease(name owner) {
+    payout_plan plan { true, "", 0, time_point_sec(), {}, asset(0, REX_SYMBOL), asset(0, EOS_SYMBOL), "", 0, 0 };
+    if (_config.withdraw_status != 1) {
+        plan.ok    = false;
+        plan.error = "withdraw has been suspended";
+        return plan;
+    }
+    // as `check_for_released`: nothing due, nothing done
+    releases releasetbl(_self, owner.value);
+    auto     itr = releasetbl.begin();
+    if (itr == releasetbl.end() || itr->time.to_time_point() > current_time_point()) {
+        return plan;
+    }
+    plan.release_id   = itr->id;
+    plan.release_time = itr->time.to_time_point();
+
+    auto collateral = get_collateral_by_issue_symbol(itr->quantity.symbol);
+    with_strategy(collateral, [&](auto s) {
+        using Strategy = decltype(s);
+        auto amounts   = vault_math::release(itr->quantity.amount, itr->rate, rate_with<Strategy>(collateral, 0),
+                                             collateral.release_fees, collateral.refund_ratio);
+        add_release_transfers<Strategy>(collateral, owner, amounts);
+    });
+    // as `release_first`: retire and withdrawlog; the release row erased, its ramstats and metrics
+    plan.inline_actions = 2;
+    plan.rows_written   = 2 + metrics_writes(collateral);
+    plan_payout(plan, plan.inline_actions, plan.rows_written);
+    if (!plan.payout_error.empty()) {
+        plan.ok    = false;
+        plan.error = plan.payout_error;
+    }
+    return plan;
+}
+
+vault::payout_plan vault::planwithdraw(name owner, asset quantity) {
+    payout_plan plan { true, "", 0, time_point_sec(), {}, asset(0, REX_SYMBOL), asset(0, EOS_SYMBOL), "", 0, 0 };
+    auto        collateral = get_collateral_by_issue_symbol(quantity.symbol);
+    if (_config.withdraw_status != 1) {
+        plan.error = "withdraw has been suspended";
+    } else if (quantity.amount <= 0) {
+        plan.error = "must transfer positive quantity";
+    } else if (get_balance(STOKRN_ACCOUNT, owner, quantity.symbol) < quantity) {
+        plan.error = "overdrawn balance";
+    }
+    if (!plan.error.empty()) {
+        plan.ok = false;
+        return plan;
+    }
+    plan.release_id   = _config.log_id + 1;
+    plan.release_time = current_time_point() + days(5);
+    // as `do_withdraw`: releaselog; config (log_id), the release row, its ramstats and metrics
+    plan.inline_actions = 1;
+    plan.rows_written   = 3 + metrics_writes(collateral);
+
+    // the release paid today: no rate gain, so no refund
+    with_strategy(collateral, [&](auto s) {
+        using Strategy = decltype(s);
+        uint64_t rate  = rate_with<Strategy>(collateral, 0);
+        auto     amounts
+            = vault_math::release(quantity.amount, rate, rate, collateral.release_fees, collateral.refund_ratio);
+        add_release_transfers<Strategy>(collateral, owner, amounts);
+    });
+    // the work of that release is done by `release`, not by the withdraw
+    uint32_t release_actions = 0, release_rows = 0;
+    plan_payout(plan, release_actions, release_rows);
+    return plan;
+}
+
+// `send_transfers` for the transfers added to `_transfers`, recorded in `plan` instead of sent;
+// the actions and rows they take are added to `inline_actions` and `rows_written`
+void vault::plan_payout(payout_plan &plan, uint32_t &inline_actions, uint32_t &rows_written) {
+    int64_t short_eos = plan_transfers();
+    bool    queued    = false;
+    for (const auto &t : _transfers) {
+        plan.transfers.push_back({ t.contract, t.to, t.quantity, t.memo, t.queued });
+        if (t.queued) {
+            rows_written += 2;   // the payouts row and its ramstats
+            queued = true;
+        } else {
+            inline_actions++;
+        }
+    }
+    if (queued) {
+        rows_written++;   // config, the queued total
+    }
+    _transfers.clear();
+    if (short_eos <= 0) {
+        return;
+    }
+    auto sale = rex_for(asset(short_eos + 1, EOS_SYMBOL));
+    if (sale.rex.amount <= 0) {
+        return;
+    }
+    plan.sell_rex = sale.rex;
+    plan.sell_eos = sale.eos;
+    inline_actions += 2;   // sellrex, withdraw
+    if (sale.eos > sale.unlent) {
+        plan.payout_error = "rex pool cannot pay the sell";
+    }
+}
+
+void vault::setramstat(name code, name table, uint64_t scopes, uint64_t rows, uint64_t bytes) {
+    require_auth(ADMIN_ACCOUNT);
+    check(code == _self || code == STOKRN_ACCOUNT, "code must be vault or stoken");
+    if (code == STOKRN_ACCOUNT) {
+        action(permission_level { _self, "active"_n }, STOKRN_ACCOUNT, "setramstat"_n,
+               std::make_tuple(table, scopes, rows, bytes))
+            .send();
+        return;
+    }
+    check(table == "collaterals"_n || table == "incomes"_n || table == "metrics"_n || table == "notifiers"_n
+              || table == "payouts"_n || table == "ratehistory"_n || table == "releases"_n,
+          "table not tracked");
+
+    ramstats stattbl(_self, _self.value);
+    auto     updater = [&](auto &s) {
+        s.table  = table;
+        s.scopes = scopes;
+        s.rows   = rows;
+        s.bytes  = bytes;
+    };
+    auto itr = stattbl.find(table.value);
+    if (itr == stattbl.end()) {
+        stattbl.emplace(_self, updater);
+    } else {
+        stattbl.modify(itr, same_payer, updater);
+    }
+}
+
 void vault::release(name owner) {
     check(_config.withdraw_status == 1, "withdraw has been suspended");
     check_for_released(owner);
@@ -263,47 +474,188 @@ void vault::withdrawlog(uint64_t log_id, uint64_t collateral_id, const name &own
     require_auth(_self);
 }
 
-// deposit
+bool vault::accepts_transfer(name self, name code, const char *data, uint32_t size) {
+    name                     from, to;
+    datastream<const char *> ds(data, size);
+    ds >> from >> to;
+    if (from == self || to != self || from == ADMIN_ACCOUNT || from == EOSIO_ACCOUNT) {
+        return false;
+    }
+    if (from == EOS_REX_ACCOUNT) {
+        return code == EOS_TOKEN_ACCOUNT;
+    }
+    if (code == EOS_TOKEN_ACCOUNT || code == STOKRN_ACCOUNT) {
+        return true;
+    }
+    // other token contracts: one find, before anything else is read
+    notifiers notifiertbl(self, self.value);
+    if (notifiertbl.find(code.value) != notifiertbl.end()) {
+        return true;
+    }
+    // a collateral created before `notifiers` existed, `on_tokens_transfer` adds its row
+    collaterals collateraltbl(self, self.value);
+    auto        itr = collateraltbl.begin();
+    while (itr != collateraltbl.end() && itr->deposit_contract != code) {
+        itr++;
+    }
+    check(itr != collateraltbl.end(), "deposit token not found");
+    return true;
+}
+
+bool vault::runs_notification(name self, name code, name action) {
+    if (action != "transfer"_n) {
+        return false;
+    }
+    // `from` and `to` are all the filter reads
+    char     head[2 * sizeof(uint64_t)];
+    uint32_t size = read_action_data(head, sizeof(head));
+    return accepts_transfer(self, code, head, size);
+}
+
+// deposit, for the transfers `accepts_transfer` lets through
 void vault::on_tokens_transfer(name from, name to, asset quantity, string memo) {
-    if (from == _self || to != _self || from == ADMIN_ACCOUNT
-        || from == EOSIO_ACCOUNT || from == EOS_REX_ACCOUNT) {
+    auto code = get_first_receiver();
+    if (from == EOS_REX_ACCOUNT) {
+        // the EOS of a REX sell, see `withdraw_sellrex`
+        if (code == EOS_TOKEN_ACCOUNT && quantity.symbol == EOS_SYMBOL) {
+            pay_queued();
+        }
         return;
     }
-    auto code = get_first_receiver();
     if (code == STOKRN_ACCOUNT) {
         auto collateral = get_collateral_by_issue_symbol(quantity.symbol);
-        do_withdraw(collateral, from, quantity);
+        with_strategy(collateral, [&](auto s) { do_withdraw<decltype(s)>(collateral, from, quantity); });
     } else {
         auto collateral = get_collateral(code, quantity.symbol);
-        do_deposit(collateral, from, quantity);
+        allow_notifier(code);
+        with_strategy(collateral, [&](auto s) { do_deposit<decltype(s)>(collateral, from, quantity); });
     }
 }
 
-void vault::transfer_token_to(name contract, name to, asset quantity, string memo) {
-    // transfer_tokens_to(v[tsf_data] tsfs)
-    if (contract == EOS_TOKEN_ACCOUNT && quantity.symbol == EOS_SYMBOL) {
-        static auto balance = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL);
-        if (quantity > balance) {
+template <typename Strategy>
+void vault::add_release_transfers(const s_collateral &collateral, const name &owner,
+                                  const vault_math::release_result &amounts) {
+    auto add = [&](name to, int64_t amount, const char *memo, memo_class kind) {
+        if (amount > 0) {
+            transfer_token_to<Strategy>(collateral.deposit_contract, to,
+                                        asset(amount, collateral.deposit_symbol), string(memo), kind);
+        }
+    };
+    add(owner, amounts.withdraw, "withdraw", memo_class::withdraw);
+    add(collateral.income_account, amounts.fees.award, "withdraw fees", memo_class::fees);
+    add(collateral.fees_account, amounts.fees.sys, "withdraw fees", memo_class::fees);
+    add(collateral.income_account, amounts.refund.award, "refund", memo_class::fees);
+    add(collateral.fees_account, amounts.refund.sys, "refund", memo_class::fees);
+}
+
+template <typename Strategy>
+void vault::transfer_token_to(name contract, name to, asset quantity, string memo, memo_class kind) {
+    add_transfer(contract, to, quantity, memo, kind, Strategy::sells_rex_on_payout);
+}
+
+namespace {
+
+    // appends the entries of `memo` missing from `joined`, compared whole: "withdraw"
+    // is not in "withdraw fees". A queued payout brings its memo already joined
+    void join_memo(string &joined, const string &memo) {
+        auto has = [&](const string &entry) {
+            for (size_t start = 0;;) {
+                size_t end = joined.find(", ", start);
+                if (joined.compare(start, end == string::npos ? string::npos : end - start, entry) == 0) {
+                    return true;
+                }
+                if (end == string::npos) {
+                    return false;
+                }
+                start = end + 2;
+            }
+        };
+        for (size_t start = 0;;) {
+            size_t end   = memo.find(", ", start);
+            auto   entry = memo.substr(start, end == string::npos ? string::npos : end - start);
+            if (!has(entry)) {
+                joined += ", " + entry;
+            }
+            if (end == string::npos) {
+                return;
+            }
+            start = end + 2;
+        }
+    }
+
+} // namespace
+
+// adds to the transfer of the same contract, recipient, symbol and class, the
+// memos joined: "withdraw fees, refund"
+void vault::add_transfer(name contract, name to, asset quantity, const string &memo, memo_class kind,
+                         bool sells_rex) {
+    for (auto &t : _transfers) {
+        if (t.contract != contract || t.to != to || t.quantity.symbol != quantity.symbol || t.kind != kind) {
+            continue;
+        }
+        t.quantity += quantity;
+        join_memo(t.memo, memo);
+        return;
+    }
+    _transfers.push_back({ contract, to, quantity, memo, kind, sells_rex });
+}
+
+// the EOS transfers are paid from the liquid balance; from the first one it does not
+// cover on, they are marked queued. Returns the EOS they are short of
+int64_t vault::plan_transfers() {
+    int64_t short_eos = 0;
+    for (auto &t : _transfers) {
+        if (!t.sells_rex) {
+            continue;
+        }
+        if (!_eos_balance) {
+            _eos_balance = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL);
+            _eos_balance->amount -= queued_eos();
+        }
+        auto &balance = *_eos_balance;
+        if (short_eos > 0 || t.quantity > balance) {
             // If the collateral retrieved is less than the available balance, the corresponding unlockable REX number is retrieved
-            // Get the eos difference
-            auto diff_eos = quantity - balance;
-            print_f("transfer to % quantity %, balance % sellrex: % (%)\n", to,
-                    quantity, balance, diff_eos);
+            auto diff_eos = t.quantity - balance;
+            VAULT_PRINT("transfer to % quantity %, balance % sellrex: % (%)\n", t.to,
+                        t.quantity, balance, diff_eos);
+            short_eos += diff_eos.amount;
             balance.amount = 0;
-            diff_eos.amount += 1;   // Prevention of errors
-            // sell it and you get the EOS
-            withdraw_sellrex(to, diff_eos, quantity, memo);
-            return;
+            t.queued       = true;
+            continue;
         }
-        balance -= quantity;
-        print_f("transfer quantity: %, balance %\n", quantity, balance);
+        balance -= t.quantity;
+        VAULT_PRINT("transfer quantity: %, balance %\n", t.quantity, balance);
+    }
+    return short_eos;
+}
+
+// sends the summed transfers in the order they were first added, the queued ones
+// go to `payouts` and matured REX is sold once for all of them
+void vault::send_transfers() {
+    int64_t short_eos = plan_transfers();
+    bool    queued    = false;
+    for (const auto &t : _transfers) {
+        if (t.queued) {
+            // queued behind the earlier payouts, the EOS of the sell pays it; without
+            // matured REX it waits for the next sell or `payout`
+            queue_payout(t.to, t.quantity, t.memo);
+            queued = true;
+            continue;
+        }
+        auto data = std::make_tuple(_self, t.to, t.quantity, t.memo);
+        action(permission_level { _self, "active"_n }, t.contract, "transfer"_n, data).send();
+    }
+    _transfers.clear();
+    if (queued) {
+        _configs.set(_config, _self);
+    }
+    if (short_eos > 0) {
+        withdraw_sellrex(asset(short_eos + 1, EOS_SYMBOL));   // +1 prevention of errors
     }
-    // print_f("transfer quantity: %\n", quantity);
-    auto data = std::make_tuple(_self, to, quantity, memo);
-    action(permission_level { _self, "active"_n }, contract, "transfer"_n, data).send();
 }
 
-void vault::do_deposit(s_collateral collateral, const name &owner, const asset &quantity) {
+template <typename Strategy>
+void vault::do_deposit(const s_collateral &collateral, const name &owner, const asset &quantity) {
     if (owner == collateral.income_account) {
         return;
     }
@@ -311,14 +663,11 @@ void vault::do_deposit(s_collateral collateral, const name &owner, const asset &
 
     check(quantity >= collateral.min_quantity, "deposit too small");
 
-    auto is_eos = collateral.deposit_contract == EOS_TOKEN_ACCOUNT
-                  && collateral.deposit_symbol == EOS_SYMBOL;
-    uint64_t rate = is_eos ? get_eos_rate(quantity.amount * -1)
-                           : get_rate(collateral.deposit_contract, quantity * -1);
-    print_f("rate: %, ", rate);
+    uint64_t rate = rate_with<Strategy>(collateral, quantity.amount * -1);
+    VAULT_PRINT("rate: %, ", rate);
 
-    uint64_t issue_amount = uint128_t(quantity.amount) * RATE_BASE / rate;
-    print_f("issue: % ", asset(issue_amount, collateral.issue_symbol));
+    uint64_t issue_amount = vault_math::issue_amount(quantity.amount, rate);
+    VAULT_PRINT("issue: % ", asset(issue_amount, collateral.issue_symbol));
     // check(false, collateral.deposit_contract.to_string());
 
     auto issue_quantity = asset(issue_amount, collateral.issue_symbol);
@@ -331,38 +680,48 @@ void vault::do_deposit(s_collateral collateral, const name &owner, const asset &
                                  current_block_time());
     action(permission_level { _self, "active"_n }, _self, "depositlog"_n, data2).send();
 
+    update_metrics(collateral, [&](auto &m) {
+        m.total_deposit += quantity;
+        m.last_rate = rate;
+    });
+
     // buy rex
-    if (is_eos) {
+    if constexpr (Strategy::lends_to_rex) {
         action(permission_level { _self, "active"_n }, _self, "buyallrex"_n, std::make_tuple())
             .send();
     }
 }
 
 // withdraw
-void vault::do_withdraw(s_collateral collateral, const name &owner, const asset &quantity) {
+template <typename Strategy>
+void vault::do_withdraw(const s_collateral &collateral, const name &owner, const asset &quantity) {
     check(_config.withdraw_status == 1, "withdraw has been suspended");
 
-    auto is_eos = collateral.deposit_contract == EOS_TOKEN_ACCOUNT
-                  && collateral.deposit_symbol == EOS_SYMBOL;
-    uint64_t rate = is_eos ? get_eos_rate(0)
-                           : get_rate(collateral.deposit_contract,
-                                      asset(0, collateral.deposit_symbol));
-    print_f("rate: %, ", rate);
+    uint64_t rate = rate_with<Strategy>(collateral, 0);
+    VAULT_PRINT("rate: %, ", rate);
 
     auto etime = current_time_point() + days(5);   // minutes(5);
 
     releases releasetbl(_self, owner.value);
     uint64_t release_id = get_log_id();
-    releasetbl.emplace(_self, [&](auto &s) {
+    bool     new_scope  = releasetbl.begin() == releasetbl.end();
+    auto     release    = releasetbl.emplace(_self, [&](auto &s) {
         s.id       = release_id;
         s.quantity = quantity;
         s.rate     = rate;
         s.time     = block_timestamp(etime);
     });
+    track_ram("releases"_n, *release, 1, new_scope);
 
     auto data = std::make_tuple(release_id, collateral.id, owner, quantity,
                                 rate, block_timestamp(etime));
     action(permission_level { _self, "active"_n }, _self, "releaselog"_n, data).send();
+
+    update_metrics(collateral, [&](auto &m) {
+        m.pending_count += 1;
+        m.pending_quantity += quantity;
+        m.last_rate = rate;
+    });
 }
 
 void vault::deposit_buyrex(asset quantity) {
@@ -372,9 +731,9 @@ void vault::deposit_buyrex(asset quantity) {
     rex_pool_table rexpool_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
     auto           rex_itr = rexpool_table.begin();
 
-    const int64_t S0         = rex_itr->total_lendable.amount;
-    const int64_t R0         = rex_itr->total_rex.amount;
-    const int64_t rex_amount = (uint128_t(quantity.amount) * R0) / S0;
+    const int64_t rex_amount = vault_math::eos_to_rex(quantity.amount,
+                                                      rex_itr->total_lendable.amount,
+                                                      rex_itr->total_rex.amount);
     auto          rex_value  = asset(rex_amount, REX_SYMBOL);
 
     // check(false, string("eos:") + quantity.to_string() + string(", rex:") + rex_value.to_string());
@@ -390,29 +749,26 @@ void vault::deposit_buyrex(asset quantity) {
         .send();
 }
 
-void vault::withdraw_sellrex(name user, asset sell_quantity, asset tsf_quantity, string memo) {
-    check(sell_quantity.symbol == EOS_SYMBOL, "invalid symbol");
-    check(sell_quantity.amount >= 0, "invalid amount");
-
+// the matured REX a sell of `sell_quantity` EOS takes, all of it for 0, drawn from `_matured_rex`
+vault::rex_sale vault::rex_for(asset sell_quantity) {
     rex_pool_table rexpool_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
     auto           rex_itr   = rexpool_table.begin();
     auto           rex_value = asset(0, REX_SYMBOL);
-    auto rate = (double)(rex_itr->total_rex.amount) / rex_itr->total_lendable.amount;
     const int64_t     S0 = rex_itr->total_lendable.amount;
     const int64_t     R0 = rex_itr->total_rex.amount;
-    rex_balance_table rexbal_table(EOSIO_ACCOUNT, EOSIO_ACCOUNT.value);
-    auto              rexbal_it = rexbal_table.find(_self.value);
 
     // It is necessary to calculate the available REX that has expired
-    static uint64_t matured_rex
-        = rexbal_it == rexbal_table.end() ? 0 : calculate_matured_rex(rexbal_it);
-    print_f("matured_rex %\n", matured_rex);
+    if (!_matured_rex) {
+        _matured_rex = get_rex_balance().matured_rex;
+    }
+    uint64_t &matured_rex = *_matured_rex;
+    VAULT_PRINT("matured_rex %\n", matured_rex);
 
     if (sell_quantity.amount == 0) {
         rex_value.amount = matured_rex;
         matured_rex      = 0;
     } else {
-        int64_t rex_amount = (uint128_t(sell_quantity.amount) * R0) / S0;
+        int64_t rex_amount = vault_math::eos_to_rex(sell_quantity.amount, S0, R0);
         if (rex_amount > matured_rex) {
             rex_amount  = matured_rex;
             matured_rex = 0;
@@ -420,30 +776,82 @@ void vault::withdraw_sellrex(name user, asset sell_quantity, asset tsf_quantity,
             matured_rex -= rex_amount;
         }
         rex_value.amount = rex_amount;
-        // check(false, string("rex_value:") + rex_value.to_string()+ ",rate:" + to_string(rate));
     }
-    sell_quantity.amount = (uint128_t(rex_value.amount) * S0) / R0;
-    // if (user != name("tester1")) {
-    // check(false, string("sell rex:") + rex_value.to_string() +  string(", matured rex:") + asset(matured_rex, REX_SYMBOL).to_string() +  string(", sell eos:") + sell_quantity.to_string());
-    // }
-    if (rex_value.amount <= 0) {
+    sell_quantity.amount = vault_math::rex_to_eos(rex_value.amount, S0, R0);
+    return rex_sale { rex_value, sell_quantity, rex_itr->total_unlent };
+}
+
+void vault::withdraw_sellrex(asset sell_quantity) {
+    check(sell_quantity.symbol == EOS_SYMBOL, "invalid symbol");
+    check(sell_quantity.amount >= 0, "invalid amount");
+
+    auto sale = rex_for(sell_quantity);
+    if (sale.rex.amount <= 0) {
         return;
     }
 
     // Use reserves to buy rex
     action(permission_level { _self, "active"_n }, EOSIO_ACCOUNT,
-           name("sellrex"), make_tuple(_self, rex_value))
+           name("sellrex"), make_tuple(_self, sale.rex))
         .send();
 
-    // The reserve is withdrawn
+    // The reserve is withdrawn, the transfer from eosio.rex pays the queued payouts
     action(permission_level { _self, "active"_n }, EOSIO_ACCOUNT,
-           name("withdraw"), make_tuple(_self, sell_quantity))
+           name("withdraw"), make_tuple(_self, sale.eos))
         .send();
+}
 
-    // To withdraw cash to the user, the next action needs to be called, otherwise the eos will not arrive
-    action(permission_level { _self, "active"_n }, _self, name("sellnext"),
-           make_tuple(user, tsf_quantity, memo))
-        .send();
+// the new total is stored by `send_transfers`, once for all the rows it queues
+void vault::queue_payout(name to, asset quantity, string memo) {
+    int64_t queued = queued_eos();
+    payouts payouttbl(_self, _self.value);
+    auto    itr = payouttbl.emplace(_self, [&](auto &p) {
+        p.id       = payouttbl.available_primary_key();
+        p.to       = to;
+        p.quantity = quantity;
+        p.memo     = memo;
+    });
+    track_ram("payouts"_n, *itr, 1, 0);
+    _config.queued_eos.emplace(queued + quantity.amount);
+}
+
+// pays the queued payouts from the head while the liquid balance covers the next
+// one, returns the liquid EOS left
+asset vault::pay_queued() {
+    auto    balance = get_balance(EOS_TOKEN_ACCOUNT, _self, EOS_SYMBOL);
+    bool    summed  = !_config.queued_eos.has_value();
+    int64_t queued  = queued_eos();
+    payouts payouttbl(_self, _self.value);
+    auto    itr  = payouttbl.begin();
+    bool    paid = false;
+    while (itr != payouttbl.end()) {
+        auto quantity = itr->quantity;
+        if (quantity > balance) {
+            if ((quantity - balance).amount >= 10) {
+                break;
+            }
+            // The error of 0.001 was the acceptable range
+            quantity = balance;
+        }
+        if (quantity.amount > 0) {
+            add_transfer(EOS_TOKEN_ACCOUNT, itr->to, quantity, itr->memo, memo_class::queued, false);
+        }
+        balance -= quantity;
+        queued -= itr->quantity.amount;
+        paid     = true;
+        auto row = *itr;
+        itr      = payouttbl.erase(itr);
+        track_ram("payouts"_n, row, -1, 0);
+    }
+
+    // the rows paid are no longer queued, one transfer per recipient
+    send_transfers();
+
+    if (paid || summed) {
+        _config.queued_eos.emplace(queued);
+        _configs.set(_config, _self);
+    }
+    return balance;
 }
 
 void vault::check_for_released(const name &owner) {
@@ -456,74 +864,119 @@ void vault::check_for_released(const name &owner) {
             return;
         }
         auto collateral = get_collateral_by_issue_symbol(itr->quantity.symbol);
+        with_strategy(collateral, [&](auto s) {
+            release_first<decltype(s)>(collateral, owner, releasetbl, itr);
+        });
+    }
+}
 
-        auto is_eos = collateral.deposit_contract == EOS_TOKEN_ACCOUNT
-                      && collateral.deposit_symbol == EOS_SYMBOL;
+// pay out `itr`, the first row of `owner`, already matured
+template <typename Strategy>
+void vault::release_first(const s_collateral &collateral, const name &owner, releases &releasetbl,
+                          releases::const_iterator itr) {
+    uint64_t rate0 = itr->rate;
+    uint64_t rate1 = rate_with<Strategy>(collateral, 0);
+    // print_f("rate0: % , rate1: % \n", rate0, rate1);
+    auto amounts = vault_math::release(itr->quantity.amount, rate0, rate1,
+                                       collateral.release_fees, collateral.refund_ratio);
+    VAULT_PRINT("withdraw: % , quantity: % rate0: %, rate1: %, RATE_BASE "
+                "% \n",
+                amounts.withdraw, itr->quantity.amount, rate0, rate1, RATE_BASE);
 
-        uint128_t rate0 = itr->rate;
-        uint128_t rate1 = is_eos ? get_eos_rate(0)
-                                 : get_rate(collateral.deposit_contract,
-                                            asset(0, collateral.deposit_symbol));
-        // print_f("rate0: % , rate1: % \n", rate0, rate1);
-        if (rate1 < rate0) {
-            rate1 = rate0;
+    auto data1 = std::make_tuple(itr->quantity, string("withdraw retire"));
+    action(permission_level { _self, "active"_n }, STOKRN_ACCOUNT, "retire"_n, data1)
+        .send();
+
+    add_release_transfers<Strategy>(collateral, owner, amounts);
+    auto withdraw_quantity        = asset(amounts.withdraw, collateral.deposit_symbol);
+    auto withdraw_to_award_fees   = asset(amounts.fees.award, collateral.deposit_symbol);
+    auto withdraw_to_sys_fees     = asset(amounts.fees.sys, collateral.deposit_symbol);
+    auto refund_to_award_quantity = asset(amounts.refund.award, collateral.deposit_symbol);
+    auto refund_to_sys_quantity   = asset(amounts.refund.sys, collateral.deposit_symbol);
+    VAULT_PRINT("refund_quantity: %\n", refund_to_award_quantity + refund_to_sys_quantity);
+    // releases queued before the metrics row existed are not counted in it
+    update_metrics(collateral, [&](auto &m) {
+        m.total_withdraw += withdraw_quantity;
+        m.withdraw_award_fees += withdraw_to_award_fees;
+        m.withdraw_sys_fees += withdraw_to_sys_fees;
+        m.refund_award_quantity += refund_to_award_quantity;
+        m.refund_sys_quantity += refund_to_sys_quantity;
+        if (m.pending_count > 0) {
+            m.pending_count -= 1;
         }
+        m.pending_quantity.amount
+            = std::max(m.pending_quantity.amount - itr->quantity.amount, int64_t(0));
+        m.last_rate = rate1;
+    });
 
-        int64_t refund0_amount = uint128_t(itr->quantity.amount) * rate0 / RATE_BASE;
-        int64_t refund1_amount = uint128_t(itr->quantity.amount) * rate1 / RATE_BASE;
-        print_f("refund0_amount: % , quantity: % rate0: %, rate1: %, RATE_BASE "
-                "% \n",
-                refund0_amount, itr->quantity.amount, rate0, rate1, RATE_BASE);
+    auto log_id = itr->id;
+    auto row    = *itr;
+    itr         = releasetbl.erase(itr);
+    // `itr` was the first row of the scope
+    track_ram("releases"_n, row, -1, -int64_t(itr == releasetbl.end()));
 
-        auto data1 = std::make_tuple(itr->quantity, string("withdraw retire"));
-        action(permission_level { _self, "active"_n }, STOKRN_ACCOUNT, "retire"_n, data1)
-            .send();
+    // one transfer per recipient
+    send_transfers();
 
-        auto withdraw_quantity = asset(refund0_amount, collateral.deposit_symbol);
-        // print_f("withdraw_quantity: %\n", withdraw_quantity);
-        auto withdraw_fees = asset(refund0_amount * collateral.release_fees / 10000,
-                                   collateral.deposit_symbol);
+    // check(false, "~~");
 
-        withdraw_quantity -= withdraw_fees;
-        if (withdraw_quantity.amount > 0) {
-            transfer_token_to(collateral.deposit_contract, owner,
-                              withdraw_quantity, string("withdraw"));
-        }
+    auto data = std::make_tuple(log_id, collateral.id, owner,
+                                withdraw_quantity, withdraw_to_award_fees,
+                                withdraw_to_sys_fees, refund_to_award_quantity,
+                                refund_to_sys_quantity, current_block_time());
+    action(permission_level { _self, "active"_n }, _self, "withdrawlog"_n, data)
+        .send();
+}
 
-        auto withdraw_to_award_fees = withdraw_fees * collateral.refund_ratio / 10000;
-        auto withdraw_to_sys_fees = withdraw_fees - withdraw_to_award_fees;
-        if (withdraw_to_award_fees.amount > 0) {
-            transfer_token_to(collateral.deposit_contract, collateral.income_account,
-                              withdraw_to_award_fees, string("withdraw fees"));
-        }
-        if (withdraw_to_sys_fees.amount > 0) {
-            transfer_token_to(collateral.deposit_contract, collateral.fees_account,
-                              withdraw_to_sys_fees, string("withdraw fees"));
+#ifdef __wasm__
+// The entry point, written out instead of generated so that `transfer` notifications go
+// through `runs_notification` before the contract object is built and `config` is read.
+// The native backend (tools/native) puts the same call in front of its action table.
+namespace {
+
+    template <typename R, typename... Args>
+    std::tuple<std::decay_t<Args>...> args_of(R (vault::*)(Args...));
+
+    template <typename R, typename... Args>
+    R result_of(R (vault::*)(Args...));
+
+    // `Action` with the arguments unpacked from the running action, the packed result
+    // of a read-only action is its return value
+    template <auto Action>
+    void execute(name receiver, name code) {
+        using args_t = decltype(args_of(Action));
+        using ret_t  = decltype(result_of(Action));
+
+        std::vector<char> data(action_data_size());
+        read_action_data(data.data(), data.size());
+        args_t                   args;
+        datastream<const char *> ds(data.data(), data.size());
+        ds >> args;
+
+        vault contract(receiver, code, datastream<const char *>(data.data(), data.size()));
+        if constexpr (std::is_void_v<ret_t>) {
+            std::apply([&](auto &...a) { (contract.*Action)(a...); }, args);
+        } else {
+            auto packed = pack(std::apply([&](auto &...a) { return (contract.*Action)(a...); }, args));
+            internal_use_do_not_use::set_action_return_value(packed.data(), packed.size());
         }
+    }
 
-        auto refund_quantity
-            = asset(refund1_amount - refund0_amount, collateral.deposit_symbol);
-        auto refund_to_award_quantity = refund_quantity * collateral.refund_ratio / 10000;
-        auto refund_to_sys_quantity = refund_quantity - refund_to_award_quantity;
-        if (refund_to_award_quantity.amount > 0) {
-            transfer_token_to(collateral.deposit_contract, collateral.income_account,
-                              refund_to_award_quantity, string("refund"));
-        }
-        if (refund_to_sys_quantity.amount > 0) {
-            transfer_token_to(collateral.deposit_contract, collateral.fees_account,
-                              refund_to_sys_quantity, string("refund"));
-        }
-        print_f("refund_quantity: %\n", refund_quantity);
-        auto log_id = itr->id;
-        itr         = releasetbl.erase(itr);
+} // namespace
 
-        // check(false, "~~");
+#define VAULT_ACTION(ACTION)                                                                                 \
+    case name(#ACTION).value: execute<&vault::ACTION>(self, first_receiver); return;
 
-        auto data = std::make_tuple(log_id, collateral.id, owner,
-                                    withdraw_quantity, withdraw_to_award_fees,
-                                    withdraw_to_sys_fees, refund_to_award_quantity,
-                                    refund_to_sys_quantity, current_block_time());
-        action(permission_level { _self, "active"_n }, _self, "withdrawlog"_n, data)
-            .send();
+extern "C" {
+[[eosio::wasm_entry]] void apply(uint64_t receiver, uint64_t code, uint64_t action) {
+    name self(receiver), first_receiver(code);
+    if (code == receiver) {
+        switch (action) { VAULT_ACTIONS(VAULT_ACTION) }
+        check(false, "unknown action");
+    }
+    if (vault::runs_notification(self, first_receiver, name(action))) {
+        execute<&vault::on_tokens_transfer>(self, first_receiver);
     }
-}
\ No newline at end of file
+}
+}
+#endif
@@ -2,7 +2,7 @@ import { Name, Asset, TimePointSec } from "@greymass/eosio";
 import { Account } from "@proton/vert"
 
 import { expectToThrow } from "@tests/helpers";
-import { Collateral, Release, Config } from "@tests/interfaces";
+import { Collateral, Income, Release, Config, Metrics, RateDay, RamStat } from "@tests/interfaces";
 import { contracts, blockchain, award_account } from "@tests/init";
 import { RATE_BASE, INCOME_PERIOD_INTERVAL, RATIO_MULTIPER } from "@tests/constants";
 import { sub, add, muldiv, randomInt, randomFloat } from "@tests/helpers";
@@ -13,6 +13,10 @@ const getColl = (id: number): Collateral => {
   return contracts.vault.tables.collaterals(VAULT_SCOPE).getTableRow(BigInt(id));
 }
 
+const getIncome = (id: number): Income => {
+  return contracts.vault.tables.incomes(VAULT_SCOPE).getTableRow(BigInt(id));
+}
+
 const getBalance = (account: Name | string, contract: Account, symcode: string): number => {
   let scope;
   if (typeof account === "string") {
@@ -38,6 +42,22 @@ const getReleases = (owner: string): Release[] => {
   return contracts.vault.tables.releases(scope).getTableRows();
 }
 
+const getMetrics = (id: number): Metrics => {
+  return contracts.vault.tables.metrics(VAULT_SCOPE).getTableRow(BigInt(id));
+}
+
+// rate recorded by `income` at `time`
+const getHistoryRate = (id: number, time: number): number | undefined => {
+  const day = Math.floor(time / 86400);
+  const row: RateDay = contracts.vault.tables.ratehistory(BigInt(id)).getTableRow(BigInt(day % 30));
+  if (row?.day != day) { return undefined; }
+  return Number(row.rates[Math.floor((time % 86400) / 600)]);
+}
+
+const getRamStat = (contract: Account, table: string): RamStat | undefined => {
+  return contract.tables.ramstats(contract.name.value.value).getTableRow(Name.from(table).value.value);
+}
+
 const getConfig = (): Config => {
   return contracts.vault.tables.config(VAULT_SCOPE).getTableRows()[0];
 }
@@ -105,8 +125,6 @@ describe('vault.defi', () => {
       "deposit_contract": "tethertether",
       "deposit_symbol": "4,USDT",
       "issue_symbol": "4,SUSDT",
-      "last_income": "0.0000 USDT",
-      "total_income": "0.0000 USDT",
       "income_ratio": 50,
       "income_account": "award.defi",
       "min_quantity": "0.1000 USDT",
@@ -114,6 +132,15 @@ describe('vault.defi', () => {
       "release_fees": 30,
       "refund_ratio": 5000
     });
+    expect(getIncome(1)).toEqual({
+      "collateral_id": 1,
+      "last_income": "0.0000 USDT",
+      "total_income": "0.0000 USDT"
+    });
+    const metrics = getMetrics(1);
+    expect(metrics.total_deposit).toBe("0.0000 USDT");
+    expect(metrics.pending_count).toBe(0);
+    expect(metrics.pending_quantity).toBe("0.0000 SUSDT");
   });
 
   it("collateral::updatecoll", async () => {
@@ -133,8 +160,6 @@ describe('vault.defi', () => {
         "deposit_contract": "tethertether",
         "deposit_symbol": "4,USDT",
         "issue_symbol": "4,SUSDT",
-        "last_income": "0.0000 USDT",
-        "total_income": "0.0000 USDT",
         "income_ratio": 60,
         "income_account": "award.defi",
         "min_quantity": "10.0000 USDT",
@@ -149,6 +174,7 @@ describe('vault.defi', () => {
     await contracts.vault.actions.income().send();
 
     const before_coll = getColl(1);
+    const before_income = getIncome(1);
 
     const deposit_contract = blockchain.getAccount(Name.from(before_coll.deposit_contract)) as Account;
     const deposit_symbol = Asset.Symbol.from(before_coll.deposit_symbol);
@@ -163,7 +189,7 @@ describe('vault.defi', () => {
     blockchain.addTime(TimePointSec.from(randomInt(600, 3600)));
     await contracts.vault.actions.income().send();
 
-    const after_coll = getColl(1);
+    const after_income = getIncome(1);
     const after_config = getConfig();
     const after_vault_balance = getBalance(contracts.vault.name, deposit_contract, deposit_symbol.name);
 
@@ -171,9 +197,10 @@ describe('vault.defi', () => {
     const income_ratio = before_coll.income_ratio;
     const income_amount = getIncomeAmount(award_balance, income_ratio, period, deposit_symbol.precision);
 
-    expect(Asset.from(after_coll.last_income).value).toBe(income_amount);
-    expect(sub(Asset.from(after_coll.total_income).value, Asset.from(before_coll.total_income).value)).toBe(income_amount);
+    expect(Asset.from(after_income.last_income).value).toBe(income_amount);
+    expect(sub(Asset.from(after_income.total_income).value, Asset.from(before_income.total_income).value)).toBe(income_amount);
     expect(sub(after_vault_balance, before_vault_balance)).toBe(income_amount);
+    expect(getHistoryRate(1, after_config.last_income_time)).toBe(getRate(deposit_contract, deposit_symbol.name, 0));
   });
 
   it("collateral::deposit", async () => {
@@ -265,6 +292,11 @@ describe('vault.defi', () => {
     const deposit_symbol = Asset.Symbol.from(coll.deposit_symbol);
 
     const releases = getReleases("account1");
+    const before_metrics = getMetrics(coll.id);
+    expect(before_metrics.pending_count).toBe(releases.length);
+    let total_withdraw = 0;
+    let total_fees = 0;
+    let last_rate = 0;
     for (const release of releases) {
 
       const new_rate = getRate(deposit_contract, `${deposit_symbol.name}`, 0);
@@ -296,8 +328,46 @@ describe('vault.defi', () => {
       expect(sub(after_account1_balance, before_account1_balance)).toBe(withdraw_amount);
       expect(sub(after_fee_account_balance, before_fee_account_balance)).toBe(fee_account_income);
       expect(sub(after_income_account_balance, before_income_account_balance)).toBe(income_account_refund);
+      total_withdraw = add(total_withdraw, withdraw_amount);
+      last_rate = new_rate;
+      total_fees = add(total_fees, add(income_account_refund, fee_account_income));
     }
     expect(getReleases("account1").length).toBe(0);
 
+    // metrics kept in step with every release
+    const metrics = getMetrics(coll.id);
+    expect(metrics.pending_count).toBe(0);
+    expect(metrics.pending_quantity).toBe(`0.0000 ${coll.issue_symbol.split(",")[1]}`);
+    expect(Asset.from(metrics.total_deposit).value).toBe(1900);
+    expect(sub(Asset.from(metrics.total_withdraw).value, Asset.from(before_metrics.total_withdraw).value)).toBe(total_withdraw);
+    const metrics_fees = [metrics.withdraw_award_fees, metrics.withdraw_sys_fees, metrics.refund_award_quantity, metrics.refund_sys_quantity]
+      .reduce((sum, quantity) => add(sum, Asset.from(quantity).value), 0);
+    expect(metrics_fees).toBe(total_fees);
+    expect(Number(metrics.last_rate)).toBe(last_rate);
+
+  });
+
+  it("ram::ramstats", async () => {
+    // one USDT collateral: 70 bytes per collaterals row, 40 per incomes row, 140 per metrics row
+    expect(getRamStat(contracts.vault, "collaterals")).toEqual({ "table": "collaterals", "scopes": 0, "rows": 1, "bytes": 70 });
+    expect(getRamStat(contracts.vault, "incomes")).toEqual({ "table": "incomes", "scopes": 0, "rows": 1, "bytes": 40 });
+    expect(getRamStat(contracts.vault, "metrics")).toEqual({ "table": "metrics", "scopes": 0, "rows": 1, "bytes": 140 });
+    // every release of account1 was paid out above
+    expect(getRamStat(contracts.vault, "releases")).toMatchObject({ "scopes": 0, "rows": 0, "bytes": 0 });
+    expect(getRamStat(contracts.stoken, "stat")).toEqual({ "table": "stat", "scopes": 1, "rows": 1, "bytes": 40 });
+    const holders = getRamStat(contracts.stoken, "accounts") as RamStat;
+    expect(holders.bytes).toBe(holders.rows * 16);
+    expect(holders.rows).toBeGreaterThan(0);
+
+    let action = contracts.vault.actions.setramstat(["vault.defi", "releases", 0, 0, 0]).send("account1@active");
+    await expectToThrow(action, "missing required authority admin.defi");
+    action = contracts.vault.actions.setramstat(["vault.defi", "config", 0, 0, 0]).send("admin.defi@active");
+    await expectToThrow(action, "table not tracked");
+    action = contracts.stoken.actions.setramstat(["accounts", 0, 0, 0]).send("admin.defi@active");
+    await expectToThrow(action, "missing required authority vault.defi");
+
+    // seeds of stoken tables go through the vault
+    await contracts.vault.actions.setramstat(["stoken.defi", "accounts", holders.scopes, holders.rows, holders.bytes]).send("admin.defi@active");
+    expect(getRamStat(contracts.stoken, "accounts")).toEqual(holders);
   });
 });
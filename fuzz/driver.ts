@@ -0,0 +1,265 @@
+import { Asset } from "@greymass/eosio";
+
+import { Chain, createChain, addTime, scopeOf, tokenOf, VAULT, ADMIN, AWARD, FEES, TOKENS } from "../bench/chain";
+import { random } from "../bench/load";
+import { VaultModel, Outcome, RATIO_BASE } from "./model";
+
+export type Op =
+  | { kind: "deposit", user: string, sym: string, amount: bigint }
+  | { kind: "withdraw", user: string, sym: string, amount: bigint }
+  | { kind: "release", user: string }
+  | { kind: "income" }
+  | { kind: "time", seconds: number }
+  | { kind: "shock", sym: string, amount: bigint }
+  | { kind: "updatecoll", sym: string, income_ratio: bigint, release_fees: bigint, refund_ratio: bigint }
+  | { kind: "updatestatus", deposit_status: number, withdraw_status: number };
+
+export interface FuzzOptions {
+  collaterals: number;
+  users: number;
+}
+
+const PRECISION = 4;
+const PARAMS = { income_ratio: 50n, release_fees: 30n, refund_ratio: 5000n, min_quantity: 1000n };
+
+export const formatAmount = (amount: bigint, sym: string): string => {
+  const negative = amount < 0n;
+  const abs = (negative ? -amount : amount).toString().padStart(PRECISION + 1, "0");
+  return `${negative ? "-" : ""}${abs.slice(0, -PRECISION)}.${abs.slice(-PRECISION)} ${sym}`;
+}
+
+const units = (quantity: string | undefined): bigint => {
+  if (!quantity) return 0n;
+  return BigInt(Asset.from(quantity).units.toString());
+}
+
+export const formatOp = (op: Op): string => {
+  const fields = Object.entries(op).filter(([key]) => key != "kind")
+    .map(([key, value]) => `${key}=${typeof value === "bigint" ? value.toString() : value}`);
+  return `${op.kind} ${fields.join(" ")}`;
+}
+
+/**
+ * Runs the same operations against the contracts on a Vert chain and against
+ * `VaultModel`, and lists every observable difference between the two.
+ */
+export class Differential {
+  readonly model: VaultModel;
+  private touched = new Set<string>();
+
+  private constructor(readonly chain: Chain) {
+    const config = chain.vault.tables.config(scopeOf(VAULT)).getTableRows()[0];
+    const now = Math.floor((chain.blockchain as any).timestamp.toMilliseconds() / 1000);
+    this.model = new VaultModel(VAULT, ADMIN, {
+      last_income_time: Number(config.last_income_time),
+      transfer_status: config.transfer_status,
+      deposit_status: config.deposit_status,
+      withdraw_status: config.withdraw_status,
+      log_id: Number(config.log_id),
+    }, now);
+
+    const collaterals = chain.vault.tables.collaterals(scopeOf(VAULT)).getTableRows();
+    for (const sym of chain.symbols) {
+      const row = collaterals.find((c: any) => c.deposit_symbol == `${PRECISION},${sym}`);
+      const balances = new Map<string, bigint>();
+      for (const account of this.accounts()) {
+        balances.set(account, this.tokenBalance(sym, account));
+      }
+      this.model.addCollateral(sym, Number(row.id), { ...PARAMS, income_account: AWARD, fees_account: FEES }, balances);
+    }
+  }
+
+  static async create(options: FuzzOptions): Promise<Differential> {
+    const chain = await createChain({ collaterals: options.collaterals, eos: false, users: options.users });
+    // the admin funds rate shocks: transfers the vault keeps without issuing shares
+    for (const sym of chain.symbols) {
+      await chain.tokens.actions.transfer([TOKENS, ADMIN, `1000000.0000 ${sym}`, "fuzz"]).send(`${TOKENS}@active`);
+    }
+    return new Differential(chain);
+  }
+
+  accounts(): string[] {
+    return [VAULT, ADMIN, AWARD, FEES, ...this.chain.users];
+  }
+
+  tokenBalance(sym: string, account: string): bigint {
+    const row = tokenOf(this.chain, sym).tables.accounts(scopeOf(account))
+      .getTableRow(Asset.SymbolCode.from(sym).value.value);
+    return units(row?.balance);
+  }
+
+  shareBalance(sym: string, account: string): bigint {
+    const row = this.chain.stoken.tables.accounts(scopeOf(account))
+      .getTableRow(Asset.SymbolCode.from(`S${sym}`).value.value);
+    return units(row?.balance);
+  }
+
+  shareSupply(sym: string): bigint {
+    const code = Asset.SymbolCode.from(`S${sym}`).value.value;
+    const row = this.chain.stoken.tables.stat(code).getTableRows()[0];
+    return units(row?.supply);
+  }
+
+  private async push(op: Op): Promise<boolean> {
+    const { chain } = this;
+    try {
+      switch (op.kind) {
+        case "deposit":
+          await chain.tokens.actions.transfer([op.user, VAULT, formatAmount(op.amount, op.sym), ""]).send(`${op.user}@active`);
+          break;
+        case "withdraw":
+          await chain.stoken.actions.transfer([op.user, VAULT, formatAmount(op.amount, `S${op.sym}`), ""]).send(`${op.user}@active`);
+          break;
+        case "release":
+          await chain.vault.actions.release([op.user]).send(`${op.user}@active`);
+          break;
+        case "income":
+          await chain.vault.actions.income().send();
+          break;
+        case "time":
+          addTime(chain, op.seconds);
+          break;
+        case "shock":
+          await chain.tokens.actions.transfer([ADMIN, VAULT, formatAmount(op.amount, op.sym), "shock"]).send(`${ADMIN}@active`);
+          break;
+        case "updatecoll": {
+          const c = this.model.collaterals.get(op.sym)!;
+          await chain.vault.actions.updatecoll({
+            "collateral_id": c.id,
+            "income_account": c.income_account,
+            "fees_account": c.fees_account,
+            "min_quantity": formatAmount(c.min_quantity, op.sym),
+            "income_ratio": Number(op.income_ratio),
+            "release_fees": Number(op.release_fees),
+            "refund_ratio": Number(op.refund_ratio),
+          }).send(`${ADMIN}@active`);
+          break;
+        }
+        case "updatestatus":
+          await chain.vault.actions.updatestatus([1, op.deposit_status, op.withdraw_status]).send(`${ADMIN}@active`);
+          break;
+      }
+      return true;
+    } catch (e) {
+      return false;
+    }
+  }
+
+  private expect(op: Op): Outcome {
+    const { model } = this;
+    switch (op.kind) {
+      case "deposit": return model.deposit(op.user, op.sym, op.amount);
+      case "withdraw": return model.withdraw(op.user, `S${op.sym}`, op.amount);
+      case "release": return model.release(op.user);
+      case "income": return model.income();
+      case "time": model.addTime(op.seconds); return { ok: true };
+      case "shock": return model.deposit(ADMIN, op.sym, op.amount);
+      case "updatecoll":
+        return model.updatecoll(op.sym, { income_ratio: op.income_ratio, release_fees: op.release_fees, refund_ratio: op.refund_ratio });
+      case "updatestatus": return model.updatestatus(1, op.deposit_status, op.withdraw_status);
+    }
+  }
+
+  /**
+   * Apply `op` to both sides. Returns the differences found, empty when the
+   * chain and the model agree.
+   */
+  async step(op: Op, full = false): Promise<string[]> {
+    if ("user" in op) this.touched.add(op.user);
+    const executed = await this.push(op);
+    const expected = this.expect(op);
+    if (executed != expected.ok) {
+      return [`chain ${executed ? "accepted" : "rejected"}, model ${expected.ok ? "accepted" : `rejected (${expected.reason})`}`];
+    }
+    const users = full ? this.chain.users : [...this.touched];
+    this.touched.clear();
+    return this.compare(users);
+  }
+
+  compare(users: string[]): string[] {
+    const { model } = this;
+    const errors: string[] = [];
+    const diff = (what: string, chain: any, expected: any) => {
+      if (chain.toString() !== expected.toString()) errors.push(`${what}: chain ${chain}, model ${expected}`);
+    };
+
+    for (const [sym, c] of model.collaterals) {
+      diff(`supply S${sym}`, this.shareSupply(sym), c.supply);
+      for (const account of [VAULT, AWARD, FEES, ...users]) {
+        diff(`${account} ${sym}`, this.tokenBalance(sym, account), c.balances.get(account) ?? 0n);
+        diff(`${account} S${sym}`, this.shareBalance(sym, account), c.shares.get(account) ?? 0n);
+      }
+    }
+
+    const config = this.chain.vault.tables.config(scopeOf(VAULT)).getTableRows()[0];
+    diff("log_id", config.log_id, model.config.log_id);
+    diff("last_income_time", config.last_income_time, model.config.last_income_time);
+
+    for (const user of users) {
+      const rows = this.chain.vault.tables.releases(scopeOf(user)).getTableRows();
+      const expected = model.releases.get(user) ?? [];
+      diff(`${user} releases`, rows.length, expected.length);
+      rows.forEach((row: any, i: number) => {
+        const r = expected[i];
+        if (!r) return;
+        diff(`${user} release ${i} id`, row.id, r.id);
+        diff(`${user} release ${i} quantity`, units(row.quantity), r.quantity);
+        diff(`${user} release ${i} rate`, row.rate, r.rate);
+        diff(`${user} release ${i} time`, Math.floor(Date.parse(row.time + "Z") / 1000), r.time);
+      });
+    }
+    return errors;
+  }
+}
+
+/**
+ * Random operation sequences. Amounts are log-uniform so both dust (rounding
+ * edges, below `min_quantity`) and large transfers show up.
+ */
+export class OpGenerator {
+  private rand: () => number;
+
+  constructor(seed: number, readonly diff: Differential) {
+    this.rand = random(seed);
+  }
+
+  private pick<T>(items: T[]): T {
+    return items[Math.floor(this.rand() * items.length)];
+  }
+
+  private amount(max_digits: number): bigint {
+    const digits = 1 + Math.floor(this.rand() * max_digits);
+    return BigInt(Math.floor(this.rand() * 10 ** digits)) + 1n;
+  }
+
+  private ratio(): bigint {
+    return this.pick([0n, 1n, 30n, 5000n, 9999n, RATIO_BASE, BigInt(Math.floor(this.rand() * 10001))]);
+  }
+
+  next(): Op {
+    const { chain, model } = this.diff;
+    const user = this.pick(chain.users);
+    const sym = this.pick(chain.symbols);
+    const r = this.rand() * 100;
+
+    if (r < 30) return { kind: "deposit", user, sym, amount: this.amount(10) };
+    if (r < 50) {
+      const held = model.collaterals.get(sym)!.shares.get(user) ?? 0n;
+      // mostly valid amounts, sometimes the full balance or more than held
+      const amount = held > 0n && this.rand() < 0.9
+        ? (this.rand() < 0.2 ? held : 1n + BigInt(Math.floor(this.rand() * Number(held))))
+        : this.amount(8);
+      return { kind: "withdraw", user, sym, amount };
+    }
+    if (r < 70) return { kind: "release", user };
+    if (r < 80) return { kind: "income" };
+    if (r < 92) return { kind: "time", seconds: this.pick([1, 599, 600, 3600, 86400, 5 * 86400]) };
+    if (r < 96) return { kind: "shock", sym, amount: this.amount(9) };
+    if (r < 98) {
+      return { kind: "updatecoll", sym, income_ratio: this.ratio(), release_fees: this.ratio(), refund_ratio: this.ratio() };
+    }
+    // suspended states are short lived so most of the run exercises the open paths
+    const status = () => this.rand() < 0.7 ? 1 : 0;
+    return { kind: "updatestatus", deposit_status: status(), withdraw_status: status() };
+  }
+}
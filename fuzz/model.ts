@@ -0,0 +1,236 @@
+/**
+ * Reference model of the vault economics, written from the contract's
+ * observable rules and independent of `vault_math.hpp`. Amounts are integer
+ * token units (bigint), time is in seconds.
+ */
+
+export const RATE_BASE = 100000000n;
+export const RATIO_BASE = 10000n;
+export const INCOME_PERIOD = 600;
+export const RELEASE_DELAY = 5 * 86400;
+// stoken max supply: 1 billion at the collateral precision
+export const STOKEN_MAX_SUPPLY = 1000000000n * 10000n;
+
+export interface CollateralParams {
+  income_account: string;
+  fees_account: string;
+  min_quantity: bigint;
+  income_ratio: bigint;
+  release_fees: bigint;
+  refund_ratio: bigint;
+}
+
+export interface ModelCollateral extends CollateralParams {
+  id: number;
+  sym: string;
+  // deposit token balances, keyed by account
+  balances: Map<string, bigint>;
+  // share (S<sym>) balances, keyed by account
+  shares: Map<string, bigint>;
+  supply: bigint;
+}
+
+export interface ModelRelease {
+  id: number;
+  // share symbol and amount
+  sym: string;
+  quantity: bigint;
+  rate: bigint;
+  time: number;
+}
+
+export interface ModelConfig {
+  last_income_time: number;
+  transfer_status: number;
+  deposit_status: number;
+  withdraw_status: number;
+  log_id: number;
+}
+
+// result of applying an operation, `ok == false` means the transaction must fail
+export interface Outcome {
+  ok: boolean;
+  reason?: string;
+}
+
+const fail = (reason: string): Outcome => ({ ok: false, reason });
+const OK: Outcome = { ok: true };
+
+const get = (m: Map<string, bigint>, account: string) => m.get(account) ?? 0n;
+
+/**
+ * Balances are staged in a copy and only committed when every step of the
+ * transaction succeeds, like a rolled back transaction on chain.
+ */
+class Ledger {
+  private changes = new Map<Map<string, bigint>, Map<string, bigint>>();
+
+  balance(m: Map<string, bigint>, account: string): bigint {
+    const staged = this.changes.get(m);
+    return staged?.has(account) ? staged.get(account)! : get(m, account);
+  }
+
+  transfer(m: Map<string, bigint>, from: string, to: string, amount: bigint): Outcome {
+    if (from === to) return fail("cannot transfer to self");
+    if (amount <= 0n) return fail("must transfer positive quantity");
+    const from_balance = this.balance(m, from);
+    if (from_balance < amount) return fail("overdrawn balance");
+    this.set(m, from, from_balance - amount);
+    this.set(m, to, this.balance(m, to) + amount);
+    return OK;
+  }
+
+  set(m: Map<string, bigint>, account: string, amount: bigint) {
+    if (!this.changes.has(m)) this.changes.set(m, new Map());
+    this.changes.get(m)!.set(account, amount);
+  }
+
+  commit() {
+    for (const [m, staged] of this.changes) {
+      for (const [account, amount] of staged) m.set(account, amount);
+    }
+  }
+}
+
+export class VaultModel {
+  readonly collaterals = new Map<string, ModelCollateral>();
+  readonly releases = new Map<string, ModelRelease[]>();
+
+  constructor(readonly vault: string, readonly admin: string, public config: ModelConfig, public now: number) { }
+
+  addCollateral(sym: string, id: number, params: CollateralParams, balances: Map<string, bigint>) {
+    this.collaterals.set(sym, { ...params, id, sym, balances, shares: new Map(), supply: 0n });
+  }
+
+  collateralOfShare(share_sym: string): ModelCollateral | undefined {
+    return this.collaterals.get(share_sym.slice(1));
+  }
+
+  // current share price, as the vault computes it outside of deposits
+  rate(c: ModelCollateral, ledger?: Ledger): bigint {
+    const balance = ledger ? ledger.balance(c.balances, this.vault) : get(c.balances, this.vault);
+    return c.supply == 0n ? RATE_BASE : balance * RATE_BASE / c.supply;
+  }
+
+  addTime(seconds: number) {
+    this.now += seconds;
+  }
+
+  deposit(owner: string, sym: string, amount: bigint): Outcome {
+    const c = this.collaterals.get(sym)!;
+    const ledger = new Ledger();
+    const transferred = ledger.transfer(c.balances, owner, this.vault, amount);
+    if (!transferred.ok) return transferred;
+
+    // the income account only tops up the vault, no shares
+    if (owner !== c.income_account && owner !== this.admin) {
+      if (this.config.deposit_status != 1) return fail("deposit has been suspended");
+      if (amount < c.min_quantity) return fail("deposit too small");
+      // the notification sees the balance after the transfer, the rate excludes the deposit
+      const before = ledger.balance(c.balances, this.vault) - amount;
+      const rate = c.supply == 0n ? RATE_BASE : before * RATE_BASE / c.supply;
+      if (rate == 0n) return fail("divide by zero");
+      const issue = amount * RATE_BASE / rate;
+      if (issue <= 0n) return fail("must issue positive quantity");
+      if (issue > STOKEN_MAX_SUPPLY - c.supply) return fail("quantity exceeds available supply");
+      c.supply += issue;
+      c.shares.set(owner, get(c.shares, owner) + issue);
+    }
+    ledger.commit();
+    return OK;
+  }
+
+  // shares sent back to the vault queue a release at the current rate
+  withdraw(owner: string, share_sym: string, amount: bigint): Outcome {
+    const c = this.collateralOfShare(share_sym)!;
+    if (amount <= 0n) return fail("must transfer positive quantity");
+    if (get(c.shares, owner) < amount) return fail("overdrawn balance");
+    if (this.config.withdraw_status != 1) return fail("withdraw has been suspended");
+
+    c.shares.set(owner, get(c.shares, owner) - amount);
+    c.shares.set(this.vault, get(c.shares, this.vault) + amount);
+    this.config.log_id++;
+    const list = this.releases.get(owner) ?? [];
+    list.push({ id: this.config.log_id, sym: share_sym, quantity: amount, rate: this.rate(c), time: this.now + RELEASE_DELAY });
+    this.releases.set(owner, list);
+    return OK;
+  }
+
+  // pays out the oldest release of `owner` once it matured, one per call
+  release(owner: string): Outcome {
+    if (this.config.withdraw_status != 1) return fail("withdraw has been suspended");
+    const list = this.releases.get(owner) ?? [];
+    if (list.length == 0 || list[0].time > this.now) return OK;
+
+    const r = list[0];
+    const c = this.collateralOfShare(r.sym)!;
+    let rate1 = this.rate(c);
+    if (rate1 < r.rate) rate1 = r.rate;
+
+    const value0 = r.quantity * r.rate / RATE_BASE;
+    const value1 = r.quantity * rate1 / RATE_BASE;
+    const fees = value0 * c.release_fees / RATIO_BASE;
+    const fees_award = fees * c.refund_ratio / RATIO_BASE;
+    const refund = value1 - value0;
+    const refund_award = refund * c.refund_ratio / RATIO_BASE;
+
+    const ledger = new Ledger();
+    const payouts: [string, bigint][] = [
+      [owner, value0 - fees],
+      [c.income_account, fees_award],
+      [c.fees_account, fees - fees_award],
+      [c.income_account, refund_award],
+      [c.fees_account, refund - refund_award],
+    ];
+    for (const [to, amount] of payouts) {
+      if (amount <= 0n) continue;
+      const sent = ledger.transfer(c.balances, this.vault, to, amount);
+      if (!sent.ok) return sent;
+    }
+    ledger.commit();
+
+    // retire the shares held since the withdraw
+    c.supply -= r.quantity;
+    c.shares.set(this.vault, get(c.shares, this.vault) - r.quantity);
+    list.shift();
+    return OK;
+  }
+
+  income(): Outcome {
+    const this_time = this.now - (this.now % INCOME_PERIOD);
+    if (this.config.last_income_time == this_time) return OK;
+    if (this.config.last_income_time > 0) {
+      const periods = BigInt((this_time - this.config.last_income_time) / INCOME_PERIOD);
+      const ledger = new Ledger();
+      const sorted = [...this.collaterals.values()].sort((a, b) => a.id - b.id);
+      for (const c of sorted) {
+        if (periods <= 0n) continue;
+        let ratio = periods * c.income_ratio;
+        if (ratio > RATIO_BASE) ratio = RATIO_BASE;
+        const amount = ledger.balance(c.balances, c.income_account) * ratio / RATIO_BASE;
+        if (amount > 0n) {
+          const sent = ledger.transfer(c.balances, c.income_account, this.vault, amount);
+          if (!sent.ok) return sent;
+        }
+      }
+      ledger.commit();
+    }
+    this.config.last_income_time = this_time;
+    return OK;
+  }
+
+  updatecoll(sym: string, params: Partial<CollateralParams>): Outcome {
+    const c = this.collaterals.get(sym)!;
+    for (const key of ["income_ratio", "release_fees", "refund_ratio"] as const) {
+      const value = params[key];
+      if (value !== undefined && value > RATIO_BASE) return fail("income_ratio need less than 10000");
+    }
+    Object.assign(c, params);
+    return OK;
+  }
+
+  updatestatus(transfer_status: number, deposit_status: number, withdraw_status: number): Outcome {
+    Object.assign(this.config, { transfer_status, deposit_status, withdraw_status });
+    return OK;
+  }
+}
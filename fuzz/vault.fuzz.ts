@@ -0,0 +1,45 @@
+import { Differential, OpGenerator, Op, formatOp } from "./driver";
+
+// `7` or a range `1-32`, each seed is an independent run on a fresh chain
+const seeds = (value: string): number[] => {
+  const [first, last] = value.split("-").map(Number);
+  const result: number[] = [];
+  for (let seed = first; seed <= (last ?? first); seed++) result.push(seed);
+  return result;
+}
+
+const SEEDS = seeds(process.env.FUZZ_SEEDS ?? "1");
+const STEPS = Number(process.env.FUZZ_STEPS ?? "2000");
+const COLLATERALS = Number(process.env.FUZZ_COLLATERALS ?? "3");
+const USERS = Number(process.env.FUZZ_USERS ?? "4");
+// compare every user, not only the ones the step touched, this often
+const FULL_EVERY = Number(process.env.FUZZ_FULL_EVERY ?? "100");
+// operations printed before the first divergence
+const HISTORY = 20;
+
+describe("vault differential fuzz", () => {
+  for (const seed of SEEDS) {
+    it(`seed=${seed}`, async () => {
+      const diff = await Differential.create({ collaterals: COLLATERALS, users: USERS });
+      const gen = new OpGenerator(seed, diff);
+      const history: Op[] = [];
+      const start = process.hrtime.bigint();
+
+      for (let step = 0; step < STEPS; step++) {
+        const op = gen.next();
+        history.push(op);
+        if (history.length > HISTORY) history.shift();
+
+        const errors = await diff.step(op, (step + 1) % FULL_EVERY == 0);
+        if (errors.length > 0) {
+          const ops = history.map((o, i) => `  ${step - history.length + 1 + i}: ${formatOp(o)}`);
+          throw new Error(`seed ${seed} diverged at step ${step}\n${ops.join("\n")}\n${errors.join("\n")}`);
+        }
+      }
+      expect(diff.compare(diff.chain.users)).toEqual([]);
+
+      const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+      console.log(`seed ${seed}: ${STEPS} steps in ${seconds.toFixed(1)}s (${(STEPS / seconds).toFixed(0)} steps/s)`);
+    }, 24 * 3600 * 1000);
+  }
+});
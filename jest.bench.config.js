@@ -0,0 +1,10 @@
+module.exports = {
+    preset: 'ts-jest',
+    testEnvironment: 'node',
+    testMatch: ['<rootDir>/bench/**/*.bench.ts'],
+    testTimeout: 600000,
+    moduleNameMapper: {
+        '^@tests/(.*)$': '<rootDir>/tests/$1',
+        '^@bench/(.*)$': '<rootDir>/bench/$1',
+    },
+};
@@ -5,15 +5,22 @@ PROJECT_HOME=`pwd`
 ## stoken build
 mkdir $PROJECT_HOME/contracts/stoken/build
 cd $PROJECT_HOME/contracts/stoken/build
-cmake ..
+cmake -DCONTRACT_RELEASE=ON ..
 make
 
 ## vault build
 mkdir $PROJECT_HOME/contracts/vault/build
 cd $PROJECT_HOME/contracts/vault/build
-cmake ..
+cmake -DCONTRACT_RELEASE=ON ..
 make
 
 # sha256sum
 shasum -a 256 $PROJECT_HOME/contracts/stoken/build/stoken/stoken.wasm
-shasum -a 256 $PROJECT_HOME/contracts/vault/build/vault/vault.wasm
\ No newline at end of file
+shasum -a 256 $PROJECT_HOME/contracts/vault/build/vault/vault.wasm
+
+## size budget, pass --update to record the sizes of this build
+cmake -S $PROJECT_HOME/tools -B $PROJECT_HOME/build/tools
+cmake --build $PROJECT_HOME/build/tools --target wasm_size
+$PROJECT_HOME/build/tools/wasmsize/wasm_size --budget $PROJECT_HOME/contracts/wasm_budget.json "$@" \
+   stoken=$PROJECT_HOME/contracts/stoken/build/stoken/stoken.wasm \
+   vault=$PROJECT_HOME/contracts/vault/build/vault/vault.wasm
@@ -1,11 +1,36 @@
 #!/bin/bash
 
+# PROFILE=1 builds the host-call counting contracts into build/profile instead,
+# see contracts/profile/host_profile.hpp
+if [ "$PROFILE" == "1" ]; then
+  OUT=`pwd`/build/profile
+  FLAGS="-DCONTRACT_PROFILE -include `pwd`/contracts/profile/host_profile.hpp"
+  EXTRA_SRC=`pwd`/contracts/profile/host_profile.cpp
+  mkdir -p $OUT/stoken $OUT/vault
+  STOKEN_WASM=$OUT/stoken/stoken.wasm
+  VAULT_WASM=$OUT/vault/vault.wasm
+# METER=1 builds into build/meter and counts the instructions of every function,
+# see tools/wasmmeter/meter.hpp; wasm_meter is built from tools/ first
+elif [ "$METER" == "1" ]; then
+  OUT=`pwd`/build/meter
+  cmake -S tools -B build/tools > /dev/null && cmake --build build/tools --target wasm_meter > /dev/null || exit 1
+  METER_TOOL=`pwd`/build/tools/wasmmeter/wasm_meter
+  mkdir -p $OUT/stoken $OUT/vault
+  STOKEN_WASM=$OUT/stoken/stoken.wasm
+  VAULT_WASM=$OUT/vault/vault.wasm
+else
+  STOKEN_WASM=stoken.wasm
+  VAULT_WASM=vault.wasm
+fi
+
 echo "compiling... [stoken.defi]"
 cd contracts/stoken
-blanc++ src/stoken.cpp -I ./include
-shasum -a 256 stoken.wasm
+blanc++ src/stoken.cpp $EXTRA_SRC -I ./include $FLAGS -o $STOKEN_WASM
+[ -n "$METER_TOOL" ] && $METER_TOOL $STOKEN_WASM $STOKEN_WASM ${STOKEN_WASM%.wasm}.names.json
+shasum -a 256 $STOKEN_WASM
 
 echo "compiling... [vault.defi]"
 cd ../vault
-blanc++ src/vault.cpp -I ./include
-shasum -a 256 vault.wasm
+blanc++ src/vault.cpp $EXTRA_SRC -I ./include $FLAGS -o $VAULT_WASM
+[ -n "$METER_TOOL" ] && $METER_TOOL $VAULT_WASM $VAULT_WASM ${VAULT_WASM%.wasm}.names.json
+shasum -a 256 $VAULT_WASM
@@ -24,8 +24,6 @@ export interface Collateral {
   deposit_contract: string;
   deposit_symbol: string;
   issue_symbol: string;
-  last_income: string;
-  total_income: string;
   income_ratio: number;
   income_account: string;
   min_quantity: string;
@@ -33,6 +31,35 @@ export interface Collateral {
   release_fees: number;
   refund_ratio: number;
 }
+export interface Income {
+  collateral_id: number;
+  last_income: string;
+  total_income: string;
+}
+export interface Metrics {
+  collateral_id: number;
+  total_deposit: string;
+  total_withdraw: string;
+  withdraw_award_fees: string;
+  withdraw_sys_fees: string;
+  refund_award_quantity: string;
+  refund_sys_quantity: string;
+  pending_count: number;
+  pending_quantity: string;
+  last_rate: number;
+  update_time: string;
+}
+export interface RateDay {
+  slot: number;
+  day: number;
+  rates: number[];
+}
+export interface RamStat {
+  table: string;
+  scopes: number;
+  rows: number;
+  bytes: number;
+}
 export interface Config {
   last_income_time: number;
   transfer_status: number;
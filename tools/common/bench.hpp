@@ -0,0 +1,27 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace tools {
+
+    // keep `value` alive so the measured computation is not optimized away
+    template <typename T>
+    inline void do_not_optimize(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct stopwatch {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        double seconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    inline void report(const char *name, uint64_t ops, double seconds) {
+        std::printf("%-28s %12.2f ns/op %10.2f Mops/s\n", name, seconds * 1e9 / double(ops),
+                    double(ops) / seconds / 1e6);
+    }
+
+} // namespace tools
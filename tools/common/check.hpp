@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal assertion helpers for the native tests, failures are counted and reported by `check_report`.
+namespace tools {
+
+    inline int &check_failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline void check_fail(const char *expr, const char *file, int line) {
+        // stop printing after a few failures, a broken formula fails millions of cases
+        if (++check_failures() <= 20) {
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        }
+    }
+
+    inline int check_report(const char *name) {
+        if (check_failures() > 0) {
+            std::fprintf(stderr, "%s: %d failure(s)\n", name, check_failures());
+            return EXIT_FAILURE;
+        }
+        std::printf("%s: ok\n", name);
+        return EXIT_SUCCESS;
+    }
+
+} // namespace tools
+
+#define CHECK(expr)                                              \
+    do {                                                         \
+        if (!(expr)) tools::check_fail(#expr, __FILE__, __LINE__); \
+    } while (0)
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Host-side encoding of eosio names, symbols and assets, bit-compatible with the CDT types.
+namespace tools {
+
+    constexpr uint64_t name_char(char c) {
+        if (c >= 'a' && c <= 'z') return uint64_t(c - 'a') + 6;
+        if (c >= '1' && c <= '5') return uint64_t(c - '1') + 1;
+        return 0;
+    }
+
+    constexpr uint64_t name_value(std::string_view str) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < 13 && i < str.size(); i++) {
+            uint64_t c = name_char(str[i]);
+            value |= i < 12 ? (c & 0x1f) << (64 - 5 * (i + 1)) : (c & 0x0f);
+        }
+        return value;
+    }
+
+    inline std::string name_string(uint64_t value) {
+        static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+        std::string str(13, '.');
+        uint64_t    tmp = value;
+        for (int i = 0; i <= 12; i++) {
+            char c      = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+            str[12 - i] = c;
+            tmp >>= (i == 0 ? 4 : 5);
+        }
+        str.erase(str.find_last_not_of('.') + 1);
+        return str;
+    }
+
+    constexpr uint64_t symbol_code_value(std::string_view code) {
+        uint64_t value = 0;
+        for (size_t i = code.size(); i > 0; i--) {
+            value = (value << 8) | uint8_t(code[i - 1]);
+        }
+        return value;
+    }
+
+    constexpr uint64_t symbol_value(std::string_view code, uint8_t precision) {
+        return (symbol_code_value(code) << 8) | precision;
+    }
+
+    inline std::string symbol_code_string(uint64_t code) {
+        std::string str;
+        for (; code > 0; code >>= 8) str += char(code & 0xff);
+        return str;
+    }
+
+    inline std::string asset_string(int64_t amount, uint64_t symbol) {
+        uint8_t     precision = uint8_t(symbol & 0xff);
+        bool        negative  = amount < 0;
+        uint64_t    abs       = negative ? uint64_t(-(amount + 1)) + 1 : uint64_t(amount);
+        std::string digits    = std::to_string(abs);
+        if (digits.size() <= precision) digits.insert(0, precision + 1 - digits.size(), '0');
+        if (precision > 0) digits.insert(digits.size() - precision, ".");
+        return (negative ? "-" : "") + digits + " " + symbol_code_string(symbol >> 8);
+    }
+
+    // "4,EOS", false when malformed
+    inline bool parse_symbol(std::string_view str, uint64_t &symbol) {
+        auto comma = str.find(',');
+        if (comma == 0 || comma == std::string_view::npos || comma + 1 == str.size()) return false;
+        uint64_t precision = 0;
+        for (char c : str.substr(0, comma)) {
+            if (c < '0' || c > '9') return false;
+            precision = precision * 10 + uint64_t(c - '0');
+        }
+        if (precision > 18 || str.size() - comma - 1 > 7) return false;
+        symbol = symbol_value(str.substr(comma + 1), uint8_t(precision));
+        return true;
+    }
+
+    // "1.2345 EOS", the precision is the number of decimals, false when malformed
+    inline bool parse_asset(std::string_view str, int64_t &amount, uint64_t &symbol) {
+        auto space = str.find(' ');
+        if (space == std::string_view::npos || space + 1 == str.size()) return false;
+        std::string_view number = str.substr(0, space);
+        bool             negative = !number.empty() && number[0] == '-';
+        if (negative) number.remove_prefix(1);
+
+        uint64_t value = 0, precision = 0;
+        bool     fraction = false, digits = false;
+        for (char c : number) {
+            if (c == '.' && !fraction) {
+                fraction = true;
+                continue;
+            }
+            if (c < '0' || c > '9' || value > (uint64_t(1) << 62) / 10) return false;
+            value  = value * 10 + uint64_t(c - '0');
+            digits = true;
+            if (fraction) precision++;
+        }
+        std::string_view code = str.substr(space + 1);
+        if (!digits || precision > 18 || code.size() > 7) return false;
+        amount = negative ? -int64_t(value) : int64_t(value);
+        symbol = symbol_value(code, uint8_t(precision));
+        return true;
+    }
+
+    // block_timestamp slots are half seconds since 2000-01-01T00:00:00
+    constexpr uint64_t BLOCK_TIMESTAMP_EPOCH = 946684800;
+
+    // first whole second at or after the slot
+    constexpr uint64_t block_time_seconds(uint32_t slot) { return BLOCK_TIMESTAMP_EPOCH + (uint64_t(slot) + 1) / 2; }
+
+    // "2022-12-03T10:13:07.000" as nodeos prints times, seconds since 1970, false when malformed
+    inline bool parse_time(std::string_view str, uint64_t &seconds) {
+        if (str.size() < 19 || str[4] != '-' || str[7] != '-' || str[10] != 'T' || str[13] != ':' || str[16] != ':')
+            return false;
+        auto field = [&](size_t at, size_t n, uint64_t &v) {
+            v = 0;
+            for (size_t i = at; i < at + n; i++) {
+                if (str[i] < '0' || str[i] > '9') return false;
+                v = v * 10 + uint64_t(str[i] - '0');
+            }
+            return true;
+        };
+        uint64_t y, m, d, hh, mm, ss;
+        if (!field(0, 4, y) || !field(5, 2, m) || !field(8, 2, d) || !field(11, 2, hh) || !field(14, 2, mm)
+            || !field(17, 2, ss) || y < 1970 || m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 59)
+            return false;
+        // days since 1970-01-01 of the civil date, March based years
+        uint64_t yy  = m <= 2 ? y - 1 : y;
+        uint64_t era = yy / 400;
+        uint64_t yoe = yy - era * 400;
+        uint64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        seconds      = ((era * 146097 + doe - 719468) * 24 + hh) * 3600 + mm * 60 + ss;
+        return true;
+    }
+
+} // namespace tools
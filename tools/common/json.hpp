@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Non-allocating JSON scanning over a buffer: values are returned as views of
+ * their raw text. Enough for dumps of table rows, escapes are skipped but not
+ * decoded.
+ */
+namespace tools::json {
+
+    inline const char *skip_ws(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        return p;
+    }
+
+    // end of the value starting at `p`, nullptr when malformed
+    inline const char *skip_value(const char *p, const char *end) {
+        p = skip_ws(p, end);
+        if (p == end) return nullptr;
+        if (*p == '"') {
+            for (p++; p < end; p++) {
+                if (*p == '\\') {
+                    p++;
+                } else if (*p == '"') {
+                    return p + 1;
+                }
+            }
+            return nullptr;
+        }
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+            for (; p < end; p++) {
+                if (*p == '"') {
+                    p = skip_value(p, end);
+                    if (!p) return nullptr;
+                    p--;
+                } else if (*p == '{' || *p == '[') {
+                    depth++;
+                } else if (*p == '}' || *p == ']') {
+                    if (--depth == 0) return p + 1;
+                }
+            }
+            return nullptr;
+        }
+        // number, true, false, null
+        const char *start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n'
+               && *p != '\r' && *p != '\t')
+            p++;
+        return p == start ? nullptr : p;
+    }
+
+    // strips the quotes of a string value, other values are returned as is
+    inline std::string_view unquote(std::string_view raw) {
+        if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"') {
+            return raw.substr(1, raw.size() - 2);
+        }
+        return raw;
+    }
+
+    /**
+     * Calls `f(key, raw_value)` for every member of the object in `text`.
+     * Returns false when `text` is not a well formed object.
+     */
+    template <typename F>
+    bool for_each_member(std::string_view text, F &&f) {
+        const char *p   = skip_ws(text.data(), text.data() + text.size());
+        const char *end = text.data() + text.size();
+        if (p == end || *p != '{') return false;
+        p = skip_ws(p + 1, end);
+        if (p < end && *p == '}') return true;
+        while (p < end) {
+            const char *key_end = skip_value(p, end);
+            if (!key_end || *p != '"') return false;
+            std::string_view key(p + 1, size_t(key_end - p - 2));
+            p = skip_ws(key_end, end);
+            if (p == end || *p != ':') return false;
+            p                     = skip_ws(p + 1, end);
+            const char *value_end = skip_value(p, end);
+            if (!value_end) return false;
+            f(key, std::string_view(p, size_t(value_end - p)));
+            p = skip_ws(value_end, end);
+            if (p < end && *p == ',') {
+                p = skip_ws(p + 1, end);
+            } else {
+                return p < end && *p == '}';
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Calls `f(raw_value)` for every element of the array in `text`.
+     * Returns false when `text` is not a well formed array.
+     */
+    template <typename F>
+    bool for_each_element(std::string_view text, F &&f) {
+        const char *p   = skip_ws(text.data(), text.data() + text.size());
+        const char *end = text.data() + text.size();
+        if (p == end || *p != '[') return false;
+        p = skip_ws(p + 1, end);
+        if (p < end && *p == ']') return true;
+        while (p < end) {
+            const char *value_end = skip_value(p, end);
+            if (!value_end) return false;
+            f(std::string_view(p, size_t(value_end - p)));
+            p = skip_ws(value_end, end);
+            if (p < end && *p == ',') {
+                p = skip_ws(p + 1, end);
+            } else {
+                return p < end && *p == ']';
+            }
+        }
+        return false;
+    }
+
+    // unsigned integer, quoted or not (nodeos quotes 64-bit values)
+    inline bool to_uint(std::string_view raw, uint64_t &value) {
+        raw = unquote(raw);
+        if (raw.empty() || raw.size() > 20) return false;
+        uint64_t v = 0;
+        for (char c : raw) {
+            if (c < '0' || c > '9') return false;
+            uint64_t next = v * 10 + uint64_t(c - '0');
+            if (next / 10 != v) return false;
+            v = next;
+        }
+        value = v;
+        return true;
+    }
+
+} // namespace tools::json
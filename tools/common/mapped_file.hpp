@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tools {
+
+    // read-only mapping of a whole file, empty when it cannot be mapped
+    class mapped_file {
+      public:
+        explicit mapped_file(const std::string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    _data = static_cast<const char *>(p);
+                    _size = size_t(st.st_size);
+                    ::madvise(p, _size, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+        }
+        ~mapped_file() {
+            if (_data) ::munmap(const_cast<char *>(_data), _size);
+        }
+        mapped_file(const mapped_file &)            = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        const char *data() const { return _data; }
+        size_t      size() const { return _size; }
+        bool        ok() const { return _data != nullptr; }
+
+      private:
+        const char *_data = nullptr;
+        size_t      _size = 0;
+    };
+
+} // namespace tools
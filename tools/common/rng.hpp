@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+namespace tools {
+
+    // splitmix64, deterministic and fast enough to feed millions of cases per second
+    struct rng {
+        uint64_t state;
+
+        explicit rng(uint64_t seed = 0x5eed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        // uniform in [lo, hi]
+        uint64_t range(uint64_t lo, uint64_t hi) {
+            if (hi - lo == UINT64_MAX) return next();
+            return lo + next() % (hi - lo + 1);
+        }
+
+        // values spread over every magnitude, edge-heavy
+        uint64_t magnitude(unsigned max_bits = 62) {
+            unsigned bits = unsigned(next() % (max_bits + 1));
+            if (bits == 0) return 0;
+            uint64_t v = next() & (bits == 64 ? UINT64_MAX : ((1ULL << bits) - 1));
+            return v | (1ULL << (bits - 1));
+        }
+
+        bool chance(unsigned percent) { return next() % 100 < percent; }
+    };
+
+} // namespace tools
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+#include <eosio/native/chain.hpp>
+
+/**
+ * CPU estimate of a transaction from the host counters of the native chain.
+ *
+ * The native build says nothing about wasm execution time, but the paths that
+ * grow with the state (`income` over the collaterals, the collateral lookups,
+ * the `payouts` queue, the REX maturity buckets) grow in table reads, writes,
+ * bytes and inline actions, which the counters see exactly.
+ *
+ * The weights are not calibrated. They are rough guesses at EOS VM OC costs on
+ * a current producer, picked so that an `eosio.token` transfer (one action and
+ * two notifications) comes out near 100 us, and have not been fitted to
+ * `yarn bench` times or to the instruction counts of the metered build. The
+ * counters are exact, so the estimates rank actions and show which dimensions
+ * grow; the microseconds, the share of the limit and the sizes at the limit
+ * are only as good as the weights.
+ */
+namespace explore {
+
+    // uncalibrated, see above
+    struct cost_weights {
+        uint64_t apply_ns = 30000;   // instantiation and dispatch, per receiver with code
+        uint64_t read_ns  = 1000;    // db_find, db_get, db_next
+        uint64_t write_ns = 3000;    // db_store, db_update, db_remove
+        uint64_t send_ns  = 2000;    // send_inline, require_recipient
+        uint64_t byte_ps  = 2000;    // per row or action byte (de)serialized, in picoseconds
+        uint64_t limit_us = 30000;   // nodeos `max-transaction-time` default
+    };
+
+    inline uint64_t estimate_ns(const eosio::native::host_counters &c, const cost_weights &w) {
+        return c.applies * w.apply_ns + (c.db_find + c.db_get + c.db_next) * w.read_ns
+               + (c.db_store + c.db_update + c.db_remove) * w.write_ns
+               + (c.send_inline + c.require_recipient) * w.send_ns
+               + (c.db_bytes + c.action_bytes) * w.byte_ps / 1000;
+    }
+
+} // namespace explore
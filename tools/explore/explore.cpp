@@ -0,0 +1,133 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <mapped_file.hpp>
+
+#include "explore.hpp"
+
+using namespace explore;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: explore [--max DIMENSION=N] [--limit-us N] [--threads N] SCENARIO\n"
+                     "  grows the vault of SCENARIO (tests/scenarios/eos.json) along each dimension,\n"
+                     "  collaterals, releases, payouts, maturities and memo, and prints the estimated\n"
+                     "  CPU of every action per size, then the worst shape of each action, its share\n"
+                     "  of the limit and the size at which each growing dimension reaches it; the\n"
+                     "  estimates use uncalibrated weights (cost.hpp), rough figures only\n");
+    }
+
+    bool parse_max(const char *text, config &cfg) {
+        const char *eq = std::strchr(text, '=');
+        if (!eq) return false;
+        for (uint32_t d = 0; d < DIMENSIONS; d++) {
+            if (std::strncmp(text, dimension_names[d], size_t(eq - text)) || dimension_names[d][eq - text]) continue;
+            char *end;
+            auto  value = std::strtoul(eq + 1, &end, 10);
+            if (end == eq + 1 || *end || value < cfg.minimum.size[d]) return false;
+            cfg.maximum.size[d] = uint32_t(value);
+            return true;
+        }
+        return false;
+    }
+
+    double us(uint64_t ns) { return double(ns) / 1000; }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    config      cfg;
+    const char *path = nullptr;
+    cfg.threads      = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--max") && i + 1 < argc) {
+            if (!parse_max(argv[++i], cfg)) {
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else if (!std::strcmp(argv[i], "--limit-us") && i + 1 < argc) {
+            cfg.weights.limit_us = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            cfg.threads = unsigned(std::max(1, std::atoi(argv[++i])));
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path || cfg.weights.limit_us == 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    tools::mapped_file file(path);
+    if (!file.ok()) {
+        std::fprintf(stderr, "explore: cannot map %s\n", path);
+        return EXIT_FAILURE;
+    }
+    native_scenario::scenario sc;
+    auto                      error = native_scenario::load(std::string_view(file.data(), file.size()), sc);
+    if (!error.empty()) {
+        std::fprintf(stderr, "explore: %s: %s\n", path, error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    auto r = explorer(sc, cfg).run();
+    if (!r.error.empty()) {
+        std::fprintf(stderr, "explore: %s\n", r.error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // estimated us of every action along each ladder, - when it failed or did not run
+    std::printf("estimated us, uncalibrated weights (tools/explore/cost.hpp): rough figures\n\n");
+    std::printf("%-12s %6s", "dimension", "size");
+    for (const auto &p : probes) std::printf(" %14s", p.name);
+    std::printf("\n");
+    for (const auto &step : r.ladder) {
+        const auto &s = r.samples[step.second];
+        std::printf("%-12s %6" PRIu32, dimension_names[step.first], s.s.size[step.first]);
+        for (const auto &m : s.probes) {
+            if (m.ran && m.ok) {
+                std::printf(" %14.1f", us(m.cost_ns));
+            } else {
+                std::printf(" %14s", "-");
+            }
+        }
+        std::printf("\n");
+    }
+
+    std::printf("\n%-14s %10s %7s  %s\n", "action", "worst us", "limit", "worst shape, growth per unit and size at the limit");
+    for (const auto &a : r.actions) {
+        if (!a.ran) {
+            std::printf("%-14s %10s %7s  failed in every shape\n", a.action, "-", "-");
+            continue;
+        }
+        std::string growth;
+        for (uint32_t d = 0; d < DIMENSIONS; d++) {
+            if (a.growth_ns[d] <= 0) continue;
+            char text[96];
+            if (a.at_limit[d]) {
+                std::snprintf(text, sizeof(text), "; %s +%.2fus, limit at %" PRIu64, dimension_names[d],
+                              a.growth_ns[d] / 1000, a.at_limit[d]);
+            } else {
+                std::snprintf(text, sizeof(text), "; %s +%.2fus, bounded", dimension_names[d], a.growth_ns[d] / 1000);
+            }
+            growth += text;
+        }
+        if (a.failed) growth += "; failed in " + std::to_string(a.failed) + " shapes";
+        std::printf("%-14s %10.1f %6.2f%%  %s%s\n", a.action, us(a.cost_ns),
+                    100.0 * double(a.cost_ns) / (double(cfg.weights.limit_us) * 1000),
+                    a.worst.describe(cfg.minimum).c_str(), growth.c_str());
+    }
+    std::printf("\nlimit %" PRIu64 " us, %zu shapes; the us and the sizes at the limit are rough estimates\n",
+                cfg.weights.limit_us, r.samples.size());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cost.hpp"
+#include "fixture.hpp"
+
+/**
+ * Searches the state shapes for the most expensive input of every action a
+ * user, the keeper or anyone can push, and how far it is from the CPU limit.
+ *
+ * Each dimension of `fixture.hpp` is first grown alone, doubling from its
+ * minimum to its maximum, which gives the cost of every action per unit of
+ * that dimension. The corner with every dimension that made some action more
+ * expensive at its maximum comes next, then that corner with each of them
+ * back at its minimum, since dimensions can get in each other's way (queued
+ * payouts stop the REX buys that add maturity buckets). The worst shape of an
+ * action is the most expensive of all of them. Every action is measured with
+ * `chain::dry_run` on the same built chain.
+ */
+namespace explore {
+
+    struct probe {
+        const char *name;
+        bool        token;   // needs a token collateral
+    };
+
+    inline const probe probes[] = {
+        { "income", false },      { "deposit/eos", false },   { "deposit/token", true }, { "withdraw/eos", false },
+        { "release/eos", false }, { "release/token", true },  { "payout", false },       { "buyallrex", false },
+    };
+    constexpr size_t PROBES = sizeof(probes) / sizeof(probes[0]);
+
+    // the step of probe `i` on a state of shape `s`
+    inline native_scenario::step probe_step(size_t i, const shape &s) {
+        std::string memo(s[MEMO], 'm');
+        std::string code = s[COLLATERALS] > 0 ? collateral_code(s[COLLATERALS] - 1) : "";
+        auto step = [](const char *contract, const char *act, const char *actor, std::string data) {
+            return native_scenario::step { name(contract), name(act), { name(actor) }, std::move(data), {}, 0 };
+        };
+        switch (i) {
+        case 0: return step("vault.defi", "income", "vault.defi", "[]");
+        case 1:
+            return step("eosio.token", "transfer", "user.b", "[\"user.b\", \"vault.defi\", \"1.0000 EOS\", \"" + memo + "\"]");
+        case 2:
+            return step("eosio.token", "transfer", "user.c",
+                        "[\"user.c\", \"vault.defi\", \"1.0000 " + code + "\", \"" + memo + "\"]");
+        case 3:
+            return step("stoken.defi", "transfer", "user.b", "[\"user.b\", \"vault.defi\", \"0.0001 SEOS\", \"" + memo + "\"]");
+        case 4: return step("vault.defi", "release", "user.b", "[\"user.b\"]");
+        case 5: return step("vault.defi", "release", "user.c", "[\"user.c\"]");
+        case 6: return step("vault.defi", "payout", "keeper.defi", "[]");
+        default: return step("vault.defi", "buyallrex", "vault.defi", "[]");
+        }
+    }
+
+    struct measurement {
+        bool                          ran = false;   // token probes do not run without a token collateral
+        bool                          ok  = false;
+        std::string                   error;
+        eosio::native::host_counters  counters;
+        uint64_t                      cost_ns = 0;
+    };
+
+    struct sample {
+        shape                    s;
+        std::string              error;   // the fixture could not be built
+        std::vector<measurement> probes;
+    };
+
+    inline sample measure(const native_scenario::scenario &sc, const shape &s, const cost_weights &w) {
+        sample                     out { s, {}, std::vector<measurement>(PROBES) };
+        native_scenario::chain     c;
+        fixture                    f(sc);
+        out.error = f.build(s, c);
+        if (!out.error.empty()) return out;
+        for (size_t i = 0; i < PROBES; i++) {
+            auto &m = out.probes[i];
+            if (probes[i].token && s[COLLATERALS] == 0) continue;
+            auto st   = probe_step(i, s);
+            m.ran     = true;
+            auto kind = native_scenario::kind_of(sc, st.contract);
+            try {
+                eosio::native::action_data act { st.contract, st.action, {}, kind->encode(st.action, st.data) };
+                for (auto actor : st.auth) act.authorization.emplace_back(actor, name("active"));
+                c.dry_run({ act });
+                m.ok = true;
+            } catch (const std::exception &e) {
+                m.error = e.what();
+            }
+            m.counters = c.counters();
+            m.cost_ns  = estimate_ns(m.counters, w);
+        }
+        return out;
+    }
+
+    struct config {
+        shape        minimum;
+        shape        maximum;
+        cost_weights weights;
+        unsigned     threads = 1;
+
+        config() {
+            maximum[COLLATERALS] = 64;
+            maximum[RELEASES]    = 256;
+            maximum[PAYOUTS]     = 256;
+            maximum[MATURITIES]  = 5;
+            maximum[MEMO]        = 256;
+        }
+    };
+
+    // dimensions the chain caps: the system contract folds matured buckets on every
+    // buy, `eosio.token` refuses memos over 256 bytes
+    inline bool bounded(dimension d) { return d == MATURITIES || d == MEMO; }
+
+    struct action_report {
+        const char *action;
+        bool        ran = false;
+        shape       worst;
+        uint64_t    cost_ns = 0;
+        uint64_t    failed  = 0;   // samples where the probe failed
+        // cost per unit of each dimension grown alone, 0 when flat (under 1% over the ladder)
+        double      growth_ns[DIMENSIONS] = {};
+        // size of each unbounded growing dimension at which the worst shape reaches the limit
+        uint64_t    at_limit[DIMENSIONS] = {};
+    };
+
+    struct report {
+        std::vector<sample>                   samples;
+        std::vector<std::pair<dimension, size_t>> ladder;   // dimension and sample of every ladder step
+        std::vector<action_report>            actions;
+        std::string                           error;
+    };
+
+    // the sizes of a ladder: the minimum, doubling, then the maximum
+    inline std::vector<uint32_t> ladder_sizes(uint32_t minimum, uint32_t maximum) {
+        std::vector<uint32_t> sizes;
+        for (uint32_t v = minimum; v < maximum; v = std::max(v * 2, v + 1)) sizes.push_back(v);
+        sizes.push_back(maximum);
+        return sizes;
+    }
+
+    class explorer {
+      public:
+        explorer(const native_scenario::scenario &sc, const config &cfg) : _sc(sc), _cfg(cfg) {}
+
+        report run() {
+            report out;
+            // the ladders, the minimum shape once
+            std::vector<shape> shapes { _cfg.minimum };
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                auto sizes = ladder_sizes(_cfg.minimum.size[d], _cfg.maximum.size[d]);
+                out.ladder.emplace_back(dimension(d), 0);
+                for (size_t i = 1; i < sizes.size(); i++) {
+                    shape s   = _cfg.minimum;
+                    s.size[d] = sizes[i];
+                    out.ladder.emplace_back(dimension(d), shapes.size());
+                    shapes.push_back(s);
+                }
+            }
+            out.samples = measure_all(shapes);
+            if (failed(out)) return out;
+
+            std::vector<action_report> actions(PROBES);
+            for (size_t p = 0; p < PROBES; p++) {
+                actions[p].action = probes[p].name;
+                growth(out, p, actions[p]);
+            }
+
+            // the corner of the growing dimensions, then that corner less each of them
+            shape corner = _cfg.minimum;
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                for (const auto &a : actions) {
+                    if (a.growth_ns[d] > 0) corner.size[d] = _cfg.maximum.size[d];
+                }
+            }
+            shapes = { corner };
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                if (corner.size[d] == _cfg.minimum.size[d]) continue;
+                shape s   = corner;
+                s.size[d] = _cfg.minimum.size[d];
+                shapes.push_back(s);
+            }
+            auto more = measure_all(shapes);
+            out.samples.insert(out.samples.end(), more.begin(), more.end());
+            if (failed(out)) return out;
+
+            for (size_t p = 0; p < PROBES; p++) worst(out, p, actions[p]);
+            out.actions = std::move(actions);
+            return out;
+        }
+
+      private:
+        std::vector<sample> measure_all(const std::vector<shape> &shapes) {
+            std::vector<sample>   samples(shapes.size());
+            std::atomic<size_t>   next { 0 };
+            auto                  work = [&] {
+                for (size_t i = next++; i < shapes.size(); i = next++) samples[i] = measure(_sc, shapes[i], _cfg.weights);
+            };
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < std::max(1u, _cfg.threads); t++) pool.emplace_back(work);
+            work();
+            for (auto &t : pool) t.join();
+            return samples;
+        }
+
+        static bool failed(report &out) {
+            for (const auto &s : out.samples) {
+                if (s.error.empty()) continue;
+                out.error = s.s.describe(shape {}) + ": " + s.error;
+                return true;
+            }
+            return false;
+        }
+
+        void growth(const report &out, size_t p, action_report &a) const {
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                const sample *first = nullptr, *last = nullptr;
+                for (const auto &step : out.ladder) {
+                    const auto &s = out.samples[step.second];
+                    if (step.first != d || !s.probes[p].ran || !s.probes[p].ok) continue;
+                    if (!first) first = &s;
+                    last = &s;
+                }
+                if (!first || first == last) continue;
+                // less than 1% over the whole ladder is flat
+                double added = double(last->probes[p].cost_ns) - double(first->probes[p].cost_ns);
+                if (added * 100 < double(first->probes[p].cost_ns)) continue;
+                a.growth_ns[d] = added / (last->s.size[d] - first->s.size[d]);
+            }
+        }
+
+        void worst(const report &out, size_t p, action_report &a) const {
+            for (const auto &s : out.samples) {
+                const auto &m = s.probes[p];
+                if (!m.ran) continue;
+                if (!m.ok) {
+                    a.failed++;
+                    continue;
+                }
+                if (!a.ran || m.cost_ns > a.cost_ns) {
+                    a.ran     = true;
+                    a.worst   = s.s;
+                    a.cost_ns = m.cost_ns;
+                }
+            }
+            if (!a.ran) return;
+            const double limit_ns = double(_cfg.weights.limit_us) * 1000;
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                if (bounded(dimension(d)) || a.growth_ns[d] <= 0) continue;
+                double room   = std::max(limit_ns - double(a.cost_ns), 0.0);
+                a.at_limit[d] = a.worst.size[d] + uint64_t(room / a.growth_ns[d]);
+            }
+        }
+
+        const native_scenario::scenario &_sc;
+        config                           _cfg;
+    };
+
+} // namespace explore
@@ -0,0 +1,137 @@
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <mapped_file.hpp>
+
+#include "explore.hpp"
+
+using namespace explore;
+
+namespace {
+
+    size_t rows(const native_scenario::chain &c, const char *code, const char *scope, const char *table) {
+        auto t = c.find_table({ name(code).value, name(scope).value, name(table).value });
+        return t ? t->size() : 0;
+    }
+
+    void test_cost() {
+        eosio::native::host_counters c;
+        cost_weights                 w;
+        CHECK(estimate_ns(c, w) == 0);
+        // a token transfer: one action, two notifications, four reads, two writes
+        c.applies           = 3;
+        c.db_find           = 2;
+        c.db_get            = 2;
+        c.db_update         = 2;
+        c.require_recipient = 2;
+        c.action_bytes      = 3 * 32;
+        c.db_bytes          = 4 * 16 + 2 * 16;
+        CHECK(estimate_ns(c, w) == 90000 + 4000 + 6000 + 4000 + 192 * 2);
+
+        CHECK(ladder_sizes(0, 5) == std::vector<uint32_t>({ 0, 1, 2, 4, 5 }));
+        CHECK(ladder_sizes(1, 8) == std::vector<uint32_t>({ 1, 2, 4, 8 }));
+        CHECK(ladder_sizes(3, 3) == std::vector<uint32_t>({ 3 }));
+        CHECK(collateral_code(0) == "TAAA" && collateral_code(27) == "TABB");
+    }
+
+    // the shape is on the chain, and measuring leaves it there
+    void test_fixture(const native_scenario::scenario &sc) {
+        shape s;
+        s[COLLATERALS] = 2;
+        s[RELEASES]    = 3;
+        s[PAYOUTS]     = 2;
+        native_scenario::chain c;
+        fixture                f(sc);
+        CHECK(f.build(s, c).empty());
+        CHECK(rows(c, "vault.defi", "vault.defi", "collaterals") == 3);
+        CHECK(rows(c, "vault.defi", "user.b", "releases") == 3);
+        CHECK(rows(c, "vault.defi", "user.c", "releases") == 1);
+        // the withdraw and both fees of each release
+        CHECK(rows(c, "vault.defi", "vault.defi", "payouts") == 3 * 2);
+
+        std::string before = native_scenario::dump_all(c);
+        for (size_t i = 0; i < PROBES; i++) {
+            auto st   = probe_step(i, s);
+            auto kind = native_scenario::kind_of(sc, st.contract);
+            eosio::native::action_data act { st.contract, st.action, {}, kind->encode(st.action, st.data) };
+            for (auto actor : st.auth) act.authorization.emplace_back(actor, name("active"));
+            c.dry_run({ act });
+            CHECK(c.counters().applies > 0);
+        }
+        CHECK(native_scenario::dump_all(c) == before);
+
+        // every probe runs on its own chain, the counters do not depend on the others
+        auto a = measure(sc, s, cost_weights {});
+        auto b = measure(sc, s, cost_weights {});
+        CHECK(a.error.empty() && a.probes.size() == PROBES);
+        for (size_t i = 0; i < PROBES; i++) {
+            CHECK(a.probes[i].ran && a.probes[i].ok);
+            CHECK(a.probes[i].cost_ns == b.probes[i].cost_ns && a.probes[i].cost_ns > 0);
+        }
+
+        // without a token collateral the token probes do not run
+        auto plain = measure(sc, shape {}, cost_weights {});
+        CHECK(plain.error.empty() && !plain.probes[2].ran && !plain.probes[5].ran && plain.probes[0].ok);
+    }
+
+    const action_report *find(const report &r, const char *action) {
+        for (const auto &a : r.actions) {
+            if (std::string(a.action) == action) return &a;
+        }
+        return nullptr;
+    }
+
+    void test_explore(const native_scenario::scenario &sc) {
+        config cfg;
+        cfg.maximum[COLLATERALS] = 4;
+        cfg.maximum[RELEASES]    = 4;
+        cfg.maximum[PAYOUTS]     = 4;
+        cfg.maximum[MATURITIES]  = 3;
+        cfg.maximum[MEMO]        = 16;
+        cfg.threads              = 2;
+        auto r                   = explorer(sc, cfg).run();
+        CHECK(r.error.empty() && r.actions.size() == PROBES);
+        // the minimum of each ladder and 3 + 2 + 3 + 2 + 5 steps past it
+        CHECK(r.ladder.size() == 15 + DIMENSIONS);
+
+        // `income` pays and records the rate of every collateral
+        auto income = find(r, "income");
+        CHECK(income && income->ran && income->failed == 0);
+        CHECK(income->growth_ns[COLLATERALS] > 0 && income->worst[COLLATERALS] == 4);
+        CHECK(income->growth_ns[RELEASES] == 0 && income->growth_ns[MEMO] == 0);
+        CHECK(income->at_limit[COLLATERALS] > 4 && income->at_limit[RELEASES] == 0);
+        CHECK(income->cost_ns < cfg.weights.limit_us * 1000);
+
+        // the rate of the EOS collateral sums the queued payouts
+        auto deposit = find(r, "deposit/eos");
+        CHECK(deposit && deposit->growth_ns[PAYOUTS] > 0 && deposit->worst[PAYOUTS] == 4);
+        CHECK(deposit->growth_ns[COLLATERALS] == 0);
+
+        // the lookups by symbol walk the collaterals, the last one is found last
+        auto release = find(r, "release/token");
+        CHECK(release && release->ran && release->growth_ns[COLLATERALS] > 0);
+        // the chain caps the memo, no projection
+        for (const auto &a : r.actions) CHECK(a.at_limit[MEMO] == 0 && a.at_limit[MATURITIES] == 0);
+
+        // a limit below the cheapest action is reached at once
+        cfg.weights.limit_us = 1;
+        r                    = explorer(sc, cfg).run();
+        income               = find(r, "income");
+        CHECK(income && income->at_limit[COLLATERALS] == income->worst[COLLATERALS]);
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    test_cost();
+    CHECK(argc > 1);
+    if (argc > 1) {
+        tools::mapped_file        file(argv[1]);
+        native_scenario::scenario sc;
+        CHECK(file.ok() && native_scenario::load(std::string_view(file.data(), file.size()), sc).empty());
+        test_fixture(sc);
+        test_explore(sc);
+    }
+    return tools::check_report("explore_test");
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include <scenario.hpp>
+
+/**
+ * Vault states of a given shape on the native chain, grown by real actions
+ * from a scenario (`tests/scenarios/eos.json`) so every row is one the
+ * contracts could have written:
+ *
+ * - `collaterals` token collaterals besides EOS, each with an income account
+ *   holding tokens, so `income` transfers for every one of them
+ * - `releases` pending rows of `user.b`, all matured
+ * - `payouts` releases of `user.a` queued in `payouts`, released after the
+ *   vault sold and bought back all its REX, so nothing is liquid or matured;
+ *   each queues its withdraw and its fees
+ * - `maturities` REX maturity buckets of the vault, one buy per day; a buy
+ *   pays the queue first, so buckets only pile up without queued payouts
+ * - `memo` bytes of the memo of the measured transfers
+ */
+namespace explore {
+
+    using eosio::name;
+
+    enum dimension : uint32_t { COLLATERALS, RELEASES, PAYOUTS, MATURITIES, MEMO, DIMENSIONS };
+
+    inline const char *const dimension_names[DIMENSIONS] = { "collaterals", "releases", "payouts", "maturities",
+                                                             "memo" };
+
+    struct shape {
+        uint32_t size[DIMENSIONS] = { 0, 1, 0, 1, 0 };
+
+        uint32_t       &operator[](dimension d) { return size[d]; }
+        const uint32_t &operator[](dimension d) const { return size[d]; }
+
+        // "collaterals=4 payouts=16", the dimensions off their minimum
+        std::string describe(const shape &minimum) const {
+            std::string out;
+            for (uint32_t d = 0; d < DIMENSIONS; d++) {
+                if (size[d] == minimum.size[d]) continue;
+                if (!out.empty()) out += ' ';
+                out += std::string(dimension_names[d]) + "=" + std::to_string(size[d]);
+            }
+            return out.empty() ? "minimal" : out;
+        }
+    };
+
+    // symbol code of the `i`th token collateral: TAAA, TAAB, ...
+    inline std::string collateral_code(uint32_t i) {
+        std::string code = "TAAA";
+        for (int p = 3; p > 0 && i > 0; p--, i /= 26) code[p] = char('A' + i % 26);
+        return code;
+    }
+
+    class fixture {
+      public:
+        explicit fixture(const native_scenario::scenario &sc) : _sc(sc) {}
+
+        // a fresh chain grown to `s`, returns an empty string or the step that failed
+        std::string build(const shape &s, native_scenario::chain &c) {
+            _error.clear();
+            c.make_current();
+            for (const auto &r : native_scenario::run(_sc, c)) {
+                if (!r.expected) return "scenario step failed: " + r.error;
+            }
+            for (auto account : { "user.c", "user.d" }) c.create_account(name(account));
+
+            for (uint32_t i = 0; i < s[COLLATERALS]; i++) {
+                auto code = collateral_code(i);
+                push(c, "eosio.token", "create", "eosio.token", "[\"eosio\", \"1000000000.0000 " + code + "\"]");
+                push(c, "eosio.token", "issue", "eosio", "[\"eosio\", \"300000.0000 " + code + "\", \"\"]");
+                push(c, "eosio.token", "transfer", "eosio", "[\"eosio\", \"award.defi\", \"100000.0000 " + code + "\", \"\"]");
+                push(c, "eosio.token", "transfer", "eosio", "[\"eosio\", \"user.c\", \"100000.0000 " + code + "\", \"\"]");
+                push(c, "vault.defi", "createcoll", "admin.defi",
+                     "[\"eosio.token\", \"4," + code + "\", \"award.defi\", \"vfees.defi\", \"0.1000 " + code
+                         + "\", 50, 30, 5000]");
+            }
+            if (s[COLLATERALS] > 0) {
+                auto code = collateral_code(s[COLLATERALS] - 1);
+                push(c, "eosio.token", "transfer", "user.c", "[\"user.c\", \"vault.defi\", \"100.0000 " + code + "\", \"\"]");
+                push(c, "stoken.defi", "transfer", "user.c", "[\"user.c\", \"vault.defi\", \"1.0000 S" + code + "\", \"\"]");
+            }
+
+            push(c, "eosio.token", "transfer", "eosio", "[\"eosio\", \"user.d\", \"1000.0000 EOS\", \"\"]");
+            push(c, "eosio.token", "transfer", "user.a", "[\"user.a\", \"vault.defi\", \"50000.0000 EOS\", \"\"]");
+            push(c, "eosio.token", "transfer", "user.b", "[\"user.b\", \"vault.defi\", \"50000.0000 EOS\", \"\"]");
+            for (uint32_t i = 0; i < s[RELEASES]; i++) {
+                push(c, "stoken.defi", "transfer", "user.b", "[\"user.b\", \"vault.defi\", \"0.0001 SEOS\", \"\"]");
+            }
+            for (uint32_t i = 0; i < s[PAYOUTS]; i++) {
+                push(c, "stoken.defi", "transfer", "user.a", "[\"user.a\", \"vault.defi\", \"0.0001 SEOS\", \"\"]");
+            }
+
+            c.add_time(eosio::seconds(5 * 86400 + 600));
+            if (s[PAYOUTS] > 0) {
+                push(c, "vault.defi", "sellallrex", "admin.defi", "[]");
+                push(c, "vault.defi", "buyallrex", "admin.defi", "[]");
+                for (uint32_t i = 0; i < s[PAYOUTS]; i++) push(c, "vault.defi", "release", "user.a", "[\"user.a\"]");
+            }
+            for (uint32_t i = 1; i < s[MATURITIES]; i++) {
+                c.add_time(eosio::seconds(86400));
+                push(c, "eosio.token", "transfer", "user.d", "[\"user.d\", \"vault.defi\", \"1.0000 EOS\", \"\"]");
+            }
+            // the next income period
+            c.add_time(eosio::seconds(600));
+            return _error;
+        }
+
+      private:
+        void push(native_scenario::chain &c, const char *contract, const char *act, const char *actor,
+                  const std::string &data) {
+            if (!_error.empty()) return;
+            native_scenario::step s { name(contract), name(act), { name(actor) }, data, {}, 0 };
+            auto                  r = native_scenario::run_step(_sc, s, c);
+            if (!r.ok) _error = std::string(contract) + " " + act + " " + data + ": " + r.error;
+        }
+
+        const native_scenario::scenario &_sc;
+        std::string                      _error;
+    };
+
+} // namespace explore
@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <eosio.hpp>
+
+/**
+ * Binary layout of the log actions the indexer consumes. Field order and types
+ * follow the action declarations in contracts/vault/include/vault.hpp and
+ * contracts/stoken/include/stoken.hpp, which the generated ABIs are built from;
+ * keep them in sync when an action signature changes.
+ *
+ * Every field is fixed size, so an action decodes with a handful of loads
+ * straight from the trace buffer.
+ */
+namespace indexer {
+
+    struct asset {
+        int64_t  amount;
+        uint64_t symbol;
+    };
+
+    struct colupadtelog {
+        static constexpr uint64_t NAME = tools::name_value("colupadtelog");
+        uint64_t collateral_id;
+        uint64_t deposit_contract;
+        uint64_t deposit_symbol;
+        uint64_t issue_symbol;
+        uint64_t income_account;
+        uint64_t fees_account;
+        asset    min_quantity;
+        uint16_t income_ratio;
+        uint16_t release_fees;
+        uint16_t refund_ratio;
+
+        template <typename V>
+        void visit(V &&v) {
+            v(collateral_id, deposit_contract, deposit_symbol, issue_symbol, income_account,
+              fees_account, min_quantity, income_ratio, release_fees, refund_ratio);
+        }
+    };
+
+    struct depositlog {
+        static constexpr uint64_t NAME = tools::name_value("depositlog");
+        uint64_t collateral_id;
+        uint64_t owner;
+        asset    quantity;
+        uint64_t rate;
+        uint32_t time;
+
+        template <typename V>
+        void visit(V &&v) {
+            v(collateral_id, owner, quantity, rate, time);
+        }
+    };
+
+    // queued by a withdraw, `quantity` is in issued tokens
+    struct releaselog {
+        static constexpr uint64_t NAME = tools::name_value("releaselog");
+        uint64_t log_id;
+        uint64_t collateral_id;
+        uint64_t owner;
+        asset    quantity;
+        uint64_t rate;
+        uint32_t time;
+
+        template <typename V>
+        void visit(V &&v) {
+            v(log_id, collateral_id, owner, quantity, rate, time);
+        }
+    };
+
+    // paid out by `release`, closes the `releaselog` with the same `log_id`
+    struct withdrawlog {
+        static constexpr uint64_t NAME = tools::name_value("withdrawlog");
+        uint64_t log_id;
+        uint64_t collateral_id;
+        uint64_t owner;
+        asset    withdraw_quantity;
+        asset    withdraw_award_fees;
+        asset    withdraw_sys_fees;
+        asset    refund_award_quantity;
+        asset    refund_sys_quantity;
+        uint32_t time;
+
+        template <typename V>
+        void visit(V &&v) {
+            v(log_id, collateral_id, owner, withdraw_quantity, withdraw_award_fees,
+              withdraw_sys_fees, refund_award_quantity, refund_sys_quantity, time);
+        }
+    };
+
+    // stoken, balances after the transfer
+    struct transferlog {
+        static constexpr uint64_t NAME = tools::name_value("transferlog");
+        uint64_t from;
+        uint64_t to;
+        asset    quantity;
+        asset    from_balance;
+        asset    to_balance;
+
+        template <typename V>
+        void visit(V &&v) {
+            v(from, to, quantity, from_balance, to_balance);
+        }
+    };
+
+    struct unpacker {
+        const char *pos;
+        const char *end;
+        bool        ok = true;
+
+        template <typename T>
+        void read(T &value) {
+            if (size_t(end - pos) < sizeof(T)) {
+                ok = false;
+                return;
+            }
+            std::memcpy(&value, pos, sizeof(T));
+            pos += sizeof(T);
+        }
+        void read(asset &value) {
+            read(value.amount);
+            read(value.symbol);
+        }
+        template <typename... T>
+        void operator()(T &...fields) {
+            (read(fields), ...);
+        }
+    };
+
+    struct packer {
+        std::string &out;
+
+        template <typename T>
+        void write(const T &value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+        void write(const asset &value) {
+            write(value.amount);
+            write(value.symbol);
+        }
+        template <typename... T>
+        void operator()(const T &...fields) {
+            (write(fields), ...);
+        }
+    };
+
+    // false on short or trailing data, i.e. an action that does not match the layout above
+    template <typename Action>
+    bool unpack(const char *data, uint32_t size, Action &action) {
+        unpacker u { data, data + size };
+        action.visit(u);
+        return u.ok && u.pos == u.end;
+    }
+
+    template <typename Action>
+    std::string pack(Action action) {
+        std::string out;
+        action.visit(packer { out });
+        return out;
+    }
+
+} // namespace indexer
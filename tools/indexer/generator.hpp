@@ -0,0 +1,243 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <eosio.hpp>
+#include <rng.hpp>
+#include <vault_math.hpp>
+
+#include "actions.hpp"
+#include "index.hpp"
+#include "trace.hpp"
+
+namespace indexer {
+
+    /**
+     * Synthetic vault traffic as the contracts log it: deposits issue shares,
+     * withdraws queue releases, releases pay them out. Notifications and
+     * unrelated actions are mixed in so the indexer has something to skip.
+     *
+     * The generator tracks the resulting state on its own (not through
+     * `vault_index`), the tests compare the two.
+     */
+    class stream_generator {
+      public:
+        stream_generator(uint64_t vault, uint64_t stoken, uint64_t seed, uint32_t users,
+                         uint32_t collaterals)
+            : _vault(vault), _stoken(stoken), _rng(seed) {
+            for (uint32_t i = 0; i < users; i++) {
+                std::string name = "user";
+                for (uint32_t n = i; name.size() < 12; n /= 26) name += char('a' + n % 26);
+                _users.push_back(tools::name_value(name));
+            }
+            _totals.resize(collaterals + 1);
+            _pending.resize(collaterals + 1);
+            _rates.assign(collaterals + 1, vault_math::RATE_BASE);
+            for (uint32_t id = 1; id <= collaterals; id++) {
+                std::string code = std::string("T") + char('A' + (id - 1) % 26) + char('A' + (id - 1) / 26 % 26);
+
+                colupadtelog log {};
+                log.collateral_id    = id;
+                log.deposit_contract = TOKEN;
+                log.deposit_symbol   = tools::symbol_value(code, 4);
+                log.issue_symbol     = tools::symbol_value("S" + code, 4);
+                log.income_account   = tools::name_value("award.defi");
+                log.fees_account     = tools::name_value("vfees.defi");
+                log.min_quantity     = asset { 1000, log.deposit_symbol };
+                log.income_ratio     = 50;
+                log.release_fees     = 30;
+                log.refund_ratio     = 5000;
+                emit(_vault, _vault, colupadtelog::NAME, pack(log));
+
+                auto &t            = _totals[id];
+                t.id               = id;
+                t.deposit_contract = log.deposit_contract;
+                t.deposit_symbol   = log.deposit_symbol;
+                t.issue_symbol     = log.issue_symbol;
+            }
+        }
+
+        /**
+         * One user operation, passed to `sink` as a few `action_trace` records.
+         * The first call also flushes the collateral setup.
+         */
+        template <typename Sink>
+        void step(Sink &&sink) {
+            _slot += 1 + uint32_t(_rng.range(0, 5));
+            uint64_t r = _rng.range(0, 99);
+            if (r < 45) {
+                deposit();
+            } else if (r < 72) {
+                withdraw();
+            } else {
+                release();
+            }
+            // rates creep up as income lands
+            for (auto &rate : _rates) rate += _rng.range(0, 20);
+
+            for (const auto &rec : _records) sink(rec.trace());
+            _records.clear();
+        }
+
+        const std::vector<collateral_totals> &totals() const { return _totals; }
+
+        const std::vector<uint64_t> &users() const { return _users; }
+
+        uint64_t pending_count() const {
+            uint64_t count = 0;
+            for (const auto &list : _pending) count += list.size();
+            return count;
+        }
+
+        // share balance of `owner` in collateral `id`
+        int64_t shares(uint64_t owner, uint64_t id) const {
+            auto itr = _shares.find(position_key { owner, id });
+            return itr == _shares.end() ? 0 : itr->second;
+        }
+
+      private:
+        static constexpr uint64_t TOKEN    = tools::name_value("token.defi");
+        static constexpr uint64_t TRANSFER = tools::name_value("transfer");
+        // releases mature 5 days later, in half-second block slots
+        static constexpr uint32_t RELEASE_SLOTS = 5 * 86400 * 2;
+
+        struct record {
+            uint64_t    global_sequence;
+            uint32_t    slot;
+            uint64_t    receiver;
+            uint64_t    account;
+            uint64_t    name;
+            std::string data;
+
+            action_trace trace() const {
+                return action_trace { global_sequence, slot,    slot, receiver, account,
+                                      name,            data.data(), uint32_t(data.size()) };
+            }
+        };
+
+        void emit(uint64_t receiver, uint64_t account, uint64_t name, std::string data) {
+            _records.push_back(record { ++_sequence, _slot, receiver, account, name, std::move(data) });
+        }
+
+        // stoken transfer with the balances after it, as `transferlog` reports them
+        void share_transfer(uint64_t from, uint64_t to, uint64_t id, int64_t amount) {
+            uint64_t sym          = _totals[id].issue_symbol;
+            int64_t &from_balance = _shares[position_key { from, id }];
+            from_balance -= amount;
+            int64_t &to_balance = _shares[position_key { to, id }];
+            to_balance += amount;
+
+            emit(_stoken, _stoken, TRANSFER, std::string(40, '\0'));
+            emit(from, _stoken, TRANSFER, std::string(40, '\0'));
+            emit(to, _stoken, TRANSFER, std::string(40, '\0'));
+            transferlog log { from, to, asset { amount, sym }, asset { from_balance, sym },
+                              asset { to_balance, sym } };
+            emit(_stoken, _stoken, transferlog::NAME, pack(log));
+        }
+
+        uint64_t pick_user() { return _users[_rng.range(0, _users.size() - 1)]; }
+        uint64_t pick_collateral() { return _rng.range(1, _totals.size() - 1); }
+
+        void deposit() {
+            uint64_t owner  = pick_user();
+            uint64_t id     = pick_collateral();
+            auto    &t      = _totals[id];
+            int64_t  amount = int64_t(_rng.range(1000, 100000000));
+
+            // the deposit transfer reaches the vault as a notification
+            emit(TOKEN, TOKEN, TRANSFER, std::string(40, '\0'));
+            emit(_vault, TOKEN, TRANSFER, std::string(40, '\0'));
+
+            // `issue` credits the vault, then transfers to the owner
+            int64_t issued = int64_t(vault_math::issue_amount(amount, _rates[id]));
+            _shares[position_key { _vault, id }] += issued;
+            share_transfer(_vault, owner, id, issued);
+
+            depositlog log { id, owner, asset { amount, t.deposit_symbol }, _rates[id], _slot };
+            emit(_vault, _vault, depositlog::NAME, pack(log));
+            t.total_deposit += amount;
+            t.deposits++;
+            t.last_rate   = _rates[id];
+            t.update_time = _slot;
+        }
+
+        void withdraw() {
+            uint64_t owner = pick_user();
+            uint64_t id    = pick_collateral();
+            int64_t  held  = shares(owner, id);
+            if (held <= 0) {
+                return deposit();
+            }
+            auto   &t      = _totals[id];
+            int64_t amount = int64_t(_rng.range(1, uint64_t(held)));
+            share_transfer(owner, _vault, id, amount);
+
+            releaselog log { ++_log_id, id, owner, asset { amount, t.issue_symbol }, _rates[id],
+                             _slot + RELEASE_SLOTS };
+            emit(_vault, _vault, releaselog::NAME, pack(log));
+            _pending[id].push_back(log);
+            t.withdraws++;
+            t.pending_count++;
+            t.pending_quantity += amount;
+            t.last_rate   = _rates[id];
+            t.update_time = _slot;
+        }
+
+        void release() {
+            uint64_t id = pick_collateral();
+            if (_pending[id].empty()) {
+                return withdraw();
+            }
+            // any pending release, those of different owners mature independently
+            auto      &list = _pending[id];
+            size_t     i    = size_t(_rng.range(0, list.size() - 1));
+            releaselog r    = list[i];
+            list[i]         = list.back();
+            list.pop_back();
+
+            auto &t       = _totals[id];
+            auto  amounts = vault_math::release(r.quantity.amount, r.rate, _rates[id], 30, 5000);
+            // the vault retires the shares, stoken logs no transfer for it
+            _shares[position_key { _vault, id }] -= r.quantity.amount;
+
+            uint64_t    sym = t.deposit_symbol;
+            withdrawlog log { r.log_id,
+                              id,
+                              r.owner,
+                              asset { amounts.withdraw, sym },
+                              asset { amounts.fees.award, sym },
+                              asset { amounts.fees.sys, sym },
+                              asset { amounts.refund.award, sym },
+                              asset { amounts.refund.sys, sym },
+                              _slot };
+            emit(_vault, _vault, withdrawlog::NAME, pack(log));
+            t.total_withdraw += amounts.withdraw;
+            t.withdraw_award_fees += amounts.fees.award;
+            t.withdraw_sys_fees += amounts.fees.sys;
+            t.refund_award_quantity += amounts.refund.award;
+            t.refund_sys_quantity += amounts.refund.sys;
+            t.releases++;
+            t.pending_count--;
+            t.pending_quantity -= r.quantity.amount;
+            t.update_time = _slot;
+        }
+
+        uint64_t   _vault;
+        uint64_t   _stoken;
+        tools::rng _rng;
+        uint64_t   _sequence = 0;
+        uint64_t   _log_id   = 0;
+        uint32_t   _slot     = 1000000000;
+
+        std::vector<uint64_t>                 _users;
+        std::vector<collateral_totals>        _totals;
+        std::vector<std::vector<releaselog>>  _pending;
+        std::vector<uint64_t>                 _rates;
+        std::vector<record>                   _records;
+        // share balances by (owner, collateral id)
+        std::unordered_map<position_key, int64_t, position_hash> _shares;
+    };
+
+} // namespace indexer
@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "actions.hpp"
+#include "trace.hpp"
+
+namespace indexer {
+
+    struct pending_release {
+        uint64_t owner;
+        uint64_t collateral_id;
+        int64_t  quantity;   // issued tokens
+        uint64_t rate;
+        uint32_t time;       // maturity, block_timestamp slot
+    };
+
+    // mirrors the `metrics` table plus event counts
+    struct collateral_totals {
+        uint64_t id               = 0;
+        uint64_t deposit_contract = 0;
+        uint64_t deposit_symbol   = 0;
+        uint64_t issue_symbol     = 0;
+
+        int64_t total_deposit         = 0;
+        int64_t total_withdraw        = 0;
+        int64_t withdraw_award_fees   = 0;
+        int64_t withdraw_sys_fees     = 0;
+        int64_t refund_award_quantity = 0;
+        int64_t refund_sys_quantity   = 0;
+
+        uint64_t deposits         = 0;
+        uint64_t withdraws        = 0;
+        uint64_t releases         = 0;
+        uint64_t pending_count    = 0;
+        int64_t  pending_quantity = 0;
+        uint64_t last_rate        = 0;
+        uint32_t update_time      = 0;
+    };
+
+    struct position_key {
+        uint64_t owner;
+        uint64_t code;   // symbol code, precision stripped
+
+        bool operator==(const position_key &other) const {
+            return owner == other.owner && code == other.code;
+        }
+    };
+
+    struct position_hash {
+        size_t operator()(const position_key &key) const {
+            uint64_t h = (key.owner ^ (key.code * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+            return size_t(h ^ (h >> 31));
+        }
+    };
+
+    struct index_stats {
+        uint64_t records   = 0;
+        uint64_t applied   = 0;
+        uint64_t skipped   = 0;   // other contracts, other actions and notifications
+        uint64_t malformed = 0;   // data that does not match the action layout
+        uint64_t unmatched = 0;   // withdrawlog without a pending releaselog, e.g. before the replay window
+    };
+
+    /**
+     * Replays vault and stoken log actions into per-user positions, pending
+     * releases and per-collateral totals. State only grows with distinct
+     * users, collaterals and pending releases, not with the event count.
+     */
+    class vault_index {
+      public:
+        vault_index(uint64_t vault, uint64_t stoken) : _vault(vault), _stoken(stoken) {}
+
+        void apply(const action_trace &trace) {
+            _stats.records++;
+            if (trace.receiver != trace.account) {
+                _stats.skipped++;
+                return;
+            }
+            bool ok = true;
+            if (trace.account == _vault) {
+                switch (trace.name) {
+                case depositlog::NAME: ok = on<depositlog>(trace); break;
+                case releaselog::NAME: ok = on<releaselog>(trace); break;
+                case withdrawlog::NAME: ok = on<withdrawlog>(trace); break;
+                case colupadtelog::NAME: ok = on<colupadtelog>(trace); break;
+                default: _stats.skipped++; return;
+                }
+            } else if (trace.account == _stoken && trace.name == transferlog::NAME) {
+                ok = on<transferlog>(trace);
+            } else {
+                _stats.skipped++;
+                return;
+            }
+            ok ? _stats.applied++ : _stats.malformed++;
+        }
+
+        const index_stats &stats() const { return _stats; }
+
+        // indexed by collateral id, entry 0 and gaps stay empty
+        const std::vector<collateral_totals> &collaterals() const { return _collaterals; }
+
+        const std::unordered_map<uint64_t, pending_release> &pending() const { return _pending; }
+
+        const std::unordered_map<position_key, int64_t, position_hash> &positions() const {
+            return _positions;
+        }
+
+        int64_t balance(uint64_t owner, uint64_t code) const {
+            auto itr = _positions.find(position_key { owner, code });
+            return itr == _positions.end() ? 0 : itr->second;
+        }
+
+      private:
+        // decoded on the stack straight from the trace buffer
+        template <typename Action>
+        bool on(const action_trace &trace) {
+            Action action;
+            if (!unpack(trace.data, trace.data_size, action)) return false;
+            apply(action, trace);
+            return true;
+        }
+
+        collateral_totals &collateral(uint64_t id) {
+            if (id >= _collaterals.size()) _collaterals.resize(id + 1);
+            auto &c = _collaterals[id];
+            c.id    = id;
+            return c;
+        }
+
+        void apply(const colupadtelog &log, const action_trace &) {
+            auto &c            = collateral(log.collateral_id);
+            c.deposit_contract = log.deposit_contract;
+            c.deposit_symbol   = log.deposit_symbol;
+            c.issue_symbol     = log.issue_symbol;
+        }
+
+        void apply(const depositlog &log, const action_trace &) {
+            auto &c = collateral(log.collateral_id);
+            c.total_deposit += log.quantity.amount;
+            c.deposits++;
+            c.last_rate   = log.rate;
+            c.update_time = log.time;
+        }
+
+        void apply(const releaselog &log, const action_trace &trace) {
+            auto &c = collateral(log.collateral_id);
+            c.withdraws++;
+            c.pending_count++;
+            c.pending_quantity += log.quantity.amount;
+            c.last_rate   = log.rate;
+            c.update_time = trace.block_time;
+            _pending[log.log_id]
+                = pending_release { log.owner, log.collateral_id, log.quantity.amount, log.rate, log.time };
+        }
+
+        void apply(const withdrawlog &log, const action_trace &) {
+            auto &c = collateral(log.collateral_id);
+            c.total_withdraw += log.withdraw_quantity.amount;
+            c.withdraw_award_fees += log.withdraw_award_fees.amount;
+            c.withdraw_sys_fees += log.withdraw_sys_fees.amount;
+            c.refund_award_quantity += log.refund_award_quantity.amount;
+            c.refund_sys_quantity += log.refund_sys_quantity.amount;
+            c.releases++;
+            c.update_time = log.time;
+
+            auto itr = _pending.find(log.log_id);
+            if (itr == _pending.end()) {
+                _stats.unmatched++;
+                return;
+            }
+            c.pending_count--;
+            c.pending_quantity -= itr->second.quantity;
+            _pending.erase(itr);
+        }
+
+        void apply(const transferlog &log, const action_trace &) {
+            _positions[position_key { log.from, log.from_balance.symbol >> 8 }] = log.from_balance.amount;
+            _positions[position_key { log.to, log.to_balance.symbol >> 8 }]     = log.to_balance.amount;
+        }
+
+        uint64_t    _vault;
+        uint64_t    _stoken;
+        index_stats _stats;
+
+        std::vector<collateral_totals>                           _collaterals;
+        std::unordered_map<uint64_t, pending_release>            _pending;
+        std::unordered_map<position_key, int64_t, position_hash> _positions;
+    };
+
+} // namespace indexer
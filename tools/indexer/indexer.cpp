@@ -0,0 +1,105 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <bench.hpp>
+#include <eosio.hpp>
+
+#include "index.hpp"
+#include "trace.hpp"
+
+using namespace indexer;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr, "usage: indexer [--vault NAME] [--stoken NAME] [--repeat N] TRACE\n"
+                             "  replays TRACE and prints per-collateral totals,\n"
+                             "  --repeat replays it N times and reports the fastest run\n");
+    }
+
+    void print(const vault_index &index) {
+        const auto &s = index.stats();
+        std::printf("records=%" PRIu64 " applied=%" PRIu64 " skipped=%" PRIu64
+                    " malformed=%" PRIu64 " unmatched=%" PRIu64 "\n",
+                    s.records, s.applied, s.skipped, s.malformed, s.unmatched);
+        std::printf("positions=%zu pending=%zu\n", index.positions().size(), index.pending().size());
+
+        for (const auto &c : index.collaterals()) {
+            if (c.id == 0) continue;
+            std::printf("collateral %" PRIu64 " %s deposits=%" PRIu64 " withdraws=%" PRIu64
+                        " releases=%" PRIu64 " pending=%" PRIu64 "\n",
+                        c.id, tools::name_string(c.deposit_contract).c_str(), c.deposits, c.withdraws,
+                        c.releases, c.pending_count);
+            std::printf("  total_deposit=%s total_withdraw=%s pending_quantity=%s last_rate=%" PRIu64 "\n",
+                        tools::asset_string(c.total_deposit, c.deposit_symbol).c_str(),
+                        tools::asset_string(c.total_withdraw, c.deposit_symbol).c_str(),
+                        tools::asset_string(c.pending_quantity, c.issue_symbol).c_str(), c.last_rate);
+            std::printf("  fees award=%s sys=%s refund award=%s sys=%s\n",
+                        tools::asset_string(c.withdraw_award_fees, c.deposit_symbol).c_str(),
+                        tools::asset_string(c.withdraw_sys_fees, c.deposit_symbol).c_str(),
+                        tools::asset_string(c.refund_award_quantity, c.deposit_symbol).c_str(),
+                        tools::asset_string(c.refund_sys_quantity, c.deposit_symbol).c_str());
+        }
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    uint64_t    vault  = tools::name_value("vault.defi");
+    uint64_t    stoken = tools::name_value("stoken.defi");
+    int         repeat = 1;
+    const char *path   = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--vault") && i + 1 < argc) {
+            vault = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--stoken") && i + 1 < argc) {
+            stoken = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--repeat") && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    mapped_file file(path);
+    if (!file.ok()) {
+        std::fprintf(stderr, "indexer: cannot map %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    double best = 0;
+    for (int run = 0; run < repeat; run++) {
+        vault_index      index(vault, stoken);
+        trace_reader     reader(file.data(), file.size());
+        action_trace     trace;
+        tools::stopwatch timer;
+        while (reader.next(trace)) {
+            index.apply(trace);
+        }
+        double seconds = timer.seconds();
+        if (reader.error()) {
+            std::fprintf(stderr, "indexer: %s: %s after %" PRIu64 " records\n", path, reader.error(),
+                         index.stats().records);
+            return EXIT_FAILURE;
+        }
+        if (run == 0) print(index);
+        if (run == 0 || seconds < best) best = seconds;
+        if (run + 1 == repeat) {
+            std::printf("%" PRIu64 " records, %.1f MB in %.3fs (%.2f M records/s, %.0f MB/s)\n",
+                        index.stats().records, double(file.size()) / 1e6, best,
+                        double(index.stats().records) / best / 1e6, double(file.size()) / best / 1e6);
+        }
+    }
+    return EXIT_SUCCESS;
+}
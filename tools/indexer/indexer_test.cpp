@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <check.hpp>
+#include <eosio.hpp>
+
+#include "generator.hpp"
+#include "index.hpp"
+#include "trace.hpp"
+
+using namespace indexer;
+
+namespace {
+
+    const uint64_t VAULT  = tools::name_value("vault.defi");
+    const uint64_t STOKEN = tools::name_value("stoken.defi");
+
+    void test_encoding() {
+        CHECK(tools::name_string(tools::name_value("vault.defi")) == "vault.defi");
+        CHECK(tools::name_string(tools::name_value("a1b2c3d4e5.z")) == "a1b2c3d4e5.z");
+        CHECK(tools::name_value("eosio") == 6138663577826885632ULL);
+        CHECK(tools::symbol_value("EOS", 4) == 0x534f4504ULL);
+        CHECK(tools::asset_string(12345, tools::symbol_value("EOS", 4)) == "1.2345 EOS");
+        CHECK(tools::asset_string(-5, tools::symbol_value("SUSDT", 4)) == "-0.0005 SUSDT");
+        CHECK(tools::asset_string(7, tools::symbol_value("BTC", 0)) == "7 BTC");
+    }
+
+    void test_pack() {
+        depositlog in { 3, VAULT, asset { 42, tools::symbol_value("EOS", 4) }, 100000001, 77 };
+        std::string data = pack(in);
+        CHECK(data.size() == 8 + 8 + 16 + 8 + 4);
+
+        depositlog out {};
+        CHECK(unpack(data.data(), uint32_t(data.size()), out));
+        CHECK(out.collateral_id == 3 && out.owner == VAULT && out.quantity.amount == 42);
+        CHECK(out.rate == 100000001 && out.time == 77);
+        CHECK(!unpack(data.data(), uint32_t(data.size() - 1), out));
+        data += '\0';
+        CHECK(!unpack(data.data(), uint32_t(data.size()), out));
+    }
+
+    // the generator tracks state on its own, the index must reach the same
+    void test_replay(const std::string &path) {
+        stream_generator gen(VAULT, STOKEN, 7, 500, 5);
+        {
+            trace_writer writer(path);
+            CHECK(writer.ok());
+            for (int i = 0; i < 200000; i++) {
+                gen.step([&](const action_trace &trace) { writer.write(trace); });
+            }
+        }
+
+        mapped_file file(path);
+        CHECK(file.ok());
+        trace_reader reader(file.data(), file.size());
+        vault_index  index(VAULT, STOKEN);
+        action_trace trace;
+        while (reader.next(trace)) index.apply(trace);
+        CHECK(reader.error() == nullptr);
+
+        const auto &s = index.stats();
+        CHECK(s.records == s.applied + s.skipped);
+        CHECK(s.malformed == 0 && s.unmatched == 0);
+        CHECK(index.pending().size() == gen.pending_count());
+
+        CHECK(index.collaterals().size() == gen.totals().size());
+        for (const auto &expected : gen.totals()) {
+            if (expected.id == 0) continue;
+            const auto &c = index.collaterals()[expected.id];
+            CHECK(c.issue_symbol == expected.issue_symbol);
+            CHECK(c.total_deposit == expected.total_deposit);
+            CHECK(c.total_withdraw == expected.total_withdraw);
+            CHECK(c.withdraw_award_fees == expected.withdraw_award_fees);
+            CHECK(c.withdraw_sys_fees == expected.withdraw_sys_fees);
+            CHECK(c.refund_award_quantity == expected.refund_award_quantity);
+            CHECK(c.refund_sys_quantity == expected.refund_sys_quantity);
+            CHECK(c.deposits == expected.deposits);
+            CHECK(c.withdraws == expected.withdraws);
+            CHECK(c.releases == expected.releases);
+            CHECK(c.pending_count == expected.pending_count);
+            CHECK(c.pending_quantity == expected.pending_quantity);
+            CHECK(c.last_rate == expected.last_rate);
+            CHECK(c.update_time <= expected.update_time);
+
+            for (uint64_t user : gen.users()) {
+                CHECK(index.balance(user, c.issue_symbol >> 8) == gen.shares(user, c.id));
+            }
+        }
+    }
+
+    void test_damaged(const std::string &path) {
+        stream_generator gen(VAULT, STOKEN, 1, 10, 1);
+        std::string      bytes;
+        {
+            trace_writer writer(path);
+            for (int i = 0; i < 100; i++) {
+                gen.step([&](const action_trace &trace) { writer.write(trace); });
+            }
+            // a depositlog too short for its layout
+            action_trace bad { 1, 1, 1, VAULT, VAULT, depositlog::NAME, "abc", 3 };
+            writer.write(bad);
+        }
+        {
+            mapped_file  file(path);
+            trace_reader reader(file.data(), file.size());
+            vault_index  index(VAULT, STOKEN);
+            action_trace trace;
+            while (reader.next(trace)) index.apply(trace);
+            CHECK(reader.error() == nullptr);
+            CHECK(index.stats().malformed == 1);
+            bytes.assign(file.data(), file.size());
+        }
+
+        // cut inside the last record
+        trace_reader reader(bytes.data(), bytes.size() - 2);
+        action_trace trace;
+        uint64_t     records = 0;
+        while (reader.next(trace)) records++;
+        CHECK(reader.error() != nullptr);
+        CHECK(records > 0);
+
+        trace_reader garbage("nope", 4);
+        CHECK(!garbage.next(trace) && garbage.error() != nullptr);
+    }
+
+} // namespace
+
+int main() {
+    std::string path = std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp")
+                       + "/indexer_test." + std::to_string(::getpid()) + ".trace";
+    test_encoding();
+    test_pack();
+    test_replay(path);
+    test_damaged(path);
+    std::remove(path.c_str());
+    return tools::check_report("indexer_test");
+}
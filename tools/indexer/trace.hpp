@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <mapped_file.hpp>
+
+/**
+ * Binary action trace file, a local stand-in for a state-history stream.
+ *
+ *     file   := "VTRC" u32 version record*
+ *     record := u32 size, then `size` bytes:
+ *               u64 global_sequence, u32 block_num, u32 block_time (block_timestamp slot),
+ *               u64 receiver, u64 account, u64 name, u32 data_size, data[data_size]
+ *
+ * Integers are little endian, as on chain. `data` is the action data exactly as
+ * serialized by the contract, notifications are separate records whose receiver
+ * differs from the account.
+ */
+namespace indexer {
+
+    using tools::mapped_file;
+
+    static constexpr char     TRACE_MAGIC[4] = { 'V', 'T', 'R', 'C' };
+    static constexpr uint32_t TRACE_VERSION  = 1;
+    static constexpr size_t   HEADER_SIZE    = 8;
+    static constexpr size_t   RECORD_FIXED   = 8 + 4 + 4 + 8 + 8 + 8 + 4;
+
+    // one record, `data` points into the mapped file
+    struct action_trace {
+        uint64_t    global_sequence;
+        uint32_t    block_num;
+        uint32_t    block_time;
+        uint64_t    receiver;
+        uint64_t    account;
+        uint64_t    name;
+        const char *data;
+        uint32_t    data_size;
+    };
+
+    template <typename T>
+    inline T load(const char *p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    /**
+     * Iterates the records of a trace buffer without copying. `next` returns
+     * false at the end or on a truncated record, `error()` tells them apart.
+     */
+    class trace_reader {
+      public:
+        // `start` resumes at the `offset()` of an earlier reader of the same file
+        trace_reader(const char *data, size_t size, size_t start = HEADER_SIZE)
+            : _begin(data), _pos(data), _end(data + size), _good(data) {
+            if (size < HEADER_SIZE || std::memcmp(data, TRACE_MAGIC, 4) != 0
+                || load<uint32_t>(data + 4) != TRACE_VERSION || start < HEADER_SIZE || start > size) {
+                _error = "not a trace file";
+                _pos   = _end;
+                return;
+            }
+            _pos += start;
+            _good = _pos;
+        }
+
+        bool next(action_trace &trace) {
+            if (_pos == _end) return false;
+            if (size_t(_end - _pos) < 4) return fail();
+            uint32_t size = load<uint32_t>(_pos);
+            if (size < RECORD_FIXED || size_t(_end - _pos - 4) < size) return fail();
+
+            const char *p         = _pos + 4;
+            trace.global_sequence = load<uint64_t>(p);
+            trace.block_num       = load<uint32_t>(p + 8);
+            trace.block_time      = load<uint32_t>(p + 12);
+            trace.receiver        = load<uint64_t>(p + 16);
+            trace.account         = load<uint64_t>(p + 24);
+            trace.name            = load<uint64_t>(p + 32);
+            trace.data_size       = load<uint32_t>(p + 40);
+            trace.data            = p + RECORD_FIXED;
+            if (trace.data_size != size - RECORD_FIXED) return fail();
+
+            _pos += 4 + size;
+            _good = _pos;
+            return true;
+        }
+
+        const char *error() const { return _error; }
+
+        // bytes up to the end of the last complete record, a file still being written may end in a partial one
+        size_t offset() const { return size_t(_good - _begin); }
+
+      private:
+        bool fail() {
+            _error = "truncated record";
+            _pos   = _end;
+            return false;
+        }
+
+        const char *_begin;
+        const char *_pos;
+        const char *_end;
+        const char *_good;
+        const char *_error = nullptr;
+    };
+
+    // appends records to a trace file, used by `trace_gen` and the tests
+    class trace_writer {
+      public:
+        explicit trace_writer(const std::string &path) : _file(std::fopen(path.c_str(), "wb")) {
+            if (!_file) return;
+            std::fwrite(TRACE_MAGIC, 1, 4, _file);
+            put(TRACE_VERSION);
+        }
+        ~trace_writer() {
+            if (_file) std::fclose(_file);
+        }
+        trace_writer(const trace_writer &)            = delete;
+        trace_writer &operator=(const trace_writer &) = delete;
+
+        bool ok() const { return _file != nullptr; }
+
+        void write(const action_trace &trace) {
+            put(uint32_t(RECORD_FIXED + trace.data_size));
+            put(trace.global_sequence);
+            put(trace.block_num);
+            put(trace.block_time);
+            put(trace.receiver);
+            put(trace.account);
+            put(trace.name);
+            put(trace.data_size);
+            std::fwrite(trace.data, 1, trace.data_size, _file);
+        }
+
+      private:
+        template <typename T>
+        void put(T value) {
+            std::fwrite(&value, sizeof(T), 1, _file);
+        }
+
+        std::FILE *_file;
+    };
+
+} // namespace indexer
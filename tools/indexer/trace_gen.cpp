@@ -0,0 +1,40 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include <eosio.hpp>
+
+#include "generator.hpp"
+#include "trace.hpp"
+
+using namespace indexer;
+
+// Writes a synthetic trace of `ops` user operations for benchmarking `indexer`.
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: trace_gen FILE [ops=1000000] [seed=1] [users=10000] [collaterals=8]\n");
+        return EXIT_FAILURE;
+    }
+    uint64_t ops         = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    uint64_t seed        = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    uint32_t users       = argc > 4 ? uint32_t(std::strtoul(argv[4], nullptr, 10)) : 10000;
+    uint32_t collaterals = argc > 5 ? uint32_t(std::strtoul(argv[5], nullptr, 10)) : 8;
+
+    trace_writer writer(argv[1]);
+    if (!writer.ok()) {
+        std::fprintf(stderr, "trace_gen: cannot write %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    stream_generator gen(tools::name_value("vault.defi"), tools::name_value("stoken.defi"), seed,
+                         users, collaterals);
+    uint64_t records = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        gen.step([&](const action_trace &trace) {
+            writer.write(trace);
+            records++;
+        });
+    }
+    std::printf("%" PRIu64 " operations, %" PRIu64 " records, %" PRIu64 " pending releases\n", ops,
+                records, gen.pending_count());
+    return EXIT_SUCCESS;
+}
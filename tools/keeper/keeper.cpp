@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+#include <eosio.hpp>
+#include <mapped_file.hpp>
+
+#include "keeper.hpp"
+
+using namespace keeper;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: keeper [--vault NAME] [--actor NAME] [--batch N] [--retry SECONDS] [--buyrex ACTOR]\n"
+                     "              [--snapshot DUMP] [--trace FILE [--follow]] [--now SECONDS]\n"
+                     "  schedules income and the maturity of every pending release from DUMP and\n"
+                     "  FILE, and prints the due transactions as JSON lines on stdout, signed by\n"
+                     "  --actor (keeper.defi); --buyrex adds a buyallrex after every income,\n"
+                     "  signed by ACTOR, the vault or its admin;\n"
+                     "  --follow keeps running, reads the records appended to FILE and pushes\n"
+                     "  the work when it becomes due\n");
+    }
+
+    // records of `path` after `offset`, returns the offset to resume at
+    size_t read_trace(const char *path, size_t offset, vault_keeper &k, uint64_t &malformed) {
+        tools::mapped_file file(path);
+        if (!file.ok()) return offset;
+        indexer::trace_reader reader(file.data(), file.size(), offset);
+        indexer::action_trace trace;
+        while (reader.next(trace)) {
+            if (!k.apply(trace)) malformed++;
+        }
+        return std::max(offset, reader.offset());
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    config      cfg;
+    const char *snapshot = nullptr;
+    const char *trace    = nullptr;
+    bool        follow   = false;
+    uint64_t    now      = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--vault") && i + 1 < argc) {
+            cfg.vault = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--actor") && i + 1 < argc) {
+            cfg.actor = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) {
+            cfg.max_actions = size_t(std::max(1, std::atoi(argv[++i])));
+        } else if (!std::strcmp(argv[i], "--retry") && i + 1 < argc) {
+            cfg.retry_delay = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "--buyrex") && i + 1 < argc) {
+            cfg.rex_actor = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--snapshot") && i + 1 < argc) {
+            snapshot = argv[++i];
+        } else if (!std::strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (!std::strcmp(argv[i], "--follow")) {
+            follow = true;
+        } else if (!std::strcmp(argv[i], "--now") && i + 1 < argc) {
+            now = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if ((!snapshot && !trace) || (follow && (!trace || now))) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    jsonl_transport out(stdout);
+    vault_keeper    k(cfg, out);
+
+    if (snapshot) {
+        tools::mapped_file file(snapshot);
+        if (!file.ok()) {
+            std::fprintf(stderr, "keeper: cannot map %s\n", snapshot);
+            return EXIT_FAILURE;
+        }
+        auto stats = k.load_snapshot(file.data(), file.size());
+        std::fprintf(stderr, "keeper: %s: %" PRIu64 " rows, %" PRIu64 " malformed\n", snapshot, stats.rows,
+                     stats.malformed);
+    }
+
+    uint64_t malformed = 0;
+    size_t   offset    = indexer::HEADER_SIZE;
+    if (trace) offset = read_trace(trace, offset, k, malformed);
+
+    auto report = [&](uint64_t at, const tick_stats &t) {
+        if (t.transactions == 0) return;
+        std::fprintf(stderr,
+                     "keeper: %" PRIu64 ": %" PRIu64 " transactions, %" PRIu64 " actions, %" PRIu64
+                     " failed, %zu releases pending\n",
+                     at, t.transactions, t.actions, t.failed, k.tasks().pending());
+    };
+
+    if (!follow) {
+        if (!now) now = uint64_t(std::time(nullptr));
+        report(now, k.tick(now));
+        std::fprintf(stderr, "keeper: next task at %" PRIu64 ", %" PRIu64 " malformed trace records\n",
+                     k.tasks().next_time(), malformed);
+        return EXIT_SUCCESS;
+    }
+
+    // poll the trace at least every few seconds, sleep until the next task otherwise
+    const uint64_t poll = 5;
+    for (;;) {
+        offset      = read_trace(trace, offset, k, malformed);
+        uint64_t at = uint64_t(std::time(nullptr));
+        report(at, k.tick(at));
+        uint64_t next = k.tasks().next_time();
+        uint64_t wait = next > at ? std::min(next - at, poll) : poll;
+        std::this_thread::sleep_for(std::chrono::seconds(wait));
+    }
+}
@@ -0,0 +1,301 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <dump.hpp>
+#include <eosio.hpp>
+#include <json.hpp>
+#include <ledger.hpp>
+
+#include <actions.hpp>
+#include <trace.hpp>
+
+#include "schedule.hpp"
+
+/**
+ * Calls `income`, `payout`, `release` and optionally `buyallrex` when they are
+ * due, instead of a cron job calling `income` blindly and nobody releasing the
+ * matured rows of inactive owners.
+ *
+ * The schedule is built from a table dump (the JSON-lines or binary format
+ * `reconcile` reads) and kept current from the action trace (`indexer` format).
+ * Due work goes out in as few transactions as `max_actions` allows, through a
+ * `transport`. A release counts as paid out once a `release_source` no longer
+ * has its row, or once its `withdrawlog` shows up in the trace.
+ */
+namespace keeper {
+
+    struct action {
+        uint64_t    account;
+        uint64_t    name;
+        uint64_t    actor;
+        std::string args;   // positional JSON arguments, as the steps of tests/scenarios
+    };
+
+    using transaction = std::vector<action>;
+
+    class transport {
+      public:
+        virtual ~transport() = default;
+        // empty on success, otherwise why the whole transaction failed
+        virtual std::string push(const transaction &trx) = 0;
+    };
+
+    /**
+     * One JSON line per transaction, for a submitter reading a pipe:
+     *
+     *     {"actions":[{"account":"vault.defi","name":"release","authorization":[{"actor":"keeper","permission":"active"}],"data":["user.a"]}]}
+     */
+    class jsonl_transport : public transport {
+      public:
+        explicit jsonl_transport(std::FILE *out) : _out(out) {}
+
+        std::string push(const transaction &trx) override {
+            std::string line = "{\"actions\":[";
+            for (size_t i = 0; i < trx.size(); i++) {
+                const auto &a = trx[i];
+                line += i ? ",{" : "{";
+                line += "\"account\":\"" + tools::name_string(a.account) + "\",\"name\":\""
+                        + tools::name_string(a.name) + "\",\"authorization\":[{\"actor\":\""
+                        + tools::name_string(a.actor) + "\",\"permission\":\"active\"}],\"data\":" + a.args + "}";
+            }
+            line += "]}\n";
+            if (std::fputs(line.c_str(), _out) < 0 || std::fflush(_out) != 0) return "write failed";
+            return {};
+        }
+
+      private:
+        std::FILE *_out;
+    };
+
+    /**
+     * The `releases` rows on chain, read back after a `release` went through:
+     * the action pays out the first row of its owner when it has matured and
+     * does nothing otherwise.
+     */
+    class release_source {
+      public:
+        virtual ~release_source() = default;
+        // ids of the pending releases of `owner`, false when the table cannot be read
+        virtual bool release_ids(uint64_t owner, std::vector<uint64_t> &ids) = 0;
+    };
+
+    struct config {
+        uint64_t vault = tools::name_value("vault.defi");
+        // signs `income`, `payout` and `release`; the vault takes `payout` from keeper.defi or its admin
+        uint64_t actor       = tools::name_value("keeper.defi");
+        size_t   max_actions = 16;
+        uint64_t retry_delay = 60;
+        // signs a `buyallrex` after every income, the vault or its admin; 0 never calls it
+        uint64_t rex_actor = 0;
+    };
+
+    struct tick_stats {
+        uint64_t transactions = 0;   // pushed, including the failed ones
+        uint64_t actions      = 0;   // in successful transactions
+        uint64_t failed       = 0;   // actions rescheduled after failing on their own
+        uint64_t unpaid       = 0;   // releases still on chain after their `release` went through
+    };
+
+    struct ingest_stats {
+        uint64_t rows      = 0;
+        uint64_t malformed = 0;
+    };
+
+    class vault_keeper {
+      public:
+        // without `releases`, a sent release stays pending until its `withdrawlog` is applied
+        vault_keeper(const config &cfg, transport &out, release_source *releases = nullptr)
+            : _cfg(cfg), _out(out), _releases(releases) {}
+
+        // `releases` and `config` rows of a table dump, other rows are ignored
+        ingest_stats load_snapshot(const char *data, size_t size) {
+            ingest_stats stats;
+            for (const auto &c : reconcile::split(data, size, 1)) {
+                reconcile::row_reader reader(c);
+                reconcile::row        r;
+                while (reader.next(r)) {
+                    if (r.code != _cfg.vault) continue;
+                    bool ok = true;
+                    if (r.table == RELEASES) {
+                        ok = release_row(r);
+                    } else if (r.table == CONFIG) {
+                        ok = config_row(r);
+                    } else {
+                        continue;
+                    }
+                    stats.rows++;
+                    if (!ok) stats.malformed++;
+                }
+                stats.malformed += reader.malformed();
+            }
+            return stats;
+        }
+
+        // vault actions of the live trace: new and paid out releases, `income` calls
+        bool apply(const indexer::action_trace &trace) {
+            if (trace.receiver != trace.account || trace.account != _cfg.vault) return true;
+            if (trace.name == indexer::releaselog::NAME) {
+                indexer::releaselog log;
+                if (!indexer::unpack(trace.data, trace.data_size, log)) return false;
+                _schedule.add_release(log.log_id, log.owner, tools::block_time_seconds(log.time));
+            } else if (trace.name == indexer::withdrawlog::NAME) {
+                indexer::withdrawlog log;
+                if (!indexer::unpack(trace.data, trace.data_size, log)) return false;
+                _schedule.remove_release(log.log_id);
+            } else if (trace.name == INCOME) {
+                _schedule.income_ran(tools::block_time_seconds(trace.block_time));
+            }
+            return true;
+        }
+
+        /**
+         * Pushes the work due at `now`: `income` first so releases pay out at the
+         * new rate, `payout` for the payouts queued since the last tick, then one
+         * `release` per matured row, `buyallrex` last. A transaction that fails is
+         * retried one action at a time, actions that still fail come up again
+         * after `retry_delay`, as do the releases whose row is still there once
+         * their `release` went through.
+         */
+        tick_stats tick(uint64_t now) {
+            tick_stats stats;
+            due_work   work = _schedule.take_due(now);
+            if (work.empty()) return stats;
+
+            struct item {
+                action   act;
+                task     kind;
+                uint64_t id;
+                uint64_t owner;
+            };
+            std::vector<item> items;
+            if (work.income) {
+                items.push_back({ call(INCOME, "[]"), task::income, 0, 0 });
+                items.push_back({ call(PAYOUT, "[]"), task::income, 0, 0 });
+            }
+            for (size_t i = 0; i < work.release_ids.size(); i++) {
+                items.push_back({ call(RELEASE, "[\"" + tools::name_string(work.owners[i]) + "\"]"), task::release,
+                                  work.release_ids[i], work.owners[i] });
+            }
+            if (work.income && _cfg.rex_actor) {
+                items.push_back({ action { _cfg.vault, BUYALLREX, _cfg.rex_actor, "[]" }, task::income, 0, 0 });
+            }
+
+            // releases that went through, checked against the table once everything is sent
+            std::vector<const item *> sent;
+            auto                      done = [&](const item &it) {
+                if (it.kind == task::release) {
+                    sent.push_back(&it);
+                } else if (it.act.name == INCOME) {
+                    _schedule.income_ran(now);
+                }
+            };
+            const size_t batch = std::max<size_t>(_cfg.max_actions, 1);
+            for (size_t begin = 0; begin < items.size(); begin += batch) {
+                size_t      end = std::min(items.size(), begin + batch);
+                transaction trx;
+                for (size_t i = begin; i < end; i++) trx.push_back(items[i].act);
+                stats.transactions++;
+                if (_out.push(trx).empty()) {
+                    stats.actions += trx.size();
+                    for (size_t i = begin; i < end; i++) done(items[i]);
+                    continue;
+                }
+                for (size_t i = begin; i < end; i++) {
+                    stats.transactions++;
+                    if (_out.push({ items[i].act }).empty()) {
+                        stats.actions++;
+                        done(items[i]);
+                    } else {
+                        stats.failed++;
+                        // a failed `payout` or `buyallrex` waits for the next income
+                        if (items[i].act.name == INCOME || items[i].kind == task::release) {
+                            _schedule.retry(items[i].kind, items[i].id, now + _cfg.retry_delay);
+                        }
+                    }
+                }
+            }
+
+            // the rows left of every owner, read once; nullopt when they cannot be read
+            std::unordered_map<uint64_t, std::optional<std::vector<uint64_t>>> rows;
+            auto left = [&](uint64_t owner) -> const std::optional<std::vector<uint64_t>> & {
+                auto itr = rows.find(owner);
+                if (itr == rows.end()) {
+                    std::vector<uint64_t> ids;
+                    bool                  ok = _releases && _releases->release_ids(owner, ids);
+                    itr = rows.emplace(owner, ok ? std::optional(std::move(ids)) : std::nullopt).first;
+                }
+                return itr->second;
+            };
+            for (const item *it : sent) {
+                const auto &ids = left(it->owner);
+                if (ids && std::find(ids->begin(), ids->end(), it->id) == ids->end()) {
+                    _schedule.remove_release(it->id);
+                    continue;
+                }
+                if (ids) stats.unpaid++;
+                _schedule.retry(task::release, it->id, now + _cfg.retry_delay);
+            }
+            return stats;
+        }
+
+        schedule     &tasks() { return _schedule; }
+        const config &settings() const { return _cfg; }
+
+      private:
+        static constexpr uint64_t RELEASES  = tools::name_value("releases");
+        static constexpr uint64_t CONFIG    = tools::name_value("config");
+        static constexpr uint64_t INCOME    = tools::name_value("income");
+        static constexpr uint64_t PAYOUT    = tools::name_value("payout");
+        static constexpr uint64_t RELEASE   = tools::name_value("release");
+        static constexpr uint64_t BUYALLREX = tools::name_value("buyallrex");
+
+        action call(uint64_t name, std::string args) const {
+            return action { _cfg.vault, name, _cfg.actor, std::move(args) };
+        }
+
+        // id, quantity, rate, then the maturity as a block_timestamp
+        bool release_row(const reconcile::row &r) {
+            uint64_t id, maturity;
+            if (!r.binary.empty()) {
+                if (r.binary.size() < 36 || !reconcile::binary_row { r.binary }.u64(0, id)) return false;
+                maturity = tools::block_time_seconds(reconcile::load_u32(r.binary.data() + 32));
+            } else {
+                static const char *const keys[] = { "id", "time" };
+                std::string_view         v[2];
+                if (!reconcile::json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], id)
+                    || !tools::parse_time(tools::json::unquote(v[1]), maturity))
+                    return false;
+            }
+            _schedule.add_release(id, r.scope, maturity);
+            return true;
+        }
+
+        bool config_row(const reconcile::row &r) {
+            uint64_t last_income_time;
+            if (!r.binary.empty()) {
+                if (!reconcile::binary_row { r.binary }.u64(0, last_income_time)) return false;
+            } else {
+                static const char *const keys[] = { "last_income_time" };
+                std::string_view         v[1];
+                if (!reconcile::json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], last_income_time))
+                    return false;
+            }
+            // nothing to call before the admin's first `income`
+            if (last_income_time > 0) _schedule.income_ran(last_income_time);
+            return true;
+        }
+
+        config          _cfg;
+        transport      &_out;
+        release_source *_releases;
+        schedule        _schedule;
+    };
+
+} // namespace keeper
@@ -0,0 +1,349 @@
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <eosio.hpp>
+#include <mapped_file.hpp>
+
+#include <scenario.hpp>
+
+#include "keeper.hpp"
+
+using namespace keeper;
+
+namespace {
+
+    const uint64_t VAULT = tools::name_value("vault.defi");
+
+    struct recording_transport : transport, release_source {
+        std::vector<transaction>                             pushed;
+        std::string                                          fail_name;   // actions of this name fail
+        std::map<uint64_t, std::vector<uint64_t>>            rows;        // `releases` ids by owner
+        std::map<uint64_t, uint64_t>                         matured;     // ids paid out by `release`, by owner
+
+        std::string push(const transaction &trx) override {
+            for (const auto &a : trx) {
+                if (tools::name_string(a.name) == fail_name) return "assertion failure";
+            }
+            pushed.push_back(trx);
+            // `release` pays out the first row of the owner, when it has matured
+            for (const auto &a : trx) {
+                if (tools::name_string(a.name) != "release") continue;
+                uint64_t owner = tools::name_value(a.args.substr(2, a.args.size() - 4));
+                auto    &ids   = rows[owner];
+                if (!ids.empty() && matured[owner] > 0) {
+                    ids.erase(ids.begin());
+                    matured[owner]--;
+                }
+            }
+            return {};
+        }
+
+        bool release_ids(uint64_t owner, std::vector<uint64_t> &ids) override {
+            ids = rows[owner];
+            return true;
+        }
+    };
+
+    // the `releases` rows of the native chain
+    struct chain_releases : release_source {
+        eosio::native::chain &c;
+
+        explicit chain_releases(eosio::native::chain &c) : c(c) {}
+
+        bool release_ids(uint64_t owner, std::vector<uint64_t> &ids) override {
+            ids.clear();
+            auto t = c.find_table({ VAULT, owner, tools::name_value("releases") });
+            if (t) {
+                for (const auto &[id, row] : *t) ids.push_back(id);
+            }
+            return true;
+        }
+    };
+
+    // the contracts of a scenario on the native chain, standing in for a local node
+    struct chain_transport : transport {
+        const native_scenario::scenario &sc;
+        eosio::native::chain            &c;
+        std::vector<transaction>         pushed;
+
+        chain_transport(const native_scenario::scenario &sc, eosio::native::chain &c) : sc(sc), c(c) {}
+
+        std::string push(const transaction &trx) override {
+            try {
+                std::vector<eosio::native::action_data> actions;
+                for (const auto &a : trx) {
+                    auto kind = native_scenario::kind_of(sc, eosio::name(a.account));
+                    eosio::check(kind != nullptr, "no contract");
+                    actions.push_back({ eosio::name(a.account),
+                                        eosio::name(a.name),
+                                        { eosio::permission_level(eosio::name(a.actor), eosio::name("active")) },
+                                        kind->encode(eosio::name(a.name), a.args) });
+                }
+                c.push_transaction(actions);
+            } catch (const std::exception &e) {
+                return e.what();
+            }
+            pushed.push_back(trx);
+            return {};
+        }
+    };
+
+    void test_time() {
+        uint64_t t = 0;
+        CHECK(tools::parse_time("2023-01-01T00:00:00.000", t) && t == 1672531200);
+        CHECK(tools::parse_time("2022-12-03T10:13:07.000", t) && t == 1670062387);
+        CHECK(tools::parse_time("2024-02-29T23:59:59", t) && t == 1709251199);
+        CHECK(!tools::parse_time("2023-13-01T00:00:00", t));
+        CHECK(!tools::parse_time("2023-01-01 00:00:00", t));
+        // slot 0 is 2000-01-01T00:00:00.000, odd slots are due at the next whole second
+        CHECK(tools::block_time_seconds(0) == 946684800);
+        CHECK(tools::block_time_seconds(3) == 946684802);
+    }
+
+    void test_schedule() {
+        schedule s;
+        CHECK(s.next_time() == 0);
+        s.add_release(3, 30, 1000);
+        s.add_release(1, 10, 500);
+        s.add_release(2, 20, 500);
+        s.add_release(2, 20, 500);   // seen in the dump and in the trace
+        s.income_ran(1190);
+        CHECK(s.pending() == 3);
+        CHECK(s.next_time() == 500);
+
+        auto work = s.take_due(499);
+        CHECK(work.empty());
+        work = s.take_due(500);
+        CHECK(!work.income && work.release_ids == std::vector<uint64_t>({ 1, 2 }));
+        CHECK(work.owners == std::vector<uint64_t>({ 10, 20 }));
+        s.remove_release(1);
+        s.remove_release(2);
+
+        // paid out by its owner before maturity
+        s.remove_release(3);
+        CHECK(s.next_time() == 1200);
+        // a later income supersedes the queued tick
+        s.income_ran(1250);
+        CHECK(s.next_time() == 1800);
+        work = s.take_due(1800);
+        CHECK(work.income && work.release_ids.empty());
+        CHECK(s.next_time() == 0);
+
+        s.add_release(4, 40, 2000);
+        s.retry(task::release, 4, 2100);
+        s.retry(task::release, 5, 2100);   // unknown, dropped
+        work = s.take_due(2100);
+        CHECK(work.release_ids == std::vector<uint64_t>({ 4 }));
+        CHECK(s.pending() == 1);
+
+        // a release is not retried before it matures
+        s.remove_release(4);
+        s.add_release(6, 60, 3000);
+        s.retry(task::release, 6, 2500);
+        CHECK(s.take_due(2500).empty() && s.next_time() == 3000);
+    }
+
+    indexer::action_trace record(uint64_t name, uint32_t block_time, const std::string &data) {
+        return indexer::action_trace { 0, 0, block_time, VAULT, VAULT, name, data.data(), uint32_t(data.size()) };
+    }
+
+    void test_trace() {
+        recording_transport out;
+        vault_keeper        k(config {}, out);
+
+        // maturity as a block_timestamp slot: 1000 seconds after the epoch
+        indexer::releaselog released { 7, 1, tools::name_value("user.a"), { 10, 0 }, 1, 2000 };
+        indexer::releaselog other { 8, 1, tools::name_value("user.b"), { 10, 0 }, 1, 4000 };
+        indexer::withdrawlog paid {};
+        paid.log_id = 8;
+        std::string d1 = indexer::pack(released), d2 = indexer::pack(other), d3 = indexer::pack(paid);
+        CHECK(k.apply(record(indexer::releaselog::NAME, 0, d1)));
+        CHECK(k.apply(record(indexer::releaselog::NAME, 0, d2)));
+        CHECK(k.apply(record(indexer::withdrawlog::NAME, 0, d3)));
+        CHECK(k.apply(record(tools::name_value("income"), 2 * 600, "")));
+        CHECK(!k.apply(record(indexer::releaselog::NAME, 0, "short")));
+        // notifications and other contracts do not count
+        auto notified     = record(tools::name_value("income"), 2 * 3000, "");
+        notified.receiver = tools::name_value("user.a");
+        CHECK(k.apply(notified));
+
+        const uint64_t epoch = tools::BLOCK_TIMESTAMP_EPOCH;
+        CHECK(k.tasks().pending() == 1);
+        CHECK(k.tasks().next_time() == epoch + 1000);
+        auto stats = k.tick(epoch + 1200);
+        CHECK(stats.transactions == 1 && stats.actions == 3 && stats.failed == 0);
+        CHECK(out.pushed.size() == 1 && out.pushed[0].size() == 3);
+        CHECK(tools::name_string(out.pushed[0][0].name) == "income" && out.pushed[0][0].args == "[]");
+        CHECK(tools::name_string(out.pushed[0][1].name) == "payout" && out.pushed[0][1].args == "[]");
+        CHECK(tools::name_string(out.pushed[0][2].name) == "release" && out.pushed[0][2].args == "[\"user.a\"]");
+        CHECK(tools::name_string(out.pushed[0][2].actor) == "keeper.defi");
+        // without a release source the row stays pending until its `withdrawlog` shows up
+        CHECK(stats.unpaid == 0 && k.tasks().pending() == 1);
+        CHECK(k.tasks().next_time() == epoch + 1200 + k.settings().retry_delay);
+        paid.log_id = 7;
+        std::string d4 = indexer::pack(paid);
+        CHECK(k.apply(record(indexer::withdrawlog::NAME, 0, d4)));
+        CHECK(k.tasks().pending() == 0 && k.tasks().next_time() == epoch + 1800);
+
+        // a partial record at the end of a growing trace is read once it is complete
+        auto path = std::filesystem::temp_directory_path() / "keeper_test.trace";
+        {
+            indexer::trace_writer w(path.string());
+            w.write(record(indexer::releaselog::NAME, 0, d1));
+        }
+        std::string bytes;
+        {
+            tools::mapped_file f(path.string());
+            bytes.assign(f.data(), f.size());
+        }
+        indexer::trace_reader whole(bytes.data(), bytes.size());
+        indexer::action_trace t;
+        CHECK(whole.next(t) && !whole.next(t) && whole.offset() == bytes.size());
+        indexer::trace_reader partial(bytes.data(), bytes.size() - 3);
+        CHECK(!partial.next(t) && partial.offset() == indexer::HEADER_SIZE);
+        indexer::trace_reader resumed(bytes.data(), bytes.size(), indexer::HEADER_SIZE);
+        CHECK(resumed.next(t) && t.name == indexer::releaselog::NAME);
+        std::filesystem::remove(path);
+    }
+
+    void test_batching() {
+        recording_transport out;
+        config              cfg;
+        cfg.max_actions = 2;
+        cfg.rex_actor   = tools::name_value("admin.defi");
+        vault_keeper k(cfg, out, &out);
+        const uint64_t user_a = tools::name_value("user.a"), user_b = tools::name_value("user.b");
+        for (uint64_t id = 1; id <= 3; id++) k.tasks().add_release(id, user_a, 100);
+        out.rows[user_a]    = { 1, 2, 3 };
+        out.matured[user_a] = 3;
+        k.tasks().income_ran(0);
+
+        auto stats = k.tick(600);
+        CHECK(stats.transactions == 3 && stats.actions == 6 && stats.unpaid == 0);
+        CHECK(out.pushed.size() == 3 && out.pushed[2].size() == 2);
+        // only `buyallrex` is signed by the admin
+        CHECK(tools::name_string(out.pushed[2][1].name) == "buyallrex");
+        CHECK(tools::name_string(out.pushed[2][1].actor) == "admin.defi");
+        CHECK(tools::name_string(out.pushed[2][0].actor) == "keeper.defi");
+        CHECK(k.tasks().pending() == 0);
+
+        // a failed transaction is split, the failing action comes back after the retry delay
+        k.tasks().add_release(4, user_b, 700);
+        out.rows[user_b]    = { 4 };
+        out.matured[user_b] = 1;
+        out.pushed.clear();
+        out.fail_name = "release";
+        stats         = k.tick(1200);
+        CHECK(stats.failed == 1 && stats.actions == 3 && out.pushed.size() == 2);
+        CHECK(k.tasks().pending() == 1 && k.tasks().next_time() == 1260);
+        out.fail_name.clear();
+        stats = k.tick(1260);
+        CHECK(stats.actions == 1 && k.tasks().pending() == 0);
+
+        // a `release` that goes through without paying the row out leaves it pending
+        k.tasks().add_release(5, user_b, 1300);
+        out.rows[user_b] = { 5 };
+        stats            = k.tick(1300);
+        CHECK(stats.actions == 1 && stats.failed == 0 && stats.unpaid == 1);
+        CHECK(k.tasks().pending() == 1 && k.tasks().next_time() == 1360);
+        out.matured[user_b] = 1;
+        stats               = k.tick(1360);
+        CHECK(stats.unpaid == 0 && k.tasks().pending() == 0);
+    }
+
+    std::string read(const std::string &path) {
+        tools::mapped_file file(path);
+        return file.ok() ? std::string(file.data(), file.size()) : std::string();
+    }
+
+    // the schedule of a dump of the native chain pays out every release once it matures
+    void test_chain(const std::string &path) {
+        native_scenario::scenario sc;
+        CHECK(native_scenario::load(read(path), sc).empty());
+        eosio::native::chain c;
+        c.make_current();
+        native_scenario::run(sc, c);
+
+        auto step = [&](const char *contract, const char *act, const char *actor, std::string data) {
+            native_scenario::step s { eosio::name(contract), eosio::name(act), { eosio::name(actor) }, data, {}, 0 };
+            return native_scenario::run_step(sc, s, c).ok;
+        };
+        auto withdraw = [&](const char *owner, const char *quantity) {
+            return step("stoken.defi", "transfer", owner,
+                        std::string("[\"") + owner + "\", \"vault.defi\", \"" + quantity + "\", \"\"]");
+        };
+        CHECK(withdraw("account1", "5.0000 SUSDT"));
+        c.add_time(eosio::seconds(3600));
+        CHECK(withdraw("account2", "5.0000 SUSDT"));
+        CHECK(withdraw("account1", "1.0000 SUSDT"));
+
+        chain_transport out(sc, c);
+        chain_releases  table(c);
+        config          cfg;
+        cfg.actor       = tools::name_value("keeper.defi");
+        cfg.max_actions = 2;
+        vault_keeper k(cfg, out, &table);
+        std::string  rows  = native_scenario::dump_all(c);
+        auto         stats = k.load_snapshot(rows.data(), rows.size());
+        CHECK(stats.rows == 4 && stats.malformed == 0);
+        CHECK(k.tasks().pending() == 3);
+
+        // the income tick passed during the withdraws, the releases are days away
+        auto now = [&] { return uint64_t(c.now().sec_since_epoch()); };
+        auto t   = k.tick(now());
+        CHECK(t.transactions == 1 && t.actions == 2 && t.failed == 0);
+        CHECK(k.tasks().next_time() == now() - now() % INCOME_PERIOD + INCOME_PERIOD);
+
+        auto releases = [&](const char *owner) {
+            std::vector<uint64_t> ids;
+            table.release_ids(tools::name_value(owner), ids);
+            return ids.size();
+        };
+        // a release pushed before its row matures, here from a wrong maturity, goes through
+        // and pays nothing; the row stays pending
+        std::vector<uint64_t> early;
+        table.release_ids(tools::name_value("account2"), early);
+        CHECK(early.size() == 1);
+        vault_keeper wrong(cfg, out, &table);
+        wrong.tasks().add_release(early[0], tools::name_value("account2"), now());
+        t = wrong.tick(now());
+        CHECK(t.actions == 1 && t.failed == 0 && t.unpaid == 1);
+        CHECK(releases("account2") == 1 && wrong.tasks().pending() == 1);
+        CHECK(wrong.tasks().next_time() == now() + cfg.retry_delay);
+
+        // the first withdraw matures an hour before the others
+        c.add_time(eosio::seconds(5 * 86400 - 3600));
+        t = k.tick(now());
+        CHECK(t.failed == 0 && t.transactions == 2 && t.actions == 3);
+        CHECK(releases("account1") == 1 && releases("account2") == 1);
+        CHECK(k.tasks().pending() == 2);
+
+        // suspended withdrawals fail the releases, they are pushed again once they reopen
+        CHECK(step("vault.defi", "updatestatus", "admin.defi", "[1, 1, 0]"));
+        c.add_time(eosio::seconds(3600));
+        t = k.tick(now());
+        CHECK(t.failed == 2 && t.actions == 2 && t.transactions == 4);
+        CHECK(k.tasks().next_time() == now() + cfg.retry_delay);
+        CHECK(step("vault.defi", "updatestatus", "admin.defi", "[1, 1, 1]"));
+        c.add_time(eosio::seconds(cfg.retry_delay));
+        t = k.tick(now());
+        CHECK(t.failed == 0 && t.transactions == 1 && t.actions == 2);
+        CHECK(releases("account1") == 0 && releases("account2") == 0);
+        CHECK(k.tasks().pending() == 0);
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    test_time();
+    test_schedule();
+    test_trace();
+    test_batching();
+    CHECK(argc > 1);
+    if (argc > 1) test_chain(argv[1]);
+    return tools::check_report("keeper_test");
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Upcoming work of the vault, ordered by the time it becomes due: the next
+ * `income` tick and the maturity of every pending release.
+ *
+ * Releases that are paid out are dropped from `_live` only, their queue
+ * entries are skipped when they come up, as are the earlier entries of retried
+ * tasks. Memory grows with the pending releases, never with the number of
+ * events seen.
+ */
+namespace keeper {
+
+    static constexpr uint64_t INCOME_PERIOD = 600;
+
+    enum class task : uint8_t { income, release };
+
+    struct event {
+        uint64_t time;   // seconds since 1970
+        task     kind;
+        uint64_t id;     // release id, 0 for income
+
+        bool operator>(const event &other) const {
+            return time != other.time ? time > other.time : id > other.id;
+        }
+    };
+
+    // what is due, `owners` holds one entry per release, in maturity order
+    struct due_work {
+        bool                  income = false;
+        std::vector<uint64_t> release_ids;
+        std::vector<uint64_t> owners;
+
+        bool empty() const { return !income && release_ids.empty(); }
+    };
+
+    class schedule {
+      public:
+        void add_release(uint64_t id, uint64_t owner, uint64_t maturity) {
+            auto [itr, added] = _live.emplace(id, release { owner, maturity, maturity });
+            if (!added) return;
+            _queue.push(event { maturity, task::release, id });
+        }
+
+        // paid out or seen in a `withdrawlog`
+        void remove_release(uint64_t id) { _live.erase(id); }
+
+        // `income` ran at `time`, it has nothing to do before the next period
+        void income_ran(uint64_t time) {
+            uint64_t next = time - time % INCOME_PERIOD + INCOME_PERIOD;
+            if (next <= _next_income) return;
+            _next_income = next;
+            _queue.push(event { next, task::income, 0 });
+        }
+
+        // a failed task comes up again at `time`, a release not before it matures
+        void retry(task kind, uint64_t id, uint64_t time) {
+            if (kind == task::income) {
+                _next_income = time;
+                _queue.push(event { time, task::income, 0 });
+            } else if (auto itr = _live.find(id); itr != _live.end()) {
+                itr->second.due = std::max(time, itr->second.maturity);
+                _queue.push(event { itr->second.due, task::release, id });
+            }
+        }
+
+        // removes and returns every task due at `now`
+        due_work take_due(uint64_t now) {
+            due_work work;
+            while (!_queue.empty() && _queue.top().time <= now) {
+                event e = _queue.top();
+                _queue.pop();
+                if (e.kind == task::income) {
+                    // superseded by a later `income_ran`
+                    if (e.time == _next_income) work.income = true;
+                    continue;
+                }
+                auto itr = _live.find(e.id);
+                if (itr == _live.end() || itr->second.due != e.time) continue;
+                work.release_ids.push_back(e.id);
+                work.owners.push_back(itr->second.owner);
+            }
+            return work;
+        }
+
+        // time of the earliest task, 0 when there is none
+        uint64_t next_time() {
+            while (!_queue.empty()) {
+                const event &e = _queue.top();
+                auto itr       = _live.find(e.id);
+                bool stale     = e.kind == task::income ? e.time != _next_income
+                                                        : itr == _live.end() || itr->second.due != e.time;
+                if (!stale) return e.time;
+                _queue.pop();
+            }
+            return 0;
+        }
+
+        size_t pending() const { return _live.size(); }
+
+      private:
+        struct release {
+            uint64_t owner;
+            uint64_t maturity;
+            uint64_t due;   // the queue entry that counts, earlier ones were retried
+        };
+
+        std::priority_queue<event, std::vector<event>, std::greater<event>> _queue;
+        std::unordered_map<uint64_t, release>                               _live;
+        uint64_t                                                            _next_income = 0;
+    };
+
+} // namespace keeper
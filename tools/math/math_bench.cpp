@@ -0,0 +1,72 @@
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include <vault_math.hpp>
+
+#include <bench.hpp>
+#include <rng.hpp>
+
+using namespace vault_math;
+
+namespace {
+
+    struct input {
+        int64_t  quantity;
+        uint64_t rate0;
+        uint64_t rate1;
+        int64_t  total;
+        int64_t  supply;
+        uint16_t fees;
+        uint16_t refund;
+    };
+
+    template <typename F>
+    void run(const char *name, const std::vector<input> &inputs, uint64_t rounds, F &&f) {
+        tools::stopwatch timer;
+        for (uint64_t round = 0; round < rounds; round++) {
+            for (const auto &in : inputs) {
+                tools::do_not_optimize(f(in));
+            }
+        }
+        tools::report(name, rounds * inputs.size(), timer.seconds());
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+
+    tools::rng         rng(42);
+    std::vector<input> inputs(1 << 16);
+    for (auto &in : inputs) {
+        in.quantity = int64_t(rng.magnitude(50));
+        in.rate0    = rng.range(RATE_BASE, 3 * RATE_BASE);
+        in.rate1    = rng.range(RATE_BASE, 3 * RATE_BASE);
+        in.total    = int64_t(rng.magnitude(55));
+        in.supply   = int64_t(rng.range(1, 1ULL << 55));
+        in.fees     = uint16_t(rng.range(0, 100));
+        in.refund   = uint16_t(rng.range(0, 10000));
+    }
+
+    run("rate", inputs, rounds, [](const input &in) { return rate(uint64_t(in.total), in.supply); });
+    run("issue_amount", inputs, rounds, [](const input &in) { return issue_amount(in.quantity, in.rate0); });
+    run("refund_amount", inputs, rounds, [](const input &in) { return refund_amount(in.quantity, in.rate0); });
+    run("split_fees", inputs, rounds, [](const input &in) { return split_fees(in.quantity, in.refund).award; });
+    run("release", inputs, rounds, [](const input &in) {
+        auto r = release(in.quantity, in.rate0, in.rate1, in.fees, in.refund);
+        return r.withdraw + r.fees.sys + r.refund.sys;
+    });
+    run("eos_to_rex", inputs, rounds, [](const input &in) { return eos_to_rex(in.quantity, in.supply, in.total + 1); });
+    run("rex_to_eos", inputs, rounds, [](const input &in) { return rex_to_eos(in.quantity, in.supply, in.total + 1); });
+    run("income_amount", inputs, rounds, [](const input &in) { return income_amount(in.quantity, in.fees, in.fees); });
+
+    std::vector<std::pair<uint32_t, int64_t>> maturities;
+    for (uint32_t i = 0; i < 32; i++) {
+        maturities.emplace_back(i * 86400, int64_t(rng.magnitude(40)));
+    }
+    run("matured_rex (32 buckets)", inputs, rounds / 16 + 1, [&](const input &in) {
+        return matured_rex(0, maturities, uint32_t(in.fees) * 86400 / 4);
+    });
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include <cinttypes>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include <vault_math.hpp>
+
+#include <bench.hpp>
+#include <check.hpp>
+#include <rng.hpp>
+
+using namespace vault_math;
+
+namespace {
+
+    // Reference floor(a * b / c) on 32-bit limbs and shift-subtract division,
+    // independent of the compiler's 128-bit support. Result truncated to 64 bits.
+    uint64_t ref_muldiv(uint64_t a, uint64_t b, uint64_t c) {
+        uint64_t a0 = a & 0xffffffff, a1 = a >> 32;
+        uint64_t b0 = b & 0xffffffff, b1 = b >> 32;
+        uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+        uint64_t mid   = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+        uint64_t lo    = (p00 & 0xffffffff) | (mid << 32);
+        uint64_t hi    = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+        if (hi == 0) {
+            return lo / c;
+        }
+        uint64_t q_lo = 0, r = 0;
+        for (int i = 127; i >= 0; i--) {
+            uint64_t bit   = i >= 64 ? (hi >> (i - 64)) & 1 : (lo >> i) & 1;
+            bool     carry = r >> 63;
+            r              = (r << 1) | bit;
+            if (carry || r >= c) {
+                r -= c;
+                if (i < 64) q_lo |= 1ULL << i;
+            }
+        }
+        return q_lo;
+    }
+
+    int64_t ref_ratio(int64_t amount, uint16_t ratio) {
+        // amounts are never negative on chain, mirror sign handling for completeness
+        if (amount < 0) return -int64_t(ref_muldiv(uint64_t(-amount), ratio, RATIO_BASE));
+        return int64_t(ref_muldiv(uint64_t(amount), ratio, RATIO_BASE));
+    }
+
+    const uint64_t edge_amounts[] = { 0, 1, 2, 9, 10, 99, 9999, 10000, 10001, 99999999, 100000000,
+                                      100000001, 1ULL << 31, 1ULL << 32, (1ULL << 32) + 1,
+                                      10000000000000ULL, 1ULL << 53, uint64_t(MAX_AMOUNT) };
+    const uint64_t edge_rates[]   = { 1, 2, 99999999, RATE_BASE, RATE_BASE + 1, 2 * RATE_BASE,
+                                      199578590, 199690012, 10 * RATE_BASE, 1ULL << 40 };
+    const uint16_t edge_ratios[]  = { 0, 1, 10, 30, 50, 500, 3000, 5000, 9999, 10000 };
+
+    void test_rate() {
+        CHECK(pow10(0) == 1);
+        CHECK(pow10(4) == 10000);
+        CHECK(pow10(8) == RATE_BASE);
+        CHECK(pow10(18) == 1000000000000000000ULL);
+        CHECK(rate(0, 0) == RATE_BASE);
+        CHECK(rate(12345, 0) == RATE_BASE);
+        CHECK(rate(1000, 1000) == RATE_BASE);
+        CHECK(rate(2000, 1000) == 2 * RATE_BASE);
+        CHECK(rate(1, 3) == 33333333);
+        CHECK(total_with(100, 50, -30) == 120);
+        CHECK(total_with(100, 0, 0) == 100);
+        CHECK(total_with(0, 0, 0) == 0);
+
+        for (auto total : edge_amounts) {
+            for (auto supply : edge_amounts) {
+                if (supply == 0) continue;
+                // rate stays representable while total / supply < 2^64 / RATE_BASE
+                if (total / supply >= 100000000000ULL) continue;
+                CHECK(rate(total, int64_t(supply)) == ref_muldiv(total, RATE_BASE, supply));
+            }
+        }
+    }
+
+    void test_issue_refund() {
+        for (auto q : edge_amounts) {
+            for (auto r : edge_rates) {
+                if (q / r >= (1ULL << 63) / RATE_BASE) continue;
+                uint64_t issued = issue_amount(int64_t(q), r);
+                CHECK(issued == ref_muldiv(q, RATE_BASE, r));
+                if (r / RATE_BASE > 0 && issued >= (1ULL << 63) / (r / RATE_BASE + 1)) continue;
+                int64_t back = refund_amount(int64_t(issued), r);
+                CHECK(uint64_t(back) == ref_muldiv(issued, r, RATE_BASE));
+                // the round trip never pays out more than was deposited
+                CHECK(uint64_t(back) <= q);
+            }
+        }
+        CHECK(issue_amount(0, RATE_BASE) == 0);
+        CHECK(refund_amount(0, RATE_BASE) == 0);
+        CHECK(issue_amount(10000, 2 * RATE_BASE) == 5000);
+        CHECK(refund_amount(5000, 2 * RATE_BASE) == 10000);
+    }
+
+    void test_split() {
+        for (auto a : edge_amounts) {
+            for (auto ratio : edge_ratios) {
+                auto s = split_fees(int64_t(a), ratio);
+                CHECK(s.award == ref_ratio(int64_t(a), ratio));
+                CHECK(s.award + s.sys == int64_t(a));
+                CHECK(s.award >= 0 && s.sys >= 0);
+            }
+            CHECK(split_fees(int64_t(a), 0).award == 0);
+            CHECK(split_fees(int64_t(a), 10000).sys == 0);
+        }
+    }
+
+    void test_release() {
+        // the README example: 1000 SUSDT locked at 199578590, 30 pips fee, half refunded
+        auto r = release(10000000, 199578590, 199690012, 30, 5000);
+        CHECK(r.withdraw + r.fees.award + r.fees.sys == refund_amount(10000000, 199578590));
+        CHECK(r.refund.award + r.refund.sys
+              == refund_amount(10000000, 199690012) - refund_amount(10000000, 199578590));
+
+        // the current rate below the locked rate never reduces the payout
+        auto low = release(10000000, 199578590, 100000000, 30, 5000);
+        CHECK(low.refund.award == 0 && low.refund.sys == 0);
+        CHECK(low.withdraw == r.withdraw);
+
+        CHECK(release_rate(5, 3) == 5);
+        CHECK(release_rate(3, 5) == 5);
+        CHECK(withdraw_fees(10000, 30) == 30);
+        CHECK(withdraw_fees(9999, 1) == 0);
+    }
+
+    void test_rex() {
+        CHECK(eos_to_rex(10000, 10000, 100000000) == 100000000);
+        CHECK(rex_to_eos(100000000, 10000, 100000000) == 10000);
+        CHECK(rex_utilization(85, 100) == 85);
+        CHECK(rex_utilization(0, 100) == 0);
+        CHECK(rex_utilization(MAX_AMOUNT, MAX_AMOUNT) == 100);
+        for (auto eos : edge_amounts) {
+            if (eos > (1ULL << 52)) continue;
+            int64_t rex  = eos_to_rex(int64_t(eos), 3000000000000LL, 30000000000000000LL);
+            int64_t back = rex_to_eos(rex, 3000000000000LL, 30000000000000000LL);
+            CHECK(back <= int64_t(eos));
+            CHECK(int64_t(eos) - back <= 1);
+        }
+    }
+
+    void test_income() {
+        CHECK(income_ratio(0, 50) == 0);
+        CHECK(income_ratio(1, 50) == 50);
+        CHECK(income_ratio(200, 50) == 10000);
+        CHECK(income_ratio(1000, 50) == 10000);
+        CHECK(income_amount(2000000000, 1, 50) == 10000000);
+        CHECK(income_amount(2000000000, 1000, 50) == 2000000000);
+        CHECK(income_amount(0, 10, 50) == 0);
+    }
+
+    void test_history() {
+        CHECK(HISTORY_POINTS == 144);
+        CHECK(history_point(1669710600) == (1669710600 % 86400) / 600);
+        CHECK(history_point(86400 - 1) == 143);
+        CHECK(history_slot(0) == 0 && history_slot(29 * 86400) == 29 && history_slot(30 * 86400) == 0);
+
+        CHECK(annualized_yield(RATE_BASE, RATE_BASE, 86400) == 0);
+        CHECK(annualized_yield(0, RATE_BASE, 86400) == 0);
+        // +1% over a year is 1%, +1% over a day is 365%
+        CHECK(annualized_yield(RATE_BASE, RATE_BASE + RATE_BASE / 100, YEAR_SECONDS) == 1000000);
+        CHECK(annualized_yield(RATE_BASE, RATE_BASE + RATE_BASE / 100, 86400) == 365000000);
+        CHECK(annualized_yield(RATE_BASE, RATE_BASE - RATE_BASE / 100, YEAR_SECONDS) == -1000000);
+        CHECK(annualized_yield(1, UINT64_MAX, 1) == INT64_MAX);
+    }
+
+    void test_matured() {
+        std::vector<std::pair<uint32_t, int64_t>> maturities = { { 10, 5 }, { 20, 7 }, { 30, 11 } };
+        CHECK(matured_rex(3, maturities, uint32_t(5)) == 3);
+        CHECK(matured_rex(3, maturities, uint32_t(10)) == 8);
+        CHECK(matured_rex(3, maturities, uint32_t(25)) == 15);
+        CHECK(matured_rex(3, maturities, uint32_t(100)) == 26);
+        std::vector<std::pair<uint32_t, int64_t>> empty;
+        CHECK(matured_rex(0, empty, uint32_t(100)) == 0);
+    }
+
+    // Exhaustive small domain plus random cases across every magnitude against the reference.
+    uint64_t test_random(uint64_t cases) {
+        tools::rng rng(0xdef1b0c5);
+        uint64_t   checked = 0;
+
+        // every deposit amount below 2^16 at a spread of rates
+        for (uint64_t q = 0; q < (1 << 16); q++) {
+            for (auto r : edge_rates) {
+                uint64_t issued = issue_amount(int64_t(q), r);
+                CHECK(issued == ref_muldiv(q, RATE_BASE, r));
+                CHECK(uint64_t(refund_amount(int64_t(issued), r)) <= q);
+                checked++;
+            }
+        }
+
+        for (uint64_t i = 0; i < cases; i++) {
+            // refund0 * release_fees is a 64-bit product in the contract, keep it in range
+            uint64_t quantity = rng.magnitude(44);
+            uint64_t rate0    = rng.range(RATE_BASE / 2, 4 * RATE_BASE);
+            uint64_t rate1    = rng.chance(20) ? rate0 : rng.range(RATE_BASE / 2, 4 * RATE_BASE);
+            uint16_t fees     = uint16_t(rng.range(0, 10000));
+            uint16_t refund   = uint16_t(rng.range(0, 10000));
+
+            auto r = release(int64_t(quantity), rate0, rate1, fees, refund);
+
+            int64_t refund0 = int64_t(ref_muldiv(quantity, rate0, RATE_BASE));
+            int64_t refund1 = int64_t(ref_muldiv(quantity, rate1 < rate0 ? rate0 : rate1, RATE_BASE));
+            int64_t fee     = refund0 * fees / 10000;
+            CHECK(r.withdraw == refund0 - fee);
+            CHECK(r.fees.award == ref_ratio(fee, refund));
+            CHECK(r.fees.award + r.fees.sys == fee);
+            CHECK(r.refund.award == ref_ratio(refund1 - refund0, refund));
+            CHECK(r.refund.award + r.refund.sys == refund1 - refund0);
+            CHECK(r.withdraw >= 0 && r.fees.sys >= 0 && r.refund.sys >= 0);
+
+            uint64_t total  = rng.magnitude(60);
+            uint64_t supply = rng.magnitude(60);
+            if (supply > 0 && total / supply < 100000000000ULL) {
+                CHECK(rate(total, int64_t(supply)) == ref_muldiv(total, RATE_BASE, supply));
+            }
+
+            uint64_t lendable = rng.range(1, 1ULL << 50);
+            uint64_t rex      = rng.range(1, 1ULL << 60);
+            uint64_t eos      = rng.magnitude(50);
+            if (eos / lendable < (1ULL << 62) / (rex / lendable + 1)) {
+                CHECK(uint64_t(eos_to_rex(int64_t(eos), int64_t(lendable), int64_t(rex)))
+                      == ref_muldiv(eos, rex, lendable));
+            }
+            checked += 4;
+        }
+        return checked;
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    uint64_t cases = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    test_rate();
+    test_issue_refund();
+    test_split();
+    test_release();
+    test_rex();
+    test_income();
+    test_history();
+    test_matured();
+
+    tools::stopwatch timer;
+    uint64_t         checked = test_random(cases);
+    double           seconds = timer.seconds();
+    std::printf("%" PRIu64 " cases in %.3fs (%.2f M cases/s)\n", checked, seconds,
+                double(checked) / seconds / 1e6);
+
+    return tools::check_report("math_test");
+}
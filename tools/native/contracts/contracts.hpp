@@ -0,0 +1,59 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+
+/**
+ * Contracts a native chain can deploy, by the kind name scenario files use:
+ *
+ * - `vault`, `stoken` - the contracts of this repository, compiled from
+ *   `src` under `contracts/vault` and `contracts/stoken` against the native shim
+ * - `token` - stand-in of `eosio.token`
+ * - `system` - stand-in of the parts of `eosio.system` the vault uses:
+ *   staking, proxy voting, the REX fund, `buyrex` and `sellrex`
+ * - `results` - `eosio.reserv`, receives the REX results and does nothing
+ */
+namespace native_contracts {
+
+    using apply_fn  = void (*)(eosio::name receiver, eosio::name code, eosio::name action);
+    using encode_fn = std::vector<char> (*)(eosio::name action, std::string_view json);
+
+    struct kind {
+        std::string_view name;
+        apply_fn         apply;
+        encode_fn        encode;
+    };
+
+    void              vault_apply(eosio::name receiver, eosio::name code, eosio::name action);
+    std::vector<char> vault_encode(eosio::name action, std::string_view json);
+    void              stoken_apply(eosio::name receiver, eosio::name code, eosio::name action);
+    std::vector<char> stoken_encode(eosio::name action, std::string_view json);
+    void              token_apply(eosio::name receiver, eosio::name code, eosio::name action);
+    std::vector<char> token_encode(eosio::name action, std::string_view json);
+    void              system_apply(eosio::name receiver, eosio::name code, eosio::name action);
+    std::vector<char> system_encode(eosio::name action, std::string_view json);
+
+    inline void results_apply(eosio::name, eosio::name, eosio::name) {}
+
+    inline std::vector<char> results_encode(eosio::name action, std::string_view) {
+        eosio::check(false, "unknown action " + action.to_string());
+        return {};
+    }
+
+    inline const kind *find_kind(std::string_view name) {
+        static const kind kinds[] = {
+            { "vault", &vault_apply, &vault_encode },
+            { "stoken", &stoken_apply, &stoken_encode },
+            { "token", &token_apply, &token_encode },
+            { "system", &system_apply, &system_encode },
+            { "results", &results_apply, &results_encode },
+        };
+        for (const auto &k : kinds) {
+            if (k.name == name) return &k;
+        }
+        return nullptr;
+    }
+
+} // namespace native_contracts
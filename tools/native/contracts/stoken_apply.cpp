@@ -0,0 +1,28 @@
+// the contract source as CDT compiles it, against the native shim
+#include <stoken.cpp>
+
+#include <eosio/native/dispatch.hpp>
+
+#include "contracts.hpp"
+
+namespace {
+
+    const eosio::native::action_entry actions[] = {
+        NATIVE_ACTION(stoken, create),   NATIVE_ACTION(stoken, issue), NATIVE_ACTION(stoken, retire),
+        NATIVE_ACTION(stoken, transfer), NATIVE_ACTION(stoken, open),  NATIVE_ACTION(stoken, close),
+        NATIVE_ACTION(stoken, transferlog), NATIVE_ACTION(stoken, setramstat),
+    };
+
+} // namespace
+
+namespace native_contracts {
+
+    void stoken_apply(eosio::name receiver, eosio::name code, eosio::name action) {
+        eosio::native::dispatch(actions, nullptr, receiver, code, action);
+    }
+
+    std::vector<char> stoken_encode(eosio::name action, std::string_view json) {
+        return eosio::native::encode(actions, action, json);
+    }
+
+} // namespace native_contracts
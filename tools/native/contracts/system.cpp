@@ -0,0 +1,343 @@
+#include <eosio/asset.hpp>
+#include <eosio/eosio.hpp>
+#include <eosio/native/dispatch.hpp>
+
+#include "contracts.hpp"
+
+using namespace eosio;
+
+/**
+ * Stand-in of the parts of `eosio.system` the vault touches. The REX pool
+ * and balance rows keep the system contract layout (the vault reads them),
+ * `buyrex` and `sellrex` use its integer formulas and maturity buckets:
+ *
+ * - the first purchase creates the pool at 10000 REX per core unit
+ * - `R1 = S1 * R0 / S0` on buy, `proceeds = rex * S0 / R0` on sell
+ * - purchases mature at the start of the day, 5 days later
+ *
+ * Nothing is lent out, so no rentals, loans or sell orders.
+ */
+namespace native_system {
+
+    static constexpr name   TOKEN_ACCOUNT { "eosio.token"_n };
+    static constexpr name   REX_ACCOUNT { "eosio.rex"_n };
+    static constexpr name   STAKE_ACCOUNT { "eosio.stake"_n };
+    static constexpr name   RESULTS_ACCOUNT { "eosio.reserv"_n };
+    static constexpr symbol CORE_SYMBOL = symbol("EOS", 4);
+    static constexpr symbol REX_SYMBOL  = symbol("REX", 4);
+
+    static constexpr int64_t  REX_RATIO       = 10000;
+    static constexpr int64_t  INIT_TOTAL_RENT = 200000000;
+    static constexpr uint32_t MATURITY_DAYS   = 5;
+    static constexpr uint32_t DAY_SECONDS     = 86400;
+
+    class system_contract : public contract {
+      public:
+        using contract::contract;
+
+        void init(unsigned_int version, const symbol &core) {
+            require_auth(get_self());
+            check(version.value == 0, "unsupported version for init action");
+            check(core == CORE_SYMBOL, "the stand-in only supports 4,EOS as core symbol");
+        }
+
+        void regproxy(const name &proxy, bool isproxy) {
+            require_auth(proxy);
+            voters_table voters(get_self(), get_self().value);
+            auto         pitr = voters.find(proxy.value);
+            if (pitr != voters.end()) {
+                check(isproxy != pitr->is_proxy, "action has no effect");
+                check(!isproxy || !pitr->proxy, "account that uses a proxy is not allowed to become a proxy");
+                voters.modify(pitr, same_payer, [&](auto &p) { p.is_proxy = isproxy; });
+            } else {
+                voters.emplace(proxy, [&](auto &p) {
+                    p.owner    = proxy;
+                    p.is_proxy = isproxy;
+                });
+            }
+        }
+
+        // the stake stays with `from`, the vault only stakes to itself
+        void delegatebw(const name &from, const name & /* receiver */, const asset &stake_net_quantity,
+                        const asset &stake_cpu_quantity, bool /* transfer */) {
+            require_auth(from);
+            check(stake_net_quantity.symbol == CORE_SYMBOL && stake_cpu_quantity.symbol == CORE_SYMBOL,
+                  "must stake core token");
+            check(stake_net_quantity.amount >= 0 && stake_cpu_quantity.amount >= 0, "must stake a positive amount");
+            auto total = stake_net_quantity + stake_cpu_quantity;
+            check(total.amount > 0, "must stake a positive amount");
+
+            action(permission_level { from, "active"_n }, TOKEN_ACCOUNT, "transfer"_n,
+                   std::make_tuple(from, STAKE_ACCOUNT, total, std::string("stake bandwidth")))
+                .send();
+
+            voters_table voters(get_self(), get_self().value);
+            auto         vitr = voters.find(from.value);
+            if (vitr == voters.end()) {
+                voters.emplace(from, [&](auto &v) {
+                    v.owner  = from;
+                    v.staked = total.amount;
+                });
+            } else {
+                voters.modify(vitr, same_payer, [&](auto &v) { v.staked += total.amount; });
+            }
+        }
+
+        void voteproducer(const name &voter, const name &proxy, const std::vector<name> &producers) {
+            require_auth(voter);
+            voters_table voters(get_self(), get_self().value);
+            auto         vitr = voters.find(voter.value);
+            check(vitr != voters.end(), "user must stake before they can vote");
+            check(!proxy || !vitr->is_proxy, "account registered as a proxy is not allowed to use a proxy");
+            if (proxy) {
+                check(producers.size() == 0, "cannot vote for producers and proxy at same time");
+                check(voter != proxy, "cannot proxy to self");
+                auto pitr = voters.find(proxy.value);
+                check(pitr != voters.end() && pitr->is_proxy, "invalid proxy specified");
+            } else {
+                check(producers.size() <= 30, "attempt to vote for too many producers");
+            }
+            voters.modify(vitr, same_payer, [&](auto &v) {
+                v.proxy     = proxy;
+                v.producers = producers;
+            });
+        }
+
+        void deposit(const name &owner, const asset &amount) {
+            require_auth(owner);
+            check(amount.symbol == CORE_SYMBOL, "must deposit core token");
+            check(amount.amount > 0, "must deposit a positive amount");
+
+            action(permission_level { owner, "active"_n }, TOKEN_ACCOUNT, "transfer"_n,
+                   std::make_tuple(owner, REX_ACCOUNT, amount, std::string("deposit to REX fund")))
+                .send();
+
+            rex_fund_table funds(get_self(), get_self().value);
+            auto           itr = funds.find(owner.value);
+            if (itr == funds.end()) {
+                funds.emplace(owner, [&](auto &f) {
+                    f.owner   = owner;
+                    f.balance = amount;
+                });
+            } else {
+                funds.modify(itr, same_payer, [&](auto &f) { f.balance += amount; });
+            }
+        }
+
+        void withdraw(const name &owner, const asset &amount) {
+            require_auth(owner);
+            check(amount.symbol == CORE_SYMBOL, "must withdraw core token");
+            check(amount.amount > 0, "must withdraw a positive amount");
+            transfer_from_fund(owner, amount);
+
+            action(permission_level { REX_ACCOUNT, "active"_n }, TOKEN_ACCOUNT, "transfer"_n,
+                   std::make_tuple(REX_ACCOUNT, owner, amount, std::string("withdraw from REX fund")))
+                .send();
+        }
+
+        void buyrex(const name &from, const asset &amount) {
+            require_auth(from);
+            check(amount.symbol == CORE_SYMBOL, "asset must be core token");
+            check(0 < amount.amount, "must use positive amount");
+
+            voters_table voters(get_self(), get_self().value);
+            auto         vitr = voters.find(from.value);
+            check(vitr != voters.end() && (vitr->proxy || vitr->producers.size() >= 21),
+                  "must vote for at least 21 producers or for a proxy before buying REX");
+
+            transfer_from_fund(from, amount);
+            int64_t rex_received = add_to_rex_pool(amount);
+            add_to_rex_balance(from, amount, rex_received);
+
+            send_result("buyresult"_n, asset(rex_received, REX_SYMBOL));
+        }
+
+        void sellrex(const name &from, const asset &rex) {
+            require_auth(from);
+            check(rex.symbol == REX_SYMBOL && rex.amount > 0, "asset must be a positive amount of (REX, 4)");
+
+            rex_pool_table pools(get_self(), get_self().value);
+            auto           pool = pools.begin();
+            check(pool != pools.end() && pool->total_rex.amount > 0, "rex system not initialized yet");
+
+            rex_balance_table balances(get_self(), get_self().value);
+            auto              bitr = balances.find(from.value);
+            check(bitr != balances.end(), "user must first buyrex");
+            balances.modify(bitr, same_payer, [&](auto &rb) { process_maturities(rb); });
+            check(bitr->matured_rex >= rex.amount, "insufficient available rex");
+
+            const int64_t S0 = pool->total_lendable.amount;
+            const int64_t R0 = pool->total_rex.amount;
+            const int64_t p  = int64_t((unsigned __int128)(rex.amount) * S0 / R0);
+            check(p <= pool->total_unlent.amount, "insufficient funds in the REX pool");
+
+            pools.modify(pool, same_payer, [&](auto &rt) {
+                rt.total_rex.amount      = R0 - rex.amount;
+                rt.total_lendable.amount = S0 - p;
+                rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
+            });
+            balances.modify(bitr, same_payer, [&](auto &rb) {
+                int64_t stake_change = int64_t((unsigned __int128)(rb.vote_stake.amount) * rex.amount
+                                               / rb.rex_balance.amount);
+                rb.vote_stake.amount -= stake_change;
+                rb.rex_balance.amount -= rex.amount;
+                rb.matured_rex -= rex.amount;
+            });
+
+            rex_fund_table funds(get_self(), get_self().value);
+            auto           fitr = funds.find(from.value);
+            check(fitr != funds.end(), "user must first deposit");
+            funds.modify(fitr, same_payer, [&](auto &f) { f.balance.amount += p; });
+
+            send_result("sellresult"_n, asset(p, CORE_SYMBOL));
+        }
+
+      private:
+        struct voter_info {
+            name              owner;
+            name              proxy;
+            std::vector<name> producers;
+            int64_t           staked   = 0;
+            bool              is_proxy = false;
+            uint64_t          primary_key() const { return owner.value; }
+        };
+
+        struct rex_pool {
+            uint8_t  version = 0;
+            asset    total_lent;
+            asset    total_unlent;
+            asset    total_rent;
+            asset    total_lendable;
+            asset    total_rex;
+            asset    namebid_proceeds;
+            uint64_t loan_num = 0;
+            uint64_t primary_key() const { return 0; }
+        };
+
+        struct rex_fund {
+            uint8_t  version = 0;
+            name     owner;
+            asset    balance;
+            uint64_t primary_key() const { return owner.value; }
+        };
+
+        struct rex_balance {
+            uint8_t                                        version = 0;
+            name                                           owner;
+            asset                                          vote_stake;
+            asset                                          rex_balance;
+            int64_t                                        matured_rex = 0;
+            std::deque<std::pair<time_point_sec, int64_t>> rex_maturities;
+            uint64_t                                       primary_key() const { return owner.value; }
+        };
+
+        typedef eosio::multi_index<"voters"_n, voter_info>   voters_table;
+        typedef eosio::multi_index<"rexpool"_n, rex_pool>    rex_pool_table;
+        typedef eosio::multi_index<"rexfund"_n, rex_fund>    rex_fund_table;
+        typedef eosio::multi_index<"rexbal"_n, rex_balance> rex_balance_table;
+
+        static time_point_sec rex_maturity() {
+            uint32_t now = current_time_point().sec_since_epoch();
+            return time_point_sec(now - now % DAY_SECONDS + MATURITY_DAYS * DAY_SECONDS);
+        }
+
+        static void process_maturities(rex_balance &rb) {
+            time_point_sec now(current_time_point());
+            while (!rb.rex_maturities.empty() && rb.rex_maturities.front().first <= now) {
+                rb.matured_rex += rb.rex_maturities.front().second;
+                rb.rex_maturities.pop_front();
+            }
+        }
+
+        void transfer_from_fund(const name &owner, const asset &amount) {
+            rex_fund_table funds(get_self(), get_self().value);
+            auto           itr = funds.find(owner.value);
+            check(itr != funds.end() && itr->balance.amount >= amount.amount, "insufficient funds");
+            funds.modify(itr, same_payer, [&](auto &f) { f.balance.amount -= amount.amount; });
+        }
+
+        int64_t add_to_rex_pool(const asset &payment) {
+            rex_pool_table pools(get_self(), get_self().value);
+            auto           itr = pools.begin();
+            int64_t        rex_received;
+            if (itr == pools.end()) {
+                rex_received = payment.amount * REX_RATIO;
+                pools.emplace(get_self(), [&](auto &rp) {
+                    rp.total_lendable   = payment;
+                    rp.total_lent       = asset(0, CORE_SYMBOL);
+                    rp.total_unlent     = rp.total_lendable - rp.total_lent;
+                    rp.total_rent       = asset(INIT_TOTAL_RENT, CORE_SYMBOL);
+                    rp.total_rex        = asset(rex_received, REX_SYMBOL);
+                    rp.namebid_proceeds = asset(0, CORE_SYMBOL);
+                });
+                return rex_received;
+            }
+            if (itr->total_rex.amount == 0) {
+                rex_received = payment.amount * REX_RATIO;
+            } else {
+                const int64_t S0 = itr->total_lendable.amount;
+                const int64_t S1 = S0 + payment.amount;
+                const int64_t R0 = itr->total_rex.amount;
+                const int64_t R1 = int64_t((unsigned __int128)(S1) * R0 / S0);
+                rex_received     = R1 - R0;
+            }
+            pools.modify(itr, same_payer, [&](auto &rt) {
+                rt.total_unlent.amount += payment.amount;
+                rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
+                rt.total_rex.amount += rex_received;
+            });
+            return rex_received;
+        }
+
+        void add_to_rex_balance(const name &owner, const asset &payment, int64_t rex_received) {
+            const time_point_sec maturity = rex_maturity();
+            rex_balance_table    balances(get_self(), get_self().value);
+            auto                 bitr = balances.find(owner.value);
+            if (bitr == balances.end()) {
+                balances.emplace(owner, [&](auto &rb) {
+                    rb.owner       = owner;
+                    rb.vote_stake  = payment;
+                    rb.rex_balance = asset(rex_received, REX_SYMBOL);
+                    rb.rex_maturities.emplace_back(maturity, rex_received);
+                });
+                return;
+            }
+            balances.modify(bitr, same_payer, [&](auto &rb) {
+                rb.rex_balance.amount += rex_received;
+                rb.vote_stake.amount += payment.amount;
+                if (!rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity) {
+                    rb.rex_maturities.back().second += rex_received;
+                } else {
+                    rb.rex_maturities.emplace_back(maturity, rex_received);
+                }
+                process_maturities(rb);
+            });
+        }
+
+        // the system contract reports REX results to `eosio.reserv` without authorization
+        void send_result(name act, const asset &quantity) {
+            if (!is_account(RESULTS_ACCOUNT)) return;
+            action(std::vector<permission_level> {}, RESULTS_ACCOUNT, act, std::make_tuple(quantity)).send();
+        }
+    };
+
+    const native::action_entry actions[] = {
+        NATIVE_ACTION(system_contract, init),         NATIVE_ACTION(system_contract, regproxy),
+        NATIVE_ACTION(system_contract, delegatebw),   NATIVE_ACTION(system_contract, voteproducer),
+        NATIVE_ACTION(system_contract, deposit),      NATIVE_ACTION(system_contract, withdraw),
+        NATIVE_ACTION(system_contract, buyrex),       NATIVE_ACTION(system_contract, sellrex),
+    };
+
+} // namespace native_system
+
+namespace native_contracts {
+
+    void system_apply(eosio::name receiver, eosio::name code, eosio::name action) {
+        eosio::native::dispatch(native_system::actions, nullptr, receiver, code, action);
+    }
+
+    std::vector<char> system_encode(eosio::name action, std::string_view json) {
+        return eosio::native::encode(native_system::actions, action, json);
+    }
+
+} // namespace native_contracts
@@ -0,0 +1,35 @@
+// the contract source as CDT compiles it, against the native shim
+#include <vault.cpp>
+
+#include <eosio/native/dispatch.hpp>
+
+#include "contracts.hpp"
+
+namespace {
+
+#define VAULT_NATIVE_ACTION(ACTION) NATIVE_ACTION(vault, ACTION),
+
+    // the list the wasm `apply` switches on
+    const eosio::native::action_entry actions[] = { VAULT_ACTIONS(VAULT_NATIVE_ACTION) };
+
+#undef VAULT_NATIVE_ACTION
+
+    // [[eosio::on_notify("*::transfer")]]
+    const eosio::native::action_entry notify = NATIVE_NOTIFY(vault, transfer, on_tokens_transfer);
+
+} // namespace
+
+namespace native_contracts {
+
+    // the `apply` of vault.cpp: a notification `runs_notification` turns away ends here,
+    // before the contract is built
+    void vault_apply(eosio::name receiver, eosio::name code, eosio::name action) {
+        if (code != receiver && !vault::runs_notification(receiver, code, action)) return;
+        eosio::native::dispatch(actions, &notify, receiver, code, action);
+    }
+
+    std::vector<char> vault_encode(eosio::name action, std::string_view json) {
+        return eosio::native::encode(actions, action, json);
+    }
+
+} // namespace native_contracts
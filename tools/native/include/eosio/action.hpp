@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/chain.hpp>
+
+namespace eosio {
+
+    inline void require_auth(name n) { native::chain::get().require_auth(n); }
+    inline bool has_auth(name n) { return native::chain::get().has_auth(n); }
+    inline void require_recipient(name n) { native::chain::get().require_recipient(n); }
+    inline bool is_account(name n) {
+        native::chain::get().mutable_counters().is_account++;
+        return native::chain::get().is_account(n);
+    }
+
+    // the data of the running action as the host function reads it: the bytes
+    // copied, or the whole size when `len` is 0
+    inline uint32_t read_action_data(void *msg, uint32_t len) {
+        const auto &data = native::chain::get().current_action().data;
+        if (len == 0) return uint32_t(data.size());
+        uint32_t copied = std::min(len, uint32_t(data.size()));
+        std::memcpy(msg, data.data(), copied);
+        return copied;
+    }
+    inline uint32_t action_data_size() { return uint32_t(native::chain::get().current_action().data.size()); }
+
+    template <typename... Names>
+    void require_recipient(name n, Names... more) {
+        require_recipient(n);
+        (require_recipient(more), ...);
+    }
+
+    struct action {
+        eosio::name                   account;
+        eosio::name                   name;
+        std::vector<permission_level> authorization;
+        std::vector<char>             data;
+
+        action() = default;
+
+        template <typename T>
+        action(const permission_level &auth, eosio::name a, eosio::name n, T &&value)
+            : account(a), name(n), authorization { auth }, data(pack(std::forward<T>(value))) {}
+
+        template <typename T>
+        action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T &&value)
+            : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+        void send() const { native::chain::get().send_inline({ account, name, authorization, data }); }
+
+        template <typename T>
+        T data_as() const {
+            return unpack<T>(data);
+        }
+    };
+
+    namespace native {
+        template <typename C, typename... Args>
+        std::tuple<std::decay_t<Args>...> action_args(void (C::*)(Args...));
+
+        template <auto Action>
+        using action_args_t = decltype(action_args(Action));
+
+        template <auto Action>
+        void send_inline_action(eosio::name code, eosio::name act, std::vector<permission_level> auths,
+                                action_args_t<Action> args) {
+            eosio::action(std::move(auths), code, act, args).send();
+        }
+    } // namespace native
+
+} // namespace eosio
+
+#define SEND_INLINE_ACTION(CONTRACT_OBJECT, NAME, ...)                                                      \
+    ::eosio::native::send_inline_action<&std::decay_t<decltype(CONTRACT_OBJECT)>::NAME>(                    \
+        (CONTRACT_OBJECT).get_self(), ::eosio::name(#NAME), __VA_ARGS__)
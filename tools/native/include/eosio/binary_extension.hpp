@@ -0,0 +1,50 @@
+#pragma once
+#include <optional>
+#include <utility>
+
+#include <eosio/check.hpp>
+
+namespace eosio {
+
+    /**
+     * A field appended to a table or action after it shipped: absent in the
+     * bytes written before it existed, packed as the bare value otherwise. The
+     * datastream reads it only when bytes remain.
+     */
+    template <typename T>
+    class binary_extension {
+      public:
+        using value_type = T;
+
+        constexpr binary_extension() = default;
+        constexpr binary_extension(const T &v) : _value(v) {}
+        constexpr binary_extension(T &&v) : _value(std::move(v)) {}
+
+        constexpr bool has_value() const { return _value.has_value(); }
+
+        T &value() {
+            check(_value.has_value(), "cannot get value of empty binary_extension");
+            return *_value;
+        }
+        const T &value() const {
+            check(_value.has_value(), "cannot get value of empty binary_extension");
+            return *_value;
+        }
+        T value_or(const T &def = {}) const { return _value ? *_value : def; }
+
+        T       &operator*() { return value(); }
+        const T &operator*() const { return value(); }
+        T       *operator->() { return &value(); }
+        const T *operator->() const { return &value(); }
+
+        template <typename... Args>
+        T &emplace(Args &&...args) {
+            return _value.emplace(std::forward<Args>(args)...);
+        }
+        void reset() { _value.reset(); }
+
+      private:
+        std::optional<T> _value;
+    };
+
+} // namespace eosio
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+    // thrown by `check`, aborts the running transaction
+    struct assert_exception : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    inline void check(bool pred, const char *msg) {
+        if (!pred) throw assert_exception(msg);
+    }
+
+    inline void check(bool pred, const std::string &msg) {
+        if (!pred) throw assert_exception(msg);
+    }
+
+    inline void check(bool pred, std::string &&msg) {
+        if (!pred) throw assert_exception(msg);
+    }
+
+} // namespace eosio
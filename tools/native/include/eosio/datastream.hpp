@@ -0,0 +1,441 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+    // variable length unsigned integer as in the ABI `varuint32`
+    struct unsigned_int {
+        uint32_t value = 0;
+        unsigned_int(uint32_t v = 0) : value(v) {}
+        operator uint32_t() const { return value; }
+    };
+
+    namespace reflect_detail {
+
+        // converts to anything, used to count the fields of an aggregate
+        struct any_field {
+            template <typename T>
+            constexpr operator T() const;
+        };
+
+        template <typename T, typename Seq, typename = void>
+        struct brace_constructible : std::false_type {};
+
+        template <typename T, size_t... I>
+        struct brace_constructible<T, std::index_sequence<I...>,
+                                   std::void_t<decltype(T { (void(I), any_field {})... })>> : std::true_type {};
+
+        template <typename T, size_t N>
+        constexpr size_t field_count() {
+            if constexpr (N == 0) {
+                return 0;
+            } else if constexpr (brace_constructible<T, std::make_index_sequence<N>>::value) {
+                return N;
+            } else {
+                return field_count<T, N - 1>();
+            }
+        }
+
+    } // namespace reflect_detail
+
+    /**
+     * Call `visit(fields...)` with every member of the aggregate `obj`, the
+     * native replacement for the field reflection CDT generates for tables.
+     */
+    template <typename T, typename F>
+    void for_each_field(T &obj, F &&visit) {
+        using U = std::remove_const_t<T>;
+        constexpr size_t count = reflect_detail::field_count<U, 24>();
+        static_assert(count > 0, "type is not a reflectable aggregate");
+        if constexpr (false) {
+        } else if constexpr (count == 1) {
+            auto &[f0] = obj;
+            visit(f0);
+        } else if constexpr (count == 2) {
+            auto &[f0, f1] = obj;
+            visit(f0, f1);
+        } else if constexpr (count == 3) {
+            auto &[f0, f1, f2] = obj;
+            visit(f0, f1, f2);
+        } else if constexpr (count == 4) {
+            auto &[f0, f1, f2, f3] = obj;
+            visit(f0, f1, f2, f3);
+        } else if constexpr (count == 5) {
+            auto &[f0, f1, f2, f3, f4] = obj;
+            visit(f0, f1, f2, f3, f4);
+        } else if constexpr (count == 6) {
+            auto &[f0, f1, f2, f3, f4, f5] = obj;
+            visit(f0, f1, f2, f3, f4, f5);
+        } else if constexpr (count == 7) {
+            auto &[f0, f1, f2, f3, f4, f5, f6] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6);
+        } else if constexpr (count == 8) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7);
+        } else if constexpr (count == 9) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+        } else if constexpr (count == 10) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+        } else if constexpr (count == 11) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+        } else if constexpr (count == 12) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+        } else if constexpr (count == 13) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+        } else if constexpr (count == 14) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+        } else if constexpr (count == 15) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+        } else if constexpr (count == 16) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+        } else if constexpr (count == 17) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16);
+        } else if constexpr (count == 18) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17);
+        } else if constexpr (count == 19) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18);
+        } else if constexpr (count == 20) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19);
+        } else if constexpr (count == 21) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20);
+        } else if constexpr (count == 22) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21);
+        } else if constexpr (count == 23) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22);
+        } else if constexpr (count == 24) {
+            auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23] = obj;
+            visit(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23);
+        }
+    }
+
+    template <typename T>
+    class datastream {
+      public:
+        datastream(T start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+        void skip(size_t s) { _pos += s; }
+        bool read(char *d, size_t s) {
+            check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+            std::memcpy(d, _pos, s);
+            _pos += s;
+            return true;
+        }
+        bool write(const char *d, size_t s) {
+            check(size_t(_end - _pos) >= s, "datastream attempted to write past the end");
+            std::memcpy((void *)_pos, d, s);
+            _pos += s;
+            return true;
+        }
+        bool   valid() const { return _pos <= _end; }
+        T      pos() const { return _pos; }
+        size_t tellp() const { return size_t(_pos - _start); }
+        size_t remaining() const { return size_t(_end - _pos); }
+        void   seekp(size_t p) { _pos = _start + p; }
+
+      private:
+        T _start;
+        T _pos;
+        T _end;
+    };
+
+    // size counting stream
+    template <>
+    class datastream<size_t> {
+      public:
+        datastream(size_t init = 0) : _size(init) {}
+        void   skip(size_t s) { _size += s; }
+        bool   write(const char *, size_t s) { _size += s; return true; }
+        size_t tellp() const { return _size; }
+        size_t remaining() const { return 0; }
+
+      private:
+        size_t _size;
+    };
+
+    template <typename Stream, typename T>
+    void pack_value(Stream &ds, const T &v);
+    template <typename Stream, typename T>
+    void unpack_value(Stream &ds, T &v);
+
+    template <typename Stream>
+    void pack_value(Stream &ds, const unsigned_int &v) {
+        uint64_t val = v.value;
+        do {
+            uint8_t b = uint8_t(val) & 0x7f;
+            val >>= 7;
+            b |= ((val > 0) << 7);
+            ds.write((const char *)&b, 1);
+        } while (val);
+    }
+
+    template <typename Stream>
+    void unpack_value(Stream &ds, unsigned_int &v) {
+        uint64_t val = 0;
+        char     b   = 0;
+        uint8_t  by  = 0;
+        do {
+            ds.read(&b, 1);
+            val |= uint32_t(uint8_t(b) & 0x7f) << by;
+            by += 7;
+        } while (uint8_t(b) & 0x80 && by < 32);
+        v.value = uint32_t(val);
+    }
+
+    template <typename T>
+    struct is_vector_like : std::false_type {};
+    template <typename T, typename A>
+    struct is_vector_like<std::vector<T, A>> : std::true_type {};
+    template <typename T, typename A>
+    struct is_vector_like<std::deque<T, A>> : std::true_type {};
+
+    template <typename T>
+    struct is_pair : std::false_type {};
+    template <typename A, typename B>
+    struct is_pair<std::pair<A, B>> : std::true_type {};
+
+    template <typename T>
+    struct is_tuple : std::false_type {};
+    template <typename... A>
+    struct is_tuple<std::tuple<A...>> : std::true_type {};
+
+    template <typename T>
+    struct is_optional : std::false_type {};
+    template <typename T>
+    struct is_optional<std::optional<T>> : std::true_type {};
+
+    template <typename T>
+    struct is_binary_extension : std::false_type {};
+    template <typename T>
+    struct is_binary_extension<binary_extension<T>> : std::true_type {};
+
+    template <typename T>
+    struct is_map : std::false_type {};
+    template <typename K, typename V, typename C, typename A>
+    struct is_map<std::map<K, V, C, A>> : std::true_type {};
+
+    template <typename Stream, typename T>
+    void pack_value(Stream &ds, const T &v) {
+        if constexpr (std::is_same_v<T, bool>) {
+            uint8_t b = v ? 1 : 0;
+            ds.write((const char *)&b, 1);
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>
+                             || std::is_same_v<T, __int128> || std::is_same_v<T, unsigned __int128>) {
+            ds.write((const char *)&v, sizeof(T));
+        } else if constexpr (std::is_same_v<T, name> || std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+            ds.write((const char *)&v.value, sizeof(uint64_t));
+        } else if constexpr (std::is_same_v<T, asset>) {
+            pack_value(ds, v.amount);
+            pack_value(ds, v.symbol);
+        } else if constexpr (std::is_same_v<T, extended_asset>) {
+            pack_value(ds, v.quantity);
+            pack_value(ds, v.contract);
+        } else if constexpr (std::is_same_v<T, extended_symbol>) {
+            pack_value(ds, v.sym);
+            pack_value(ds, v.contract);
+        } else if constexpr (std::is_same_v<T, time_point>) {
+            pack_value(ds, v.elapsed.count());
+        } else if constexpr (std::is_same_v<T, time_point_sec>) {
+            pack_value(ds, v.utc_seconds);
+        } else if constexpr (std::is_same_v<T, block_timestamp>) {
+            pack_value(ds, v.slot);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            pack_value(ds, unsigned_int(uint32_t(v.size())));
+            ds.write(v.data(), v.size());
+        } else if constexpr (is_vector_like<T>::value) {
+            pack_value(ds, unsigned_int(uint32_t(v.size())));
+            for (const auto &e : v) pack_value(ds, e);
+        } else if constexpr (is_map<T>::value) {
+            pack_value(ds, unsigned_int(uint32_t(v.size())));
+            for (const auto &e : v) {
+                pack_value(ds, e.first);
+                pack_value(ds, e.second);
+            }
+        } else if constexpr (is_pair<T>::value) {
+            pack_value(ds, v.first);
+            pack_value(ds, v.second);
+        } else if constexpr (is_tuple<T>::value) {
+            std::apply([&](const auto &...e) { (pack_value(ds, e), ...); }, v);
+        } else if constexpr (is_optional<T>::value) {
+            pack_value(ds, v.has_value());
+            if (v) pack_value(ds, *v);
+        } else if constexpr (is_binary_extension<T>::value) {
+            if (v.has_value()) pack_value(ds, v.value());
+        } else {
+            for_each_field(v, [&](const auto &...f) { (pack_value(ds, f), ...); });
+        }
+    }
+
+    namespace custom_unpack_detail {
+
+        // hides the generic `eosio::operator>>` from ordinary lookup in here, and
+        // that one rejects `probe` when found through ADL, so `probe >> v` only
+        // finds an `operator>>` declared for `T` itself
+        struct probe {};
+        void operator>>(probe, probe);
+
+        template <typename T, typename = void>
+        struct has : std::false_type {};
+        template <typename T>
+        struct has<T, std::void_t<decltype(std::declval<probe &>() >> std::declval<T &>())>> : std::true_type {};
+
+    } // namespace custom_unpack_detail
+
+    // rows with their own `template <typename DataStream> friend DataStream &operator>>`, as CDT allows
+    template <typename T>
+    constexpr bool has_custom_unpack = custom_unpack_detail::has<T>::value;
+
+    template <typename Stream, typename T>
+    void unpack_value(Stream &ds, T &v) {
+        if constexpr (std::is_same_v<T, bool>) {
+            uint8_t b = 0;
+            ds.read((char *)&b, 1);
+            v = b != 0;
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>
+                             || std::is_same_v<T, __int128> || std::is_same_v<T, unsigned __int128>) {
+            ds.read((char *)&v, sizeof(T));
+        } else if constexpr (std::is_same_v<T, name> || std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+            ds.read((char *)&v.value, sizeof(uint64_t));
+        } else if constexpr (std::is_same_v<T, asset>) {
+            unpack_value(ds, v.amount);
+            unpack_value(ds, v.symbol);
+        } else if constexpr (std::is_same_v<T, extended_asset>) {
+            unpack_value(ds, v.quantity);
+            unpack_value(ds, v.contract);
+        } else if constexpr (std::is_same_v<T, extended_symbol>) {
+            unpack_value(ds, v.sym);
+            unpack_value(ds, v.contract);
+        } else if constexpr (std::is_same_v<T, time_point>) {
+            int64_t c = 0;
+            unpack_value(ds, c);
+            v = time_point(microseconds(c));
+        } else if constexpr (std::is_same_v<T, time_point_sec>) {
+            unpack_value(ds, v.utc_seconds);
+        } else if constexpr (std::is_same_v<T, block_timestamp>) {
+            unpack_value(ds, v.slot);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            unsigned_int size;
+            unpack_value(ds, size);
+            v.resize(size.value);
+            if (size.value) ds.read(v.data(), size.value);
+        } else if constexpr (is_vector_like<T>::value) {
+            unsigned_int size;
+            unpack_value(ds, size);
+            v.clear();
+            v.resize(size.value);
+            for (auto &e : v) unpack_value(ds, e);
+        } else if constexpr (is_map<T>::value) {
+            unsigned_int size;
+            unpack_value(ds, size);
+            v.clear();
+            for (uint32_t i = 0; i < size.value; i++) {
+                typename T::key_type    k;
+                typename T::mapped_type m;
+                unpack_value(ds, k);
+                unpack_value(ds, m);
+                v.emplace(std::move(k), std::move(m));
+            }
+        } else if constexpr (is_pair<T>::value) {
+            unpack_value(ds, v.first);
+            unpack_value(ds, v.second);
+        } else if constexpr (is_tuple<T>::value) {
+            std::apply([&](auto &...e) { (unpack_value(ds, e), ...); }, v);
+        } else if constexpr (is_optional<T>::value) {
+            bool has = false;
+            unpack_value(ds, has);
+            if (has) {
+                typename T::value_type e {};
+                unpack_value(ds, e);
+                v = std::move(e);
+            } else {
+                v.reset();
+            }
+        } else if constexpr (is_binary_extension<T>::value) {
+            // absent when the bytes end before it, as in rows written before the field existed
+            if (ds.remaining() > 0) {
+                typename T::value_type e {};
+                unpack_value(ds, e);
+                v.emplace(std::move(e));
+            } else {
+                v.reset();
+            }
+        } else if constexpr (has_custom_unpack<T>) {
+            operator>>(ds, v);
+        } else {
+            for_each_field(v, [&](auto &...f) { (unpack_value(ds, f), ...); });
+        }
+    }
+
+    template <typename Stream, typename T>
+    Stream &operator<<(Stream &ds, const T &v) {
+        pack_value(ds, v);
+        return ds;
+    }
+
+    template <typename Stream, typename T,
+              typename = std::enable_if_t<!std::is_same_v<Stream, custom_unpack_detail::probe>>>
+    Stream &operator>>(Stream &ds, T &v) {
+        unpack_value(ds, v);
+        return ds;
+    }
+
+    template <typename T>
+    size_t pack_size(const T &v) {
+        datastream<size_t> ds;
+        pack_value(ds, v);
+        return ds.tellp();
+    }
+
+    template <typename T>
+    std::vector<char> pack(const T &v) {
+        std::vector<char> result(pack_size(v));
+        datastream<char *> ds(result.data(), result.size());
+        pack_value(ds, v);
+        return result;
+    }
+
+    template <typename T>
+    T unpack(const char *buffer, size_t len) {
+        T                        result {};
+        datastream<const char *> ds(buffer, len);
+        unpack_value(ds, result);
+        return result;
+    }
+
+    template <typename T>
+    T unpack(const std::vector<char> &bytes) {
+        return unpack<T>(bytes.data(), bytes.size());
+    }
+
+} // namespace eosio
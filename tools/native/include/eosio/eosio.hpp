@@ -0,0 +1,24 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
+#include <eosio/check.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/system.hpp>
+#include <eosio/time.hpp>
+
+typedef unsigned __int128 uint128_t;
+typedef __int128          int128_t;
@@ -0,0 +1,229 @@
+#pragma once
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/chain.hpp>
+
+namespace eosio {
+
+    static constexpr name same_payer {};
+
+    /**
+     * In-memory `multi_index` over `native::chain` tables, primary index only.
+     * Rows are stored packed exactly as on chain, so tables written by one
+     * contract can be read by another through its own row struct.
+     */
+    template <name::raw TableName, typename T>
+    class multi_index {
+      public:
+        class const_iterator {
+          public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type        = T;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const T *;
+            using reference         = const T &;
+
+            const_iterator() = default;
+
+            const T &operator*() const {
+                check(_idx && _obj, "cannot dereference end iterator");
+                return *_obj;
+            }
+            const T *operator->() const { return &operator*(); }
+
+            const_iterator &operator++() {
+                check(_idx && _obj, "cannot increment end iterator");
+                *this = _idx->next_of(_pk);
+                return *this;
+            }
+            const_iterator operator++(int) {
+                auto tmp = *this;
+                ++(*this);
+                return tmp;
+            }
+            const_iterator &operator--() {
+                check(_idx != nullptr, "cannot decrement iterator");
+                *this = _obj ? _idx->prev_of(_pk) : _idx->last();
+                check(_obj != nullptr, "cannot decrement iterator at beginning of table");
+                return *this;
+            }
+            const_iterator operator--(int) {
+                auto tmp = *this;
+                --(*this);
+                return tmp;
+            }
+
+            friend bool operator==(const const_iterator &a, const const_iterator &b) { return a._obj == b._obj; }
+            friend bool operator!=(const const_iterator &a, const const_iterator &b) { return a._obj != b._obj; }
+
+          private:
+            friend class multi_index;
+            const_iterator(const multi_index *idx, uint64_t pk, const T *obj) : _idx(idx), _pk(pk), _obj(obj) {}
+
+            const multi_index *_idx = nullptr;
+            uint64_t           _pk  = 0;
+            const T           *_obj = nullptr;
+        };
+
+        using iterator               = const_iterator;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+        name     get_code() const { return _code; }
+        uint64_t get_scope() const { return _scope; }
+
+        const_iterator begin() const {
+            auto t = table();
+            if (!t || t->empty()) return end();
+            return load(t->begin()->first, t->begin()->second);
+        }
+        const_iterator end() const { return const_iterator(this, 0, nullptr); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        const_iterator find(uint64_t pk) const {
+            counters().db_find++;
+            auto t = table();
+            if (!t) return end();
+            auto itr = t->find(pk);
+            if (itr == t->end()) return end();
+            return load(itr->first, itr->second);
+        }
+
+        const_iterator require_find(uint64_t pk, const char *msg = "unable to find key") const {
+            auto itr = find(pk);
+            check(itr != end(), msg);
+            return itr;
+        }
+
+        const T &get(uint64_t pk, const char *msg = "unable to find key") const {
+            auto itr = find(pk);
+            check(itr != end(), msg);
+            return *itr;
+        }
+
+        const_iterator lower_bound(uint64_t pk) const {
+            auto t = table();
+            if (!t) return end();
+            auto itr = t->lower_bound(pk);
+            if (itr == t->end()) return end();
+            return load(itr->first, itr->second);
+        }
+
+        const_iterator upper_bound(uint64_t pk) const {
+            auto t = table();
+            if (!t) return end();
+            auto itr = t->upper_bound(pk);
+            if (itr == t->end()) return end();
+            return load(itr->first, itr->second);
+        }
+
+        uint64_t available_primary_key() const {
+            auto t = table();
+            if (!t || t->empty()) return 0;
+            auto last = t->rbegin()->first;
+            check(last < std::numeric_limits<uint64_t>::max() - 1, "next primary key in table is at autoincrement limit");
+            return last + 1;
+        }
+
+        template <typename Lambda>
+        const_iterator emplace(name payer, Lambda &&constructor) {
+            check(native::chain::get().can_write(_code), "cannot create objects in table of another contract");
+            T obj {};
+            constructor(obj);
+            uint64_t pk = obj.primary_key();
+            native::chain::get().store(id(), pk, payer, pack(obj));
+            auto &cached = _cache[pk];
+            if (!cached) cached = std::make_unique<T>();
+            *cached = std::move(obj);
+            return const_iterator(this, pk, cached.get());
+        }
+
+        template <typename Lambda>
+        void modify(const_iterator itr, name payer, Lambda &&updater) {
+            check(itr != end(), "cannot pass end iterator to modify");
+            modify(*itr, payer, std::forward<Lambda>(updater));
+        }
+
+        template <typename Lambda>
+        void modify(const T &obj, name payer, Lambda &&updater) {
+            check(native::chain::get().can_write(_code), "cannot modify objects in table of another contract");
+            auto &mutable_obj = const_cast<T &>(obj);
+            uint64_t pk       = obj.primary_key();
+            updater(mutable_obj);
+            check(pk == obj.primary_key(), "updater cannot change primary key when modifying an object");
+            native::chain::get().update(id(), pk, payer, pack(obj));
+        }
+
+        const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            auto next = itr;
+            ++next;
+            erase(*itr);
+            return next;
+        }
+
+        void erase(const T &obj) {
+            check(native::chain::get().can_write(_code), "cannot erase objects in table of another contract");
+            uint64_t pk = obj.primary_key();
+            native::chain::get().remove(id(), pk);
+            _cache.erase(pk);
+        }
+
+      private:
+        native::table_id id() const { return native::table_id { _code.value, _scope, uint64_t(TableName) }; }
+
+        const native::table *table() const { return native::chain::get().find_table(id()); }
+
+        static native::host_counters &counters() { return native::chain::get().mutable_counters(); }
+
+        // objects stay at a stable address per primary key, refreshed on every load
+        const_iterator load(uint64_t pk, const native::row &r) const {
+            counters().db_get++;
+            counters().db_bytes += r.data.size();
+            auto &cached = _cache[pk];
+            if (!cached) cached = std::make_unique<T>();
+            *cached = unpack<T>(r.data);
+            return const_iterator(this, pk, cached.get());
+        }
+
+        const_iterator next_of(uint64_t pk) const {
+            counters().db_next++;
+            auto t = table();
+            if (!t) return end();
+            auto itr = t->upper_bound(pk);
+            if (itr == t->end()) return end();
+            return load(itr->first, itr->second);
+        }
+
+        const_iterator prev_of(uint64_t pk) const {
+            auto t = table();
+            if (!t) return end();
+            auto itr = t->lower_bound(pk);
+            if (itr == t->begin()) return end();
+            --itr;
+            return load(itr->first, itr->second);
+        }
+
+        const_iterator last() const {
+            auto t = table();
+            if (!t || t->empty()) return end();
+            auto itr = std::prev(t->end());
+            return load(itr->first, itr->second);
+        }
+
+        name                                        _code;
+        uint64_t                                    _scope;
+        mutable std::map<uint64_t, std::unique_ptr<T>> _cache;
+    };
+
+} // namespace eosio
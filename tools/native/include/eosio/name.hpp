@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <eosio/check.hpp>
+
+namespace eosio {
+
+    /**
+     * Native stand-in of `eosio::name`, same 64-bit encoding as CDT.
+     */
+    struct name {
+        uint64_t value = 0;
+
+        constexpr name() = default;
+        constexpr explicit name(uint64_t v) : value(v) {}
+        constexpr explicit name(std::string_view str) : value(0) {
+            if (str.size() > 13) {
+                throw_invalid("string is too long to be a valid name");
+            }
+            auto n = std::min<size_t>(str.size(), 12);
+            for (size_t i = 0; i < n; ++i) {
+                value <<= 5;
+                value |= char_to_value(str[i]);
+            }
+            value <<= (4 + 5 * (12 - n));
+            if (str.size() == 13) {
+                uint64_t v = char_to_value(str[12]);
+                if (v > 0x0Full) {
+                    throw_invalid("thirteenth character in name cannot be a letter that comes after j");
+                }
+                value |= v;
+            }
+        }
+
+        static constexpr uint8_t char_to_value(char c) {
+            if (c == '.') return 0;
+            if (c >= '1' && c <= '5') return uint8_t(c - '1') + 1;
+            if (c >= 'a' && c <= 'z') return uint8_t(c - 'a') + 6;
+            throw_invalid("character is not in allowed character set for names");
+            return 0;
+        }
+
+        static void throw_invalid(const char *msg);
+
+        enum class raw : uint64_t {};
+
+        constexpr operator raw() const { return raw(value); }
+        constexpr explicit operator bool() const { return value != 0; }
+
+        std::string to_string() const {
+            static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+            std::string str(13, '.');
+            uint64_t    tmp = value;
+            for (uint32_t i = 0; i <= 12; ++i) {
+                char c      = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+                str[12 - i] = c;
+                tmp >>= (i == 0 ? 4 : 5);
+            }
+            auto end = str.find_last_not_of('.');
+            str.resize(end == std::string::npos ? 0 : end + 1);
+            return str;
+        }
+
+        friend constexpr bool operator==(const name &a, const name &b) { return a.value == b.value; }
+        friend constexpr bool operator!=(const name &a, const name &b) { return a.value != b.value; }
+        friend constexpr bool operator<(const name &a, const name &b) { return a.value < b.value; }
+    };
+
+    inline void name::throw_invalid(const char *msg) { throw assert_exception(msg); }
+
+    inline namespace literals {
+        constexpr name operator""_n(const char *s, size_t n) { return name(std::string_view(s, n)); }
+    } // namespace literals
+
+} // namespace eosio
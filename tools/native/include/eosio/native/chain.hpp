@@ -0,0 +1,210 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+    struct permission_level {
+        name actor;
+        name permission;
+
+        permission_level() = default;
+        permission_level(name a, name p) : actor(a), permission(p) {}
+
+        friend bool operator==(const permission_level &a, const permission_level &b) {
+            return a.actor == b.actor && a.permission == b.permission;
+        }
+    };
+
+    namespace native {
+
+        struct action_data {
+            eosio::name                   account;
+            eosio::name                   name;
+            std::vector<permission_level> authorization;
+            std::vector<char>             data;
+        };
+
+        // one executed action, notifications included
+        struct action_trace {
+            eosio::name receiver;
+            eosio::name account;
+            eosio::name action;
+            uint32_t    depth = 0;
+            bool        notification = false;
+        };
+
+        struct table_id {
+            uint64_t code;
+            uint64_t scope;
+            uint64_t table;
+
+            friend bool operator<(const table_id &a, const table_id &b) {
+                return std::tie(a.code, a.scope, a.table) < std::tie(b.code, b.scope, b.table);
+            }
+            friend bool operator==(const table_id &a, const table_id &b) {
+                return a.code == b.code && a.scope == b.scope && a.table == b.table;
+            }
+        };
+
+        struct row {
+            std::vector<char> data;
+            eosio::name       payer;
+        };
+
+        using table = std::map<uint64_t, row>;
+
+        // counters of the emulated host functions, reset per transaction
+        struct host_counters {
+            uint64_t db_find   = 0;
+            uint64_t db_get    = 0;
+            uint64_t db_store  = 0;
+            uint64_t db_update = 0;
+            uint64_t db_remove = 0;
+            uint64_t db_next   = 0;
+            uint64_t send_inline = 0;
+            uint64_t require_recipient = 0;
+            uint64_t is_account = 0;
+            uint64_t applies      = 0;   // receivers with code, notifications included
+            uint64_t action_bytes = 0;   // action data each of them unpacked
+            uint64_t db_bytes     = 0;   // row bytes loaded and written
+            int64_t  ram_delta = 0;
+        };
+
+        // one row written by a transaction, in the order the contracts wrote them
+        struct storage_delta {
+            enum kind_t : uint8_t { store, update, remove };
+
+            table_id id;
+            uint64_t pk;
+            kind_t   kind;
+            int64_t  ram_delta;   // as counted in `host_counters::ram_delta`
+        };
+
+        using apply_handler = std::function<void(name receiver, name code, name action)>;
+
+        // thrown when a transaction fails, carries the assertion message
+        struct transaction_error : std::runtime_error {
+            using std::runtime_error::runtime_error;
+        };
+
+        /**
+         * In-memory chain: tables, accounts, contracts, inline action and
+         * notification ordering as nodeos executes them, and undo on failure.
+         *
+         * Contract code reaches the chain through `get()`, the chain made
+         * current on the calling thread, so independent chains can run on
+         * separate threads.
+         */
+        class chain {
+          public:
+            chain();
+            ~chain();
+            chain(const chain &)            = delete;
+            chain &operator=(const chain &) = delete;
+
+            static chain &get();
+            void          make_current();
+
+            // accounts and code
+            void create_account(name account);
+            bool is_account(name account) const { return _accounts.count(account) > 0; }
+            void set_contract(name account, apply_handler handler);
+            // `actor@active` is satisfied by the inline actions `code` sends (`code@eosio.code`)
+            void add_code_permission(name actor, name code);
+            // inline actions of a privileged account skip authorization, as for `eosio`
+            void set_privileged(name account) { _privileged.insert(account); }
+
+            // time
+            time_point now() const { return _now; }
+            void       set_time(time_point t) { _now = t; }
+            void       add_time(microseconds m) { _now = _now + m; }
+
+            // transactions, throw `transaction_error` and leave state untouched on failure
+            void push_transaction(const std::vector<action_data> &actions);
+            void push_action(const action_data &act) { push_transaction({ act }); }
+            // runs the transaction and undoes it even when it succeeds, traces and counters stay
+            void dry_run(const std::vector<action_data> &actions);
+
+            const std::vector<action_trace> &traces() const { return _traces; }
+            // packed return value of the last top level action that set one
+            const std::vector<char>         &return_value() const { return _return_value; }
+            const std::string                &console() const { return _console; }
+            const host_counters              &counters() const { return _counters; }
+            const std::vector<storage_delta> &deltas() const { return _deltas; }
+
+            // database, used by multi_index
+            const table *find_table(const table_id &id) const;
+            table       &get_table(const table_id &id);
+            void         store(const table_id &id, uint64_t pk, name payer, std::vector<char> data);
+            void         update(const table_id &id, uint64_t pk, name payer, std::vector<char> data);
+            void         remove(const table_id &id, uint64_t pk);
+
+            const std::map<table_id, table> &tables() const { return _tables; }
+            std::map<table_id, table>       &mutable_tables() { return _tables; }
+
+            // execution context of the running action
+            name                            receiver() const { return _ctx ? _ctx->receiver : name(); }
+            // contracts write their own tables, fixtures write anything between transactions
+            bool                            can_write(name code) const { return !_ctx || _ctx->receiver == code; }
+            name                            first_receiver() const { return _ctx ? _ctx->act->account : name(); }
+            const action_data              &current_action() const;
+            void                            require_recipient(name recipient);
+            void                            send_inline(action_data act);
+            bool                            has_auth(name actor) const;
+            void                            require_auth(name actor) const;
+            void                            print(const std::string &s) { _console += s; }
+            void                            set_return_value(std::vector<char> value);
+            host_counters                  &mutable_counters() { return _counters; }
+
+          private:
+            struct context {
+                const action_data       *act;
+                name                     receiver;
+                std::vector<name>        notified;
+                std::vector<action_data> inlines;
+            };
+
+            struct undo_entry {
+                table_id                 id;
+                uint64_t                 pk;
+                std::unique_ptr<row>     before;   // null when the row did not exist
+            };
+
+            void execute(const action_data &act, uint32_t depth);
+            void apply(context &ctx, name receiver, uint32_t depth, bool notification);
+            void check_authorization(const action_data &act, name sender) const;
+            void record_undo(const table_id &id, uint64_t pk);
+            void rollback();
+            void run(const std::vector<action_data> &actions, bool commit);
+
+            std::set<name>                     _accounts;
+            std::map<name, apply_handler>      _contracts;
+            std::map<name, std::set<name>>     _code_permissions;
+            std::set<name>                     _privileged;
+            std::map<table_id, table>          _tables;
+            time_point                         _now;
+
+            context                           *_ctx   = nullptr;
+            uint32_t                           _depth = 0;
+            std::vector<undo_entry>            _undo;
+            bool                               _in_transaction = false;
+            std::vector<action_trace>          _traces;
+            std::string                        _console;
+            std::vector<char>                  _return_value;
+            host_counters                      _counters;
+            std::vector<storage_delta>         _deltas;
+        };
+
+    } // namespace native
+} // namespace eosio
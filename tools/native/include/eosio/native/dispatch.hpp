@@ -0,0 +1,113 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/chain.hpp>
+#include <eosio/native/json_args.hpp>
+
+/**
+ * Action dispatch for native builds, the counterpart of the `apply` CDT
+ * generates from `[[eosio::action]]` and `[[eosio::on_notify]]`. A contract
+ * lists its actions once:
+ *
+ *     const native::action_entry vault_actions[] = {
+ *         NATIVE_ACTION(vault, updatestatus), ...
+ *     };
+ *
+ * and the same table serves execution and encoding action data from JSON.
+ */
+namespace eosio::native {
+
+    template <typename C, typename R, typename... Args>
+    std::tuple<std::decay_t<Args>...> member_args(R (C::*)(Args...));
+
+    template <typename C, typename R, typename... Args>
+    R member_result(R (C::*)(Args...));
+
+    // unpack the running action's data into the arguments and call `C::Action`
+    template <typename C, auto Action>
+    void execute_action(name receiver, name code) {
+        using args_t = decltype(member_args(Action));
+        using ret_t  = decltype(member_result(Action));
+
+        const auto              &data = chain::get().current_action().data;
+        datastream<const char *> ds(data.data(), data.size());
+        args_t                   args {};
+        std::apply([&](auto &...a) { (unpack_value(ds, a), ...); }, args);
+
+        C contract(receiver, code, datastream<const char *>(data.data(), data.size()));
+        if constexpr (std::is_void_v<ret_t>) {
+            std::apply([&](auto &...a) { (contract.*Action)(a...); }, args);
+        } else {
+            auto result = std::apply([&](auto &...a) { return (contract.*Action)(a...); }, args);
+            chain::get().set_return_value(pack(result));
+        }
+    }
+
+    // packed action data from a JSON array of the arguments in declaration order
+    template <auto Action>
+    std::vector<char> encode_args(std::string_view json) {
+        using args_t = decltype(member_args(Action));
+        args_t args {};
+        check(json_args::parse_tuple(json, args), "cannot encode action arguments " + std::string(json));
+        return std::apply([](const auto &...a) { return pack(std::make_tuple(a...)); }, args);
+    }
+
+    struct action_entry {
+        eosio::name name;
+        void (*execute)(eosio::name receiver, eosio::name code);
+        std::vector<char> (*encode)(std::string_view json);
+    };
+
+    /**
+     * Run the action of the current context: own actions when `code` is the
+     * receiver, otherwise the `notify` entry for a `transfer` notification
+     * (`on_notify("*::transfer")`), anything else is ignored as in CDT.
+     */
+    template <size_t N>
+    void dispatch(const action_entry (&actions)[N], const action_entry *notify, eosio::name receiver,
+                  eosio::name code, eosio::name act) {
+        if (code == receiver) {
+            for (const auto &a : actions) {
+                if (a.name == act) {
+                    a.execute(receiver, code);
+                    return;
+                }
+            }
+            check(false, "unknown action " + act.to_string());
+        }
+        if (notify && act == notify->name) {
+            notify->execute(receiver, code);
+        }
+    }
+
+    // packed data of `act` from its JSON arguments
+    template <size_t N>
+    std::vector<char> encode(const action_entry (&actions)[N], eosio::name act, std::string_view json) {
+        for (const auto &a : actions) {
+            if (a.name == act) return a.encode(json);
+        }
+        check(false, "unknown action " + act.to_string());
+        return {};
+    }
+
+} // namespace eosio::native
+
+#define NATIVE_ACTION(CONTRACT, ACTION)                                                                      \
+    ::eosio::native::action_entry {                                                                         \
+        ::eosio::name(#ACTION), &::eosio::native::execute_action<CONTRACT, &CONTRACT::ACTION>,              \
+            &::eosio::native::encode_args<&CONTRACT::ACTION>                                                \
+    }
+
+#define NATIVE_NOTIFY(CONTRACT, ACTION, HANDLER)                                                             \
+    ::eosio::native::action_entry {                                                                         \
+        ::eosio::name(#ACTION), &::eosio::native::execute_action<CONTRACT, &CONTRACT::HANDLER>,             \
+            &::eosio::native::encode_args<&CONTRACT::HANDLER>                                               \
+    }
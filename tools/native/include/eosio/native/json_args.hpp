@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <json.hpp>
+
+#include <eosio/asset.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+
+/**
+ * Action arguments from JSON as `cleos push action` takes them: a positional
+ * array, integers quoted or not, names, `"4,EOS"` symbols, `"1.0000 EOS"`
+ * assets, strings and arrays of those. Parsers return false on malformed
+ * input instead of throwing, the caller reports the whole argument list.
+ */
+namespace eosio::native::json_args {
+
+    using tools::json::for_each_element;
+    using tools::json::unquote;
+
+    inline bool is_quoted(std::string_view raw) { return raw.size() >= 2 && raw.front() == '"' && raw.back() == '"'; }
+
+    inline bool parse_int(std::string_view raw, __int128 &value) {
+        raw           = unquote(raw);
+        bool negative = !raw.empty() && raw.front() == '-';
+        if (negative) raw.remove_prefix(1);
+        uint64_t u = 0;
+        if (!tools::json::to_uint(raw, u)) return false;
+        value = negative ? -__int128(u) : __int128(u);
+        return true;
+    }
+
+    // "1.0000 EOS", the precision is the number of decimals written
+    inline bool parse_asset(std::string_view raw, asset &value) {
+        if (!is_quoted(raw)) return false;
+        raw        = unquote(raw);
+        auto space = raw.find(' ');
+        if (space == std::string_view::npos) return false;
+        std::string_view number = raw.substr(0, space), code = raw.substr(space + 1);
+        bool             negative = !number.empty() && number.front() == '-';
+        if (negative) number.remove_prefix(1);
+        auto     dot       = number.find('.');
+        uint8_t  precision = dot == std::string_view::npos ? 0 : uint8_t(number.size() - dot - 1);
+        uint64_t amount    = 0;
+        for (char c : number) {
+            if (c == '.') continue;
+            if (c < '0' || c > '9') return false;
+            amount = amount * 10 + uint64_t(c - '0');
+        }
+        value.amount = negative ? -int64_t(amount) : int64_t(amount);
+        value.symbol = symbol(symbol_code(code), precision);
+        return value.is_valid();
+    }
+
+    // "4,EOS"
+    inline bool parse_symbol(std::string_view raw, symbol &value) {
+        if (!is_quoted(raw)) return false;
+        raw        = unquote(raw);
+        auto comma = raw.find(',');
+        if (comma == std::string_view::npos || comma == 0) return false;
+        uint64_t precision = 0;
+        if (!tools::json::to_uint(raw.substr(0, comma), precision) || precision > 18) return false;
+        value = symbol(symbol_code(raw.substr(comma + 1)), uint8_t(precision));
+        return value.is_valid();
+    }
+
+    // the escapes `JSON.stringify` writes for plain text
+    inline bool parse_string(std::string_view raw, std::string &value) {
+        if (!is_quoted(raw)) return false;
+        raw = unquote(raw);
+        value.clear();
+        for (size_t i = 0; i < raw.size(); i++) {
+            if (raw[i] != '\\') {
+                value += raw[i];
+                continue;
+            }
+            if (++i == raw.size()) return false;
+            switch (raw[i]) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            case '"':
+            case '\\':
+            case '/': value += raw[i]; break;
+            default: return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool parse_value(std::string_view raw, T &value);
+
+    template <typename Tuple, size_t... I>
+    bool parse_elements(std::string_view json, Tuple &values, std::index_sequence<I...>) {
+        std::vector<std::string_view> raw;
+        if (!for_each_element(json, [&](std::string_view v) { raw.push_back(v); })) return false;
+        if (raw.size() != sizeof...(I)) return false;
+        return (parse_value(raw[I], std::get<I>(values)) && ...);
+    }
+
+    // positional arguments, exactly one element per tuple member
+    template <typename... T>
+    bool parse_tuple(std::string_view json, std::tuple<T...> &values) {
+        return parse_elements(json, values, std::index_sequence_for<T...> {});
+    }
+
+    template <typename T>
+    bool parse_value(std::string_view raw, T &value) {
+        try {
+            if constexpr (std::is_same_v<T, bool>) {
+                value = raw == "true" || raw == "1";
+                return value || raw == "false" || raw == "0";
+            } else if constexpr (std::is_same_v<T, unsigned_int>) {
+                uint32_t v = 0;
+                if (!parse_value(raw, v)) return false;
+                value = v;
+                return true;
+            } else if constexpr (std::is_integral_v<T>) {
+                __int128 v = 0;
+                if (!parse_int(raw, v)) return false;
+                if (v < __int128(std::numeric_limits<T>::min()) || v > __int128(std::numeric_limits<T>::max()))
+                    return false;
+                value = T(v);
+                return true;
+            } else if constexpr (std::is_same_v<T, name>) {
+                if (!is_quoted(raw)) return false;
+                value = name(unquote(raw));
+                return true;
+            } else if constexpr (std::is_same_v<T, symbol_code>) {
+                if (!is_quoted(raw)) return false;
+                value = symbol_code(unquote(raw));
+                return value.is_valid();
+            } else if constexpr (std::is_same_v<T, symbol>) {
+                return parse_symbol(raw, value);
+            } else if constexpr (std::is_same_v<T, asset>) {
+                return parse_asset(raw, value);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                return parse_string(raw, value);
+            } else if constexpr (std::is_same_v<T, time_point_sec>) {
+                uint64_t s = 0;
+                if (!tools::json::to_uint(raw, s)) return false;
+                value = time_point_sec(uint32_t(s));
+                return true;
+            } else if constexpr (std::is_same_v<T, block_timestamp>) {
+                uint64_t slot = 0;
+                if (!tools::json::to_uint(raw, slot)) return false;
+                value = block_timestamp(uint32_t(slot));
+                return true;
+            } else if constexpr (is_vector_like<T>::value) {
+                value.clear();
+                bool ok = true;
+                if (!for_each_element(raw, [&](std::string_view e) {
+                        typename T::value_type v {};
+                        ok = ok && parse_value(e, v);
+                        value.push_back(std::move(v));
+                    }))
+                    return false;
+                return ok;
+            } else if constexpr (is_tuple<T>::value) {
+                return parse_tuple(raw, value);
+            } else {
+                return false;
+            }
+        } catch (const assert_exception &) {
+            // invalid names and symbol codes
+            return false;
+        }
+    }
+
+} // namespace eosio::native::json_args
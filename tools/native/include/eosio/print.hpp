@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <type_traits>
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/chain.hpp>
+#include <eosio/symbol.hpp>
+
+namespace eosio {
+
+    namespace native {
+        template <typename T>
+        std::string to_print(const T &v) {
+            if constexpr (std::is_same_v<T, std::string>) {
+                return v;
+            } else if constexpr (std::is_convertible_v<T, const char *>) {
+                return std::string(v);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return v ? "true" : "false";
+            } else if constexpr (std::is_same_v<T, char>) {
+                return std::string(1, v);
+            } else if constexpr (std::is_arithmetic_v<T>) {
+                return std::to_string(v);
+            } else if constexpr (std::is_same_v<T, __int128> || std::is_same_v<T, unsigned __int128>) {
+                bool     negative = false;
+                unsigned __int128 u;
+                if constexpr (std::is_same_v<T, __int128>) {
+                    negative = v < 0;
+                    u        = negative ? (unsigned __int128)(-v) : (unsigned __int128)v;
+                } else {
+                    u = v;
+                }
+                std::string s;
+                do {
+                    s.insert(s.begin(), char('0' + int(u % 10)));
+                    u /= 10;
+                } while (u);
+                return negative ? "-" + s : s;
+            } else {
+                return v.to_string();
+            }
+        }
+    } // namespace native
+
+    template <typename... Args>
+    void print(Args &&...args) {
+        (native::chain::get().print(native::to_print(std::decay_t<Args>(args))), ...);
+    }
+
+    // `%` placeholders are replaced by the arguments in order
+    template <typename... Args>
+    void print_f(const char *fmt, Args &&...args) {
+        std::string parts[] = { native::to_print(std::decay_t<Args>(args))..., std::string() };
+        std::string out;
+        size_t      next = 0;
+        for (const char *c = fmt; *c; ++c) {
+            if (*c == '%' && next < sizeof...(Args)) {
+                out += parts[next++];
+            } else {
+                out += *c;
+            }
+        }
+        native::chain::get().print(out);
+    }
+
+} // namespace eosio
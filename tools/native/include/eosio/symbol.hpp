@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <eosio/check.hpp>
+
+namespace eosio {
+
+    struct symbol_code {
+        uint64_t value = 0;
+
+        constexpr symbol_code() = default;
+        constexpr explicit symbol_code(uint64_t raw) : value(raw) {}
+        constexpr explicit symbol_code(std::string_view str) : value(0) {
+            if (str.size() > 7) {
+                throw_invalid("string is too long to be a valid symbol_code");
+            }
+            for (auto itr = str.rbegin(); itr != str.rend(); ++itr) {
+                if (*itr < 'A' || *itr > 'Z') {
+                    throw_invalid("only uppercase letters allowed in symbol_code string");
+                }
+                value <<= 8;
+                value |= uint64_t(*itr);
+            }
+        }
+
+        static void throw_invalid(const char *msg) { throw assert_exception(msg); }
+
+        constexpr uint64_t raw() const { return value; }
+        constexpr uint32_t length() const {
+            uint64_t sym = value;
+            uint32_t len = 0;
+            while (sym & 0xFF && len <= 7) {
+                len++;
+                sym >>= 8;
+            }
+            return len;
+        }
+        constexpr bool is_valid() const {
+            auto sym = value;
+            for (int i = 0; i < 7; i++) {
+                char c = char(sym & 0xFF);
+                if (!('A' <= c && c <= 'Z')) return false;
+                sym >>= 8;
+                if (!(sym & 0xFF)) {
+                    do {
+                        sym >>= 8;
+                        if ((sym & 0xFF)) return false;
+                        i++;
+                    } while (i < 7);
+                }
+            }
+            return true;
+        }
+        std::string to_string() const {
+            std::string s;
+            auto        v = value;
+            while (v & 0xFF) {
+                s += char(v & 0xFF);
+                v >>= 8;
+            }
+            return s;
+        }
+
+        friend constexpr bool operator==(const symbol_code &a, const symbol_code &b) { return a.value == b.value; }
+        friend constexpr bool operator!=(const symbol_code &a, const symbol_code &b) { return a.value != b.value; }
+        friend constexpr bool operator<(const symbol_code &a, const symbol_code &b) { return a.value < b.value; }
+    };
+
+    struct symbol {
+        uint64_t value = 0;
+
+        constexpr symbol() = default;
+        constexpr explicit symbol(uint64_t raw) : value(raw) {}
+        constexpr symbol(symbol_code sc, uint8_t precision) : value((sc.raw() << 8) | precision) {}
+        constexpr symbol(std::string_view code, uint8_t precision)
+            : value((symbol_code(code).raw() << 8) | precision) {}
+
+        constexpr uint64_t    raw() const { return value; }
+        constexpr uint8_t     precision() const { return uint8_t(value & 0xFF); }
+        constexpr symbol_code code() const { return symbol_code(value >> 8); }
+        constexpr bool        is_valid() const { return code().is_valid(); }
+        constexpr explicit    operator bool() const { return value != 0; }
+
+        std::string to_string() const { return std::to_string(precision()) + "," + code().to_string(); }
+
+        friend constexpr bool operator==(const symbol &a, const symbol &b) { return a.value == b.value; }
+        friend constexpr bool operator!=(const symbol &a, const symbol &b) { return a.value != b.value; }
+        friend constexpr bool operator<(const symbol &a, const symbol &b) { return a.value < b.value; }
+    };
+
+} // namespace eosio
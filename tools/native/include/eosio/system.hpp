@@ -0,0 +1,10 @@
+#pragma once
+#include <eosio/native/chain.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+    inline time_point      current_time_point() { return native::chain::get().now(); }
+    inline block_timestamp current_block_time() { return block_timestamp(current_time_point()); }
+
+} // namespace eosio
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+
+namespace eosio {
+
+    struct microseconds {
+        int64_t _count = 0;
+
+        constexpr microseconds() = default;
+        constexpr explicit microseconds(int64_t c) : _count(c) {}
+
+        constexpr int64_t count() const { return _count; }
+        constexpr int64_t to_seconds() const { return _count / 1000000; }
+
+        friend constexpr microseconds operator+(const microseconds &a, const microseconds &b) { return microseconds(a._count + b._count); }
+        friend constexpr microseconds operator-(const microseconds &a, const microseconds &b) { return microseconds(a._count - b._count); }
+        friend constexpr bool operator==(const microseconds &a, const microseconds &b) { return a._count == b._count; }
+        friend constexpr bool operator<(const microseconds &a, const microseconds &b) { return a._count < b._count; }
+    };
+
+    constexpr microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+    constexpr microseconds milliseconds(int64_t s) { return microseconds(s * 1000); }
+    constexpr microseconds minutes(int64_t m) { return seconds(60 * m); }
+    constexpr microseconds hours(int64_t h) { return minutes(60 * h); }
+    constexpr microseconds days(int64_t d) { return hours(24 * d); }
+
+    struct time_point {
+        microseconds elapsed;
+
+        constexpr time_point() = default;
+        constexpr explicit time_point(microseconds e) : elapsed(e) {}
+
+        constexpr const microseconds &time_since_epoch() const { return elapsed; }
+        constexpr uint32_t            sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+
+        friend constexpr time_point operator+(const time_point &t, const microseconds &m) { return time_point(t.elapsed + m); }
+        friend constexpr time_point operator-(const time_point &t, const microseconds &m) { return time_point(t.elapsed - m); }
+        friend constexpr microseconds operator-(const time_point &a, const time_point &b) { return a.elapsed - b.elapsed; }
+        friend constexpr bool operator==(const time_point &a, const time_point &b) { return a.elapsed == b.elapsed; }
+        friend constexpr bool operator!=(const time_point &a, const time_point &b) { return !(a == b); }
+        friend constexpr bool operator<(const time_point &a, const time_point &b) { return a.elapsed < b.elapsed; }
+        friend constexpr bool operator>(const time_point &a, const time_point &b) { return b < a; }
+        friend constexpr bool operator<=(const time_point &a, const time_point &b) { return !(b < a); }
+        friend constexpr bool operator>=(const time_point &a, const time_point &b) { return !(a < b); }
+    };
+
+    struct time_point_sec {
+        uint32_t utc_seconds = 0;
+
+        constexpr time_point_sec() = default;
+        constexpr explicit time_point_sec(uint32_t s) : utc_seconds(s) {}
+        constexpr time_point_sec(const time_point &t) : utc_seconds(t.sec_since_epoch()) {}
+
+        constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+        constexpr operator time_point() const { return time_point(seconds(utc_seconds)); }
+
+        friend constexpr time_point_sec operator+(const time_point_sec &t, uint32_t offset) { return time_point_sec(t.utc_seconds + offset); }
+        friend constexpr bool operator==(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds == b.utc_seconds; }
+        friend constexpr bool operator!=(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds != b.utc_seconds; }
+        friend constexpr bool operator<(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds < b.utc_seconds; }
+        friend constexpr bool operator<=(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds <= b.utc_seconds; }
+        friend constexpr bool operator>(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds > b.utc_seconds; }
+        friend constexpr bool operator>=(const time_point_sec &a, const time_point_sec &b) { return a.utc_seconds >= b.utc_seconds; }
+    };
+
+    // half-second block slots since 2000-01-01, as on chain
+    struct block_timestamp {
+        uint32_t slot = 0;
+
+        static constexpr int32_t  block_interval_ms = 500;
+        static constexpr int64_t  block_timestamp_epoch = 946684800000ll;
+
+        constexpr block_timestamp() = default;
+        constexpr explicit block_timestamp(uint32_t s) : slot(s) {}
+        constexpr block_timestamp(const time_point &t)
+            : slot(uint32_t((t.time_since_epoch().count() / 1000 - block_timestamp_epoch) / block_interval_ms)) {}
+
+        constexpr time_point to_time_point() const {
+            return time_point(milliseconds(int64_t(slot) * block_interval_ms + block_timestamp_epoch));
+        }
+
+        friend constexpr bool operator==(const block_timestamp &a, const block_timestamp &b) { return a.slot == b.slot; }
+        friend constexpr bool operator!=(const block_timestamp &a, const block_timestamp &b) { return a.slot != b.slot; }
+        friend constexpr bool operator<(const block_timestamp &a, const block_timestamp &b) { return a.slot < b.slot; }
+    };
+
+    typedef block_timestamp block_timestamp_type;
+
+} // namespace eosio
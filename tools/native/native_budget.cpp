@@ -0,0 +1,436 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+#include <mapped_file.hpp>
+
+#include "scenario.hpp"
+
+using namespace native_scenario;
+
+/**
+ * The counters of `bench/budgets.json` measured on the native chain: every
+ * scenario of `bench/scenarios.bench.ts` on the same chain `createChain`
+ * builds, the same pushes and the last of the same `BENCH_RUNS` (5) samples.
+ *
+ * `ram_bytes` and `db_ops` count the rows of vault.defi and stoken.defi only,
+ * as `bench/metrics.ts` does: those contracts run from their own sources here,
+ * eosio.token and eosio.system are stand-ins. Wall-clock time is left to
+ * `BENCH_UPDATE=1 yarn bench`.
+ */
+namespace {
+
+    constexpr int RUNS = 5;
+    constexpr int DAY  = 86400;
+
+    const name VAULT  = name("vault.defi");
+    const name STOKEN = name("stoken.defi");
+    const name TOKENS = name("tokens");
+
+    struct counters {
+        int64_t inline_actions = 0;
+        int64_t ram_bytes      = 0;
+        int64_t db_ops         = 0;
+    };
+
+    // TA, TB ... TZ, TAA, TAB ... as `collateralSymbol` in bench/chain.ts
+    std::string collateral_symbol(uint32_t index) {
+        std::string code;
+        int64_t     n = index;
+        do {
+            code.insert(code.begin(), char('A' + n % 26));
+            n = n / 26 - 1;
+        } while (n >= 0);
+        return "T" + code;
+    }
+
+    std::string quoted(const std::string &s) { return "\"" + s + "\""; }
+
+    // `createChain` of bench/chain.ts on the native chain
+    class bench_chain {
+      public:
+        bench_chain(uint32_t collaterals, bool eos) {
+            _sc.time     = 1672531200;   // 2023-01-01T00:00:00Z
+            _sc.accounts = { name("eosio.rex"),    name("eosio.stake"), name("eosio.ram"),  name("eosio.ramfee"),
+                             name("eosio.saving"), name("eosio.bpay"),  name("eosio.vpay"), name("eosio.names"),
+                             name("admin.defi"),   name("vfees.defi"),  name("proxy.defi"), name("rexseeder"),
+                             name("award.defi"),   name("user.a"),      name("user.b") };
+            _sc.contracts  = { { name("eosio"), "system" },  { name("eosio.token"), "token" },
+                               { name("eosio.reserv"), "results" }, { TOKENS, "token" },
+                               { STOKEN, "stoken" },          { VAULT, "vault" } };
+            _sc.privileged = { name("eosio") };
+            _sc.code_permissions = { { name("award.defi"), name("award.defi") }, { name("award.defi"), VAULT },
+                                     { VAULT, STOKEN }, { VAULT, VAULT }, { name("eosio"), name("eosio") } };
+            _c.make_current();
+            deploy(_sc, _c);
+
+            push("eosio.token", "create", "eosio.token", R"(["eosio", "10000000000.0000 EOS"])");
+            push("eosio.token", "issue", "eosio", R"(["eosio", "10000000000.0000 EOS", "init"])");
+            push("eosio", "init", "eosio", R"([0, "4,EOS"])");
+            push("eosio", "regproxy", "proxy.defi", R"(["proxy.defi", true])");
+            for (const char *account : { "rexseeder", "vault.defi" }) {
+                push("eosio.token", "transfer", "eosio",
+                     "[\"eosio\", " + quoted(account) + ", \"1000.0000 EOS\", \"init\"]");
+                push("eosio", "delegatebw", account,
+                     "[" + quoted(account) + ", " + quoted(account) + ", \"1.0000 EOS\", \"1.0000 EOS\", false]");
+            }
+            push("eosio", "voteproducer", "rexseeder", R"(["rexseeder", "proxy.defi", []])");
+            push("eosio", "deposit", "rexseeder", R"(["rexseeder", "100.0000 EOS"])");
+            push("eosio", "buyrex", "rexseeder", R"(["rexseeder", "100.0000 EOS"])");
+            push("vault.defi", "proxyto", "admin.defi", R"(["proxy.defi"])");
+
+            push("eosio.token", "transfer", "eosio", R"(["eosio", "award.defi", "200000.0000 EOS", "init"])");
+            for (const auto &user : users) {
+                push("eosio.token", "transfer", "eosio",
+                     "[\"eosio\", " + quoted(user) + ", \"1000000.0000 EOS\", \"init\"]");
+            }
+            for (uint32_t i = 0; i < collaterals; i++) {
+                auto sym = collateral_symbol(i);
+                symbols.push_back(sym);
+                push("tokens", "create", "tokens", "[\"tokens\", \"10000000000.0000 " + sym + "\"]");
+                push("tokens", "issue", "tokens", "[\"tokens\", \"10000000000.0000 " + sym + "\", \"init\"]");
+                push("tokens", "transfer", "tokens", "[\"tokens\", \"award.defi\", \"200000.0000 " + sym + "\", \"init\"]");
+                for (const auto &user : users) {
+                    push("tokens", "transfer", "tokens",
+                         "[\"tokens\", " + quoted(user) + ", \"1000000.0000 " + sym + "\", \"init\"]");
+                }
+                create_collateral("tokens", sym);
+            }
+            if (eos) create_collateral("eosio.token", "EOS");
+            // first income call only sets last_income_time
+            income();
+        }
+
+        void create_collateral(const std::string &contract, const std::string &sym) {
+            push("vault.defi", "createcoll", "admin.defi",
+                 "[" + quoted(contract) + ", \"4," + sym + "\", \"award.defi\", \"vfees.defi\", \"0.1000 " + sym
+                     + "\", 50, 30, 5000]");
+        }
+
+        void deposit(const std::string &user, const std::string &amount, const std::string &sym) {
+            push(sym == "EOS" ? "eosio.token" : "tokens", "transfer", user,
+                 "[" + quoted(user) + ", \"vault.defi\", \"" + amount + " " + sym + "\", \"\"]");
+        }
+
+        void withdraw(const std::string &user, const std::string &amount, const std::string &sym) {
+            push("stoken.defi", "transfer", user,
+                 "[" + quoted(user) + ", \"vault.defi\", \"" + amount + " S" + sym + "\", \"\"]");
+        }
+
+        void release(const std::string &user) { push("vault.defi", "release", user, "[" + quoted(user) + "]"); }
+        void income() { push("vault.defi", "income", "vault.defi", "[]"); }
+        void add_time(int64_t seconds) { _c.add_time(eosio::seconds(seconds)); }
+
+        // `buildMaturities`: a REX buy on `days` distinct days
+        void build_maturities(const std::string &user, uint32_t days) {
+            for (uint32_t i = 0; i < days; i++) {
+                deposit(user, "10.0000", "EOS");
+                add_time(DAY);
+            }
+        }
+
+        // `buildReleases`: `count` pending releases of `user`
+        void build_releases(const std::string &user, const std::string &sym, uint32_t count) {
+            if (count == 0) return;
+            deposit(user, std::to_string(count) + ".0000", sym);
+            for (uint32_t i = 0; i < count; i++) withdraw(user, "0.5000", sym);
+        }
+
+        void push(const std::string &contract, const char *act, const std::string &actor, const std::string &data) {
+            if (!error.empty()) return;
+            step s { name(contract), name(act), { name(actor) }, data, {}, 0 };
+            auto r = run_step(_sc, s, _c);
+            if (!r.ok) error = contract + " " + act + " " + data + ": " + r.error;
+        }
+
+        // counters of the last transaction
+        counters last() const {
+            counters m;
+            for (const auto &t : _c.traces()) m.inline_actions += t.depth > 0 && !t.notification;
+            for (const auto &d : _c.deltas()) {
+                if (d.id.code != VAULT.value && d.id.code != STOKEN.value) continue;
+                m.ram_bytes += d.ram_delta;
+                m.db_ops++;
+            }
+            return m;
+        }
+
+        // `sample` of bench/metrics.ts: the counters of the last of RUNS runs
+        counters sample(const std::function<void(int)> &prepare, const std::function<void(int)> &fn) {
+            for (int run = 0; run < RUNS; run++) {
+                prepare(run);
+                fn(run);
+            }
+            return last();
+        }
+
+        std::vector<std::string> users { "user.a", "user.b" };
+        std::vector<std::string> symbols;
+        std::string              error;
+
+      private:
+        scenario _sc;
+        chain    _c;
+    };
+
+    using results = std::map<std::string, counters>;
+
+    void record(results &out, std::string &error, const std::string &scenario, const bench_chain &c,
+                counters m) {
+        if (!c.error.empty() && error.empty()) error = scenario + ": " + c.error;
+        out[scenario] = m;
+    }
+
+    // every scenario of bench/scenarios.bench.ts
+    std::string measure(results &out) {
+        std::string error;
+        auto        nothing = [](int) {};
+
+        for (uint32_t n : { 1u, 8u, 32u }) {
+            {
+                bench_chain c(n, false);
+                auto        m = c.sample([&](int run) {
+                    auto sym = collateral_symbol(n + uint32_t(run));
+                    c.push("tokens", "create", "tokens", "[\"tokens\", \"10000000000.0000 " + sym + "\"]");
+                }, [&](int run) { c.create_collateral("tokens", collateral_symbol(n + uint32_t(run))); });
+                record(out, error, "createcoll collaterals=" + std::to_string(n), c, m);
+            }
+            {
+                // the last collateral is the worst case for the linear collateral lookup
+                bench_chain c(n, false);
+                auto        sym = c.symbols[n - 1];
+                auto        m   = c.sample(nothing, [&](int) { c.deposit(c.users[0], "100.0000", sym); });
+                record(out, error, "deposit/token collaterals=" + std::to_string(n), c, m);
+            }
+            {
+                bench_chain c(n, false);
+                auto        m = c.sample([&](int) { c.add_time(600); }, [&](int) { c.income(); });
+                record(out, error, "income collaterals=" + std::to_string(n), c, m);
+            }
+            {
+                // the first tick of a day adds a `ratehistory` row per collateral
+                bench_chain c(n, false);
+                auto        m = c.sample([&](int) { c.add_time(DAY); }, [&](int) { c.income(); });
+                record(out, error, "income/new day collaterals=" + std::to_string(n), c, m);
+            }
+        }
+
+        for (uint32_t p : { 0u, 16u, 128u }) {
+            {
+                bench_chain c(1, false);
+                auto        user = c.users[0];
+                auto        sym  = c.symbols[0];
+                c.build_releases(user, sym, p);
+                c.deposit(user, "100.0000", sym);
+                auto m = c.sample(nothing, [&](int) { c.withdraw(user, "1.0000", sym); });
+                record(out, error, "withdraw pending=" + std::to_string(p), c, m);
+            }
+            {
+                bench_chain c(1, false);
+                auto        user = c.users[0];
+                c.build_releases(user, c.symbols[0], p + RUNS);
+                c.add_time(6 * DAY);
+                auto m = c.sample(nothing, [&](int) { c.release(user); });
+                record(out, error, "release/token pending=" + std::to_string(p), c, m);
+            }
+        }
+
+        for (uint32_t l : { 1u, 4u }) {
+            {
+                bench_chain c(0, true);
+                auto        user = c.users[0];
+                c.build_maturities(user, l);
+                auto m = c.sample(nothing, [&](int) { c.deposit(user, "10.0000", "EOS"); });
+                record(out, error, "deposit/eos maturities=" + std::to_string(l), c, m);
+            }
+            {
+                bench_chain c(0, true);
+                auto        user = c.users[0];
+                c.deposit(user, "1000.0000", "EOS");
+                c.add_time(6 * DAY);
+                c.build_maturities(user, l);
+                auto m = c.sample([&](int) {
+                    c.withdraw(user, "10.0000", "EOS");
+                    c.add_time(6 * DAY);
+                }, [&](int) { c.release(user); });
+                record(out, error, "release/eos maturities=" + std::to_string(l), c, m);
+            }
+        }
+
+        // one chain for the three stoken scenarios, in order
+        bench_chain c(1, false);
+        auto        sym = "S" + c.symbols[0];
+        c.deposit(c.users[0], "1000.0000", c.symbols[0]);
+        auto m = c.sample(nothing, [&](int) {
+            c.push("stoken.defi", "issue", "vault.defi", "[" + quoted(c.users[1]) + ", \"1.0000 " + sym + "\", \"bench\"]");
+        });
+        record(out, error, "stoken/issue", c, m);
+        m = c.sample(nothing, [&](int) {
+            c.push("stoken.defi", "transfer", c.users[0],
+                   "[" + quoted(c.users[0]) + ", " + quoted(c.users[1]) + ", \"1.0000 " + sym + "\", \"bench\"]");
+        });
+        record(out, error, "stoken/transfer", c, m);
+        m = c.sample([&](int) {
+            c.push("stoken.defi", "issue", "vault.defi", "[\"vault.defi\", \"1.0000 " + sym + "\", \"bench\"]");
+        }, [&](int) { c.push("stoken.defi", "retire", "vault.defi", "[\"1.0000 " + sym + "\", \"bench\"]"); });
+        record(out, error, "stoken/retire", c, m);
+        return error;
+    }
+
+    // a budget entry: raw members in file order, counters parsed
+    struct budget {
+        std::vector<std::pair<std::string, std::string>> members;
+        std::map<std::string, int64_t>                   values;
+    };
+
+    // the members before `scenarios`: `time_scale` and `time_tolerance`, kept as written
+    using header = std::vector<std::pair<std::string, std::string>>;
+
+    bool parse_budgets(std::string_view text, header &head, std::map<std::string, budget> &out) {
+        bool ok     = true;
+        bool parsed = tools::json::for_each_member(text, [&](std::string_view key, std::string_view value) {
+            if (key != "scenarios") {
+                for (auto &member : head) {
+                    if (member.first == key) member.second = std::string(value);
+                }
+            } else {
+                ok = ok && tools::json::for_each_member(value, [&](std::string_view scenario, std::string_view entry) {
+                    auto &b = out[std::string(scenario)];
+                    ok      = ok && tools::json::for_each_member(entry, [&](std::string_view k, std::string_view v) {
+                        b.members.emplace_back(std::string(k), std::string(v));
+                        uint64_t n = 0;
+                        if (tools::json::to_uint(v, n)) b.values[std::string(k)] = int64_t(n);
+                    });
+                });
+            }
+        });
+        return parsed && ok;
+    }
+
+    const char *const counter_keys[] = { "inline_actions", "ram_bytes", "db_ops" };
+
+    int64_t value_of(const counters &m, const std::string &key) {
+        if (key == "inline_actions") return m.inline_actions;
+        // a budget never goes below zero, as `checkBudget` records it
+        if (key == "ram_bytes") return std::max<int64_t>(m.ram_bytes, 0);
+        return m.db_ops;
+    }
+
+    // `JSON.stringify(budgets, null, 2)` as `saveResults` writes it, counters replaced
+    std::string format_budgets(const header &head, const std::map<std::string, budget> &budgets,
+                               const results &measured) {
+        std::string out = "{";
+        for (const auto &[key, value] : head) out += "\n  \"" + key + "\": " + value + ",";
+        out += "\n  \"scenarios\": {";
+        std::map<std::string, budget> merged = budgets;
+        for (const auto &[scenario, m] : measured) merged[scenario];
+        bool first = true;
+        for (const auto &[scenario, b] : merged) {
+            out += first ? "\n" : ",\n";
+            first = false;
+            std::vector<std::pair<std::string, std::string>> members;
+            auto                                             m = measured.find(scenario);
+            for (const auto &member : b.members) {
+                if (m != measured.end() && (member.first == "inline_actions" || member.first == "ram_bytes"
+                                            || member.first == "db_ops")) {
+                    continue;
+                }
+                members.push_back(member);
+            }
+            if (m != measured.end()) {
+                // after `time_ms`, before the profile and metered counters
+                size_t at = !members.empty() && members[0].first == "time_ms" ? 1 : 0;
+                for (const char *key : counter_keys) {
+                    members.insert(members.begin() + long(at++), { key, std::to_string(value_of(m->second, key)) });
+                }
+            }
+            out += "    \"" + scenario + "\": {";
+            for (size_t i = 0; i < members.size(); i++) {
+                out += (i ? ",\n      \"" : "\n      \"") + members[i].first + "\": " + members[i].second;
+            }
+            out += "\n    }";
+        }
+        out += "\n  }\n}\n";
+        return out;
+    }
+
+    void usage() {
+        std::fprintf(stderr, "usage: native_budget [--update] BUDGETS\n"
+                             "  runs the scenarios of bench/scenarios.bench.ts on the native chain and\n"
+                             "  exits with 1 when their inline_actions, ram_bytes or db_ops differ from\n"
+                             "  BUDGETS (bench/budgets.json); --update writes the measured counters\n");
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *path   = nullptr;
+    bool        update = false;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--update")) {
+            update = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    header                        head { { "time_scale", "1" }, { "time_tolerance", "1.5" } };
+    std::map<std::string, budget> budgets;
+    {
+        tools::mapped_file file(path);
+        if (file.ok() && !parse_budgets(std::string_view(file.data(), file.size()), head, budgets)) {
+            std::fprintf(stderr, "native_budget: %s is not a budget file\n", path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    results measured;
+    auto    error = measure(measured);
+    if (!error.empty()) {
+        std::fprintf(stderr, "native_budget: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> errors;
+    for (const auto &[scenario, m] : measured) {
+        std::printf("%-40s inline=%" PRId64 " db=%" PRId64 " ram=%" PRId64 "\n", scenario.c_str(), m.inline_actions,
+                    m.db_ops, m.ram_bytes);
+        auto b = budgets.find(scenario);
+        for (const char *key : counter_keys) {
+            int64_t value = value_of(m, key);
+            if (b == budgets.end() || !b->second.values.count(key)) {
+                errors.push_back(scenario + ": no " + key + " budget");
+            } else if (b->second.values.at(key) != value) {
+                errors.push_back(scenario + ": " + key + " " + std::to_string(value) + ", budget "
+                                 + std::to_string(b->second.values.at(key)));
+            }
+        }
+    }
+
+    if (update) {
+        std::ofstream(path) << format_budgets(head, budgets, measured);
+        std::printf("counters written to %s\n", path);
+        return EXIT_SUCCESS;
+    }
+    for (const auto &e : errors) {
+        std::printf("BUDGET MISMATCH %s\n", e.c_str());
+    }
+    if (!errors.empty()) {
+        std::printf("record the measured counters with native_budget --update\n");
+    }
+    return errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <mapped_file.hpp>
+
+#include "scenario.hpp"
+
+using namespace native_scenario;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr, "usage: native_run [--dump FILE] [--all] SCENARIO\n"
+                             "  runs SCENARIO on the native chain and prints one JSON line per step,\n"
+                             "  --dump writes the rows the scenario lists (every row with --all)\n"
+                             "  as JSON lines with hex data, the format reconcile reads\n");
+    }
+
+    std::string escape(const std::string &s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (uint8_t(c) >= 0x20) {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *dump = nullptr;
+    const char *path = nullptr;
+    bool        all  = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--dump") && i + 1 < argc) {
+            dump = argv[++i];
+        } else if (!std::strcmp(argv[i], "--all")) {
+            all = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    tools::mapped_file file(path);
+    if (!file.ok()) {
+        std::fprintf(stderr, "native_run: cannot map %s\n", path);
+        return EXIT_FAILURE;
+    }
+    scenario sc;
+    auto     error = load(std::string_view(file.data(), file.size()), sc);
+    if (!error.empty()) {
+        std::fprintf(stderr, "native_run: %s: %s\n", path, error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    eosio::native::chain c;
+    auto                 results    = run(sc, c);
+    size_t               unexpected = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        unexpected += !r.expected;
+        std::printf("{\"step\":%zu,\"ok\":%s,\"expected\":%s,\"error\":\"%s\"}\n", i, r.ok ? "true" : "false",
+                    r.expected ? "true" : "false", escape(r.error).c_str());
+    }
+
+    if (dump) {
+        std::FILE *f = std::fopen(dump, "w");
+        if (!f) {
+            std::fprintf(stderr, "native_run: cannot write %s\n", dump);
+            return EXIT_FAILURE;
+        }
+        auto rows = all ? dump_all(c) : dump_rows(sc, c);
+        std::fwrite(rows.data(), 1, rows.size(), f);
+        std::fclose(f);
+    }
+
+    if (unexpected > 0) {
+        std::fprintf(stderr, "native_run: %zu step(s) did not go as the scenario expects\n", unexpected);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
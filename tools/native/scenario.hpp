@@ -0,0 +1,296 @@
+#pragma once
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json.hpp>
+
+#include <eosio/native/chain.hpp>
+
+#include "contracts.hpp"
+
+/**
+ * Scenario files (the `.json` files in `tests/scenarios`), run by `native_run`
+ * here and by `bench/parity.ts` on Vert:
+ *
+ *     {
+ *       "time": 1672531200,
+ *       "accounts": ["admin.defi", ...],
+ *       "contracts": { "vault.defi": "vault", "eosio.token": "token", ... },
+ *       "privileged": ["eosio"],
+ *       "code_permissions": { "vault.defi": ["stoken.defi", "vault.defi"] },
+ *       "steps": [
+ *         { "contract": "vault.defi", "action": "createcoll", "auth": ["admin.defi"], "data": [...] },
+ *         { "wait": 600 },
+ *         { "contract": "vault.defi", "action": "release", "auth": ["user.a"], "data": ["user.a"],
+ *           "error": "withdraw has been suspended" }
+ *       ],
+ *       "dump": [{ "code": "vault.defi", "table": "releases", "scopes": ["user.a"] }]
+ *     }
+ *
+ * `data` holds the positional action arguments, `error` a substring of the
+ * expected assertion message. Scopes are names, or numbers for the tables
+ * scoped by id.
+ */
+namespace native_scenario {
+
+    using eosio::name;
+    using eosio::native::chain;
+
+    struct step {
+        // an action, or `wait` seconds
+        name              contract;
+        name              action;
+        std::vector<name> auth;
+        std::string       data;
+        std::string       error;
+        int64_t           wait = 0;
+    };
+
+    struct scope {
+        uint64_t    value;
+        std::string text;   // as written in the scenario, reused in the dump
+    };
+
+    struct dump_spec {
+        name               code;
+        name               table;
+        std::vector<scope> scopes;
+    };
+
+    struct scenario {
+        uint32_t                                     time = 0;
+        std::vector<name>                            accounts;
+        std::vector<std::pair<name, std::string>>    contracts;
+        std::vector<name>                            privileged;
+        std::vector<std::pair<name, name>>           code_permissions;   // actor, code
+        std::vector<step>                            steps;
+        std::vector<dump_spec>                       dump;
+    };
+
+    struct step_result {
+        bool        ok;
+        bool        expected;   // success, or the failure the scenario names
+        std::string error;
+    };
+
+    inline bool parse_name(std::string_view raw, name &out) {
+        if (raw.size() < 2 || raw.front() != '"') return false;
+        try {
+            out = name(tools::json::unquote(raw));
+        } catch (const eosio::assert_exception &) {
+            return false;
+        }
+        return true;
+    }
+
+    // "actor" or "actor@permission", the permission is always `active`
+    inline bool parse_actor(std::string_view raw, name &out) {
+        auto text = tools::json::unquote(raw);
+        auto at   = text.find('@');
+        if (at != std::string_view::npos) {
+            return parse_name("\"" + std::string(text.substr(0, at)) + "\"", out);
+        }
+        return parse_name(raw, out);
+    }
+
+    inline bool parse_names(std::string_view raw, std::vector<name> &out) {
+        bool ok = true;
+        return tools::json::for_each_element(raw, [&](std::string_view v) {
+                   name n;
+                   ok = ok && parse_actor(v, n);
+                   out.push_back(n);
+               })
+               && ok;
+    }
+
+    inline bool parse_step(std::string_view raw, step &out) {
+        bool ok = true;
+        bool parsed = tools::json::for_each_member(raw, [&](std::string_view key, std::string_view value) {
+            if (key == "contract") {
+                ok = ok && parse_name(value, out.contract);
+            } else if (key == "action") {
+                ok = ok && parse_name(value, out.action);
+            } else if (key == "auth") {
+                ok = ok && parse_names(value, out.auth);
+            } else if (key == "data") {
+                out.data = std::string(value);
+            } else if (key == "error") {
+                out.error = std::string(tools::json::unquote(value));
+            } else if (key == "wait") {
+                uint64_t seconds = 0;
+                ok        = ok && tools::json::to_uint(value, seconds);
+                out.wait  = int64_t(seconds);
+            }
+        });
+        return parsed && ok && (out.wait > 0 || (out.contract && out.action && !out.data.empty()));
+    }
+
+    inline bool parse_dump(std::string_view raw, dump_spec &out) {
+        bool ok = true;
+        bool parsed = tools::json::for_each_member(raw, [&](std::string_view key, std::string_view value) {
+            if (key == "code") {
+                ok = ok && parse_name(value, out.code);
+            } else if (key == "table") {
+                ok = ok && parse_name(value, out.table);
+            } else if (key == "scopes") {
+                ok = ok && tools::json::for_each_element(value, [&](std::string_view v) {
+                    scope s { 0, std::string(v) };
+                    name  n;
+                    if (tools::json::to_uint(v, s.value) && v.front() != '"') {
+                    } else if (parse_name(v, n)) {
+                        s.value = n.value;
+                    } else {
+                        ok = false;
+                    }
+                    out.scopes.push_back(std::move(s));
+                });
+            }
+        });
+        return parsed && ok && out.code && out.table;
+    }
+
+    // returns an empty string, or what is wrong with the file
+    inline std::string load(std::string_view json, scenario &out) {
+        std::string error;
+        auto        fail = [&](const char *what) {
+            if (error.empty()) error = what;
+        };
+        bool parsed = tools::json::for_each_member(json, [&](std::string_view key, std::string_view value) {
+            if (key == "time") {
+                uint64_t t = 0;
+                if (!tools::json::to_uint(value, t)) fail("time is not a number of seconds");
+                out.time = uint32_t(t);
+            } else if (key == "accounts") {
+                if (!parse_names(value, out.accounts)) fail("malformed accounts");
+            } else if (key == "privileged") {
+                if (!parse_names(value, out.privileged)) fail("malformed privileged");
+            } else if (key == "contracts") {
+                if (!tools::json::for_each_member(value, [&](std::string_view account, std::string_view kind) {
+                        name n;
+                        if (!parse_name("\"" + std::string(account) + "\"", n)) fail("malformed contract account");
+                        auto k = std::string(tools::json::unquote(kind));
+                        if (!native_contracts::find_kind(k)) fail("unknown contract kind");
+                        out.contracts.emplace_back(n, k);
+                    }))
+                    fail("malformed contracts");
+            } else if (key == "code_permissions") {
+                if (!tools::json::for_each_member(value, [&](std::string_view actor, std::string_view codes) {
+                        name              a;
+                        std::vector<name> c;
+                        if (!parse_name("\"" + std::string(actor) + "\"", a) || !parse_names(codes, c))
+                            fail("malformed code_permissions");
+                        for (auto code : c) out.code_permissions.emplace_back(a, code);
+                    }))
+                    fail("malformed code_permissions");
+            } else if (key == "steps") {
+                if (!tools::json::for_each_element(value, [&](std::string_view raw) {
+                        step s;
+                        if (!parse_step(raw, s)) fail("malformed step");
+                        out.steps.push_back(std::move(s));
+                    }))
+                    fail("malformed steps");
+            } else if (key == "dump") {
+                if (!tools::json::for_each_element(value, [&](std::string_view raw) {
+                        dump_spec d;
+                        if (!parse_dump(raw, d)) fail("malformed dump");
+                        out.dump.push_back(std::move(d));
+                    }))
+                    fail("malformed dump");
+            }
+        });
+        if (!parsed) fail("not a JSON object");
+        return error;
+    }
+
+    inline const native_contracts::kind *kind_of(const scenario &sc, name account) {
+        for (const auto &c : sc.contracts) {
+            if (c.first == account) return native_contracts::find_kind(c.second);
+        }
+        return nullptr;
+    }
+
+    // accounts, contracts and permissions, on a fresh chain
+    inline void deploy(const scenario &sc, chain &c) {
+        c.set_time(eosio::time_point(eosio::seconds(sc.time)));
+        for (auto account : sc.accounts) c.create_account(account);
+        for (const auto &contract : sc.contracts) {
+            auto kind = native_contracts::find_kind(contract.second);
+            c.set_contract(contract.first, kind->apply);
+        }
+        for (auto account : sc.privileged) c.set_privileged(account);
+        for (const auto &p : sc.code_permissions) c.add_code_permission(p.first, p.second);
+    }
+
+    inline step_result run_step(const scenario &sc, const step &s, chain &c) {
+        if (s.wait > 0) {
+            c.add_time(eosio::seconds(s.wait));
+            return step_result { true, true, {} };
+        }
+        step_result r { true, true, {} };
+        try {
+            auto kind = kind_of(sc, s.contract);
+            eosio::check(kind != nullptr, "no contract on " + s.contract.to_string());
+
+            eosio::native::action_data act { s.contract, s.action, {}, kind->encode(s.action, s.data) };
+            for (auto actor : s.auth) act.authorization.emplace_back(actor, name("active"));
+            c.push_action(act);
+        } catch (const std::exception &e) {
+            r.ok    = false;
+            r.error = e.what();
+        }
+        r.expected = s.error.empty() ? r.ok : !r.ok && r.error.find(s.error) != std::string::npos;
+        return r;
+    }
+
+    inline std::vector<step_result> run(const scenario &sc, chain &c) {
+        std::vector<step_result> results;
+        deploy(sc, c);
+        for (const auto &s : sc.steps) results.push_back(run_step(sc, s, c));
+        return results;
+    }
+
+    inline void append_hex(std::string &out, const std::vector<char> &data) {
+        static const char digits[] = "0123456789abcdef";
+        for (char ch : data) {
+            out += digits[uint8_t(ch) >> 4];
+            out += digits[uint8_t(ch) & 15];
+        }
+    }
+
+    inline void append_row(std::string &out, const std::string &code, const std::string &scope,
+                           const std::string &table, const std::vector<char> &data) {
+        out += "{\"code\":\"" + code + "\",\"scope\":" + scope + ",\"table\":\"" + table + "\",\"hex\":\"";
+        append_hex(out, data);
+        out += "\"}\n";
+    }
+
+    // rows the scenario lists, in the JSON-lines format `reconcile` reads
+    inline std::string dump_rows(const scenario &sc, const chain &c) {
+        std::string out;
+        for (const auto &d : sc.dump) {
+            for (const auto &s : d.scopes) {
+                auto t = c.find_table({ d.code.value, s.value, d.table.value });
+                if (!t) continue;
+                for (const auto &r : *t) append_row(out, d.code.to_string(), s.text, d.table.to_string(), r.second.data);
+            }
+        }
+        return out;
+    }
+
+    // every row on the chain, scopes as numbers
+    inline std::string dump_all(const chain &c) {
+        std::string out;
+        for (const auto &t : c.tables()) {
+            for (const auto &r : t.second) {
+                append_row(out, name(t.first.code).to_string(), std::to_string(t.first.scope),
+                           name(t.first.table).to_string(), r.second.data);
+            }
+        }
+        return out;
+    }
+
+} // namespace native_scenario
@@ -0,0 +1,225 @@
+#include <algorithm>
+
+#include <eosio/native/chain.hpp>
+
+namespace eosio::native {
+
+    namespace {
+        // nodeos bills this many bytes per table row on top of the row data
+        constexpr int64_t row_overhead = 112;
+        constexpr uint32_t max_inline_depth = 4;
+    } // namespace
+
+    namespace {
+        thread_local chain *current = nullptr;
+    } // namespace
+
+    chain::chain() {
+        if (!current) current = this;
+    }
+
+    chain::~chain() {
+        if (current == this) current = nullptr;
+    }
+
+    chain &chain::get() {
+        check(current != nullptr, "no chain is current on this thread");
+        return *current;
+    }
+
+    void chain::make_current() { current = this; }
+
+    void chain::create_account(name account) { _accounts.insert(account); }
+
+    void chain::set_contract(name account, apply_handler handler) {
+        _accounts.insert(account);
+        _contracts[account] = std::move(handler);
+    }
+
+    void chain::add_code_permission(name actor, name code) { _code_permissions[actor].insert(code); }
+
+    const table *chain::find_table(const table_id &id) const {
+        auto itr = _tables.find(id);
+        return itr == _tables.end() ? nullptr : &itr->second;
+    }
+
+    table &chain::get_table(const table_id &id) { return _tables[id]; }
+
+    void chain::record_undo(const table_id &id, uint64_t pk) {
+        if (!_in_transaction) {
+            return;
+        }
+        undo_entry entry { id, pk, nullptr };
+        if (auto t = find_table(id)) {
+            auto itr = t->find(pk);
+            if (itr != t->end()) {
+                entry.before = std::make_unique<row>(itr->second);
+            }
+        }
+        _undo.push_back(std::move(entry));
+    }
+
+    void chain::store(const table_id &id, uint64_t pk, name payer, std::vector<char> data) {
+        auto &t = get_table(id);
+        check(t.find(pk) == t.end(), "could not insert object, most likely a uniqueness constraint was violated");
+        record_undo(id, pk);
+        _counters.db_store++;
+        _counters.db_bytes += data.size();
+        _counters.ram_delta += int64_t(data.size()) + row_overhead;
+        _deltas.push_back({ id, pk, storage_delta::store, int64_t(data.size()) + row_overhead });
+        t.emplace(pk, row { std::move(data), payer });
+    }
+
+    void chain::update(const table_id &id, uint64_t pk, name payer, std::vector<char> data) {
+        auto &t   = get_table(id);
+        auto  itr = t.find(pk);
+        check(itr != t.end(), "object passed to modify is not in multi_index");
+        record_undo(id, pk);
+        _counters.db_update++;
+        _counters.db_bytes += data.size();
+        _counters.ram_delta += int64_t(data.size()) - int64_t(itr->second.data.size());
+        _deltas.push_back({ id, pk, storage_delta::update, int64_t(data.size()) - int64_t(itr->second.data.size()) });
+        itr->second.data = std::move(data);
+        if (payer) {
+            itr->second.payer = payer;
+        }
+    }
+
+    void chain::remove(const table_id &id, uint64_t pk) {
+        auto &t   = get_table(id);
+        auto  itr = t.find(pk);
+        check(itr != t.end(), "object passed to erase is not in multi_index");
+        record_undo(id, pk);
+        _counters.db_remove++;
+        _counters.ram_delta -= int64_t(itr->second.data.size()) + row_overhead;
+        _deltas.push_back({ id, pk, storage_delta::remove, -(int64_t(itr->second.data.size()) + row_overhead) });
+        t.erase(itr);
+    }
+
+    void chain::rollback() {
+        for (auto itr = _undo.rbegin(); itr != _undo.rend(); ++itr) {
+            auto &t = _tables[itr->id];
+            if (itr->before) {
+                t[itr->pk] = *itr->before;
+            } else {
+                t.erase(itr->pk);
+            }
+        }
+        _undo.clear();
+    }
+
+    const action_data &chain::current_action() const {
+        check(_ctx != nullptr, "no action is executing");
+        return *_ctx->act;
+    }
+
+    void chain::require_recipient(name recipient) {
+        check(_ctx != nullptr, "no action is executing");
+        _counters.require_recipient++;
+        if (recipient == _ctx->receiver) {
+            return;
+        }
+        if (std::find(_ctx->notified.begin(), _ctx->notified.end(), recipient) == _ctx->notified.end()) {
+            _ctx->notified.push_back(recipient);
+        }
+    }
+
+    void chain::send_inline(action_data act) {
+        check(_ctx != nullptr, "no action is executing");
+        _counters.send_inline++;
+        check_authorization(act, _ctx->receiver);
+        _ctx->inlines.push_back(std::move(act));
+    }
+
+    void chain::set_return_value(std::vector<char> value) {
+        // nodeos reports the value of every action, the runners only need the top level one
+        if (_ctx && _depth == 0) _return_value = std::move(value);
+    }
+
+    bool chain::has_auth(name actor) const {
+        if (!_ctx) return false;
+        for (const auto &p : _ctx->act->authorization) {
+            if (p.actor == actor) return true;
+        }
+        return false;
+    }
+
+    void chain::require_auth(name actor) const {
+        check(has_auth(actor), "missing authority of " + actor.to_string());
+    }
+
+    void chain::check_authorization(const action_data &act, name sender) const {
+        if (_privileged.count(sender)) return;
+        for (const auto &p : act.authorization) {
+            if (p.actor == sender) continue;
+            auto itr = _code_permissions.find(p.actor);
+            check(itr != _code_permissions.end() && itr->second.count(sender) > 0,
+                  "missing authority of " + p.actor.to_string() + "@" + p.permission.to_string());
+        }
+    }
+
+    void chain::apply(context &ctx, name receiver, uint32_t depth, bool notification) {
+        _traces.push_back(action_trace { receiver, ctx.act->account, ctx.act->name, depth, notification });
+        auto itr = _contracts.find(receiver);
+        if (itr == _contracts.end()) {
+            return;
+        }
+        _counters.applies++;
+        _counters.action_bytes += ctx.act->data.size();
+        ctx.receiver = receiver;
+        _ctx         = &ctx;
+        _depth       = depth;
+        itr->second(receiver, ctx.act->account, ctx.act->name);
+    }
+
+    // nodeos order: the action, its notifications in order, then the inline
+    // actions all of them sent, each executed depth-first
+    void chain::execute(const action_data &act, uint32_t depth) {
+        check(depth <= max_inline_depth, "max inline action depth per transaction reached");
+        check(is_account(act.account), "action's code account does not exist: " + act.account.to_string());
+
+        context  ctx { &act, act.account, {}, {} };
+        context *parent = _ctx;
+        apply(ctx, act.account, depth, false);
+        for (size_t i = 0; i < ctx.notified.size(); i++) {
+            check(is_account(ctx.notified[i]), "notified account does not exist");
+            apply(ctx, ctx.notified[i], depth, true);
+        }
+        _ctx = parent;
+
+        auto inlines = std::move(ctx.inlines);
+        for (const auto &inline_act : inlines) {
+            execute(inline_act, depth + 1);
+        }
+    }
+
+    void chain::push_transaction(const std::vector<action_data> &actions) { run(actions, true); }
+
+    void chain::dry_run(const std::vector<action_data> &actions) { run(actions, false); }
+
+    void chain::run(const std::vector<action_data> &actions, bool commit) {
+        check(!_in_transaction, "nested transaction");
+        _in_transaction = true;
+        _undo.clear();
+        _traces.clear();
+        _console.clear();
+        _return_value.clear();
+        _counters = host_counters {};
+        _deltas.clear();
+        try {
+            for (const auto &act : actions) {
+                execute(act, 0);
+            }
+        } catch (const std::exception &e) {
+            _ctx = nullptr;
+            rollback();
+            _in_transaction = false;
+            throw transaction_error(e.what());
+        }
+        _ctx = nullptr;
+        if (!commit) rollback();
+        _undo.clear();
+        _in_transaction = false;
+    }
+
+} // namespace eosio::native
@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <eosio.hpp>
+#include <json.hpp>
+
+/**
+ * Table dumps, one row at a time. Two formats are read:
+ *
+ * - JSON lines, one row per line:
+ *   `{"code":"vault.defi","scope":"alice","table":"releases","data":{...}}`,
+ *   `data` as `cleos get table` prints it, or `"hex":"..."` with the raw row
+ * - binary: "VROW" u32 version, then records of
+ *   u32 size, u64 code, u64 scope, u64 table, u64 primary_key, u32 data_size, data[data_size]
+ *
+ * A dump may be split into chunks at row boundaries and the chunks read in
+ * parallel.
+ */
+namespace reconcile {
+
+    static constexpr char     DUMP_MAGIC[4] = { 'V', 'R', 'O', 'W' };
+    static constexpr uint32_t DUMP_VERSION  = 1;
+    static constexpr size_t   DUMP_HEADER   = 8;
+    static constexpr size_t   ROW_FIXED     = 8 + 8 + 8 + 8 + 4;
+
+    struct row {
+        uint64_t code;
+        uint64_t scope;
+        uint64_t table;
+        // exactly one of them is set
+        std::string_view json;     // the `data` object
+        std::string_view binary;   // serialized row
+    };
+
+    struct chunk {
+        const char *begin;
+        const char *end;
+        bool        binary;
+    };
+
+    inline bool is_binary(const char *data, size_t size) {
+        return size >= DUMP_HEADER && std::memcmp(data, DUMP_MAGIC, 4) == 0;
+    }
+
+    inline uint32_t load_u32(const char *p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    inline uint64_t load_u64(const char *p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    /**
+     * About `parts` chunks of a mapped dump. JSON lines are cut at the next
+     * newline, binary dumps by walking the record sizes (no row is decoded).
+     */
+    inline std::vector<chunk> split(const char *data, size_t size, size_t parts) {
+        std::vector<chunk> chunks;
+        bool               binary = is_binary(data, size);
+        const char        *p      = binary ? data + DUMP_HEADER : data;
+        const char        *end    = data + size;
+        size_t             target = std::max<size_t>(1, size / std::max<size_t>(parts, 1));
+
+        while (p < end) {
+            const char *cut = p + std::min<size_t>(target, size_t(end - p));
+            if (binary) {
+                const char *q = p;
+                while (q < cut && size_t(end - q) >= 4) {
+                    uint32_t len = load_u32(q);
+                    if (size_t(end - q - 4) < len) {
+                        q = end;   // truncated, the reader reports it
+                        break;
+                    }
+                    q += 4 + len;
+                }
+                // trailing bytes too short for a record go to the last chunk
+                cut = q < cut ? end : q;
+            } else {
+                const char *nl = static_cast<const char *>(std::memchr(cut, '\n', size_t(end - cut)));
+                cut            = nl ? nl + 1 : end;
+            }
+            chunks.push_back(chunk { p, cut, binary });
+            p = cut;
+        }
+        return chunks;
+    }
+
+    // name given as a string or as its numeric value
+    inline uint64_t json_name(std::string_view raw) {
+        uint64_t value = 0;
+        if (raw.size() > 0 && raw.front() != '"' && tools::json::to_uint(raw, value)) return value;
+        return tools::name_value(tools::json::unquote(raw));
+    }
+
+    /**
+     * Rows of one chunk. `next` returns false at the end of the chunk;
+     * rows that cannot be parsed are counted in `malformed`.
+     */
+    class row_reader {
+      public:
+        explicit row_reader(const chunk &c) : _pos(c.begin), _end(c.end), _binary(c.binary) {}
+
+        bool next(row &r) {
+            return _binary ? next_binary(r) : next_json(r);
+        }
+
+        uint64_t malformed() const { return _malformed; }
+
+      private:
+        bool next_binary(row &r) {
+            while (_pos < _end) {
+                if (size_t(_end - _pos) < 4 + ROW_FIXED || load_u32(_pos) < ROW_FIXED
+                    || size_t(_end - _pos - 4) < load_u32(_pos)) {
+                    _malformed++;
+                    _pos = _end;
+                    return false;
+                }
+                uint32_t    size      = load_u32(_pos);
+                const char *p         = _pos + 4;
+                uint32_t    data_size = load_u32(p + 32);
+                _pos += 4 + size;
+                if (data_size != size - ROW_FIXED) {
+                    _malformed++;
+                    continue;
+                }
+                r.code   = load_u64(p);
+                r.scope  = load_u64(p + 8);
+                r.table  = load_u64(p + 16);
+                r.json   = {};
+                r.binary = std::string_view(p + ROW_FIXED, data_size);
+                return true;
+            }
+            return false;
+        }
+
+        bool next_json(row &r) {
+            while (_pos < _end) {
+                const char *nl   = static_cast<const char *>(std::memchr(_pos, '\n', size_t(_end - _pos)));
+                const char *stop = nl ? nl : _end;
+                std::string_view line(_pos, size_t(stop - _pos));
+                _pos = nl ? nl + 1 : _end;
+                if (line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+
+                bool code = false, scope = false, table = false;
+                r.json   = {};
+                r.binary = {};
+                _hex.clear();
+                bool ok = tools::json::for_each_member(line, [&](std::string_view key, std::string_view value) {
+                    if (key == "code") {
+                        r.code = json_name(value);
+                        code   = true;
+                    } else if (key == "scope") {
+                        r.scope = json_name(value);
+                        scope   = true;
+                    } else if (key == "table") {
+                        r.table = json_name(value);
+                        table   = true;
+                    } else if (key == "data") {
+                        r.json = value;
+                    } else if (key == "hex") {
+                        unhex(tools::json::unquote(value));
+                    }
+                });
+                if (!_hex.empty()) r.binary = _hex;
+                if (!ok || !code || !scope || !table || (r.json.empty() && r.binary.empty())) {
+                    _malformed++;
+                    continue;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void unhex(std::string_view hex) {
+            auto nibble = [](char c) -> int {
+                if (c >= '0' && c <= '9') return c - '0';
+                if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+                return -1;
+            };
+            for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+                int hi = nibble(hex[i]), lo = nibble(hex[i + 1]);
+                if (hi < 0 || lo < 0) {
+                    _hex.clear();
+                    return;
+                }
+                _hex += char(hi << 4 | lo);
+            }
+        }
+
+        const char *_pos;
+        const char *_end;
+        bool        _binary;
+        uint64_t    _malformed = 0;
+        // decoded `hex` of the current JSON row, reused
+        std::string _hex;
+    };
+
+    // writes binary dumps, used by the tests and by exporters
+    class dump_writer {
+      public:
+        explicit dump_writer(const std::string &path) : _file(std::fopen(path.c_str(), "wb")) {
+            if (!_file) return;
+            std::fwrite(DUMP_MAGIC, 1, 4, _file);
+            std::fwrite(&DUMP_VERSION, 4, 1, _file);
+        }
+        ~dump_writer() {
+            if (_file) std::fclose(_file);
+        }
+        dump_writer(const dump_writer &)            = delete;
+        dump_writer &operator=(const dump_writer &) = delete;
+
+        bool ok() const { return _file != nullptr; }
+
+        void write(uint64_t code, uint64_t scope, uint64_t table, uint64_t primary_key,
+                   std::string_view data) {
+            uint32_t size      = uint32_t(ROW_FIXED + data.size());
+            uint32_t data_size = uint32_t(data.size());
+            std::fwrite(&size, 4, 1, _file);
+            std::fwrite(&code, 8, 1, _file);
+            std::fwrite(&scope, 8, 1, _file);
+            std::fwrite(&table, 8, 1, _file);
+            std::fwrite(&primary_key, 8, 1, _file);
+            std::fwrite(&data_size, 4, 1, _file);
+            std::fwrite(data.data(), 1, data.size(), _file);
+        }
+
+      private:
+        std::FILE *_file;
+    };
+
+} // namespace reconcile
@@ -0,0 +1,413 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <eosio.hpp>
+#include <json.hpp>
+#include <vault_math.hpp>
+
+#include "dump.hpp"
+
+namespace reconcile {
+
+    using vault_math::i128;
+    using vault_math::u128;
+
+    struct accounts_config {
+        uint64_t vault     = tools::name_value("vault.defi");
+        uint64_t stoken    = tools::name_value("stoken.defi");
+        uint64_t eosio     = tools::name_value("eosio");
+        uint64_t eos_token = tools::name_value("eosio.token");
+    };
+
+    static constexpr uint64_t EOS_SYMBOL = tools::symbol_value("EOS", 4);
+
+    struct collateral_info {
+        uint64_t id;
+        uint64_t deposit_contract;
+        uint64_t deposit_symbol;
+        uint64_t issue_symbol;
+    };
+
+    // everything known about one issued (S) token, keyed by symbol code
+    struct share_totals {
+        bool     has_stat     = false;
+        int64_t  supply       = 0;
+        uint64_t stat_symbol  = 0;
+        i128     balances     = 0;   // sum of every stoken `accounts` row
+        uint64_t holders      = 0;
+        int64_t  vault_shares = 0;   // the vault's own `accounts` row
+
+        uint64_t pending_count    = 0;
+        i128     pending_quantity = 0;
+        uint64_t max_locked_rate  = 0;
+        uint64_t zero_rate        = 0;   // releases locked at rate 0
+        // sum of quantity * max(locked rate, current rate), second pass only
+        u128 pending_owed = 0;
+    };
+
+    struct metrics_info {
+        uint64_t collateral_id;
+        uint64_t pending_count;
+        int64_t  pending_quantity;
+    };
+
+    /**
+     * Totals accumulated from the rows of one chunk. Size depends on the number
+     * of collaterals, never on the number of rows; ledgers of chunks read in
+     * parallel are merged afterwards.
+     */
+    struct ledger {
+        uint64_t rows      = 0;
+        uint64_t skipped   = 0;
+        uint64_t malformed = 0;
+
+        std::vector<collateral_info>                   collaterals;
+        std::vector<metrics_info>                      metrics;
+        std::unordered_map<uint64_t, share_totals>     shares;
+        // vault balances by (token contract, symbol code)
+        std::map<std::pair<uint64_t, uint64_t>, int64_t> holdings;
+
+        bool     has_config     = false;
+        uint64_t log_id         = 0;
+        uint64_t max_release_id = 0;
+        // release rows whose symbol is not an issued token, checked after the merge
+        std::map<uint64_t, uint64_t> release_symbols;
+
+        bool    has_rexpool    = false;
+        int64_t total_lendable = 0;
+        int64_t total_rex      = 0;
+        bool    has_rexbal     = false;
+        int64_t rex_balance    = 0;
+
+        void merge(const ledger &other) {
+            rows += other.rows;
+            skipped += other.skipped;
+            malformed += other.malformed;
+            collaterals.insert(collaterals.end(), other.collaterals.begin(), other.collaterals.end());
+            metrics.insert(metrics.end(), other.metrics.begin(), other.metrics.end());
+            for (const auto &[code, o] : other.shares) {
+                auto &s = shares[code];
+                if (o.has_stat) {
+                    s.has_stat    = true;
+                    s.supply      = o.supply;
+                    s.stat_symbol = o.stat_symbol;
+                }
+                s.balances += o.balances;
+                s.holders += o.holders;
+                s.vault_shares += o.vault_shares;
+                s.pending_count += o.pending_count;
+                s.pending_quantity += o.pending_quantity;
+                s.max_locked_rate = std::max(s.max_locked_rate, o.max_locked_rate);
+                s.zero_rate += o.zero_rate;
+                s.pending_owed += o.pending_owed;
+            }
+            for (const auto &[key, amount] : other.holdings) holdings[key] += amount;
+            for (const auto &[code, count] : other.release_symbols) release_symbols[code] += count;
+            if (other.has_config) {
+                has_config = true;
+                log_id     = other.log_id;
+            }
+            max_release_id = std::max(max_release_id, other.max_release_id);
+            if (other.has_rexpool) {
+                has_rexpool    = true;
+                total_lendable = other.total_lendable;
+                total_rex      = other.total_rex;
+            }
+            if (other.has_rexbal) {
+                has_rexbal  = true;
+                rex_balance = other.rex_balance;
+            }
+        }
+    };
+
+    // fixed-offset reads of serialized rows, false when the row is too short
+    struct binary_row {
+        std::string_view data;
+
+        bool u64(size_t offset, uint64_t &v) const {
+            if (data.size() < offset + 8) return false;
+            std::memcpy(&v, data.data() + offset, 8);
+            return true;
+        }
+        bool i64(size_t offset, int64_t &v) const {
+            uint64_t u;
+            if (!u64(offset, u)) return false;
+            v = int64_t(u);
+            return true;
+        }
+        bool asset(size_t offset, int64_t &amount, uint64_t &symbol) const {
+            return i64(offset, amount) && u64(offset + 8, symbol);
+        }
+    };
+
+    // the members of `object` named in `keys`, in that order, false when one is missing
+    template <size_t N>
+    bool json_fields(std::string_view object, const char *const (&keys)[N], std::string_view (&values)[N]) {
+        size_t found = 0;
+        bool   ok    = tools::json::for_each_member(object, [&](std::string_view key, std::string_view value) {
+            for (size_t i = 0; i < N; i++) {
+                if (key == keys[i] && values[i].empty()) {
+                    values[i] = value;
+                    found++;
+                }
+            }
+        });
+        return ok && found == N;
+    }
+
+    inline bool json_asset(std::string_view raw, int64_t &amount, uint64_t &symbol) {
+        return tools::parse_asset(tools::json::unquote(raw), amount, symbol);
+    }
+
+    /**
+     * Folds rows into a `ledger`. The second pass (`rates` set) only reads
+     * `releases`, pricing each at max(locked rate, current rate).
+     */
+    class accumulator {
+      public:
+        accumulator(const accounts_config &accounts, ledger &out,
+                    const std::unordered_map<uint64_t, uint64_t> *rates = nullptr)
+            : _a(accounts), _out(out), _rates(rates) {}
+
+        void add(const row &r) {
+            _out.rows++;
+            bool ok = true;
+            if (_rates) {
+                if (r.code == _a.vault && r.table == RELEASES) {
+                    ok = release(r);
+                } else {
+                    _out.skipped++;
+                }
+            } else if (r.code == _a.vault) {
+                switch (r.table) {
+                case COLLATERALS: ok = collateral(r); break;
+                case RELEASES: ok = release(r); break;
+                case CONFIG: ok = config(r); break;
+                case METRICS: ok = metrics(r); break;
+                case PAYOUTS: ok = payout(r); break;
+                default: _out.skipped++;
+                }
+            } else if (r.code == _a.stoken && r.table == ACCOUNTS) {
+                ok = share_account(r);
+            } else if (r.code == _a.stoken && r.table == STAT) {
+                ok = stat(r);
+            } else if (r.table == ACCOUNTS && r.scope == _a.vault) {
+                ok = holding(r);
+            } else if (r.code == _a.eosio && r.table == REXPOOL) {
+                ok = rexpool(r);
+            } else if (r.code == _a.eosio && r.table == REXBAL) {
+                ok = rexbal(r);
+            } else {
+                _out.skipped++;
+            }
+            if (!ok) _out.malformed++;
+        }
+
+      private:
+        static constexpr uint64_t COLLATERALS = tools::name_value("collaterals");
+        static constexpr uint64_t RELEASES    = tools::name_value("releases");
+        static constexpr uint64_t CONFIG      = tools::name_value("config");
+        static constexpr uint64_t METRICS     = tools::name_value("metrics");
+        static constexpr uint64_t PAYOUTS     = tools::name_value("payouts");
+        static constexpr uint64_t ACCOUNTS    = tools::name_value("accounts");
+        static constexpr uint64_t STAT        = tools::name_value("stat");
+        static constexpr uint64_t REXPOOL     = tools::name_value("rexpool");
+        static constexpr uint64_t REXBAL      = tools::name_value("rexbal");
+
+        bool collateral(const row &r) {
+            collateral_info c {};
+            if (!r.binary.empty()) {
+                binary_row b { r.binary };
+                if (!b.u64(0, c.id) || !b.u64(8, c.deposit_contract) || !b.u64(16, c.deposit_symbol)
+                    || !b.u64(24, c.issue_symbol))
+                    return false;
+            } else {
+                static const char *const keys[] = { "id", "deposit_contract", "deposit_symbol", "issue_symbol" };
+                std::string_view         v[4];
+                if (!json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], c.id)
+                    || !tools::parse_symbol(tools::json::unquote(v[2]), c.deposit_symbol)
+                    || !tools::parse_symbol(tools::json::unquote(v[3]), c.issue_symbol))
+                    return false;
+                c.deposit_contract = json_name(v[1]);
+            }
+            _out.collaterals.push_back(c);
+            return true;
+        }
+
+        bool release(const row &r) {
+            uint64_t id, rate, symbol;
+            int64_t  quantity;
+            if (!r.binary.empty()) {
+                binary_row b { r.binary };
+                if (!b.u64(0, id) || !b.asset(8, quantity, symbol) || !b.u64(24, rate)) return false;
+            } else {
+                static const char *const keys[] = { "id", "quantity", "rate" };
+                std::string_view         v[3];
+                if (!json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], id)
+                    || !json_asset(v[1], quantity, symbol) || !tools::json::to_uint(v[2], rate))
+                    return false;
+            }
+            auto &s = _out.shares[symbol >> 8];
+            if (_rates) {
+                auto     itr     = _rates->find(symbol >> 8);
+                uint64_t current = itr == _rates->end() ? 0 : itr->second;
+                s.pending_owed += u128(uint64_t(quantity)) * vault_math::release_rate(rate, current);
+                return true;
+            }
+            s.pending_count++;
+            s.pending_quantity += quantity;
+            s.max_locked_rate = std::max(s.max_locked_rate, rate);
+            if (rate == 0) s.zero_rate++;
+            _out.release_symbols[symbol >> 8]++;
+            _out.max_release_id = std::max(_out.max_release_id, id);
+            return true;
+        }
+
+        bool config(const row &r) {
+            uint64_t log_id;
+            if (!r.binary.empty()) {
+                // last_income_time, three status bytes, log_id
+                if (!binary_row { r.binary }.u64(11, log_id)) return false;
+            } else {
+                static const char *const keys[] = { "log_id" };
+                std::string_view         v[1];
+                if (!json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], log_id)) return false;
+            }
+            _out.has_config = true;
+            _out.log_id     = log_id;
+            return true;
+        }
+
+        bool metrics(const row &r) {
+            metrics_info m {};
+            uint64_t     symbol;
+            if (!r.binary.empty()) {
+                // collateral_id, six assets, pending_count, pending_quantity
+                binary_row b { r.binary };
+                if (!b.u64(0, m.collateral_id) || !b.u64(8 + 6 * 16, m.pending_count)
+                    || !b.asset(16 + 6 * 16, m.pending_quantity, symbol))
+                    return false;
+            } else {
+                static const char *const keys[] = { "collateral_id", "pending_count", "pending_quantity" };
+                std::string_view         v[3];
+                if (!json_fields(r.json, keys, v) || !tools::json::to_uint(v[0], m.collateral_id)
+                    || !tools::json::to_uint(v[1], m.pending_count)
+                    || !json_asset(v[2], m.pending_quantity, symbol))
+                    return false;
+            }
+            _out.metrics.push_back(m);
+            return true;
+        }
+
+        // EOS the vault holds for a queued payout, not counted as collateral
+        bool payout(const row &r) {
+            int64_t  quantity;
+            uint64_t symbol;
+            if (!r.binary.empty()) {
+                // id, to, quantity, memo
+                if (!binary_row { r.binary }.asset(16, quantity, symbol)) return false;
+            } else {
+                static const char *const keys[] = { "quantity" };
+                std::string_view         v[1];
+                if (!json_fields(r.json, keys, v) || !json_asset(v[0], quantity, symbol)) return false;
+            }
+            _out.holdings[{ _a.eos_token, symbol >> 8 }] -= quantity;
+            return true;
+        }
+
+        bool balance(const row &r, int64_t &amount, uint64_t &symbol) {
+            if (!r.binary.empty()) return binary_row { r.binary }.asset(0, amount, symbol);
+            static const char *const keys[] = { "balance" };
+            std::string_view         v[1];
+            return json_fields(r.json, keys, v) && json_asset(v[0], amount, symbol);
+        }
+
+        bool share_account(const row &r) {
+            int64_t  amount;
+            uint64_t symbol;
+            if (!balance(r, amount, symbol)) return false;
+            auto &s = _out.shares[symbol >> 8];
+            s.balances += amount;
+            s.holders++;
+            if (r.scope == _a.vault) s.vault_shares += amount;
+            return true;
+        }
+
+        bool holding(const row &r) {
+            int64_t  amount;
+            uint64_t symbol;
+            if (!balance(r, amount, symbol)) return false;
+            _out.holdings[{ r.code, symbol >> 8 }] += amount;
+            return true;
+        }
+
+        bool stat(const row &r) {
+            int64_t  supply;
+            uint64_t symbol;
+            if (!r.binary.empty()) {
+                if (!binary_row { r.binary }.asset(0, supply, symbol)) return false;
+            } else {
+                static const char *const keys[] = { "supply" };
+                std::string_view         v[1];
+                if (!json_fields(r.json, keys, v) || !json_asset(v[0], supply, symbol)) return false;
+            }
+            auto &s       = _out.shares[symbol >> 8];
+            s.has_stat    = true;
+            s.supply      = supply;
+            s.stat_symbol = symbol;
+            return true;
+        }
+
+        bool rexpool(const row &r) {
+            uint64_t symbol;
+            if (!r.binary.empty()) {
+                // version, total_lent, total_unlent, total_rent, total_lendable, total_rex
+                binary_row b { r.binary };
+                if (!b.asset(1 + 3 * 16, _out.total_lendable, symbol)
+                    || !b.asset(1 + 4 * 16, _out.total_rex, symbol))
+                    return false;
+            } else {
+                static const char *const keys[] = { "total_lendable", "total_rex" };
+                std::string_view         v[2];
+                if (!json_fields(r.json, keys, v) || !json_asset(v[0], _out.total_lendable, symbol)
+                    || !json_asset(v[1], _out.total_rex, symbol))
+                    return false;
+            }
+            _out.has_rexpool = true;
+            return true;
+        }
+
+        bool rexbal(const row &r) {
+            uint64_t owner, symbol;
+            int64_t  rex;
+            if (!r.binary.empty()) {
+                // version, owner, vote_stake, rex_balance
+                binary_row b { r.binary };
+                if (!b.u64(1, owner) || !b.asset(1 + 8 + 16, rex, symbol)) return false;
+            } else {
+                static const char *const keys[] = { "owner", "rex_balance" };
+                std::string_view         v[2];
+                if (!json_fields(r.json, keys, v) || !json_asset(v[1], rex, symbol)) return false;
+                owner = json_name(v[0]);
+            }
+            if (owner != _a.vault) {
+                _out.skipped++;
+                return true;
+            }
+            _out.has_rexbal  = true;
+            _out.rex_balance = rex;
+            return true;
+        }
+
+        const accounts_config                        &_a;
+        ledger                                       &_out;
+        const std::unordered_map<uint64_t, uint64_t> *_rates;
+    };
+
+} // namespace reconcile
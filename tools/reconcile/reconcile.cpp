@@ -0,0 +1,86 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bench.hpp>
+#include <eosio.hpp>
+#include <mapped_file.hpp>
+
+#include "reconcile.hpp"
+
+using namespace reconcile;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr, "usage: reconcile [--vault NAME] [--stoken NAME] [--threads N] DUMP...\n"
+                             "  checks the vault invariants over JSON-lines or binary table dumps,\n"
+                             "  exits with 1 when one is violated\n");
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    accounts_config          accounts;
+    unsigned                 threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--vault") && i + 1 < argc) {
+            accounts.vault = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--stoken") && i + 1 < argc) {
+            accounts.stoken = tools::name_value(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = unsigned(std::max(1, std::atoi(argv[++i])));
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::unique_ptr<tools::mapped_file>> files;
+    std::vector<buffer>                              dumps;
+    size_t                                           bytes = 0;
+    for (const auto &path : paths) {
+        files.push_back(std::make_unique<tools::mapped_file>(path));
+        if (!files.back()->ok()) {
+            std::fprintf(stderr, "reconcile: cannot map %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+        dumps.push_back(buffer { files.back()->data(), files.back()->size() });
+        bytes += files.back()->size();
+    }
+
+    tools::stopwatch timer;
+    report           r       = run(dumps, accounts, threads);
+    double           seconds = timer.seconds();
+
+    for (const auto &c : r.collaterals) {
+        std::printf("collateral %" PRIu64 " %s: holds %s owes %s, supply %s rate %" PRIu64
+                    ", %" PRIu64 " pending (%s)\n",
+                    c.info.id, tools::name_string(c.info.deposit_contract).c_str(),
+                    tools::asset_string(c.holdings, c.info.deposit_symbol).c_str(),
+                    detail::amount(i128(c.owed), c.info.deposit_symbol).c_str(),
+                    tools::asset_string(c.supply, c.info.issue_symbol).c_str(), c.rate, c.pending_count,
+                    tools::asset_string(c.pending_quantity, c.info.issue_symbol).c_str());
+    }
+    for (const auto &f : r.findings) {
+        std::printf("%s %s\n", f.violation ? "VIOLATION" : "note", f.message.c_str());
+    }
+    std::printf("%" PRIu64 " rows (%" PRIu64 " skipped), %.1f MB, %zu chunks on %u threads%s in %.3fs "
+                "(%.2f M rows/s)\n",
+                r.totals.rows, r.totals.skipped, double(bytes) / 1e6, r.chunks, threads,
+                r.second_pass ? ", two passes" : "", seconds, double(r.totals.rows) / seconds / 1e6);
+    return r.ok() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
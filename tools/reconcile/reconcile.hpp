@@ -0,0 +1,208 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <eosio.hpp>
+#include <vault_math.hpp>
+
+#include "dump.hpp"
+#include "ledger.hpp"
+
+namespace reconcile {
+
+    struct finding {
+        bool        violation;   // false: worth a look, not a broken invariant
+        std::string message;
+    };
+
+    struct collateral_report {
+        collateral_info info;
+        int64_t         holdings;   // vault balance less queued payouts, plus the value of its REX for EOS
+        int64_t         supply;
+        uint64_t        rate;
+        uint64_t        pending_count;
+        int64_t         pending_quantity;
+        // collateral the vault owes: outstanding shares at the current rate plus
+        // pending releases at max(locked rate, current rate)
+        u128 owed;
+    };
+
+    struct report {
+        ledger                         totals;
+        std::vector<collateral_report> collaterals;
+        std::vector<finding>           findings;
+        size_t                         chunks      = 0;
+        bool                           second_pass = false;
+
+        bool ok() const {
+            return std::none_of(findings.begin(), findings.end(), [](const finding &f) { return f.violation; });
+        }
+    };
+
+    struct buffer {
+        const char *data;
+        size_t      size;
+    };
+
+    namespace detail {
+
+        // fold every chunk into per-thread ledgers and merge them
+        template <typename Rates>
+        ledger fold(const std::vector<chunk> &chunks, const accounts_config &accounts, unsigned threads,
+                    const Rates *rates) {
+            std::vector<ledger>      partial(std::max(1u, threads));
+            std::atomic<size_t>      next { 0 };
+            std::vector<std::thread> workers;
+            auto                     work = [&](ledger &out) {
+                accumulator acc(accounts, out, rates);
+                for (size_t i = next++; i < chunks.size(); i = next++) {
+                    row_reader reader(chunks[i]);
+                    row        r;
+                    while (reader.next(r)) acc.add(r);
+                    out.malformed += reader.malformed();
+                }
+            };
+            for (size_t t = 1; t < partial.size(); t++) workers.emplace_back(work, std::ref(partial[t]));
+            work(partial[0]);
+            for (auto &w : workers) w.join();
+
+            for (size_t t = 1; t < partial.size(); t++) partial[0].merge(partial[t]);
+            return std::move(partial[0]);
+        }
+
+        inline std::string amount(i128 value, uint64_t symbol) {
+            if (value > i128(INT64_MAX) || value < -i128(INT64_MAX)) return "(overflow)";
+            return tools::asset_string(int64_t(value), symbol);
+        }
+
+    } // namespace detail
+
+    /**
+     * Check the solvency and bookkeeping invariants over table dumps:
+     *
+     * - stoken `stat` supply equals the sum of the stoken `accounts` rows
+     * - the vault's own share balance equals the shares queued in `releases`
+     * - `metrics` pending counters match `releases`
+     * - `config.log_id` is not behind the highest release id
+     * - the vault holds at least what it owes: outstanding shares at the
+     *   current rate plus pending releases at max(locked rate, current rate)
+     *
+     * Dumps are split into about `threads * 4` chunks read in parallel. A
+     * second pass over `releases` runs only when some release is locked above
+     * the current rate of its collateral.
+     */
+    inline report run(const std::vector<buffer> &dumps, const accounts_config &accounts, unsigned threads) {
+        std::vector<chunk> chunks;
+        for (const auto &d : dumps) {
+            auto parts = split(d.data, d.size, size_t(threads) * 4);
+            chunks.insert(chunks.end(), parts.begin(), parts.end());
+        }
+
+        report out;
+        out.chunks = chunks.size();
+        out.totals = detail::fold<std::unordered_map<uint64_t, uint64_t>>(chunks, accounts, threads, nullptr);
+        ledger &l  = out.totals;
+        auto    add = [&](bool violation, std::string message) {
+            out.findings.push_back(finding { violation, std::move(message) });
+        };
+
+        std::sort(l.collaterals.begin(), l.collaterals.end(),
+                  [](const auto &a, const auto &b) { return a.id < b.id; });
+        std::unordered_map<uint64_t, uint64_t> rates;
+        bool                                   second_pass = false;
+        for (const auto &c : l.collaterals) {
+            uint64_t code = c.issue_symbol >> 8;
+            auto    &s    = l.shares[code];
+
+            collateral_report r {};
+            r.info     = c;
+            r.holdings = 0;
+            auto held  = l.holdings.find({ c.deposit_contract, c.deposit_symbol >> 8 });
+            if (held != l.holdings.end()) r.holdings = held->second;
+            if (c.deposit_contract == accounts.eos_token && c.deposit_symbol == EOS_SYMBOL && l.has_rexbal) {
+                if (!l.has_rexpool || l.total_rex <= 0) {
+                    add(true, "vault rexbal row without a usable rexpool row");
+                } else {
+                    r.holdings += vault_math::rex_to_eos(l.rex_balance, l.total_lendable, l.total_rex);
+                }
+            }
+            r.supply           = s.supply;
+            r.rate             = vault_math::rate(uint64_t(r.holdings), s.supply);
+            r.pending_count    = s.pending_count;
+            r.pending_quantity = int64_t(s.pending_quantity);
+            rates[code]        = r.rate;
+            second_pass |= s.max_locked_rate > r.rate;
+            out.collaterals.push_back(r);
+        }
+
+        if (second_pass) {
+            out.second_pass = true;
+            ledger priced   = detail::fold(chunks, accounts, threads, &rates);
+            for (const auto &[code, s] : priced.shares) l.shares[code].pending_owed = s.pending_owed;
+        }
+
+        for (auto &r : out.collaterals) {
+            const auto &c    = r.info;
+            auto       &s    = l.shares[c.issue_symbol >> 8];
+            std::string name = "collateral " + std::to_string(c.id) + " ("
+                               + tools::symbol_code_string(c.issue_symbol >> 8) + ")";
+
+            u128 pending_owed = second_pass ? s.pending_owed : u128(uint64_t(s.pending_quantity)) * r.rate;
+            r.owed = (u128(uint64_t(std::max<i128>(0, r.supply - s.pending_quantity))) * r.rate + pending_owed)
+                     / vault_math::RATE_BASE;
+
+            if (!s.has_stat) {
+                add(true, name + ": no stoken stat row");
+            } else if (s.balances != s.supply) {
+                add(true, name + ": supply " + detail::amount(s.supply, c.issue_symbol) + " but accounts hold "
+                              + detail::amount(s.balances, c.issue_symbol));
+            }
+            if (s.vault_shares != s.pending_quantity) {
+                add(true, name + ": releases queue " + detail::amount(s.pending_quantity, c.issue_symbol)
+                              + " but the vault holds " + detail::amount(s.vault_shares, c.issue_symbol));
+            }
+            if (s.zero_rate > 0) {
+                add(true, name + ": " + std::to_string(s.zero_rate) + " release(s) locked at rate 0");
+            }
+            // truncation leaves up to one unit per release and one for the supply
+            if (r.owed > u128(uint64_t(r.holdings)) + s.pending_count + 1) {
+                add(true, name + ": holds " + detail::amount(r.holdings, c.deposit_symbol) + " but owes "
+                              + detail::amount(i128(r.owed), c.deposit_symbol));
+            }
+            for (const auto &m : l.metrics) {
+                if (m.collateral_id != c.id) continue;
+                // releases queued before `metrics` existed are not counted there
+                if (m.pending_count != s.pending_count || m.pending_quantity != s.pending_quantity) {
+                    add(false, name + ": metrics count " + std::to_string(m.pending_count) + " pending ("
+                                   + detail::amount(m.pending_quantity, c.issue_symbol) + "), releases hold "
+                                   + std::to_string(s.pending_count) + " ("
+                                   + detail::amount(s.pending_quantity, c.issue_symbol) + ")");
+                }
+            }
+        }
+
+        for (const auto &[code, count] : l.release_symbols) {
+            bool known = std::any_of(l.collaterals.begin(), l.collaterals.end(),
+                                     [&](const auto &c) { return c.issue_symbol >> 8 == code; });
+            if (!known) {
+                add(true, std::to_string(count) + " release(s) of " + tools::symbol_code_string(code)
+                              + ", which no collateral issues");
+            }
+        }
+        if (!l.has_config) {
+            add(true, "no vault config row");
+        } else if (l.log_id < l.max_release_id) {
+            add(true, "config log_id " + std::to_string(l.log_id) + " is behind release id "
+                          + std::to_string(l.max_release_id));
+        }
+        if (l.malformed > 0) {
+            add(true, std::to_string(l.malformed) + " row(s) could not be parsed");
+        }
+        return out;
+    }
+
+} // namespace reconcile
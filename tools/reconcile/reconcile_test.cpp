@@ -0,0 +1,293 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <eosio.hpp>
+#include <mapped_file.hpp>
+
+#include "reconcile.hpp"
+
+using namespace reconcile;
+
+namespace {
+
+    const uint64_t VAULT   = tools::name_value("vault.defi");
+    const uint64_t STOKEN  = tools::name_value("stoken.defi");
+    const uint64_t EOSIO   = tools::name_value("eosio");
+    const uint64_t TOKEN   = tools::name_value("eosio.token");
+    const uint64_t TETHER  = tools::name_value("tethertether");
+    const uint64_t EOS     = tools::symbol_value("EOS", 4);
+    const uint64_t SEOS    = tools::symbol_value("SEOS", 4);
+    const uint64_t USDT    = tools::symbol_value("USDT", 4);
+    const uint64_t SUSDT   = tools::symbol_value("SUSDT", 4);
+    const uint64_t REX     = tools::symbol_value("REX", 4);
+    const uint64_t RELEASE = 100400000;
+
+    struct bytes {
+        std::string out;
+
+        template <typename T>
+        bytes &put(T value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+            return *this;
+        }
+        bytes &asset(int64_t amount, uint64_t symbol) { return put(amount).put(symbol); }
+    };
+
+    std::string quote(const std::string &s) { return "\"" + s + "\""; }
+    std::string json_asset(int64_t amount, uint64_t symbol) { return quote(tools::asset_string(amount, symbol)); }
+
+    // the same rows as JSON lines and as a binary dump
+    struct dump {
+        std::string jsonl;
+
+        void add(uint64_t code, uint64_t scope, const char *table, const std::string &json, const std::string &bin) {
+            jsonl += "{\"code\":" + quote(tools::name_string(code)) + ",\"scope\":" + quote(tools::name_string(scope))
+                     + ",\"table\":" + quote(table) + ",\"data\":" + json + "}\n";
+            binary.push_back({ code, scope, tools::name_value(table), bin });
+        }
+
+        void save(const std::string &json_path, const std::string &bin_path) const {
+            std::FILE *f = std::fopen(json_path.c_str(), "wb");
+            std::fwrite(jsonl.data(), 1, jsonl.size(), f);
+            std::fclose(f);
+            dump_writer w(bin_path);
+            for (const auto &b : binary) w.write(b.code, b.scope, b.table, 0, b.data);
+        }
+
+        struct bin_row {
+            uint64_t    code, scope, table;
+            std::string data;
+        };
+        std::vector<bin_row> binary;
+    };
+
+    struct options {
+        uint64_t carol_rate   = 105263157;
+        bool     drop_bob     = false;
+        uint64_t log_id       = 3;
+        uint64_t metrics_pending = 1;
+        bool     garbage      = false;
+        bool     stray        = false;
+        int      extra_holders = 0;
+        int64_t  queued       = 0;   // EOS of a queued payout
+    };
+
+    void account(dump &d, uint64_t code, uint64_t owner, int64_t amount, uint64_t symbol) {
+        d.add(code, owner, "accounts", "{\"balance\":" + json_asset(amount, symbol) + "}",
+              bytes {}.asset(amount, symbol).out);
+    }
+
+    void release(dump &d, uint64_t owner, uint64_t id, int64_t quantity, uint64_t symbol, uint64_t rate) {
+        d.add(VAULT, owner, "releases",
+              "{\"id\":" + std::to_string(id) + ",\"quantity\":" + json_asset(quantity, symbol) + ",\"rate\":\""
+                  + std::to_string(rate) + "\",\"time\":\"2022-12-03T10:13:07.000\"}",
+              bytes {}.put(id).asset(quantity, symbol).put(rate).put(uint32_t(0)).out);
+    }
+
+    void collateral(dump &d, uint64_t id, uint64_t contract, uint64_t deposit, uint64_t issue, const char *dsym,
+                    const char *isym) {
+        d.add(VAULT, VAULT, "collaterals",
+              "{\"id\":" + std::to_string(id) + ",\"deposit_contract\":" + quote(tools::name_string(contract))
+                  + ",\"deposit_symbol\":" + quote(dsym) + ",\"issue_symbol\":" + quote(isym)
+                  + ",\"last_income\":\"0.0000 EOS\",\"income_ratio\":50}",
+              bytes {}.put(id).put(contract).put(deposit).put(issue).asset(0, deposit).out);
+    }
+
+    /**
+     * Collateral 1: EOS, 1000 liquid plus 5 in REX, 1000 SEOS issued, rate 1.005.
+     * Collateral 2: USDT, 2000 held, 1900 SUSDT issued, rate 1.05263157.
+     */
+    dump build(const options &o) {
+        dump d;
+        collateral(d, 1, TOKEN, EOS, SEOS, "4,EOS", "4,SEOS");
+        collateral(d, 2, TETHER, USDT, SUSDT, "4,USDT", "4,SUSDT");
+        d.add(VAULT, VAULT, "config",
+              "{\"last_income_time\":1669710600,\"transfer_status\":1,\"deposit_status\":1,\"withdraw_status\":1,"
+              "\"log_id\":" + std::to_string(o.log_id) + "}",
+              bytes {}.put(uint64_t(1669710600)).put(uint8_t(1)).put(uint8_t(1)).put(uint8_t(1)).put(o.log_id).out);
+
+        bytes metrics;
+        metrics.put(uint64_t(2));
+        for (int i = 0; i < 6; i++) metrics.asset(0, USDT);
+        metrics.put(o.metrics_pending).asset(1000000, SUSDT).asset(0, 0);
+        d.add(VAULT, VAULT, "metrics",
+              "{\"collateral_id\":2,\"pending_count\":" + std::to_string(o.metrics_pending)
+                  + ",\"pending_quantity\":\"100.0000 SUSDT\",\"last_rate\":105263157}",
+              metrics.out);
+
+        account(d, TOKEN, VAULT, 10000000, EOS);
+        if (o.queued) {
+            d.add(VAULT, VAULT, "payouts",
+                  "{\"id\":0,\"to\":\"dave\",\"quantity\":" + json_asset(o.queued, EOS) + ",\"memo\":\"withdraw\"}",
+                  bytes {}.put(uint64_t(0)).put(tools::name_value("dave")).asset(o.queued, EOS).put(uint8_t(8)).out
+                      + "withdraw");
+        }
+        account(d, TETHER, VAULT, 20000000, USDT);
+        // someone else's balances are ignored
+        account(d, TETHER, tools::name_value("alice"), 777, USDT);
+
+        d.add(EOSIO, EOSIO, "rexpool",
+              "{\"version\":0,\"total_lent\":\"0.0000 EOS\",\"total_unlent\":\"0.0000 EOS\",\"total_rent\":\"0.0000 "
+              "EOS\",\"total_lendable\":\"1000000.0000 EOS\",\"total_rex\":\"10000000000.0000 REX\"}",
+              bytes {}.put(uint8_t(0)).asset(0, EOS).asset(0, EOS).asset(0, EOS).asset(10000000000, EOS)
+                  .asset(100000000000000, REX).out);
+        d.add(EOSIO, EOSIO, "rexbal",
+              "{\"version\":0,\"owner\":\"vault.defi\",\"vote_stake\":\"0.0000 EOS\",\"rex_balance\":\"50000.0000 "
+              "REX\",\"matured_rex\":0,\"rex_maturities\":[{\"first\":\"2022-12-01T00:00:00\",\"second\":1}]}",
+              bytes {}.put(uint8_t(0)).put(VAULT).asset(0, EOS).asset(500000000, REX).put(int64_t(0)).out);
+        d.add(EOSIO, EOSIO, "rexbal",
+              "{\"version\":0,\"owner\":\"alice\",\"vote_stake\":\"0.0000 EOS\",\"rex_balance\":\"1.0000 REX\"}",
+              bytes {}.put(uint8_t(0)).put(tools::name_value("alice")).asset(0, EOS).asset(10000, REX).out);
+
+        d.add(STOKEN, tools::name_value("SEOS"), "stat",
+              "{\"supply\":\"1000.0000 SEOS\",\"max_supply\":\"1000000000.0000 SEOS\",\"issuer\":\"vault.defi\"}",
+              bytes {}.asset(10000000, SEOS).asset(10000000000000, SEOS).put(VAULT).out);
+        d.add(STOKEN, tools::name_value("SUSDT"), "stat",
+              "{\"supply\":" + json_asset(19000000 + o.extra_holders, SUSDT)
+                  + ",\"max_supply\":\"1000000000.0000 SUSDT\",\"issuer\":\"vault.defi\"}",
+              bytes {}.asset(19000000 + o.extra_holders, SUSDT).asset(10000000000000, SUSDT).put(VAULT).out);
+
+        account(d, STOKEN, tools::name_value("alice"), 6000000, SEOS);
+        if (!o.drop_bob) account(d, STOKEN, tools::name_value("bob"), 3000000, SEOS);
+        account(d, STOKEN, VAULT, 1000000, SEOS);
+        account(d, STOKEN, tools::name_value("carol"), 18000000, SUSDT);
+        account(d, STOKEN, VAULT, 1000000, SUSDT);
+        for (int i = 0; i < o.extra_holders; i++) {
+            account(d, STOKEN, tools::name_value("holder") + uint64_t(i + 1), 1, SUSDT);
+        }
+
+        release(d, tools::name_value("alice"), 1, 600000, SEOS, 100000000);
+        release(d, tools::name_value("bob"), 2, 400000, SEOS, RELEASE);
+        release(d, tools::name_value("carol"), 3, 1000000, SUSDT, o.carol_rate);
+        if (o.stray) release(d, tools::name_value("dave"), 3, 5, tools::symbol_value("SBTC", 8), 100000000);
+
+        if (o.garbage) {
+            d.jsonl += "{\"code\":\"vault.defi\",\"scope\":\"alice\",\"table\":\"releases\",\"data\":{\"id\":4}}\n";
+            d.binary.push_back({ VAULT, tools::name_value("alice"), tools::name_value("releases"), "xx" });
+        }
+        return d;
+    }
+
+    struct result {
+        report json;
+        report binary;
+    };
+
+    result check(const dump &d, const std::string &dir, unsigned threads) {
+        std::string json_path = dir + ".jsonl", bin_path = dir + ".bin";
+        d.save(json_path, bin_path);
+        tools::mapped_file jf(json_path), bf(bin_path);
+        accounts_config    accounts;
+        result             r { run({ buffer { jf.data(), jf.size() } }, accounts, threads),
+                   run({ buffer { bf.data(), bf.size() } }, accounts, threads) };
+        std::remove(json_path.c_str());
+        std::remove(bin_path.c_str());
+
+        // both formats must agree
+        CHECK(r.json.totals.rows == r.binary.totals.rows);
+        CHECK(r.json.findings.size() == r.binary.findings.size());
+        CHECK(r.json.collaterals.size() == r.binary.collaterals.size());
+        for (size_t i = 0; i < r.json.collaterals.size() && i < r.binary.collaterals.size(); i++) {
+            CHECK(r.json.collaterals[i].holdings == r.binary.collaterals[i].holdings);
+            CHECK(r.json.collaterals[i].owed == r.binary.collaterals[i].owed);
+        }
+        return r;
+    }
+
+    bool has(const report &r, const char *text, bool violation = true) {
+        for (const auto &f : r.findings) {
+            if (f.violation == violation && f.message.find(text) != std::string::npos) return true;
+        }
+        return false;
+    }
+
+    void test_consistent(const std::string &path) {
+        auto r = check(build({}), path, 4).json;
+        CHECK(r.ok());
+        CHECK(r.findings.empty());
+        CHECK(!r.second_pass);
+        CHECK(r.totals.malformed == 0);
+        CHECK(r.collaterals.size() == 2);
+        if (r.collaterals.size() != 2) return;
+
+        const auto &eos = r.collaterals[0];
+        CHECK(eos.holdings == 10050000);
+        CHECK(eos.rate == 100500000);
+        CHECK(eos.pending_count == 2 && eos.pending_quantity == 1000000);
+        CHECK(eos.owed == 10050000);
+
+        const auto &usdt = r.collaterals[1];
+        CHECK(usdt.holdings == 20000000);
+        CHECK(usdt.rate == 105263157);
+        CHECK(usdt.owed <= 20000000);
+
+        // EOS owed to a queued payout is still in the balance but not the depositors'
+        options queued;
+        queued.queued = 10000;
+        r             = check(build(queued), path, 2).binary;
+        CHECK(r.ok() && r.totals.malformed == 0 && r.collaterals.size() == 2);
+        if (r.collaterals.size() == 2) CHECK(r.collaterals[0].holdings == 10040000 && r.collaterals[0].rate == 100400000);
+    }
+
+    void test_violations(const std::string &path) {
+        options locked;
+        locked.carol_rate = 120000000;
+        auto r            = check(build(locked), path, 2).binary;
+        CHECK(!r.ok() && r.second_pass);
+        CHECK(has(r, "collateral 2 (SUSDT): holds 2000.0000 USDT but owes 2014.7368 USDT"));
+
+        options missing;
+        missing.drop_bob = true;
+        r                = check(build(missing), path, 2).json;
+        CHECK(has(r, "supply 1000.0000 SEOS but accounts hold 700.0000 SEOS"));
+
+        options behind;
+        behind.log_id = 2;
+        CHECK(has(check(build(behind), path, 1).json, "log_id 2 is behind release id 3"));
+
+        options stray;
+        stray.stray = true;
+        CHECK(has(check(build(stray), path, 1).binary, "release(s) of SBTC"));
+
+        options garbage;
+        garbage.garbage = true;
+        auto g          = check(build(garbage), path, 3);
+        CHECK(has(g.json, "1 row(s) could not be parsed"));
+        CHECK(has(g.binary, "1 row(s) could not be parsed"));
+
+        // metrics may lag behind releases queued before the table existed
+        options metrics;
+        metrics.metrics_pending = 4;
+        r                       = check(build(metrics), path, 1).json;
+        CHECK(r.ok());
+        CHECK(has(r, "metrics count 4 pending", false));
+    }
+
+    // many rows across many chunks, every thread count gives the same totals
+    void test_parallel(const std::string &path) {
+        options many;
+        many.extra_holders = 200000;
+        // the extra shares dilute the rate, keep carol's release below it
+        many.carol_rate = 100000000;
+        auto one           = check(build(many), path, 1);
+        auto eight         = check(build(many), path, 8);
+        CHECK(one.json.ok() && eight.json.ok() && one.binary.ok() && eight.binary.ok());
+        CHECK(eight.binary.chunks > 8);
+        CHECK(one.binary.totals.rows == eight.binary.totals.rows);
+        CHECK(one.json.totals.rows == 200000 + 20);
+        CHECK(eight.json.collaterals[1].supply == 19000000 + 200000);
+    }
+
+} // namespace
+
+int main() {
+    std::string path = std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp")
+                       + "/reconcile_test." + std::to_string(::getpid());
+    test_consistent(path);
+    test_violations(path);
+    test_parallel(path);
+    return tools::check_report("reconcile_test");
+}
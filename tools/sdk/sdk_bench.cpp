@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <vector>
+
+#include <bench.hpp>
+#include <rng.hpp>
+
+#include "vault_sdk.hpp"
+
+namespace {
+
+    namespace sdk = vault_sdk;
+
+    struct input {
+        sdk::collateral_state state;
+        int64_t               amount;
+        uint64_t              locked_rate;
+    };
+
+    template <typename F>
+    void run(const char *name, const std::vector<input> &inputs, uint64_t rounds, F &&f) {
+        tools::stopwatch timer;
+        for (uint64_t round = 0; round < rounds; round++) {
+            for (const auto &in : inputs) {
+                tools::do_not_optimize(f(in));
+            }
+        }
+        tools::report(name, rounds * inputs.size(), timer.seconds());
+    }
+
+} // namespace
+
+// quotes per second on random vault states, half of them the EOS collateral with its REX
+int main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+
+    tools::rng         rng(42);
+    std::vector<input> inputs(1 << 16);
+    for (auto &in : inputs) {
+        auto &s          = in.state;
+        s.rex            = rng.range(0, 1) == 1;
+        s.deposit_symbol = s.rex ? sdk::EOS : sdk::symbol("USDT", 4);
+        s.issue_symbol   = sdk::issue_symbol(s.deposit_symbol);
+        s.release_fees   = uint16_t(rng.range(0, 100));
+        s.refund_ratio   = uint16_t(rng.range(0, 10000));
+        s.balance        = int64_t(rng.magnitude(50));
+        s.supply         = int64_t(rng.range(1, 1ULL << 50));
+        s.rex_balance    = int64_t(rng.magnitude(50));
+        s.total_lendable = int64_t(rng.range(1, 1ULL << 45));
+        s.total_rex      = int64_t(rng.range(1, 1ULL << 55));
+        s.queued_eos     = int64_t(rng.magnitude(20));
+        in.amount        = int64_t(rng.magnitude(45));
+        in.locked_rate   = rng.range(vault_math::RATE_BASE, 3 * vault_math::RATE_BASE);
+    }
+
+    run("quote_deposit", inputs, rounds, [](const input &in) { return sdk::quote_deposit(in.state, in.amount).issued; });
+    run("quote_withdraw", inputs, rounds, [](const input &in) {
+        return sdk::quote_withdraw(in.state, in.amount).paid.withdraw;
+    });
+    run("quote_release", inputs, rounds, [](const input &in) {
+        auto q = sdk::quote_release(in.state, in.amount, in.locked_rate);
+        return q.paid.withdraw + q.paid.refund.sys;
+    });
+    run("pack_deposit transaction", inputs, rounds / 4 + 1, [](const input &in) {
+        char        buffer[160];
+        sdk::writer w(buffer, sizeof(buffer));
+        sdk::pack_transaction_begin(w, {}, 1);
+        sdk::pack_deposit(w, sdk::EOS_TOKEN, sdk::name(uint64_t(in.amount)), { in.amount, in.state.deposit_symbol });
+        sdk::pack_transaction_end(w);
+        tools::do_not_optimize(buffer);
+        return w.size();
+    });
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <mapped_file.hpp>
+
+#include <eosio/multi_index.hpp>
+#include <eosio/native/chain.hpp>
+#include <tables.hpp>
+
+#include <scenario.hpp>
+
+#include "vault_sdk.hpp"
+
+// heap allocations while `counting` is set, the SDK must make none
+static std::atomic<bool>     counting { false };
+static std::atomic<uint64_t> allocations { 0 };
+
+void *operator new(size_t size) {
+    if (counting) allocations++;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+using namespace eosio::literals;
+using eosio::native::action_data;
+using eosio::native::chain;
+
+namespace {
+
+    namespace sdk = vault_sdk;
+
+    std::vector<char> bytes(const sdk::writer &w) { return std::vector<char>(w.data(), w.data() + w.size()); }
+
+    template <typename F>
+    std::vector<char> packed(F &&f) {
+        char       buffer[512];
+        sdk::writer w(buffer, sizeof(buffer));
+        f(w);
+        CHECK(w.ok());
+        return bytes(w);
+    }
+
+    const sdk::name   owner { std::string_view("user.a") };
+    const sdk::symbol usdt { "USDT", 4 };
+
+    // the action data of the SDK is what the contracts' own action tables encode from JSON
+    void test_action_data() {
+        struct expectation {
+            native_contracts::encode_fn encode;
+            const char                 *action;
+            const char                 *json;
+            std::vector<char>           sdk;
+        };
+        const expectation cases[] = {
+            { native_contracts::token_encode, "transfer", "[\"user.a\", \"vault.defi\", \"1.2345 EOS\", \"memo\"]",
+              packed([](auto &w) { sdk::data::transfer(w, owner, sdk::VAULT, { 12345, sdk::EOS }, "memo"); }) },
+            { native_contracts::stoken_encode, "transfer", "[\"user.a\", \"vault.defi\", \"0.0001 SEOS\", \"\"]",
+              packed([](auto &w) { sdk::data::transfer(w, owner, sdk::VAULT, { 1, sdk::issue_symbol(sdk::EOS) }, ""); }) },
+            { native_contracts::stoken_encode, "open", "[\"user.a\", \"4,SEOS\", \"user.a\"]",
+              packed([](auto &w) { sdk::data::open(w, owner, sdk::symbol("SEOS", 4), owner); }) },
+            { native_contracts::stoken_encode, "close", "[\"user.a\", \"4,SUSDT\"]",
+              packed([](auto &w) { sdk::data::close(w, owner, sdk::issue_symbol(usdt)); }) },
+            { native_contracts::vault_encode, "release", "[\"user.a\"]",
+              packed([](auto &w) { sdk::data::release(w, owner); }) },
+            { native_contracts::vault_encode, "income", "[]", packed([](auto &w) { sdk::data::income(w); }) },
+            { native_contracts::vault_encode, "payout", "[]", packed([](auto &w) { sdk::data::payout(w); }) },
+            { native_contracts::vault_encode, "getapy", "[7]", packed([](auto &w) { sdk::data::getapy(w, 7); }) },
+            { native_contracts::vault_encode, "getram", "[]", packed([](auto &w) { sdk::data::getram(w); }) },
+            { native_contracts::vault_encode, "planrelease", "[\"user.a\"]",
+              packed([](auto &w) { sdk::data::planrelease(w, owner); }) },
+            { native_contracts::vault_encode, "planwithdraw", "[\"user.a\", \"10.0000 SUSDT\"]",
+              packed([](auto &w) { sdk::data::planwithdraw(w, owner, { 100000, sdk::issue_symbol(usdt) }); }) },
+            { native_contracts::vault_encode, "updatestatus", "[1, 0, 1]",
+              packed([](auto &w) { sdk::data::updatestatus(w, 1, 0, 1); }) },
+            { native_contracts::vault_encode, "createcoll",
+              "[\"tethertether\", \"4,USDT\", \"award.defi\", \"vfees.defi\", \"0.1000 USDT\", 50, 30, 5000]",
+              packed([](auto &w) {
+                  sdk::data::createcoll(w, sdk::name(std::string_view("tethertether")), usdt,
+                                        sdk::name(std::string_view("award.defi")),
+                                        sdk::name(std::string_view("vfees.defi")), { 1000, usdt }, 50, 30, 5000);
+              }) },
+            { native_contracts::vault_encode, "updatecoll",
+              "[2, \"award.defi\", \"vfees.defi\", \"1.0000 USDT\", 100, 50, 4000]",
+              packed([](auto &w) {
+                  sdk::data::updatecoll(w, 2, sdk::name(std::string_view("award.defi")),
+                                        sdk::name(std::string_view("vfees.defi")), { 10000, usdt }, 100, 50, 4000);
+              }) },
+            { native_contracts::vault_encode, "proxyto", "[\"proxy.a\"]",
+              packed([](auto &w) { sdk::data::proxyto(w, sdk::name(std::string_view("proxy.a"))); }) },
+            { native_contracts::vault_encode, "buyallrex", "[]", packed([](auto &w) { sdk::data::buyallrex(w); }) },
+            { native_contracts::vault_encode, "buyrex", "[\"3.0000 EOS\"]",
+              packed([](auto &w) { sdk::data::buyrex(w, { 30000, sdk::EOS }); }) },
+            { native_contracts::vault_encode, "sellallrex", "[]", packed([](auto &w) { sdk::data::sellallrex(w); }) },
+            { native_contracts::vault_encode, "sellrex", "[\"5.0000 REX\"]",
+              packed([](auto &w) { sdk::data::sellrex(w, { 50000, sdk::symbol("REX", 4) }); }) },
+            { native_contracts::vault_encode, "setramstat", "[\"vault.defi\", \"releases\", 812, 1904, 68544]",
+              packed([](auto &w) {
+                  sdk::data::setramstat(w, sdk::VAULT, sdk::name(std::string_view("releases")), 812, 1904, 68544);
+              }) },
+        };
+        for (const auto &c : cases) {
+            bool same = c.encode(eosio::name(c.action), c.json) == c.sdk;
+            CHECK(same);
+            if (!same) std::fprintf(stderr, "sdk_test: %s %s\n", c.action, c.json);
+        }
+    }
+
+    // actions and transactions in the layout of the chain's own types
+    void test_transaction() {
+        sdk::asset quantity { 12345, sdk::EOS };
+        auto       deposit = packed([&](auto &w) { sdk::pack_deposit(w, sdk::EOS_TOKEN, owner, quantity, "hi"); });
+        action_data expected { "eosio.token"_n, "transfer"_n, { eosio::permission_level("user.a"_n, "active"_n) },
+                               native_contracts::token_encode("transfer"_n,
+                                                              "[\"user.a\", \"vault.defi\", \"1.2345 EOS\", \"hi\"]") };
+        CHECK(deposit == eosio::pack(expected));
+
+        auto        release = packed([&](auto &w) { sdk::pack_release(w, owner); });
+        action_data released { "vault.defi"_n, "release"_n, { eosio::permission_level("user.a"_n, "active"_n) },
+                               native_contracts::vault_encode("release"_n, "[\"user.a\"]") };
+        CHECK(release == eosio::pack(released));
+
+        // a header with a varuint over one byte
+        sdk::transaction_header header { 1700000000, 0x1234, 0xdeadbeef, 300, 20, 0 };
+        auto trx = packed([&](auto &w) {
+            sdk::pack_transaction_begin(w, header, 2);
+            sdk::pack_deposit(w, sdk::EOS_TOKEN, owner, quantity, "hi");
+            sdk::pack_release(w, owner);
+            sdk::pack_transaction_end(w);
+        });
+        auto reference = eosio::pack(std::make_tuple(
+            header.expiration, header.ref_block_num, header.ref_block_prefix,
+            eosio::unsigned_int(header.max_net_usage_words), header.max_cpu_usage_ms, eosio::unsigned_int(header.delay_sec),
+            std::vector<action_data> {}, std::vector<action_data> { expected, released },
+            std::vector<std::pair<uint16_t, std::vector<char>>> {}));
+        CHECK(trx == reference);
+
+        // too small a buffer: nothing past it is written, the size needed is reported
+        char        small[16] = {};
+        sdk::writer w(small, sizeof(small));
+        sdk::pack_release(w, owner);
+        CHECK(!w.ok() && w.size() == release.size());
+        sdk::writer sizer;
+        sdk::pack_release(sizer, owner);
+        CHECK(sizer.ok() && sizer.size() == release.size());
+    }
+
+    struct collateral_row {
+        uint64_t      id;
+        eosio::name   deposit_contract;
+        eosio::symbol deposit_symbol;
+        eosio::symbol issue_symbol;
+        uint16_t      income_ratio;
+        eosio::name   income_account;
+        eosio::asset  min_quantity;
+        eosio::name   fees_account;
+        uint16_t      release_fees;
+        uint16_t      refund_ratio;
+        uint64_t      primary_key() const { return id; }
+    };
+    using collaterals = eosio::multi_index<"collaterals"_n, collateral_row>;
+
+    struct config_row {
+        uint64_t last_income_time;
+        uint8_t  transfer_status;
+        uint8_t  deposit_status;
+        uint8_t  withdraw_status;
+        uint64_t log_id;
+        uint64_t primary_key() const { return "config"_n.value; }
+    };
+    using configs = eosio::multi_index<"config"_n, config_row>;
+
+    struct payout_row {
+        uint64_t     id;
+        eosio::name  to;
+        eosio::asset quantity;
+        std::string  memo;
+        uint64_t     primary_key() const { return id; }
+    };
+    using payouts = eosio::multi_index<"payouts"_n, payout_row>;
+
+    struct release_row {
+        uint64_t     id;
+        eosio::asset quantity;
+        uint64_t     rate;
+        uint32_t     time;
+        uint64_t     primary_key() const { return id; }
+    };
+    using releases = eosio::multi_index<"releases"_n, release_row>;
+
+    int64_t balance(eosio::name token, eosio::name account, eosio::symbol sym) {
+        accounts t(token, account.value);
+        auto     itr = t.find(sym.code().raw());
+        return itr == t.end() ? 0 : itr->balance.amount;
+    }
+
+    // the state of the collateral of `sym`, read as a client reads it from the chain
+    sdk::collateral_state state_of(eosio::symbol sym) {
+        const eosio::name vault = "vault.defi"_n;
+        collaterals       collateraltbl(vault, vault.value);
+        auto              row = collateraltbl.begin();
+        while (row != collateraltbl.end() && row->deposit_symbol != sym) row++;
+        CHECK(row != collateraltbl.end());
+
+        sdk::collateral_state s;
+        s.deposit_symbol = sdk::symbol(row->deposit_symbol.raw());
+        s.issue_symbol   = sdk::symbol(row->issue_symbol.raw());
+        s.min_quantity   = row->min_quantity.amount;
+        s.release_fees   = row->release_fees;
+        s.refund_ratio   = row->refund_ratio;
+        const auto cfg   = configs(vault, vault.value).get("config"_n.value);
+        s.deposit_open   = cfg.deposit_status == 1;
+        s.withdraw_open  = cfg.withdraw_status == 1;
+        s.balance        = balance(row->deposit_contract, vault, sym);
+        s.supply         = stats("stoken.defi"_n, row->issue_symbol.code().raw()).get(row->issue_symbol.code().raw()).supply.amount;
+
+        s.rex = row->deposit_contract == "eosio.token"_n && sym == eosio::symbol("EOS", 4);
+        if (s.rex) {
+            rex_balance_view_table rexbal("eosio"_n, "eosio"_n.value);
+            auto                   bal = rexbal.find(vault.value);
+            s.rex_balance              = bal == rexbal.end() ? 0 : bal->rex_balance;
+            const auto pool            = *rex_pool_table("eosio"_n, "eosio"_n.value).begin();
+            s.total_lendable           = pool.total_lendable.amount;
+            s.total_rex                = pool.total_rex.amount;
+            for (const auto &p : payouts(vault, vault.value)) s.queued_eos += p.quantity.amount;
+        }
+        return s;
+    }
+
+    // the push of SDK-packed action data, false when it fails
+    bool push(chain &c, eosio::name account, eosio::name act, eosio::name actor, std::vector<char> data) {
+        try {
+            c.push_action(action_data { account, act, { eosio::permission_level(actor, "active"_n) }, std::move(data) });
+            return true;
+        } catch (const std::exception &e) {
+            std::fprintf(stderr, "sdk_test: %s: %s\n", act.to_string().c_str(), e.what());
+            return false;
+        }
+    }
+
+    uint64_t last_release_rate(eosio::name owner) {
+        releases t("vault.defi"_n, owner.value);
+        uint64_t rate = 0;
+        for (const auto &r : t) rate = r.rate;
+        return rate;
+    }
+
+    /**
+     * Quotes are what the contract then does: the tokens a deposit issues, the rate a
+     * withdraw locks in, and what a release pays. `token` is the collateral's contract,
+     * `owner` holds some of it.
+     */
+    void test_quotes(const std::filesystem::path &path, eosio::name token, eosio::symbol sym, eosio::name owner,
+                     bool release) {
+        native_scenario::scenario sc;
+        tools::mapped_file        file(path.string());
+        CHECK(file.ok() && native_scenario::load(std::string_view(file.data(), file.size()), sc).empty());
+        chain c;
+        c.make_current();
+        native_scenario::run(sc, c);
+
+        const sdk::name    who(owner.value);
+        const eosio::name  vault = "vault.defi"_n, stoken = "stoken.defi"_n;
+        const eosio::symbol issued(eosio::symbol_code("S" + sym.code().to_string()), sym.precision());
+
+        // a deposit
+        auto    s       = state_of(sym);
+        int64_t amount  = 1234567;
+        auto    deposit = sdk::quote_deposit(s, amount);
+        CHECK(!deposit.error && deposit.issued > 0);
+        int64_t before = balance(stoken, owner, issued);
+        CHECK(push(c, token, "transfer"_n, owner,
+                   packed([&](auto &w) { sdk::data::transfer(w, who, sdk::VAULT, { amount, s.deposit_symbol }, ""); })));
+        CHECK(balance(stoken, owner, issued) - before == deposit.issued);
+        CHECK(sdk::quote_deposit(state_of(sym), s.min_quantity - 1).error == std::string("deposit too small"));
+
+        // a withdraw
+        releases pending(vault, owner.value);
+        CHECK(pending.begin() == pending.end());
+        s               = state_of(sym);
+        int64_t quantity = deposit.issued / 3;
+        auto    withdraw = sdk::quote_withdraw(s, quantity);
+        CHECK(!withdraw.error && withdraw.paid.withdraw > 0);
+        CHECK(push(c, stoken, "transfer"_n, owner,
+                   packed([&](auto &w) { sdk::data::transfer(w, who, sdk::VAULT, { quantity, s.issue_symbol }, ""); })));
+        CHECK(last_release_rate(owner) == withdraw.rate);
+        if (!release) return;
+
+        // and its release, the rate up since: the fees and the refund go to their accounts
+        collaterals collateraltbl(vault, vault.value);
+        auto        coll = collateraltbl.begin();
+        while (coll->deposit_symbol != sym) coll++;
+        eosio::name income_account = coll->income_account, fees_account = coll->fees_account;
+        c.add_time(eosio::seconds(5 * 86400 + 1));
+        CHECK(native_scenario::run_step(sc, { vault, "income"_n, { vault }, "[]", {}, 0 }, c).ok);
+        s             = state_of(sym);
+        auto quote    = sdk::quote_release(s, quantity, withdraw.rate);
+        CHECK(!quote.error && quote.rate > withdraw.rate && quote.paid.refund.award > 0);
+        int64_t owner0 = balance(token, owner, sym), income0 = balance(token, income_account, sym),
+                fees0  = balance(token, fees_account, sym);
+        CHECK(push(c, vault, "release"_n, owner, packed([&](auto &w) { sdk::data::release(w, who); })));
+        CHECK(balance(token, owner, sym) - owner0 == quote.paid.withdraw);
+        CHECK(balance(token, income_account, sym) - income0 == quote.paid.fees.award + quote.paid.refund.award);
+        CHECK(balance(token, fees_account, sym) - fees0 == quote.paid.fees.sys + quote.paid.refund.sys);
+    }
+
+    // quotes and packing run on the stack alone
+    void test_no_allocation() {
+        sdk::collateral_state s;
+        s.deposit_symbol = sdk::EOS;
+        s.issue_symbol   = sdk::issue_symbol(sdk::EOS);
+        s.rex            = true;
+        s.balance        = 1000000;
+        s.supply         = 900000;
+        s.rex_balance    = 50000000;
+        s.total_lendable = 7000000;
+        s.total_rex      = 60000000000;
+
+        char     buffer[256];
+        uint64_t sum = 0;
+        counting     = true;
+        for (int64_t i = 1; i <= 1000; i++) {
+            sum += uint64_t(sdk::quote_deposit(s, i * 1000).issued);
+            sum += uint64_t(sdk::quote_release(s, i, vault_math::RATE_BASE).paid.withdraw);
+            sdk::writer w(buffer, sizeof(buffer));
+            sdk::pack_transaction_begin(w, {}, 1);
+            sdk::pack_deposit(w, sdk::EOS_TOKEN, owner, { i, sdk::EOS }, "deposit");
+            sdk::pack_transaction_end(w);
+            sum += w.size();
+        }
+        counting = false;
+        CHECK(sum > 0 && allocations == 0);
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    test_action_data();
+    test_transaction();
+    test_no_allocation();
+    CHECK(argc > 1);
+    if (argc > 1) {
+        std::filesystem::path dir(argv[1]);
+        test_quotes(dir / "eos.json", "eosio.token"_n, eosio::symbol("EOS", 4), "user.b"_n, false);
+        test_quotes(dir / "usdt.json", "tethertether"_n, eosio::symbol("USDT", 4), "account1"_n, true);
+    }
+    return tools::check_report("sdk_test");
+}
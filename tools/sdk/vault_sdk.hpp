@@ -0,0 +1,338 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <eosio.hpp>
+#include <vault_math.hpp>
+
+/**
+ * Client SDK of the vault for exchanges and wallets: quotes of deposits,
+ * withdraws and releases, and the binary action data and transactions that
+ * make them. Header-only and allocation-free.
+ *
+ * Quotes run the formulas of `vault_math.hpp`, the header the contract is
+ * built from, on a `collateral_state` read from the chain tables, so a quote
+ * is what the contract computes from the same state, to the last unit.
+ *
+ * Actions are packed into a caller buffer in the layout nodeos expects, no
+ * ABI needed. The packed transaction is what gets signed: sha256 of the
+ * chain id, the transaction and 32 zero bytes, left to the client's keys.
+ *
+ *     char           buffer[256];
+ *     vault_sdk::writer w(buffer, sizeof(buffer));
+ *     vault_sdk::pack_transaction_begin(w, header, 1);
+ *     vault_sdk::pack_deposit(w, vault_sdk::EOS_TOKEN, owner, { 10000, vault_sdk::EOS });
+ *     vault_sdk::pack_transaction_end(w);
+ *     // w.ok(): buffer holds w.size() bytes, else w.size() is the size needed
+ */
+namespace vault_sdk {
+
+    struct name {
+        uint64_t value = 0;
+
+        constexpr name() = default;
+        constexpr explicit name(uint64_t v) : value(v) {}
+        constexpr explicit name(std::string_view str) : value(tools::name_value(str)) {}
+
+        friend constexpr bool operator==(name a, name b) { return a.value == b.value; }
+        friend constexpr bool operator!=(name a, name b) { return a.value != b.value; }
+    };
+
+    struct symbol {
+        uint64_t value = 0;
+
+        constexpr symbol() = default;
+        constexpr explicit symbol(uint64_t v) : value(v) {}
+        constexpr symbol(std::string_view code, uint8_t precision) : value(tools::symbol_value(code, precision)) {}
+
+        constexpr uint8_t precision() const { return uint8_t(value & 0xff); }
+
+        friend constexpr bool operator==(symbol a, symbol b) { return a.value == b.value; }
+        friend constexpr bool operator!=(symbol a, symbol b) { return a.value != b.value; }
+    };
+
+    struct asset {
+        int64_t amount = 0;
+        symbol  sym;
+    };
+
+    struct permission_level {
+        name actor;
+        name permission { std::string_view("active") };
+    };
+
+    inline constexpr name   VAULT { std::string_view("vault.defi") };
+    inline constexpr name   STOKEN { std::string_view("stoken.defi") };
+    inline constexpr name   EOS_TOKEN { std::string_view("eosio.token") };
+    inline constexpr symbol EOS { "EOS", 4 };
+
+    // the symbol the vault issues for `deposit`: "S" and the code, same precision
+    constexpr symbol issue_symbol(symbol deposit) {
+        return symbol((((deposit.value >> 8) << 8 | 'S') << 8) | deposit.precision());
+    }
+
+    // ---------------------------------------------------------------------
+    // quotes
+
+    /**
+     * What a quote depends on, one read of each table:
+     *
+     * - `collaterals` row: the symbols, `min_quantity`, `release_fees`, `refund_ratio`
+     * - `config`: `deposit_status` and `withdraw_status` (1 open)
+     * - the vault's balance of the deposit token, the `stat` supply of the issued one
+     * - the EOS collateral only: the vault's `rexbal` row, `rexpool`, and the EOS
+     *   owed to the `payouts` queue, which is in the balance but no longer the depositors'
+     */
+    struct collateral_state {
+        symbol   deposit_symbol;
+        symbol   issue_symbol;
+        int64_t  min_quantity = 0;
+        uint16_t release_fees = 0;
+        uint16_t refund_ratio = 0;
+        bool     deposit_open  = true;
+        bool     withdraw_open = true;
+        int64_t  balance = 0;
+        int64_t  supply  = 0;
+
+        bool    rex            = false;
+        int64_t rex_balance    = 0;   // 0 without a `rexbal` row
+        int64_t total_lendable = 0;
+        int64_t total_rex      = 0;
+        int64_t queued_eos     = 0;
+    };
+
+    // `rate_with` of the contract: the rate as if `adjust` more were held
+    constexpr uint64_t rate(const collateral_state &s, int64_t adjust = 0) {
+        if (s.rex) {
+            uint64_t rex_eos = s.rex_balance == 0
+                                   ? 0
+                                   : uint64_t(vault_math::rex_to_eos(s.rex_balance, s.total_lendable, s.total_rex));
+            return vault_math::rate(vault_math::total_with(s.balance, rex_eos, adjust - s.queued_eos), s.supply);
+        }
+        return vault_math::rate(vault_math::total_with(s.balance + adjust, 0, 0), s.supply);
+    }
+
+    // `error` is the assertion the action would fail with, null when it goes through
+    struct deposit_quote {
+        const char *error  = nullptr;
+        uint64_t    rate   = 0;
+        int64_t     issued = 0;
+    };
+
+    struct release_quote {
+        const char                *error = nullptr;
+        uint64_t                   rate  = 0;   // locked into the release row by a withdraw, paid at by a release
+        vault_math::release_result paid {};
+    };
+
+    // a transfer of `amount` to the vault, on the state before it lands
+    constexpr deposit_quote quote_deposit(const collateral_state &s, int64_t amount) {
+        if (!s.deposit_open) return { "deposit has been suspended" };
+        if (amount < s.min_quantity) return { "deposit too small" };
+        // the contract reads the balance after the transfer and takes `amount` back out
+        deposit_quote q { nullptr, rate(s, 0), 0 };
+        // the issue division traps on chain once the collateral is worth nothing
+        if (q.rate == 0) return { "vault rate is zero" };
+        q.issued = int64_t(vault_math::issue_amount(amount, q.rate));
+        return q;
+    }
+
+    // a transfer of `quantity` issued tokens to the vault: the rate of the release row it
+    // adds, and what that release pays if the rate has not moved when it matures
+    constexpr release_quote quote_withdraw(const collateral_state &s, int64_t quantity) {
+        if (!s.withdraw_open) return { "withdraw has been suspended" };
+        uint64_t r = rate(s, 0);
+        return { nullptr, r, vault_math::release(quantity, r, r, s.release_fees, s.refund_ratio) };
+    }
+
+    // `release` of a matured row of `quantity` locked at `locked_rate`
+    constexpr release_quote quote_release(const collateral_state &s, int64_t quantity, uint64_t locked_rate) {
+        if (!s.withdraw_open) return { "withdraw has been suspended" };
+        uint64_t r = rate(s, 0);
+        return { nullptr, vault_math::release_rate(locked_rate, r),
+                 vault_math::release(quantity, locked_rate, r, s.release_fees, s.refund_ratio) };
+    }
+
+    // ---------------------------------------------------------------------
+    // packing
+
+    /**
+     * Writes into a caller buffer and never allocates. A write that does not fit
+     * clears `ok()` but is still counted, so `size()` is then the size needed.
+     * Without a buffer it only counts.
+     */
+    class writer {
+      public:
+        constexpr writer() = default;
+        writer(char *buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {}
+
+        void write(const void *data, size_t size) {
+            if (_buffer && _size + size <= _capacity) {
+                std::memcpy(_buffer + _size, data, size);
+            } else if (_buffer) {
+                _overflow = true;
+            }
+            _size += size;
+        }
+
+        template <typename T>
+        void write_le(T value) {
+            char bytes[sizeof(T)];
+            for (size_t i = 0; i < sizeof(T); i++) bytes[i] = char(uint64_t(value) >> (8 * i));
+            write(bytes, sizeof(T));
+        }
+
+        void write_varuint32(uint32_t value) {
+            char   bytes[5];
+            size_t n = 0;
+            do {
+                uint8_t b = value & 0x7f;
+                value >>= 7;
+                bytes[n++] = char(b | (value > 0 ? 0x80 : 0));
+            } while (value > 0);
+            write(bytes, n);
+        }
+
+        size_t      size() const { return _size; }
+        bool        ok() const { return !_overflow; }
+        const char *data() const { return _buffer; }
+
+      private:
+        char  *_buffer   = nullptr;
+        size_t _capacity = 0;
+        size_t _size     = 0;
+        bool   _overflow = false;
+    };
+
+    inline void pack(writer &w, uint8_t v) { w.write_le(v); }
+    inline void pack(writer &w, uint16_t v) { w.write_le(v); }
+    inline void pack(writer &w, uint32_t v) { w.write_le(v); }
+    inline void pack(writer &w, uint64_t v) { w.write_le(v); }
+    inline void pack(writer &w, int64_t v) { w.write_le(v); }
+    inline void pack(writer &w, name v) { w.write_le(v.value); }
+    inline void pack(writer &w, symbol v) { w.write_le(v.value); }
+    inline void pack(writer &w, std::string_view v) {
+        w.write_varuint32(uint32_t(v.size()));
+        w.write(v.data(), v.size());
+    }
+    inline void pack(writer &w, const asset &v) {
+        pack(w, v.amount);
+        pack(w, v.sym);
+    }
+    inline void pack(writer &w, const permission_level &v) {
+        pack(w, v.actor);
+        pack(w, v.permission);
+    }
+
+    template <typename... T>
+    void pack_all(writer &w, const T &...values) {
+        (pack(w, values), ...);
+    }
+
+    // action data, one function per action in the argument order of the contracts
+    namespace data {
+
+        // eosio.token, stoken.defi and the token collaterals
+        inline void transfer(writer &w, name from, name to, const asset &quantity, std::string_view memo) {
+            pack_all(w, from, to, quantity, memo);
+        }
+
+        // stoken.defi
+        inline void open(writer &w, name owner, symbol sym, name ram_payer) { pack_all(w, owner, sym, ram_payer); }
+        inline void close(writer &w, name owner, symbol sym) { pack_all(w, owner, sym); }
+
+        // vault.defi, anyone
+        inline void release(writer &w, name owner) { pack(w, owner); }
+        inline void income(writer &) {}
+        inline void payout(writer &) {}
+        inline void getapy(writer &w, uint64_t collateral_id) { pack(w, collateral_id); }
+        inline void getram(writer &) {}
+        inline void planrelease(writer &w, name owner) { pack(w, owner); }
+        inline void planwithdraw(writer &w, name owner, const asset &quantity) { pack_all(w, owner, quantity); }
+
+        // vault.defi, admin.defi
+        inline void updatestatus(writer &w, uint8_t transfer_status, uint8_t deposit_status, uint8_t withdraw_status) {
+            pack_all(w, transfer_status, deposit_status, withdraw_status);
+        }
+        inline void createcoll(writer &w, name contract, symbol sym, name income_account, name fees_account,
+                               const asset &min_quantity, uint16_t income_ratio, uint16_t release_fees,
+                               uint16_t refund_ratio) {
+            pack_all(w, contract, sym, income_account, fees_account, min_quantity, income_ratio, release_fees,
+                     refund_ratio);
+        }
+        inline void updatecoll(writer &w, uint64_t collateral_id, name income_account, name fees_account,
+                               const asset &min_quantity, uint16_t income_ratio, uint16_t release_fees,
+                               uint16_t refund_ratio) {
+            pack_all(w, collateral_id, income_account, fees_account, min_quantity, income_ratio, release_fees,
+                     refund_ratio);
+        }
+        inline void proxyto(writer &w, name proxy) { pack(w, proxy); }
+        inline void buyallrex(writer &) {}
+        inline void buyrex(writer &w, const asset &quantity) { pack(w, quantity); }
+        inline void sellallrex(writer &) {}
+        inline void sellrex(writer &w, const asset &quantity) { pack(w, quantity); }
+        inline void setramstat(writer &w, name code, name table, uint64_t scopes, uint64_t rows, uint64_t bytes) {
+            pack_all(w, code, table, scopes, rows, bytes);
+        }
+
+    } // namespace data
+
+    /**
+     * One action with a single authorization, its data written by `write_data(writer &)`,
+     * which is called twice: once to size the data, once to write it.
+     */
+    template <typename Data>
+    void pack_action(writer &w, name account, name act, const permission_level &auth, Data &&write_data) {
+        pack_all(w, account, act);
+        w.write_varuint32(1);
+        pack(w, auth);
+        writer sizer;
+        write_data(sizer);
+        w.write_varuint32(uint32_t(sizer.size()));
+        write_data(w);
+    }
+
+    // a deposit: `quantity` of `token` from `owner` to the vault
+    inline void pack_deposit(writer &w, name token, name owner, const asset &quantity, std::string_view memo = {}) {
+        pack_action(w, token, name(std::string_view("transfer")), { owner },
+                    [&](writer &d) { data::transfer(d, owner, VAULT, quantity, memo); });
+    }
+
+    // a withdraw: `quantity` issued tokens from `owner` to the vault
+    inline void pack_withdraw(writer &w, name owner, const asset &quantity, std::string_view memo = {}) {
+        pack_action(w, STOKEN, name(std::string_view("transfer")), { owner },
+                    [&](writer &d) { data::transfer(d, owner, VAULT, quantity, memo); });
+    }
+
+    // the release of the matured rows of `owner`, signed by `owner`
+    inline void pack_release(writer &w, name owner) {
+        pack_action(w, VAULT, name(std::string_view("release")), { owner },
+                    [&](writer &d) { data::release(d, owner); });
+    }
+
+    struct transaction_header {
+        uint32_t expiration       = 0;   // seconds since 1970
+        uint16_t ref_block_num    = 0;
+        uint32_t ref_block_prefix = 0;
+        uint32_t max_net_usage_words = 0;
+        uint8_t  max_cpu_usage_ms    = 0;
+        uint32_t delay_sec           = 0;
+    };
+
+    // the header of a transaction of `actions` actions, no context free ones; the
+    // actions follow, packed with `pack_action`, then `pack_transaction_end`
+    inline void pack_transaction_begin(writer &w, const transaction_header &h, uint32_t actions) {
+        pack_all(w, h.expiration, h.ref_block_num, h.ref_block_prefix);
+        w.write_varuint32(h.max_net_usage_words);
+        pack(w, h.max_cpu_usage_ms);
+        w.write_varuint32(h.delay_sec);
+        w.write_varuint32(0);
+        w.write_varuint32(actions);
+    }
+
+    // no transaction extensions
+    inline void pack_transaction_end(writer &w) { w.write_varuint32(0); }
+
+} // namespace vault_sdk
@@ -0,0 +1,439 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <vault_math.hpp>
+
+#include "stream.hpp"
+
+/**
+ * Native model of one EOS collateral of the vault, driven by a `stream`.
+ *
+ * Every amount goes through the `vault_math` formulas the contract uses, and
+ * the release payout follows `send_transfers` / `withdraw_sellrex` step by
+ * step: the liquid balance and matured REX are read once per action, the
+ * fees and refunds of a recipient are summed into one transfer, the payouts
+ * the liquid balance does not cover are queued and REX is sold once for the
+ * difference. The queue is paid in order when the EOS of a sell arrives (a
+ * gap below 10 units tolerated), by `buyallrex` and by the keeper's `payout`
+ * every period. A release whose inline actions would fail (the pool cannot
+ * pay the sell) is rolled back and retried every income period, as a user
+ * would.
+ *
+ * Inline actions are counted the way the contract sends them (stoken's inline
+ * transfer on `issue` included), not including the user's own transfer.
+ */
+namespace sim {
+
+    struct params {
+        uint16_t income_ratio  = 50;      // share of the income account moved per period, pips
+        uint16_t release_fees  = 30;      // pips of the refunded collateral
+        uint16_t refund_ratio  = 5000;    // part of the fees and rate gain back to the income account
+        uint32_t release_delay = 5 * DAY;
+        uint16_t rex_cutoff    = 85;      // REX pool utilization (percent) at which `buyrex` sells instead
+    };
+
+    struct market {
+        int64_t  total_lendable = 1000000000000;       // 100M EOS in the REX pool
+        int64_t  total_rex      = 10000000000000000;   // 10000 REX per EOS
+        uint16_t rex_apr        = 300;                 // pool growth a year from rentals, pips
+        int64_t  min_quantity   = 10000;               // collateral `min_quantity`
+    };
+
+    struct result {
+        params p;
+
+        uint64_t              final_rate = 0;
+        uint64_t              min_rate   = 0;
+        uint64_t              max_rate   = 0;
+        int64_t               apy        = 0;   // over the whole run, `annualized_yield` scale
+        std::vector<uint64_t> daily_rates;      // at each midnight
+
+        uint64_t deposits         = 0;
+        uint64_t withdraws        = 0;
+        uint64_t releases         = 0;
+        uint64_t failed_deposits  = 0;   // reverted: the cutoff sell-all could not be paid by the pool
+        uint64_t failed_releases  = 0;   // reverted attempts, retried the next period
+        uint64_t waiting_payouts  = 0;   // payouts still queued when their release went through
+        int64_t  waiting_amount   = 0;
+        int64_t  max_shortfall    = 0;   // largest payout not covered by liquid + matured REX
+        uint64_t late_releases    = 0;   // paid after their due period
+
+        uint64_t rex_buys  = 0;
+        uint64_t rex_sells = 0;          // `sellrex` actions, either path
+        uint64_t sell_all  = 0;          // of which `buyrex` sold everything above the cutoff
+
+        uint64_t deposit_actions = 0;    // inline actions sent for user operations
+        uint64_t withdraw_actions = 0;
+        uint64_t release_actions = 0;
+        uint64_t keeper_actions  = 0;    // `income` transfers, `payout` sells and transfers
+
+        int64_t deposited      = 0;      // collateral of the deposits that went through
+        int64_t fees_collected = 0;      // paid to `fees_account`
+        int64_t income_moved   = 0;      // moved from the income account into the vault
+
+        uint64_t user_ops() const { return deposits + withdraws + releases; }
+        double   actions_per_op() const {
+            uint64_t ops = user_ops();
+            return ops ? double(deposit_actions + withdraw_actions + release_actions) / double(ops) : 0;
+        }
+    };
+
+    class vault_model {
+      public:
+        vault_model(const params &p, const market &m, uint32_t users)
+            : _p(p), _m(m), _shares(users, 0) {
+            _s.total_lendable = m.total_lendable;
+            _s.total_rex      = m.total_rex;
+            _r.p              = p;
+            _r.min_rate = _r.max_rate = vault_math::RATE_BASE;
+        }
+
+        result run(const stream &s) {
+            _last_income = 0;
+            for (const auto &o : s.ops) {
+                switch (o.kind) {
+                case op_kind::deposit: deposit(o.time, o.user, o.amount); break;
+                case op_kind::withdraw: withdraw(o.time, o.user, o.amount); break;
+                case op_kind::period: period(o.time, o.amount, o.util); break;
+                }
+            }
+            _r.fees_collected = _fees;
+            _r.final_rate     = rate(0);
+            _r.apy            = vault_math::annualized_yield(vault_math::RATE_BASE, _r.final_rate, s.end - s.start);
+            return _r;
+        }
+
+        // collateral held by the vault, liquid plus the REX value
+        int64_t holdings() const { return _s.liquid + rex_value(); }
+        int64_t supply() const { return _s.supply; }
+        int64_t income_balance() const { return _s.income; }
+        int64_t paid_out() const { return _paid; }
+        int64_t queued() const { return _s.queued; }
+        int64_t pending_shares() const {
+            int64_t sum = 0;
+            for (const auto &r : _pending) sum += r.shares;
+            for (const auto &r : _due) sum += r.shares;
+            return sum;
+        }
+
+      private:
+        // everything a reverted action rolls back
+        struct state {
+            int64_t liquid         = 0;
+            int64_t income         = 0;
+            int64_t supply         = 0;
+            int64_t rex_balance    = 0;
+            int64_t rex_matured    = 0;
+            int64_t total_lendable = 0;
+            int64_t total_rex      = 0;
+            int64_t total_lent     = 0;
+            int64_t queued         = 0;   // sum of `_queue`
+        };
+
+        enum class to : uint8_t { owner, income, fees };
+
+        struct queued_payout {
+            int64_t quantity;
+            to      dest;
+        };
+
+        struct release_row {
+            uint32_t user;
+            int64_t  shares;
+            uint64_t rate;
+            uint32_t due;
+        };
+
+        struct bucket {
+            uint32_t maturity;
+            int64_t  rex;
+        };
+
+        int64_t rex_value() const {
+            return _s.rex_balance ? vault_math::rex_to_eos(_s.rex_balance, _s.total_lendable, _s.total_rex) : 0;
+        }
+
+        // queued payouts are not the depositors'
+        uint64_t rate(int64_t adjust) const {
+            return vault_math::rate(vault_math::total_with(_s.liquid, uint64_t(rex_value()), adjust - _s.queued),
+                                    _s.supply);
+        }
+
+        void pay(int64_t quantity, to dest) {
+            _s.liquid -= quantity;
+            if (dest == to::income) _s.income += quantity;
+            if (dest == to::owner) _paid += quantity;
+            if (dest == to::fees) _fees += quantity;
+        }
+
+        // `pay_queued`, returns the transfers sent: the rows paid to the income and
+        // fees accounts are summed into one each, the owners' counted one by one
+        uint64_t pay_queued() {
+            uint64_t sent = 0;
+            bool     to_income = false, to_fees = false;
+            while (!_queue.empty()) {
+                int64_t quantity = _queue.front().quantity;
+                if (quantity > _s.liquid) {
+                    if (quantity - _s.liquid >= 10) break;
+                    quantity = _s.liquid;
+                }
+                if (quantity > 0) {
+                    auto dest = _queue.front().dest;
+                    pay(quantity, dest);
+                    bool &sent_to = dest == to::income ? to_income : to_fees;
+                    if (dest == to::owner || !sent_to) sent++;
+                    if (dest != to::owner) sent_to = true;
+                }
+                _s.queued -= _queue.front().quantity;
+                _queue.pop_front();
+            }
+            return sent;
+        }
+
+        // the keeper's `payout`: the queue first, matured REX sold for the rest
+        void payout() {
+            state                     saved   = _s;
+            std::deque<queued_payout> queue   = _queue;
+            int64_t                   paid    = _paid;
+            int64_t                   fees    = _fees;
+            uint64_t                  actions = pay_queued();
+            if (_s.queued > _s.liquid) {
+                int64_t rex = std::min(
+                    vault_math::eos_to_rex(_s.queued - _s.liquid + 1, _s.total_lendable, _s.total_rex),
+                    _s.rex_matured);
+                int64_t fund = 0;
+                if (rex > 0 && !sell_rex(rex, fund)) {
+                    _s     = saved;
+                    _queue = queue;
+                    _paid  = paid;
+                    _fees  = fees;
+                    return;
+                }
+                if (rex > 0) {
+                    _s.liquid += fund;
+                    _r.rex_sells++;
+                    actions += 2 + pay_queued();   // sellrex, withdraw, the transfers
+                }
+            }
+            _r.keeper_actions += actions;
+        }
+
+        void mature(uint32_t now) {
+            while (!_buckets.empty() && _buckets.front().maturity <= now) {
+                _s.rex_matured += _buckets.front().rex;
+                _buckets.pop_front();
+            }
+        }
+
+        // `sellrex`: false when the pool cannot pay out of its unlent part
+        bool sell_rex(int64_t rex, int64_t &fund) {
+            int64_t eos = vault_math::rex_to_eos(rex, _s.total_lendable, _s.total_rex);
+            if (eos > _s.total_lendable - _s.total_lent) return false;
+            _s.total_lendable -= eos;
+            _s.total_rex -= rex;
+            _s.rex_balance -= rex;
+            _s.rex_matured -= rex;
+            fund += eos;
+            return true;
+        }
+
+        void deposit(uint32_t now, uint32_t user, int64_t amount) {
+            if (amount < _m.min_quantity) return;
+            mature(now);
+            state                     saved = _s;
+            std::deque<queued_payout> queue = _queue;
+            int64_t                   paid  = _paid;
+            int64_t                   fees  = _fees;
+
+            uint64_t r     = rate(0);
+            int64_t  issue = int64_t(vault_math::issue_amount(amount, r));
+            _s.liquid += amount;
+            _s.supply += issue;
+            uint64_t actions = 4;   // issue, stoken transfer, depositlog, buyallrex
+
+            // `buyrex` pays the queue first and keeps what it still owes liquid
+            actions += pay_queued();
+            int64_t available = _s.liquid - _s.queued;
+            if (available >= 10000) {
+                if (vault_math::rex_utilization(_s.total_lent, _s.total_lendable) >= _p.rex_cutoff) {
+                    // withdraw_sellrex(0): everything matured, its EOS pays the rest of the queue
+                    if (_s.rex_matured > 0) {
+                        int64_t fund = 0;
+                        if (!sell_rex(_s.rex_matured, fund)) {
+                            _s     = saved;
+                            _queue = queue;
+                            _paid  = paid;
+                            _fees  = fees;
+                            _r.failed_deposits++;
+                            return;
+                        }
+                        _s.liquid += fund;
+                        _r.rex_sells++;
+                        _r.sell_all++;
+                        actions += 2 + pay_queued();   // sellrex, withdraw, the transfers
+                    }
+                } else {
+                    int64_t rex = vault_math::eos_to_rex(available, _s.total_lendable, _s.total_rex);
+                    _s.total_lendable += available;
+                    _s.total_rex += rex;
+                    _s.rex_balance += rex;
+                    _s.liquid -= available;
+                    // REX matures at midnight five days later
+                    _buckets.push_back(bucket { now - now % DAY + 5 * DAY, rex });
+                    _r.rex_buys++;
+                    actions += 2;   // deposit, buyrex
+                }
+            }
+            _shares[user] += issue;
+            _r.deposited += amount;
+            _r.deposits++;
+            _r.deposit_actions += actions;
+        }
+
+        void withdraw(uint32_t now, uint32_t user, int64_t pips) {
+            int64_t shares = int64_t(vault_math::i128(_shares[user]) * pips / 10000);
+            if (shares <= 0) return;
+            _shares[user] -= shares;
+            _pending.push_back(release_row { user, shares, rate(0), now + _p.release_delay });
+            _r.withdraws++;
+            _r.withdraw_actions += 1;   // releaselog
+        }
+
+        void period(uint32_t now, int64_t revenue, uint16_t util) {
+            mature(now);
+            // rentals grow the pool, i.e. the REX price
+            _s.total_lendable += int64_t(vault_math::i128(_s.total_lendable) * _m.rex_apr / 10000
+                                         / (vault_math::YEAR_SECONDS / PERIOD));
+            _s.total_lent = int64_t(vault_math::i128(_s.total_lendable) * util / 10000);
+
+            if (_last_income > 0) {
+                uint64_t periods = (now - _last_income) / PERIOD;
+                int64_t  moved   = vault_math::income_amount(_s.income, periods, _p.income_ratio);
+                if (moved > 0) {
+                    _s.income -= moved;
+                    _s.liquid += moved;
+                    _r.income_moved += moved;
+                    _r.keeper_actions++;
+                }
+            }
+            _last_income = now;
+            _s.income += revenue;
+            if (!_queue.empty()) payout();
+
+            while (!_pending.empty() && _pending.front().due <= now) {
+                _due.push_back(_pending.front());
+                _pending.pop_front();
+            }
+            size_t kept = 0;
+            for (size_t i = 0; i < _due.size(); i++) {
+                if (!release(_due[i])) {
+                    _due[kept++] = _due[i];
+                } else if (_due[i].due + PERIOD <= now) {
+                    _r.late_releases++;
+                }
+            }
+            _due.resize(kept);
+
+            uint64_t r  = rate(0);
+            _r.min_rate = std::min(_r.min_rate, r);
+            _r.max_rate = std::max(_r.max_rate, r);
+            if (now % DAY == 0) _r.daily_rates.push_back(r);
+        }
+
+        // `check_for_released` for one row, false when the transaction would fail
+        bool release(const release_row &row) {
+            state                     saved   = _s;
+            std::deque<queued_payout> queue   = _queue;
+            int64_t                   paid    = _paid;
+            auto                      amounts = vault_math::release(row.shares, row.rate, rate(0), _p.release_fees, _p.refund_ratio);
+
+            int64_t total = amounts.withdraw + amounts.fees.award + amounts.fees.sys + amounts.refund.award
+                            + amounts.refund.sys;
+            int64_t matured_eos
+                = _s.rex_matured ? vault_math::rex_to_eos(_s.rex_matured, _s.total_lendable, _s.total_rex) : 0;
+            _r.max_shortfall = std::max(_r.max_shortfall, total - _s.liquid - matured_eos);
+
+            _s.supply -= row.shares;   // retire
+            uint64_t actions = 2;      // retire, withdrawlog
+
+            // read once per action, as the cached optionals of the contract
+            int64_t       cached  = _s.liquid - _s.queued;
+            int64_t       matured = _s.rex_matured;
+            const int64_t S0      = _s.total_lendable;
+            const int64_t R0      = _s.total_rex;
+            uint64_t      sells   = 0;
+            uint64_t      added   = 0;
+
+            int64_t       short_eos = 0;
+
+            auto transfer = [&](int64_t quantity, to dest) {
+                if (quantity <= 0) return true;
+                if (short_eos > 0 || quantity > cached) {
+                    short_eos += quantity - cached;
+                    cached = 0;
+                    _queue.push_back(queued_payout { quantity, dest });
+                    _s.queued += quantity;
+                    added++;
+                    return true;
+                }
+                cached -= quantity;
+                actions += 1;
+                if (quantity > _s.liquid) return false;
+                pay(quantity, dest);
+                return true;
+            };
+
+            // summed per recipient as `send_transfers`, one sell for what the balance does not cover
+            int64_t fees0 = _fees;
+            bool    ok    = transfer(amounts.withdraw, to::owner)
+                      && transfer(amounts.fees.award + amounts.refund.award, to::income)
+                      && transfer(amounts.fees.sys + amounts.refund.sys, to::fees);
+            int64_t rex = ok && short_eos > 0 ? std::min(vault_math::eos_to_rex(short_eos + 1, S0, R0), matured) : 0;
+            // withdraw_sellrex returns early without matured REX, the payouts wait for the next sell
+            if (rex > 0) {
+                int64_t sell = vault_math::rex_to_eos(rex, S0, R0);
+                int64_t fund = 0;
+                ok           = sell_rex(rex, fund) && sell <= fund;
+                if (ok) {
+                    sells++;
+                    _s.liquid += sell;
+                    actions += 2 + pay_queued();   // sellrex, withdraw, the transfers
+                }
+            }
+            if (!ok) {
+                _s     = saved;
+                _queue = queue;
+                _paid  = paid;
+                _fees  = fees0;
+                _r.failed_releases++;
+                return false;
+            }
+            _r.rex_sells += sells;
+            // the queue is paid in order, what is left of this release is at its end
+            for (size_t i = _queue.size() - std::min<size_t>(added, _queue.size()); i < _queue.size(); i++) {
+                _r.waiting_payouts++;
+                _r.waiting_amount += _queue[i].quantity;
+            }
+            _r.releases++;
+            _r.release_actions += actions;
+            return true;
+        }
+
+        params                    _p;
+        market                    _m;
+        state                     _s;
+        result                    _r;
+        std::vector<int64_t>      _shares;
+        std::deque<release_row>   _pending;   // by due time, the delay is the same for every row
+        std::vector<release_row>  _due;       // due, retried until they go through
+        std::deque<bucket>        _buckets;   // REX not matured yet
+        std::deque<queued_payout> _queue;     // `payouts`, in order
+        uint32_t                  _last_income = 0;
+        int64_t                   _paid        = 0;
+        int64_t                   _fees        = 0;
+    };
+
+} // namespace sim
@@ -0,0 +1,158 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bench.hpp>
+#include <eosio.hpp>
+
+#include "stream.hpp"
+#include "sweep.hpp"
+
+using namespace sim;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: sim [options]\n"
+                     "  parameters, comma separated lists, every combination is simulated:\n"
+                     "    --income-ratio 10,50,100   --release-fees 0,30   --refund-ratio 5000\n"
+                     "    --delay-days 1,5           --cutoff 75,85,95\n"
+                     "  stream:\n"
+                     "    --days N --users N --deposits N/day --withdraws N/day --revenue EOS-units/day\n"
+                     "    --util PIPS --seed N\n"
+                     "    --trace FILE [--collateral ID] [--vault NAME]   recorded deposits and withdraws\n"
+                     "  output:\n"
+                     "    --threads N --trajectory FILE (daily rates of every combination)\n"
+                     "  prints one CSV row per combination\n");
+    }
+
+    template <typename T>
+    bool parse_list(const char *text, std::vector<T> &out, uint64_t scale = 1) {
+        out.clear();
+        for (const char *p = text; *p;) {
+            char *end;
+            auto  value = std::strtoull(p, &end, 10);
+            if (end == p) return false;
+            out.push_back(T(value * scale));
+            p = *end == ',' ? end + 1 : end;
+            if (*end && *end != ',') return false;
+        }
+        return !out.empty();
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    grid        g;
+    scenario    sc;
+    market      m;
+    unsigned    threads    = std::max(1u, std::thread::hardware_concurrency());
+    const char *trace      = nullptr;
+    const char *trajectory = nullptr;
+    uint64_t    collateral = 1;
+    uint64_t    vault      = tools::name_value("vault.defi");
+
+    for (int i = 1; i < argc; i++) {
+        bool        ok   = true;
+        const char *arg  = argv[i];
+        const char *next = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!next) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        i++;
+        if (!std::strcmp(arg, "--income-ratio")) {
+            ok = parse_list(next, g.income_ratio);
+        } else if (!std::strcmp(arg, "--release-fees")) {
+            ok = parse_list(next, g.release_fees);
+        } else if (!std::strcmp(arg, "--refund-ratio")) {
+            ok = parse_list(next, g.refund_ratio);
+        } else if (!std::strcmp(arg, "--delay-days")) {
+            ok = parse_list(next, g.release_delay, DAY);
+        } else if (!std::strcmp(arg, "--cutoff")) {
+            ok = parse_list(next, g.rex_cutoff);
+        } else if (!std::strcmp(arg, "--days")) {
+            sc.days = uint32_t(std::strtoul(next, nullptr, 10));
+        } else if (!std::strcmp(arg, "--users")) {
+            sc.users = std::max(1u, uint32_t(std::strtoul(next, nullptr, 10)));
+        } else if (!std::strcmp(arg, "--deposits")) {
+            sc.deposits_day = uint32_t(std::strtoul(next, nullptr, 10));
+        } else if (!std::strcmp(arg, "--withdraws")) {
+            sc.withdraws_day = uint32_t(std::strtoul(next, nullptr, 10));
+        } else if (!std::strcmp(arg, "--revenue")) {
+            sc.revenue_day = std::strtoll(next, nullptr, 10);
+        } else if (!std::strcmp(arg, "--util")) {
+            sc.util_mean = uint16_t(std::min(9999ul, std::strtoul(next, nullptr, 10)));
+        } else if (!std::strcmp(arg, "--seed")) {
+            sc.seed = std::strtoull(next, nullptr, 10);
+        } else if (!std::strcmp(arg, "--trace")) {
+            trace = next;
+        } else if (!std::strcmp(arg, "--collateral")) {
+            collateral = std::strtoull(next, nullptr, 10);
+        } else if (!std::strcmp(arg, "--vault")) {
+            vault = tools::name_value(next);
+        } else if (!std::strcmp(arg, "--threads")) {
+            threads = unsigned(std::max(1, std::atoi(next)));
+        } else if (!std::strcmp(arg, "--trajectory")) {
+            trajectory = next;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    stream s = trace ? recorded(trace, vault, collateral, sc) : synthetic(sc);
+    if (s.ops.empty()) {
+        std::fprintf(stderr, "sim: no operations%s%s\n", trace ? " in " : "", trace ? trace : "");
+        return EXIT_FAILURE;
+    }
+    auto combos = g.expand();
+
+    tools::stopwatch timer;
+    auto             results = sweep(s, m, combos, threads);
+    double           seconds = timer.seconds();
+
+    std::printf("income_ratio,release_fees,refund_ratio,delay_days,cutoff,final_rate,min_rate,max_rate,apy,"
+                "deposits,withdraws,releases,failed_deposits,failed_releases,late_releases,waiting_payouts,"
+                "waiting_amount,max_shortfall,rex_buys,rex_sells,sell_all,actions_per_op,deposit_actions,"
+                "withdraw_actions,release_actions,keeper_actions,fees_collected,income_moved\n");
+    for (const auto &r : results) {
+        std::printf("%u,%u,%u,%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRIu64 ",%" PRIu64
+                    ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 ",%" PRIu64
+                    ",%" PRIu64 ",%" PRIu64 ",%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64
+                    ",%" PRId64 "\n",
+                    r.p.income_ratio, r.p.release_fees, r.p.refund_ratio, r.p.release_delay / DAY, r.p.rex_cutoff,
+                    r.final_rate, r.min_rate, r.max_rate, r.apy, r.deposits, r.withdraws, r.releases,
+                    r.failed_deposits, r.failed_releases, r.late_releases, r.waiting_payouts, r.waiting_amount,
+                    r.max_shortfall, r.rex_buys, r.rex_sells, r.sell_all, r.actions_per_op(), r.deposit_actions,
+                    r.withdraw_actions, r.release_actions, r.keeper_actions, r.fees_collected, r.income_moved);
+    }
+
+    if (trajectory) {
+        std::FILE *f = std::fopen(trajectory, "w");
+        if (!f) {
+            std::fprintf(stderr, "sim: cannot write %s\n", trajectory);
+            return EXIT_FAILURE;
+        }
+        std::fprintf(f, "combination,day,rate\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            for (size_t d = 0; d < results[i].daily_rates.size(); d++) {
+                std::fprintf(f, "%zu,%zu,%" PRIu64 "\n", i, d, results[i].daily_rates[d]);
+            }
+        }
+        std::fclose(f);
+    }
+
+    std::fprintf(stderr, "%zu combinations x %zu operations on %u threads in %.3fs (%.2f M ops/s)\n",
+                 combos.size(), s.ops.size(), threads, seconds,
+                 double(combos.size()) * double(s.ops.size()) / seconds / 1e6);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <eosio.hpp>
+#include <mapped_file.hpp>
+
+#include <generator.hpp>
+
+#include "sweep.hpp"
+
+using namespace sim;
+
+namespace {
+
+    scenario small() {
+        scenario sc;
+        sc.days          = 20;
+        sc.users         = 200;
+        sc.deposits_day  = 60;
+        sc.withdraws_day = 40;
+        return sc;
+    }
+
+    int64_t revenue(const stream &s) {
+        int64_t sum = 0;
+        for (const auto &o : s.ops) {
+            if (o.kind == op_kind::period) sum += o.amount;
+        }
+        return sum;
+    }
+
+    // every unit that came in is held, still in the income account, or paid out
+    void test_conservation() {
+        stream s = synthetic(small());
+        market m;
+        m.rex_apr = 0;
+        for (uint16_t cutoff : { 0, 85, 100 }) {
+            params p;
+            p.rex_cutoff = cutoff;
+            vault_model model(p, m, s.users);
+            result      r = model.run(s);
+
+            int64_t in  = r.deposited + revenue(s);
+            int64_t out = model.holdings() + model.income_balance() + model.paid_out() + r.fees_collected;
+            // REX conversions truncate, at most a unit or two per buy and sell
+            CHECK(in >= out && in - out <= int64_t(2 * (r.rex_buys + r.rex_sells) + 2));
+            CHECK(r.deposits > 0 && r.withdraws > 0 && r.releases > 0);
+            CHECK(model.supply() >= model.pending_shares());
+        }
+    }
+
+    void test_rate() {
+        scenario sc    = small();
+        sc.revenue_day = 0;
+        stream s       = synthetic(sc);
+        market m;
+        m.rex_apr = 0;
+
+        // no revenue, no fees: the rate only moves by truncation
+        params flat;
+        flat.release_fees = 0;
+        result r          = vault_model(flat, m, s.users).run(s);
+        CHECK(r.max_rate <= vault_math::RATE_BASE + 10 && r.min_rate >= vault_math::RATE_BASE - 10);
+        CHECK(r.daily_rates.size() == sc.days - 1);   // every midnight after the start
+
+        // fees stay in the vault, moving the income account faster raises the rate sooner
+        stream with_revenue = synthetic(small());
+        params slow, fast;
+        slow.income_ratio = 5;
+        fast.income_ratio = 500;
+        result a          = vault_model(slow, m, with_revenue.users).run(with_revenue);
+        result b          = vault_model(fast, m, with_revenue.users).run(with_revenue);
+        CHECK(a.final_rate > vault_math::RATE_BASE);
+        CHECK(b.final_rate > a.final_rate);
+        CHECK(b.income_moved > a.income_moved);
+        CHECK(b.apy > a.apy && a.apy > 0);
+    }
+
+    void test_rex() {
+        stream s = synthetic(small());
+        market m;
+
+        // at or above the cutoff nothing is bought, payouts never need REX
+        params never;
+        never.rex_cutoff = 0;
+        result r         = vault_model(never, m, s.users).run(s);
+        CHECK(r.rex_buys == 0 && r.rex_sells == 0 && r.waiting_payouts == 0 && r.failed_releases == 0);
+        CHECK(r.actions_per_op() > 0);
+        // issue, stoken transfer, depositlog, buyallrex
+        CHECK(r.deposit_actions == 4 * r.deposits);
+        CHECK(r.withdraw_actions == r.withdraws);
+
+        // everything goes to REX: releases sell it, and a delay shorter than the
+        // REX maturity leaves payouts without matured REX to sell
+        params always;
+        always.rex_cutoff = 100;
+        r                 = vault_model(always, m, s.users).run(s);
+        CHECK(r.rex_buys > 0 && r.rex_sells > 0 && r.sell_all == 0);
+        CHECK(r.deposit_actions == 6 * r.deposits);
+        CHECK(r.waiting_payouts == 0);
+
+        // the payouts wait in the queue instead, the releases go through and the
+        // keeper pays the queue once the REX matures
+        always.release_delay = DAY;
+        vault_model early(always, m, s.users);
+        r = early.run(s);
+        CHECK(r.waiting_payouts > 0 && r.waiting_amount > 0 && r.max_shortfall > 0);
+        CHECK(r.failed_releases == 0 && r.keeper_actions > r.waiting_payouts);
+
+        // a pool lent out past the cutoff: deposits sell all matured REX
+        scenario busy  = small();
+        busy.util_mean = 9000;
+        busy.util_swing = 0;
+        stream   b     = synthetic(busy);
+        params   p;
+        r = vault_model(p, m, b.users).run(b);
+        CHECK(r.rex_buys == 0 && r.sell_all == 0);
+        p.rex_cutoff = 95;
+        r            = vault_model(p, m, b.users).run(b);
+        CHECK(r.rex_buys > 0);
+    }
+
+    // results do not depend on the thread count and keep the grid order
+    void test_sweep() {
+        stream s = synthetic(small());
+        grid   g;
+        g.income_ratio  = { 10, 50, 200 };
+        g.release_fees  = { 0, 30 };
+        g.release_delay = { DAY, 5 * DAY };
+        g.rex_cutoff    = { 0, 85 };
+        auto combos     = g.expand();
+        CHECK(combos.size() == 24);
+
+        auto one   = sweep(s, market {}, combos, 1);
+        auto eight = sweep(s, market {}, combos, 8);
+        CHECK(one.size() == combos.size() && eight.size() == combos.size());
+        for (size_t i = 0; i < combos.size(); i++) {
+            CHECK(one[i].p.income_ratio == combos[i].income_ratio && one[i].p.rex_cutoff == combos[i].rex_cutoff);
+            CHECK(one[i].final_rate == eight[i].final_rate && one[i].daily_rates == eight[i].daily_rates);
+            CHECK(one[i].release_actions == eight[i].release_actions);
+        }
+    }
+
+    // deposits and withdraws of one collateral from an indexer trace
+    void test_recorded(const std::string &path) {
+        uint64_t                  vault = tools::name_value("vault.defi");
+        indexer::stream_generator gen(vault, tools::name_value("stoken.defi"), 7, 50, 2);
+        uint64_t                  deposits = 0, withdraws = 0;
+        {
+            indexer::trace_writer writer(path);
+            for (int i = 0; i < 20000; i++) {
+                gen.step([&](const indexer::action_trace &t) {
+                    writer.write(t);
+                    if (t.receiver != vault || t.account != vault) return;
+                    uint64_t id;
+                    std::memcpy(&id, t.data + (t.name == indexer::releaselog::NAME ? 8 : 0), 8);
+                    if (id != 2) return;
+                    if (t.name == indexer::depositlog::NAME) deposits++;
+                    if (t.name == indexer::releaselog::NAME) withdraws++;
+                });
+            }
+        }
+        stream s = recorded(path, vault, 2, small());
+        std::remove(path.c_str());
+
+        uint64_t d = 0, w = 0, periods = 0;
+        for (const auto &o : s.ops) {
+            d += o.kind == op_kind::deposit;
+            w += o.kind == op_kind::withdraw;
+            periods += o.kind == op_kind::period;
+            CHECK(o.kind != op_kind::withdraw || (o.amount >= 1 && o.amount <= 10000));
+        }
+        CHECK(d == deposits && d > 0);
+        // a withdraw before any recorded deposit has no shares to take a fraction of
+        CHECK(w <= withdraws && w > 0);
+        CHECK(periods > 0 && s.users <= 50);
+
+        result r = vault_model(params {}, market {}, s.users).run(s);
+        CHECK(r.deposits > 0 && r.withdraws > 0);
+
+        CHECK(recorded(path, vault, 2, small()).ops.empty());
+    }
+
+} // namespace
+
+int main() {
+    std::string path = std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp")
+                       + "/sim_test." + std::to_string(::getpid());
+    test_conservation();
+    test_rate();
+    test_rex();
+    test_sweep();
+    test_recorded(path);
+    return tools::check_report("sim_test");
+}
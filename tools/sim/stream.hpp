@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <mapped_file.hpp>
+#include <rng.hpp>
+#include <vault_math.hpp>
+
+#include <actions.hpp>
+#include <trace.hpp>
+
+/**
+ * Operation streams fed to the simulator. A stream does not depend on the
+ * vault parameters, so one stream is shared read-only by every combination
+ * of a sweep:
+ *
+ * - withdraws are a fraction of the user's shares, not a share amount,
+ *   since the shares a deposit buys depend on the simulated rate
+ * - every income period carries the revenue landing in the income account
+ *   and the REX pool utilization for that period
+ */
+namespace sim {
+
+    static constexpr uint32_t PERIOD       = vault_math::HISTORY_PERIOD;
+    static constexpr uint32_t DAY          = vault_math::DAY_SECONDS;
+    static constexpr uint32_t BLOCK_EPOCH  = 946684800;   // block_timestamp slot 0, in unix seconds
+
+    enum class op_kind : uint8_t { deposit, withdraw, period };
+
+    struct op {
+        uint32_t time;
+        op_kind  kind;
+        uint32_t user;     // deposit, withdraw
+        int64_t  amount;   // deposit: collateral, withdraw: pips of the user's shares,
+                           // period: revenue to the income account
+        uint16_t util;     // period: REX pool utilization in pips
+    };
+
+    struct stream {
+        std::vector<op> ops;
+        uint32_t        users = 0;
+        uint32_t        start = 0;
+        uint32_t        end   = 0;
+    };
+
+    struct scenario {
+        uint64_t seed          = 1;
+        uint32_t start         = 1669852800;   // 2022-12-01
+        uint32_t days          = 90;
+        uint32_t users         = 2000;
+        uint32_t deposits_day  = 400;
+        int64_t  mean_deposit  = 1000000;      // 100.0000 EOS
+        uint32_t withdraws_day = 250;
+        int64_t  revenue_day   = 5000000;      // 500.0000 EOS a day from swap fees
+        uint16_t util_mean     = 6000;         // REX pool utilization, pips
+        uint16_t util_swing    = 1500;         // random walk step bound per day, pips
+    };
+
+    // periods between `start` and `end`, revenue spread evenly with some noise
+    inline void add_periods(stream &s, tools::rng &rng, const scenario &sc) {
+        int64_t  per_period = sc.revenue_day / (DAY / PERIOD);
+        int64_t  util       = sc.util_mean;
+        uint32_t first      = s.start - s.start % PERIOD + PERIOD;
+        for (uint32_t t = first; t < s.end; t += PERIOD) {
+            if (t % DAY == 0) {
+                util += int64_t(rng.range(0, 2 * sc.util_swing)) - sc.util_swing;
+                // drift back towards the mean
+                util += (int64_t(sc.util_mean) - util) / 8;
+                util = std::min<int64_t>(std::max<int64_t>(util, 0), 9999);
+            }
+            int64_t revenue = per_period > 0 ? int64_t(rng.range(0, uint64_t(2 * per_period))) : 0;
+            s.ops.push_back(op { t, op_kind::period, 0, revenue, uint16_t(util) });
+        }
+    }
+
+    inline void sort_ops(stream &s) {
+        // periods first within a second, as the keeper's income call lands before user actions
+        std::stable_sort(s.ops.begin(), s.ops.end(), [](const op &a, const op &b) {
+            if (a.time != b.time) return a.time < b.time;
+            return (a.kind == op_kind::period) > (b.kind == op_kind::period);
+        });
+    }
+
+    /**
+     * Random deposits and withdraws spread uniformly over `days`. Deposit sizes
+     * are log-uniform between 1/16 and 16 times `mean_deposit`, withdraws take
+     * 10%, half or all of the user's shares.
+     */
+    inline stream synthetic(const scenario &sc) {
+        tools::rng rng(sc.seed);
+        stream     s;
+        s.users = sc.users;
+        s.start = sc.start;
+        s.end   = sc.start + sc.days * DAY;
+
+        for (uint32_t day = 0; day < sc.days; day++) {
+            uint32_t base = sc.start + day * DAY;
+            for (uint32_t i = 0; i < sc.deposits_day; i++) {
+                int64_t amount = sc.mean_deposit / 16;
+                for (uint64_t k = rng.range(0, 8); k > 0; k--) amount *= 2;
+                amount += int64_t(rng.range(0, uint64_t(amount)));
+                s.ops.push_back(op { uint32_t(base + rng.range(0, DAY - 1)), op_kind::deposit,
+                                     uint32_t(rng.range(0, sc.users - 1)), amount, 0 });
+            }
+            for (uint32_t i = 0; i < sc.withdraws_day; i++) {
+                static constexpr int64_t fractions[] = { 1000, 5000, 10000, 10000 };
+                s.ops.push_back(op { uint32_t(base + rng.range(0, DAY - 1)), op_kind::withdraw,
+                                     uint32_t(rng.range(0, sc.users - 1)), fractions[rng.range(0, 3)], 0 });
+            }
+        }
+        add_periods(s, rng, sc);
+        sort_ops(s);
+        return s;
+    }
+
+    /**
+     * Deposits and withdraws of one collateral recorded in an action trace
+     * (`tools/indexer/trace.hpp`). Traces carry no revenue or REX pool data,
+     * those come from `sc` as for a synthetic stream. Returns an empty stream
+     * when the file cannot be read.
+     */
+    inline stream recorded(const std::string &path, uint64_t vault, uint64_t collateral_id,
+                           const scenario &sc) {
+        stream            s;
+        tools::mapped_file file(path);
+        if (!file.ok()) return s;
+
+        std::unordered_map<uint64_t, uint32_t> users;
+        std::vector<int64_t>                   shares;   // recorded balance, to turn withdraws into fractions
+        auto user = [&](uint64_t owner) {
+            auto it = users.emplace(owner, uint32_t(users.size())).first;
+            if (it->second == shares.size()) shares.push_back(0);
+            return it->second;
+        };
+
+        indexer::trace_reader  reader(file.data(), file.size());
+        indexer::action_trace  trace;
+        while (reader.next(trace)) {
+            if (trace.receiver != vault || trace.account != vault) continue;
+            uint32_t time = trace.block_time / 2 + BLOCK_EPOCH;
+            if (trace.name == indexer::depositlog::NAME) {
+                indexer::depositlog log;
+                if (!indexer::unpack(trace.data, trace.data_size, log) || log.collateral_id != collateral_id) {
+                    continue;
+                }
+                uint32_t u = user(log.owner);
+                shares[u] += int64_t(vault_math::issue_amount(log.quantity.amount, log.rate));
+                s.ops.push_back(op { time, op_kind::deposit, u, log.quantity.amount, 0 });
+            } else if (trace.name == indexer::releaselog::NAME) {
+                indexer::releaselog log;
+                if (!indexer::unpack(trace.data, trace.data_size, log) || log.collateral_id != collateral_id) {
+                    continue;
+                }
+                uint32_t u = user(log.owner);
+                if (shares[u] <= 0) continue;
+                int64_t pips = std::min<int64_t>(
+                    std::max<int64_t>(int64_t(vault_math::i128(log.quantity.amount) * 10000 / shares[u]), 1), 10000);
+                shares[u] -= std::min(shares[u], log.quantity.amount);
+                s.ops.push_back(op { time, op_kind::withdraw, u, pips, 0 });
+            }
+            if (s.start == 0) s.start = time;
+            s.end = std::max(s.end, time + 1);
+        }
+        if (s.ops.empty()) return s;
+
+        s.users = uint32_t(users.size());
+        tools::rng rng(sc.seed);
+        add_periods(s, rng, sc);
+        sort_ops(s);
+        return s;
+    }
+
+} // namespace sim
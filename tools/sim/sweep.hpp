@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "model.hpp"
+#include "stream.hpp"
+
+namespace sim {
+
+    // values tried for each parameter, every combination is simulated
+    struct grid {
+        std::vector<uint16_t> income_ratio  { 50 };
+        std::vector<uint16_t> release_fees  { 30 };
+        std::vector<uint16_t> refund_ratio  { 5000 };
+        std::vector<uint32_t> release_delay { 5 * DAY };
+        std::vector<uint16_t> rex_cutoff    { 85 };
+
+        std::vector<params> expand() const {
+            std::vector<params> out;
+            for (auto income : income_ratio)
+                for (auto fees : release_fees)
+                    for (auto refund : refund_ratio)
+                        for (auto delay : release_delay)
+                            for (auto cutoff : rex_cutoff) out.push_back(params { income, fees, refund, delay, cutoff });
+            return out;
+        }
+    };
+
+    /**
+     * Run every combination over the same stream. Workers take the next
+     * combination from a shared counter, results keep the order of `combos`
+     * whatever the thread count.
+     */
+    inline std::vector<result> sweep(const stream &s, const market &m, const std::vector<params> &combos,
+                                     unsigned threads) {
+        std::vector<result>      out(combos.size());
+        std::atomic<size_t>      next { 0 };
+        std::vector<std::thread> workers;
+        auto                     work = [&] {
+            for (size_t i = next++; i < combos.size(); i = next++) {
+                out[i] = vault_model(combos[i], m, s.users).run(s);
+            }
+        };
+        threads = std::max(1u, std::min<unsigned>(threads, unsigned(combos.size())));
+        for (unsigned t = 1; t < threads; t++) workers.emplace_back(work);
+        work();
+        for (auto &w : workers) w.join();
+        return out;
+    }
+
+} // namespace sim
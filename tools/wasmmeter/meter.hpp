@@ -0,0 +1,628 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <wasm.hpp>
+
+/**
+ * Instruction metering pass over a contract wasm (`yarn build:meter`).
+ *
+ * Every defined function gets a mutable i64 global that counts the
+ * instructions it executed. Bodies are split into straight runs at each
+ * block, loop, if, else, end and branch, and each run starts by adding its
+ * instruction count to the global, so the count is exact for any path that
+ * does not trap. The structural `block`, `loop`, `else` and `end` are not
+ * counted. `apply` is wrapped to zero the counters, run the contract and
+ * print a trailer, and calls to `eosio_exit` print it before exiting:
+ *
+ *     #instructions vault.defi {"212":4801,"388":97}
+ *
+ * keyed by the function index of the original module, whose name section
+ * `instrument` returns. The trailer is written from the 32 bytes under the
+ * stack pointer. The metered wasm is for the bench only: one global per
+ * function is far over the mutable global limit of nodeos.
+ */
+namespace wasm_meter {
+
+    struct reader {
+        const uint8_t *p;
+        const uint8_t *end;
+        bool           ok = true;
+
+        uint64_t u() {
+            uint64_t value = 0;
+            if (ok && !wasm_size::read_leb(p, end, value)) ok = false;
+            return ok ? value : 0;
+        }
+        uint8_t byte() {
+            if (!ok || p == end) {
+                ok = false;
+                return 0;
+            }
+            return *p++;
+        }
+        void skip(uint64_t n) {
+            if (!ok || n > uint64_t(end - p)) {
+                ok = false;
+                return;
+            }
+            p += n;
+        }
+        std::string str() {
+            uint64_t       n     = u();
+            const uint8_t *start = p;
+            skip(n);
+            return ok ? std::string(reinterpret_cast<const char *>(start), n) : std::string();
+        }
+    };
+
+    inline void put_u(std::vector<uint8_t> &out, uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            out.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    inline void put_s(std::vector<uint8_t> &out, int64_t value) {
+        for (;;) {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            bool done = (value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40));
+            out.push_back(done ? byte : byte | 0x80);
+            if (done) return;
+        }
+    }
+
+    inline void put_str(std::vector<uint8_t> &out, const std::string &s) {
+        put_u(out, s.size());
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    inline void put_section(std::vector<uint8_t> &out, uint8_t id, const std::vector<uint8_t> &payload) {
+        out.push_back(id);
+        put_u(out, payload.size());
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+
+    enum opcode : uint8_t {
+        BLOCK = 0x02, LOOP = 0x03, IF = 0x04, ELSE = 0x05, END = 0x0b, BR = 0x0c, BR_IF = 0x0d, BR_TABLE = 0x0e,
+        RETURN = 0x0f, CALL = 0x10, CALL_INDIRECT = 0x11, LOCAL_GET = 0x20, LOCAL_SET = 0x21, GLOBAL_GET = 0x23,
+        GLOBAL_SET = 0x24, I32_STORE8 = 0x3a, I32_CONST = 0x41, I64_CONST = 0x42, I32_EQZ = 0x45,
+        I64_EQZ = 0x50, I32_ADD = 0x6a, I32_SUB = 0x6b, I64_ADD = 0x7c, UNREACHABLE = 0x00,
+    };
+
+    // skips the immediates of `op`, false for an opcode outside the MVP and sign extension
+    inline bool skip_immediates(uint8_t op, reader &r) {
+        switch (op) {
+        case BLOCK:
+        case LOOP:
+        case IF:
+        case BR:
+        case BR_IF:
+        case CALL:
+        case I32_CONST:
+        case I64_CONST: r.u(); return true;
+        case BR_TABLE:
+            for (uint64_t n = r.u() + 1; n > 0 && r.ok; n--) r.u();
+            return true;
+        case CALL_INDIRECT:
+            r.u();
+            r.byte();
+            return true;
+        case 0x3f:
+        case 0x40: r.byte(); return true;
+        case 0x43: r.skip(4); return true;
+        case 0x44: r.skip(8); return true;
+        case 0xfc: return r.u() <= 7;   // saturating truncations
+        default: break;
+        }
+        if (op >= 0x20 && op <= 0x24) {
+            r.u();
+            return true;
+        }
+        if (op >= 0x28 && op <= 0x3e) {
+            r.u();
+            r.u();
+            return true;
+        }
+        return op <= 0x01 || op == ELSE || op == END || op == RETURN || op == 0x1a || op == 0x1b
+               || (op >= 0x45 && op <= 0xc4);
+    }
+
+    struct func_type {
+        std::vector<uint8_t> params;
+        std::vector<uint8_t> results;
+        bool operator==(const func_type &o) const { return params == o.params && results == o.results; }
+    };
+
+    struct result {
+        std::vector<uint8_t>            wasm;
+        std::map<uint32_t, std::string> names;       // function index of the original module, defined functions
+        uint32_t                        functions = 0;   // metered
+        std::string                     error;
+    };
+
+    namespace detail {
+
+        constexpr uint8_t I32 = 0x7f, I64 = 0x7e;
+
+        // the trailer text, written under the stack pointer; offsets of its pieces
+        inline const char trailer_text[] = "\n#instructions  {,\"\":}\n";
+        constexpr int32_t HEAD = 0, HEAD_LEN = 15, OPEN = 15, COMMA = 17, COLON = 19, CLOSE = 21;
+
+        struct body {
+            std::vector<uint8_t> code;
+
+            body &op(uint8_t o) {
+                code.push_back(o);
+                return *this;
+            }
+            body &op(uint8_t o, uint64_t immediate) {
+                code.push_back(o);
+                put_u(code, immediate);
+                return *this;
+            }
+            body &i32(int32_t v) {
+                code.push_back(I32_CONST);
+                put_s(code, v);
+                return *this;
+            }
+            body &i64(int64_t v) {
+                code.push_back(I64_CONST);
+                put_s(code, v);
+                return *this;
+            }
+            body &store8(uint32_t offset) {
+                code.push_back(I32_STORE8);
+                put_u(code, 0);
+                put_u(code, offset);
+                return *this;
+            }
+            // with `locals` i32 locals
+            std::vector<uint8_t> finish(uint32_t locals) const {
+                std::vector<uint8_t> out, inner;
+                if (locals) {
+                    put_u(inner, 1);
+                    put_u(inner, locals);
+                    inner.push_back(I32);
+                } else {
+                    put_u(inner, 0);
+                }
+                inner.insert(inner.end(), code.begin(), code.end());
+                inner.push_back(END);
+                put_u(out, inner.size());
+                out.insert(out.end(), inner.begin(), inner.end());
+                return out;
+            }
+        };
+
+        // names of the name section subsection `id`, by index
+        inline std::map<uint32_t, std::string> name_map(const uint8_t *p, const uint8_t *end, uint8_t id) {
+            std::map<uint32_t, std::string> names;
+            reader                          r { p, end };
+            r.str();   // "name"
+            while (r.ok && r.p < r.end) {
+                uint8_t        sub  = r.byte();
+                uint64_t       size = r.u();
+                const uint8_t *next = r.p;
+                r.skip(size);
+                if (!r.ok || sub != id) continue;
+                reader s { next, r.p };
+                for (uint64_t n = s.u(); n > 0 && s.ok; n--) {
+                    uint32_t index = uint32_t(s.u());
+                    names[index]   = s.str();
+                }
+            }
+            return names;
+        }
+
+    } // namespace detail
+
+    inline result instrument(const uint8_t *data, size_t size) {
+        using namespace detail;
+        result out;
+        auto   fail = [&](std::string error) {
+            out.error = std::move(error);
+            out.wasm.clear();
+            return out;
+        };
+
+        wasm_size::module_info info;
+        auto                   error = wasm_size::parse(data, size, info);
+        if (!error.empty()) return fail(error);
+
+        // the payloads by section id, custom sections besides the name section kept in order
+        std::map<uint8_t, std::pair<const uint8_t *, const uint8_t *>> sections;
+        std::vector<std::pair<const uint8_t *, const uint8_t *>>       customs;
+        std::pair<const uint8_t *, const uint8_t *>                    name_section { nullptr, nullptr };
+        {
+            reader r { data + 8, data + size };
+            while (r.ok && r.p < r.end) {
+                uint8_t        id      = r.byte();
+                uint64_t       length  = r.u();
+                const uint8_t *payload = r.p;
+                r.skip(length);
+                if (id != 0) {
+                    sections[id] = { payload, r.p };
+                } else if (reader { payload, r.p }.str() == "name") {
+                    name_section = { payload, r.p };
+                } else {
+                    customs.emplace_back(payload, r.p);
+                }
+            }
+        }
+        auto section = [&](uint8_t id) {
+            auto it = sections.find(id);
+            return it == sections.end() ? reader { nullptr, nullptr } : reader { it->second.first, it->second.second };
+        };
+
+        std::vector<func_type> types;
+        {
+            reader r = section(1);
+            for (uint64_t n = r.p ? r.u() : 0; n > 0 && r.ok; n--) {
+                func_type t;
+                if (r.byte() != 0x60) return fail("bad type section");
+                for (uint64_t k = r.u(); k > 0 && r.ok; k--) t.params.push_back(r.byte());
+                for (uint64_t k = r.u(); k > 0 && r.ok; k--) t.results.push_back(r.byte());
+                types.push_back(std::move(t));
+            }
+            if (!r.ok) return fail("bad type section");
+        }
+        auto type_of = [&](func_type t) {
+            for (size_t i = 0; i < types.size(); i++) {
+                if (types[i] == t) return uint32_t(i);
+            }
+            types.push_back(std::move(t));
+            return uint32_t(types.size() - 1);
+        };
+
+        // imports, the env functions the trailer calls by name
+        std::vector<uint8_t>            imports;
+        uint64_t                        import_count = 0;
+        uint32_t                        import_funcs = 0, import_globals = 0;
+        std::map<std::string, uint32_t> env;
+        {
+            reader r = section(2);
+            if (r.p) {
+                import_count = r.u();
+                const uint8_t *start = r.p;
+                for (uint64_t n = import_count; n > 0 && r.ok; n--) {
+                    auto    module = r.str();
+                    auto    field  = r.str();
+                    uint8_t kind   = r.byte();
+                    if (kind == 0) {
+                        r.u();
+                        if (module == "env") env[field] = import_funcs;
+                        import_funcs++;
+                    } else if (kind == 1) {
+                        r.byte();
+                        if (r.byte() & 1) r.u();
+                        r.u();
+                    } else if (kind == 2) {
+                        if (r.byte() & 1) r.u();
+                        r.u();
+                    } else if (kind == 3) {
+                        r.byte();
+                        r.byte();
+                        import_globals++;
+                    } else {
+                        r.ok = false;
+                    }
+                }
+                if (!r.ok) return fail("bad import section");
+                imports.assign(start, r.p);
+            }
+        }
+        const std::pair<const char *, func_type> needed[] = {
+            { "prints_l", { { I32, I32 }, {} } },
+            { "printui", { { I64 }, {} } },
+            { "printn", { { I64 }, {} } },
+            { "current_receiver", { {}, { I64 } } },
+        };
+        uint32_t added = 0;
+        for (const auto &[field, type] : needed) {
+            if (env.count(field)) continue;
+            put_str(imports, "env");
+            put_str(imports, field);
+            imports.push_back(0);
+            put_u(imports, type_of(type));
+            env[field] = import_funcs + added++;
+            import_count++;
+        }
+        const uint32_t shift     = added;
+        const uint32_t first_def = import_funcs + shift;   // index of the first defined function
+
+        std::vector<uint32_t> func_types;
+        {
+            reader r = section(3);
+            for (uint64_t n = r.p ? r.u() : 0; n > 0 && r.ok; n--) func_types.push_back(uint32_t(r.u()));
+            if (!r.ok) return fail("bad function section");
+        }
+        const uint32_t defined = uint32_t(func_types.size());
+        if (info.functions != defined) return fail("function and code sections differ");
+
+        // the counters follow the module's own globals
+        std::vector<uint8_t> globals;
+        uint32_t             global_count = 0;
+        bool                 global0_sp   = false;
+        {
+            reader r = section(6);
+            if (r.p) {
+                global_count         = uint32_t(r.u());
+                const uint8_t *start = r.p;
+                for (uint32_t g = 0; g < global_count && r.ok; g++) {
+                    uint8_t type = r.byte();
+                    uint8_t mut  = r.byte();
+                    if (g == 0 && import_globals == 0) global0_sp = type == I32 && mut == 1;
+                    for (uint8_t op = r.byte(); r.ok && op != END; op = r.byte()) {
+                        if (!skip_immediates(op, r)) r.ok = false;
+                    }
+                }
+                if (!r.ok) return fail("bad global section");
+                globals.assign(start, r.p);
+            }
+        }
+        const uint32_t first_counter = import_globals + global_count;
+        for (uint32_t f = 0; f < defined; f++) globals.insert(globals.end(), { I64, 1, I64_CONST, 0, END });
+
+        uint32_t stack_pointer = 0;
+        {
+            bool found = false;
+            if (name_section.first) {
+                for (const auto &[index, name] : name_map(name_section.first, name_section.second, 7)) {
+                    if (name == "__stack_pointer") {
+                        stack_pointer = index;
+                        found         = true;
+                    }
+                }
+                for (auto &[index, name] : name_map(name_section.first, name_section.second, 1)) {
+                    if (index >= import_funcs) out.names[index] = std::move(name);
+                }
+            }
+            if (!found && !global0_sp) return fail("no stack pointer global");
+        }
+
+        // the added functions: trailer, eosio_exit wrapper when imported, apply wrapper
+        const uint32_t trailer      = first_def + defined;
+        const bool     has_exit     = env.count("eosio_exit");
+        const uint32_t exit_wrapper = has_exit ? trailer + 1 : UINT32_MAX;
+        const uint32_t apply        = trailer + 1 + (has_exit ? 1 : 0);
+
+        auto remap = [&](uint64_t f, uint32_t exit_wrapper) -> uint64_t {
+            if (f >= import_funcs) return f + shift;
+            return has_exit && f == env["eosio_exit"] ? exit_wrapper : f;
+        };
+
+        // exports, `apply` goes through its wrapper
+        std::vector<uint8_t> exports;
+        uint32_t             original_apply = UINT32_MAX;
+        {
+            reader r = section(7);
+            uint64_t n = r.p ? r.u() : 0;
+            put_u(exports, n);
+            for (; n > 0 && r.ok; n--) {
+                auto     name  = r.str();
+                uint8_t  kind  = r.byte();
+                uint64_t index = r.u();
+                if (kind == 0 && name == "apply") {
+                    original_apply = uint32_t(index);
+                    index          = apply;
+                } else if (kind == 0) {
+                    index = remap(index, exit_wrapper);
+                }
+                put_str(exports, name);
+                exports.push_back(kind);
+                put_u(exports, index);
+            }
+            if (!r.ok) return fail("bad export section");
+            if (original_apply == UINT32_MAX || original_apply < import_funcs) return fail("no apply export");
+        }
+
+        std::vector<uint8_t> start;
+        if (sections.count(8)) {
+            reader r = section(8);
+            put_u(start, remap(r.u(), exit_wrapper));
+            if (!r.ok) return fail("bad start section");
+        }
+
+        std::vector<uint8_t> elements;
+        if (sections.count(9)) {
+            reader   r = section(9);
+            uint64_t n = r.u();
+            put_u(elements, n);
+            for (; n > 0 && r.ok; n--) {
+                if (r.u() != 0) return fail("unsupported element segment");
+                put_u(elements, 0);
+                const uint8_t *offset = r.p;
+                for (uint8_t op = r.byte(); r.ok && op != END; op = r.byte()) {
+                    if (!skip_immediates(op, r)) r.ok = false;
+                }
+                elements.insert(elements.end(), offset, r.p);
+                uint64_t count = r.u();
+                put_u(elements, count);
+                for (; count > 0 && r.ok; count--) put_u(elements, remap(r.u(), exit_wrapper));
+            }
+            if (!r.ok) return fail("bad element section");
+        }
+
+        // the bodies, each straight run led by the update of its counter
+        std::vector<uint8_t> code;
+        put_u(code, defined + 2 + (has_exit ? 1 : 0));
+        {
+            reader r = section(10);
+            r.u();
+            for (uint32_t f = 0; f < defined && r.ok; f++) {
+                uint64_t       length = r.u();
+                const uint8_t *end    = r.p + std::min<uint64_t>(length, uint64_t(r.end - r.p));
+                reader         b { r.p, end };
+                r.skip(length);
+                const uint8_t *locals = b.p;
+                for (uint64_t n = b.u(); n > 0 && b.ok; n--) {
+                    b.u();
+                    b.byte();
+                }
+                std::vector<uint8_t> body(locals, b.p), run;
+                uint64_t             count = 0;
+                const uint32_t       g     = first_counter + f;
+                auto flush = [&] {
+                    if (count) {
+                        body.push_back(GLOBAL_GET);
+                        put_u(body, g);
+                        body.push_back(I64_CONST);
+                        put_s(body, int64_t(count));
+                        body.push_back(I64_ADD);
+                        body.push_back(GLOBAL_SET);
+                        put_u(body, g);
+                    }
+                    body.insert(body.end(), run.begin(), run.end());
+                    run.clear();
+                    count = 0;
+                };
+                int depth = 1;
+                while (b.ok && depth > 0) {
+                    const uint8_t *at = b.p;
+                    uint8_t        op = b.byte();
+                    if (op == CALL) {
+                        run.push_back(CALL);
+                        put_u(run, remap(b.u(), exit_wrapper));
+                    } else {
+                        if (!skip_immediates(op, b)) return fail("unsupported opcode " + std::to_string(op));
+                        run.insert(run.end(), at, b.p);
+                    }
+                    if (op != BLOCK && op != LOOP && op != ELSE && op != END) count++;
+                    switch (op) {
+                    case BLOCK:
+                    case LOOP:
+                    case IF: depth++; flush(); break;
+                    case END: depth--; flush(); break;
+                    case ELSE:
+                    case BR:
+                    case BR_IF:
+                    case BR_TABLE:
+                    case RETURN:
+                    case UNREACHABLE: flush(); break;
+                    default: break;
+                    }
+                }
+                if (!b.ok || depth != 0 || b.p != end) return fail("bad body of function " + std::to_string(f));
+                put_u(code, body.size());
+                code.insert(code.end(), body.begin(), body.end());
+            }
+            if (!r.ok) return fail("bad code section");
+        }
+
+        // trailer: "\n#instructions " receiver " {" then `"index":count` of every counter that ran, "}\n"
+        {
+            body t;
+            t.op(GLOBAL_GET, stack_pointer).i32(32).op(I32_SUB).op(LOCAL_SET, 0);
+            for (size_t k = 0; k + 1 < sizeof(trailer_text); k++) {
+                t.op(LOCAL_GET, 0).i32(int32_t(uint8_t(trailer_text[k]))).store8(uint32_t(k));
+            }
+            auto print = [&](int32_t offset, int32_t length) {
+                t.op(LOCAL_GET, 0).i32(offset).op(I32_ADD).i32(length).op(CALL, env["prints_l"]);
+            };
+            t.i32(1).op(LOCAL_SET, 1);
+            print(HEAD, HEAD_LEN);
+            t.op(CALL, env["current_receiver"]).op(CALL, env["printn"]);
+            print(OPEN, 2);
+            for (uint32_t f = 0; f < defined; f++) {
+                const uint32_t g = first_counter + f;
+                t.op(GLOBAL_GET, g).op(I64_EQZ).op(I32_EQZ).op(IF, 0x40);
+                // `,"` or `"` for the first
+                t.op(LOCAL_GET, 0).i32(COMMA).op(I32_ADD).op(LOCAL_GET, 1).op(I32_ADD);
+                t.i32(2).op(LOCAL_GET, 1).op(I32_SUB).op(CALL, env["prints_l"]);
+                t.i64(import_funcs + f).op(CALL, env["printui"]);
+                print(COLON, 2);
+                t.op(GLOBAL_GET, g).op(CALL, env["printui"]);
+                t.i32(0).op(LOCAL_SET, 1);
+                t.op(END);
+            }
+            print(CLOSE, 2);
+            auto bytes = t.finish(2);
+            code.insert(code.end(), bytes.begin(), bytes.end());
+            func_types.push_back(type_of({ {}, {} }));
+        }
+        if (has_exit) {
+            body w;
+            w.op(CALL, trailer).op(LOCAL_GET, 0).op(CALL, env["eosio_exit"]);
+            auto bytes = w.finish(0);
+            code.insert(code.end(), bytes.begin(), bytes.end());
+            func_types.push_back(type_of({ { I32 }, {} }));
+        }
+        {
+            body a;
+            for (uint32_t f = 0; f < defined; f++) a.i64(0).op(GLOBAL_SET, first_counter + f);
+            a.op(LOCAL_GET, 0).op(LOCAL_GET, 1).op(LOCAL_GET, 2).op(CALL, original_apply + shift).op(CALL, trailer);
+            auto bytes = a.finish(0);
+            code.insert(code.end(), bytes.begin(), bytes.end());
+            func_types.push_back(type_of({ { I64, I64, I64 }, {} }));
+        }
+
+        // the module, sections in their order
+        std::vector<uint8_t> payload;
+        auto                 emit = [&](uint8_t id) {
+            std::vector<uint8_t> p;
+            switch (id) {
+            case 1:
+                put_u(p, types.size());
+                for (const auto &t : types) {
+                    p.push_back(0x60);
+                    put_u(p, t.params.size());
+                    p.insert(p.end(), t.params.begin(), t.params.end());
+                    put_u(p, t.results.size());
+                    p.insert(p.end(), t.results.begin(), t.results.end());
+                }
+                break;
+            case 2:
+                put_u(p, import_count);
+                p.insert(p.end(), imports.begin(), imports.end());
+                break;
+            case 3:
+                put_u(p, func_types.size());
+                for (auto t : func_types) put_u(p, t);
+                break;
+            case 6:
+                put_u(p, global_count + defined);
+                p.insert(p.end(), globals.begin(), globals.end());
+                break;
+            case 7: p = exports; break;
+            case 8: p = start; break;
+            case 9: p = elements; break;
+            case 10: p = code; break;
+            default:
+                if (!sections.count(id)) return;
+                p.assign(sections[id].first, sections[id].second);
+            }
+            if (id == 8 && start.empty()) return;
+            if (id == 9 && elements.empty()) return;
+            put_section(out.wasm, id, p);
+        };
+        out.wasm.assign(data, data + 8);
+        for (uint8_t id : { 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 10, 11 }) emit(id);
+        for (const auto &[begin, end] : customs) {
+            put_section(out.wasm, 0, std::vector<uint8_t>(begin, end));
+        }
+        out.functions = defined;
+        return out;
+    }
+
+    // `{"212":"vault::release_first<strategy::rex>(...)",...}`, the names the bench shows for trailer keys
+    inline std::string format_names(const std::map<uint32_t, std::string> &names) {
+        std::string out = "{";
+        for (const auto &[index, name] : names) {
+            if (out.size() > 1) out += ",\n";
+            out += "\"" + std::to_string(index) + "\":\"";
+            for (char c : name) {
+                if (c == '"' || c == '\\') out += '\\';
+                if (uint8_t(c) >= 0x20) out += c;
+            }
+            out += '"';
+        }
+        return out + "}\n";
+    }
+
+} // namespace wasm_meter
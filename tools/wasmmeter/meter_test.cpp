@@ -0,0 +1,364 @@
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+#include <eosio.hpp>
+
+#include "meter.hpp"
+
+using namespace wasm_meter;
+
+namespace {
+
+    // a module with `countdown(n)`, a loop of n rounds, and an `apply` that
+    // calls it or, for action 0, exits through `eosio_exit`
+    std::vector<uint8_t> test_module(bool names) {
+        std::vector<uint8_t> m { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+        auto                 section = [&](uint8_t id, std::vector<uint8_t> p) { put_section(m, id, p); };
+        auto                 str     = [](std::vector<uint8_t> &p, const std::string &s) { put_str(p, s); };
+
+        // (i64 i64 i64) (i32) -> i32, (i32), (i64)
+        section(1, { 4, 0x60, 3, 0x7e, 0x7e, 0x7e, 0, 0x60, 1, 0x7f, 1, 0x7f, 0x60, 1, 0x7f, 0, 0x60, 1, 0x7e, 0 });
+        std::vector<uint8_t> imports { 2 };
+        str(imports, "env");
+        str(imports, "printui");
+        imports.insert(imports.end(), { 0, 3 });
+        str(imports, "env");
+        str(imports, "eosio_exit");
+        imports.insert(imports.end(), { 0, 2 });
+        section(2, imports);
+        section(3, { 2, 1, 0 });
+        section(5, { 1, 0, 1 });
+        // the stack pointer
+        section(6, { 1, 0x7f, 1, I32_CONST, 0x80, 0x08, END });
+        std::vector<uint8_t> exports { 1 };
+        str(exports, "apply");
+        exports.insert(exports.end(), { 0, 3 });
+        section(7, exports);
+
+        std::vector<uint8_t> countdown {
+            0, BLOCK, 0x40, LOOP, 0x40, LOCAL_GET, 0, I32_EQZ, BR_IF, 1,
+            LOCAL_GET, 0, I32_CONST, 1, I32_SUB, LOCAL_SET, 0, BR, 0, END, END, LOCAL_GET, 0, END,
+        };
+        std::vector<uint8_t> apply {
+            0, LOCAL_GET, 2, I64_EQZ, IF, 0x40, I32_CONST, 7, CALL, 1, END,
+            I32_CONST, 3, CALL, 2, 0x1a, END,
+        };
+        std::vector<uint8_t> code { 2 };
+        put_u(code, countdown.size());
+        code.insert(code.end(), countdown.begin(), countdown.end());
+        put_u(code, apply.size());
+        code.insert(code.end(), apply.begin(), apply.end());
+        section(10, code);
+
+        if (names) {
+            std::vector<uint8_t> p, functions { 2, 2 }, globals { 1, 0 };
+            str(p, "name");
+            str(functions, "countdown");
+            functions.push_back(3);
+            str(functions, "apply");
+            str(globals, "__stack_pointer");
+            p.push_back(1);
+            put_u(p, functions.size());
+            p.insert(p.end(), functions.begin(), functions.end());
+            p.push_back(7);
+            put_u(p, globals.size());
+            p.insert(p.end(), globals.begin(), globals.end());
+            section(0, p);
+        }
+        return m;
+    }
+
+    struct exit_called {
+        int32_t code;
+    };
+
+    // runs the opcodes the test module and the metering pass use
+    class machine {
+      public:
+        std::string console;
+        uint64_t    receiver = tools::name_value("vault.defi");
+
+        explicit machine(const std::vector<uint8_t> &wasm) {
+            reader r { wasm.data() + 8, wasm.data() + wasm.size() };
+            while (r.ok && r.p < r.end) {
+                uint8_t        id  = r.byte();
+                uint64_t       len = r.u();
+                reader         s { r.p, r.p + len };
+                r.skip(len);
+                if (id == 1) {
+                    for (uint64_t n = s.u(); n > 0; n--) {
+                        s.byte();
+                        func_type t;
+                        for (uint64_t k = s.u(); k > 0; k--) t.params.push_back(s.byte());
+                        for (uint64_t k = s.u(); k > 0; k--) t.results.push_back(s.byte());
+                        _types.push_back(t);
+                    }
+                } else if (id == 2) {
+                    for (uint64_t n = s.u(); n > 0; n--) {
+                        s.str();
+                        auto field = s.str();
+                        s.byte();
+                        _funcs.push_back({ uint32_t(s.u()), field, nullptr, nullptr });
+                    }
+                } else if (id == 3) {
+                    for (uint64_t n = s.u(); n > 0; n--) _funcs.push_back({ uint32_t(s.u()), {}, nullptr, nullptr });
+                } else if (id == 5) {
+                    _memory.resize(65536);
+                } else if (id == 6) {
+                    for (uint64_t n = s.u(); n > 0; n--) {
+                        s.byte();
+                        s.byte();
+                        // the stack pointer of the test module, the counters start at zero
+                        uint8_t op = s.byte();
+                        skip_immediates(op, s);
+                        _globals.push_back(op == I32_CONST ? 1024 : 0);
+                        s.byte();
+                    }
+                } else if (id == 7) {
+                    for (uint64_t n = s.u(); n > 0; n--) {
+                        auto name = s.str();
+                        s.byte();
+                        _exports[name] = uint32_t(s.u());
+                    }
+                } else if (id == 10) {
+                    size_t f = 0;
+                    while (f < _funcs.size() && !_funcs[f].field.empty()) f++;
+                    for (uint64_t n = s.u(); n > 0; n--, f++) {
+                        uint64_t size = s.u();
+                        _funcs[f].body = s.p;
+                        _funcs[f].end  = s.p + size;
+                        s.skip(size);
+                    }
+                }
+            }
+        }
+
+        void apply(uint64_t action) { call(_exports.at("apply"), { receiver, receiver, action }); }
+
+      private:
+        struct function {
+            uint32_t       type;
+            std::string    field;   // imports
+            const uint8_t *body;
+            const uint8_t *end;
+        };
+        struct label {
+            bool           loop;
+            const uint8_t *start;   // after the block type
+            const uint8_t *end;     // after the matching end
+            size_t         height;
+        };
+
+        // the matching else (or nullptr) and end of the block whose body starts at `p`
+        std::pair<const uint8_t *, const uint8_t *> match(const uint8_t *p, const uint8_t *end) {
+            reader         r { p, end };
+            const uint8_t *else_at = nullptr;
+            for (int depth = 1; r.ok;) {
+                uint8_t op = r.byte();
+                skip_immediates(op, r);
+                if (op == BLOCK || op == LOOP || op == IF) depth++;
+                if (op == ELSE && depth == 1) else_at = r.p;
+                if (op == END && --depth == 0) return { else_at, r.p };
+            }
+            throw std::runtime_error("unmatched block");
+        }
+
+        std::vector<uint64_t> call(uint32_t f, std::vector<uint64_t> args) {
+            const auto &fn   = _funcs.at(f);
+            const auto &type = _types.at(fn.type);
+            if (!fn.field.empty()) return host(fn.field, args);
+
+            reader r { fn.body, fn.end };
+            for (uint64_t n = r.u(); n > 0; n--) {
+                args.resize(args.size() + r.u(), 0);
+                r.byte();
+            }
+            std::vector<uint64_t> stack;
+            std::vector<label>    labels { { false, r.p, fn.end, 0 } };
+            auto pop = [&] {
+                uint64_t v = stack.back();
+                stack.pop_back();
+                return v;
+            };
+            auto branch = [&](uint64_t depth) {
+                label l = labels[labels.size() - 1 - depth];
+                labels.resize(labels.size() - depth - (l.loop ? 0 : 1));
+                stack.resize(l.height);
+                r.p = l.loop ? l.start : l.end;
+            };
+            while (!labels.empty()) {
+                uint8_t op = r.byte();
+                switch (op) {
+                case BLOCK:
+                case LOOP:
+                case IF: {
+                    r.byte();
+                    auto [else_at, end] = match(r.p, fn.end);
+                    if (op == IF && pop() == 0) {
+                        if (!else_at) {
+                            r.p = end;
+                            break;
+                        }
+                        r.p = else_at;
+                    }
+                    labels.push_back({ op == LOOP, r.p, end, stack.size() });
+                    break;
+                }
+                case ELSE: r.p = labels.back().end; labels.pop_back(); break;
+                case END: labels.pop_back(); break;
+                case BR: branch(r.u()); break;
+                case BR_IF: {
+                    uint64_t depth = r.u();
+                    if (pop()) branch(depth);
+                    break;
+                }
+                case RETURN: labels.clear(); break;
+                case CALL: {
+                    uint32_t              callee = uint32_t(r.u());
+                    std::vector<uint64_t> in(_types.at(_funcs.at(callee).type).params.size());
+                    for (size_t i = in.size(); i > 0; i--) in[i - 1] = pop();
+                    for (auto v : call(callee, in)) stack.push_back(v);
+                    break;
+                }
+                case 0x1a: pop(); break;
+                case LOCAL_GET: stack.push_back(args.at(r.u())); break;
+                case LOCAL_SET: args.at(r.u()) = pop(); break;
+                case GLOBAL_GET: stack.push_back(_globals.at(r.u())); break;
+                case GLOBAL_SET: _globals.at(r.u()) = pop(); break;
+                case I32_STORE8: {
+                    r.u();
+                    uint64_t offset = r.u();
+                    uint8_t  value  = uint8_t(pop());
+                    _memory.at(uint32_t(pop()) + offset) = value;
+                    break;
+                }
+                case I32_CONST:
+                case I64_CONST: {
+                    // small constants only, enough for the test module and the pass
+                    const uint8_t *at = r.p;
+                    r.u();
+                    int64_t v = 0;
+                    int     shift = 0;
+                    for (; at < r.p; at++, shift += 7) v |= int64_t(*at & 0x7f) << shift;
+                    if (shift < 64 && (r.p[-1] & 0x40)) v |= -(int64_t(1) << shift);
+                    stack.push_back(op == I32_CONST ? uint32_t(v) : uint64_t(v));
+                    break;
+                }
+                case I32_EQZ: stack.push_back(uint32_t(pop()) == 0); break;
+                case I64_EQZ: stack.push_back(pop() == 0); break;
+                case I32_ADD: {
+                    uint32_t b = uint32_t(pop());
+                    stack.push_back(uint32_t(uint32_t(pop()) + b));
+                    break;
+                }
+                case I32_SUB: {
+                    uint32_t b = uint32_t(pop());
+                    stack.push_back(uint32_t(uint32_t(pop()) - b));
+                    break;
+                }
+                case I64_ADD: {
+                    uint64_t b = pop();
+                    stack.push_back(pop() + b);
+                    break;
+                }
+                default: throw std::runtime_error("opcode " + std::to_string(op));
+                }
+            }
+            return std::vector<uint64_t>(stack.end() - long(type.results.size()), stack.end());
+        }
+
+        std::vector<uint64_t> host(const std::string &field, const std::vector<uint64_t> &args) {
+            if (field == "prints_l") {
+                console.append(reinterpret_cast<const char *>(&_memory.at(uint32_t(args[0]))), uint32_t(args[1]));
+            } else if (field == "printui") {
+                console += std::to_string(args[0]);
+            } else if (field == "printn") {
+                console += tools::name_string(args[0]);
+            } else if (field == "current_receiver") {
+                return { receiver };
+            } else if (field == "eosio_exit") {
+                throw exit_called { int32_t(args[0]) };
+            }
+            return {};
+        }
+
+        std::vector<func_type>           _types;
+        std::vector<function>            _funcs;
+        std::vector<uint64_t>            _globals;
+        std::vector<uint8_t>             _memory;
+        std::map<std::string, uint32_t>  _exports;
+    };
+
+    void test_counts() {
+        auto wasm = test_module(true);
+        auto r    = instrument(wasm.data(), wasm.size());
+        CHECK(r.error.empty() && r.functions == 2);
+        CHECK(r.names.size() == 2 && r.names[2] == "countdown" && r.names[3] == "apply");
+        CHECK(format_names(r.names) == "{\"2\":\"countdown\",\n\"3\":\"apply\"}\n");
+        wasm_size::module_info info;
+        CHECK(wasm_size::parse(r.wasm.data(), r.wasm.size(), info).empty());
+        // the name section is dropped, the trailer, the exit and apply wrappers added
+        CHECK(info.functions == 5 && info.custom_bytes == 0);
+        if (!r.error.empty()) return;
+
+        // countdown(3): 4 checks of 3 instructions, 3 rounds of 5, the return;
+        // apply: the test of the action, the call and the drop
+        machine m(r.wasm);
+        m.apply(1);
+        CHECK(m.console == "\n#instructions vault.defi {\"2\":28,\"3\":6}\n");
+
+        // the counters start from zero in every action
+        m.console.clear();
+        m.apply(1);
+        CHECK(m.console == "\n#instructions vault.defi {\"2\":28,\"3\":6}\n");
+
+        // the trailer is printed before `eosio_exit`, once
+        machine exit(r.wasm);
+        bool    exited = false;
+        try {
+            exit.apply(0);
+        } catch (const exit_called &e) {
+            exited = e.code == 7;
+        }
+        CHECK(exited && exit.console == "\n#instructions vault.defi {\"3\":5}\n");
+    }
+
+    void test_modules() {
+        // without a name section global 0 is the stack pointer
+        auto wasm = test_module(false);
+        auto r    = instrument(wasm.data(), wasm.size());
+        CHECK(r.error.empty() && r.names.empty());
+        if (r.error.empty()) {
+            machine m(r.wasm);
+            m.apply(2);
+            CHECK(m.console == "\n#instructions vault.defi {\"2\":28,\"3\":6}\n");
+        }
+
+        // a metered module is a valid input of the pass
+        auto again = instrument(r.wasm.data(), r.wasm.size());
+        CHECK(again.error.empty() && again.functions == 5);
+
+        std::vector<uint8_t> text { 'n', 'o', 't', ' ', 'w', 'a', 's', 'm' };
+        CHECK(instrument(text.data(), text.size()).error == "not a wasm module");
+        // an opcode of a later proposal
+        auto simd = test_module(false);
+        for (size_t i = simd.size(); i-- > 0;) {
+            if (simd[i] == 0x1a) {
+                simd[i] = 0xfd;
+                break;
+            }
+        }
+        CHECK(instrument(simd.data(), simd.size()).error == "unsupported opcode 253");
+    }
+
+} // namespace
+
+int main() {
+    test_counts();
+    test_modules();
+    return tools::check_report("meter_test");
+}
@@ -0,0 +1,37 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <mapped_file.hpp>
+
+#include "meter.hpp"
+
+using namespace wasm_meter;
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::fprintf(stderr, "usage: wasm_meter IN.wasm OUT.wasm NAMES.json\n"
+                             "  writes IN with a counter of executed instructions per function, printed by\n"
+                             "  every action as a #instructions trailer, and the function names of the keys;\n"
+                             "  OUT may be IN\n");
+        return EXIT_FAILURE;
+    }
+    result r;
+    {
+        tools::mapped_file file(argv[1]);
+        if (!file.ok()) {
+            std::fprintf(stderr, "wasm_meter: cannot map %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        r = instrument(reinterpret_cast<const uint8_t *>(file.data()), file.size());
+    }
+    if (!r.error.empty()) {
+        std::fprintf(stderr, "wasm_meter: %s: %s\n", argv[1], r.error.c_str());
+        return EXIT_FAILURE;
+    }
+    std::ofstream(argv[2], std::ios::binary).write(reinterpret_cast<const char *>(r.wasm.data()), std::streamsize(r.wasm.size()));
+    std::ofstream(argv[3]) << format_names(r.names);
+    std::printf("%s: %u functions metered, %zu named, %zu bytes\n", argv[2], r.functions, r.names.size(), r.wasm.size());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <json.hpp>
+
+/**
+ * Section sizes of a WASM module and the budget they are checked against.
+ *
+ * Only the section headers, and the element counts of the function, code and
+ * data sections, are read. That is all the size report needs: nodeos
+ * instantiation and recompilation cost grows with the code section and the
+ * function count, and the data section is copied into memory on every
+ * instantiation.
+ */
+namespace wasm_size {
+
+    struct section {
+        uint8_t     id;
+        std::string name;
+        uint64_t    size; // payload bytes, without the id and size header
+    };
+
+    struct module_info {
+        std::vector<section> sections;
+        uint64_t             total         = 0;
+        uint64_t             functions     = 0; // entries of the code section
+        uint64_t             data_segments = 0;
+        uint64_t             code_bytes    = 0;
+        uint64_t             data_bytes    = 0;
+        uint64_t             custom_bytes  = 0; // names, producers and other custom sections
+    };
+
+    inline const char *section_name(uint8_t id) {
+        static const char *const names[] = { "custom",   "type",  "import", "function", "table",
+                                             "memory",   "global", "export", "start",    "element",
+                                             "code",     "data",  "datacount" };
+        return id < sizeof(names) / sizeof(names[0]) ? names[id] : "unknown";
+    }
+
+    inline bool read_leb(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) return false;
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // empty on success, otherwise what is wrong with the module
+    inline std::string parse(const uint8_t *data, size_t size, module_info &out) {
+        static const uint8_t header[] = { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+        out = module_info {};
+        if (size < sizeof(header) || !std::equal(header, header + sizeof(header), data)) {
+            return "not a wasm module";
+        }
+        out.total        = size;
+        const uint8_t *p = data + sizeof(header), *end = data + size;
+        while (p < end) {
+            uint8_t  id = *p++;
+            uint64_t length;
+            if (!read_leb(p, end, length) || length > uint64_t(end - p)) {
+                return "truncated section " + std::to_string(out.sections.size());
+            }
+            const uint8_t *payload = p;
+            p += length;
+
+            section s { id, section_name(id), length };
+            if (id == 0) {
+                uint64_t name_length;
+                if (!read_leb(payload, p, name_length) || name_length > uint64_t(p - payload)) {
+                    return "bad custom section name";
+                }
+                s.name = "custom:" + std::string(reinterpret_cast<const char *>(payload), name_length);
+                out.custom_bytes += length;
+            } else if (id == 10 || id == 11) {
+                uint64_t count;
+                if (!read_leb(payload, p, count)) return std::string("bad ") + s.name + " section";
+                if (id == 10) {
+                    out.functions  = count;
+                    out.code_bytes = length;
+                } else {
+                    out.data_segments = count;
+                    out.data_bytes    = length;
+                }
+            }
+            out.sections.push_back(std::move(s));
+        }
+        return {};
+    }
+
+    // limits of one module, a zero field is not checked
+    struct budget {
+        uint64_t total     = 0;
+        uint64_t code      = 0;
+        uint64_t data      = 0;
+        uint64_t functions = 0;
+    };
+
+    using budgets = std::map<std::string, budget>;
+
+    inline budget measured(const module_info &m) {
+        return budget { m.total, m.code_bytes, m.data_bytes, m.functions };
+    }
+
+    // `{"vault": {"total": 1, "code": 2, "data": 3, "functions": 4}, ...}`
+    inline bool parse_budgets(std::string_view text, budgets &out) {
+        out.clear();
+        bool numbers = true;
+        bool objects = tools::json::for_each_member(text, [&](std::string_view name, std::string_view value) {
+            budget b;
+            bool fields = tools::json::for_each_member(value, [&](std::string_view key, std::string_view raw) {
+                uint64_t v = 0;
+                if (!tools::json::to_uint(raw, v)) numbers = false;
+                if (key == "total") b.total = v;
+                else if (key == "code") b.code = v;
+                else if (key == "data") b.data = v;
+                else if (key == "functions") b.functions = v;
+            });
+            if (!fields) numbers = false;
+            out[std::string(name)] = b;
+        });
+        return objects && numbers;
+    }
+
+    inline std::string format_budgets(const budgets &all) {
+        std::string out = "{\n";
+        for (auto it = all.begin(); it != all.end(); it++) {
+            const auto &b = it->second;
+            out += "  \"" + it->first + "\": { \"total\": " + std::to_string(b.total)
+                   + ", \"code\": " + std::to_string(b.code) + ", \"data\": " + std::to_string(b.data)
+                   + ", \"functions\": " + std::to_string(b.functions) + " }";
+            out += std::next(it) == all.end() ? "\n" : ",\n";
+        }
+        return out + "}\n";
+    }
+
+    // one line per exceeded limit, empty when within budget
+    inline std::vector<std::string> over_budget(const std::string &name, const budget &limit, const budget &m) {
+        std::vector<std::string> errors;
+        auto check = [&](const char *field, uint64_t value, uint64_t max) {
+            if (max > 0 && value > max) {
+                errors.push_back(name + ": " + field + " " + std::to_string(value) + " > "
+                                 + std::to_string(max));
+            }
+        };
+        check("total", m.total, limit.total);
+        check("code", m.code, limit.code);
+        check("data", m.data, limit.data);
+        check("functions", m.functions, limit.functions);
+        return errors;
+    }
+
+} // namespace wasm_size
@@ -0,0 +1,105 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mapped_file.hpp>
+
+#include "wasm.hpp"
+
+using namespace wasm_size;
+
+namespace {
+
+    void usage() {
+        std::fprintf(stderr, "usage: wasm_size [--budget FILE [--update]] NAME=FILE.wasm...\n"
+                             "  prints the section sizes of each module, exits with 1 when one is\n"
+                             "  over its budget; one without an entry is only reported; --update\n"
+                             "  writes the measured sizes as the new budget\n");
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string                                      budget_path;
+    bool                                             update = false;
+    std::vector<std::pair<std::string, std::string>> modules;
+
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--budget") && i + 1 < argc) {
+            budget_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--update")) {
+            update = true;
+        } else if (argv[i][0] != '-' && std::strchr(argv[i], '=')) {
+            const char *eq = std::strchr(argv[i], '=');
+            modules.emplace_back(std::string(argv[i], size_t(eq - argv[i])), std::string(eq + 1));
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (modules.empty() || (update && budget_path.empty())) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    budgets limits;
+    if (!budget_path.empty()) {
+        tools::mapped_file file(budget_path);
+        if (file.ok() && !parse_budgets(std::string_view(file.data(), file.size()), limits)) {
+            std::fprintf(stderr, "wasm_size: %s is not a budget file\n", budget_path.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    budgets                  measurements;
+    std::vector<std::string> errors;
+    std::vector<std::string> missing;
+    for (const auto &[name, path] : modules) {
+        tools::mapped_file file(path);
+        if (!file.ok()) {
+            std::fprintf(stderr, "wasm_size: cannot map %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+        module_info m;
+        std::string error = parse(reinterpret_cast<const uint8_t *>(file.data()), file.size(), m);
+        if (!error.empty()) {
+            std::fprintf(stderr, "wasm_size: %s: %s\n", path.c_str(), error.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::printf("%s: %" PRIu64 " bytes, %" PRIu64 " functions, %" PRIu64 " data segments\n", name.c_str(),
+                    m.total, m.functions, m.data_segments);
+        for (const auto &s : m.sections) {
+            std::printf("  %-24s %10" PRIu64 "\n", s.name.c_str(), s.size);
+        }
+
+        measurements[name] = measured(m);
+        auto limit         = limits.find(name);
+        if (limit == limits.end()) {
+            // a module without an entry would never be checked
+            if (!budget_path.empty() && !update) missing.push_back(name);
+        } else {
+            auto over = over_budget(name, limit->second, measurements[name]);
+            errors.insert(errors.end(), over.begin(), over.end());
+        }
+    }
+
+    if (update) {
+        for (const auto &[name, b] : measurements) limits[name] = b;
+        std::ofstream(budget_path) << format_budgets(limits);
+        std::printf("budget written to %s\n", budget_path.c_str());
+        return EXIT_SUCCESS;
+    }
+    for (const auto &e : errors) {
+        std::printf("OVER BUDGET %s\n", e.c_str());
+    }
+    for (const auto &name : missing) {
+        std::printf("NO BUDGET %s, record it with --update\n", name.c_str());
+    }
+    return errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <check.hpp>
+
+#include "wasm.hpp"
+
+using namespace wasm_size;
+
+namespace {
+
+    struct bytes {
+        std::vector<uint8_t> out { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+
+        static void leb(std::vector<uint8_t> &to, uint64_t value) {
+            do {
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                to.push_back(value ? byte | 0x80 : byte);
+            } while (value);
+        }
+        bytes &section(uint8_t id, const std::vector<uint8_t> &payload) {
+            out.push_back(id);
+            leb(out, payload.size());
+            out.insert(out.end(), payload.begin(), payload.end());
+            return *this;
+        }
+        // a section starting with an element count, padded to `size` bytes
+        bytes &counted(uint8_t id, uint64_t count, size_t size) {
+            std::vector<uint8_t> payload;
+            leb(payload, count);
+            payload.resize(size);
+            return section(id, payload);
+        }
+        bytes &custom(const std::string &name, size_t size) {
+            std::vector<uint8_t> payload;
+            leb(payload, name.size());
+            payload.insert(payload.end(), name.begin(), name.end());
+            payload.resize(size);
+            return section(0, payload);
+        }
+        std::string parse(module_info &m) const { return wasm_size::parse(out.data(), out.size(), m); }
+    };
+
+    void test_sections() {
+        bytes b;
+        b.counted(1, 3, 10).counted(3, 200, 201).counted(10, 200, 300).counted(11, 2, 150).custom("name", 40);
+        module_info m;
+        CHECK(b.parse(m).empty());
+        CHECK(m.total == b.out.size());
+        CHECK(m.sections.size() == 5);
+        CHECK(m.sections[0].name == "type" && m.sections[0].size == 10);
+        CHECK(m.sections[2].name == "code" && m.sections[2].size == 300);
+        CHECK(m.sections[4].name == "custom:name" && m.sections[4].size == 40);
+        CHECK(m.functions == 200);
+        CHECK(m.code_bytes == 300);
+        CHECK(m.data_segments == 2);
+        CHECK(m.data_bytes == 150);
+        CHECK(m.custom_bytes == 40);
+
+        // multi-byte section sizes
+        bytes large;
+        large.counted(10, 1000, 70000);
+        CHECK(large.parse(m).empty());
+        CHECK(m.code_bytes == 70000 && m.functions == 1000);
+
+        // header only
+        CHECK(bytes().parse(m).empty() && m.sections.empty() && m.total == 8);
+    }
+
+    void test_malformed() {
+        module_info m;
+        std::vector<uint8_t> text { 'n', 'o', 't', ' ', 'w', 'a', 's', 'm' };
+        CHECK(parse(text.data(), text.size(), m) == "not a wasm module");
+        CHECK(parse(text.data(), 3, m) == "not a wasm module");
+
+        bytes past_end;
+        past_end.counted(10, 1, 20);
+        past_end.out.resize(past_end.out.size() - 1);
+        CHECK(past_end.parse(m) == "truncated section 0");
+
+        bytes no_size;
+        no_size.counted(1, 1, 4).out.push_back(10);
+        CHECK(no_size.parse(m) == "truncated section 1");
+
+        bytes bad_name;
+        bad_name.section(0, { 9, 'a' });
+        CHECK(bad_name.parse(m) == "bad custom section name");
+
+        bytes empty_code;
+        empty_code.section(10, {});
+        CHECK(empty_code.parse(m) == "bad code section");
+    }
+
+    void test_budget() {
+        budgets b;
+        CHECK(parse_budgets("{}", b) && b.empty());
+        CHECK(parse_budgets(R"({"vault": {"total": 100, "code": "60", "data": 20, "functions": 7}, "stoken": {}})", b));
+        CHECK(b.size() == 2);
+        CHECK(b["vault"].total == 100 && b["vault"].code == 60 && b["vault"].data == 20 && b["vault"].functions == 7);
+        CHECK(b["stoken"].total == 0);
+        CHECK(!parse_budgets(R"({"vault": {"total": -1}})", b));
+        CHECK(!parse_budgets(R"({"vault": 1})", b));
+        CHECK(!parse_budgets("[]", b));
+
+        // round trip
+        budgets written { { "stoken", { 10, 5, 2, 3 } }, { "vault", { 100, 60, 20, 7 } } };
+        budgets read;
+        CHECK(parse_budgets(format_budgets(written), read));
+        CHECK(read.size() == 2 && read["vault"].code == 60 && read["stoken"].functions == 3);
+
+        budget limit { 100, 60, 20, 7 };
+        CHECK(over_budget("vault", limit, { 100, 60, 20, 7 }).empty());
+        auto over = over_budget("vault", limit, { 101, 60, 21, 7 });
+        CHECK(over.size() == 2);
+        CHECK(over.size() == 2 && over[0] == "vault: total 101 > 100" && over[1] == "vault: data 21 > 20");
+        // zero limits are not checked
+        CHECK(over_budget("vault", { 0, 0, 0, 7 }, { 1000, 1000, 1000, 7 }).empty());
+    }
+
+} // namespace
+
+int main() {
+    test_sections();
+    test_malformed();
+    test_budget();
+    return tools::check_report("wasm_test");
+}